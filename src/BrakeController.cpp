@@ -0,0 +1,167 @@
+/** @file BrakeController.cpp
+ *  This file contains the BrakeController class, which sets the duty cycle of the BRAKE
+ *  pin so the motor slows down at a commanded rate.
+*/
+
+#include <math.h>
+#include "BrakeController.h"
+
+
+
+/** @brief Constructor for the BrakeController class
+ *
+ *  @param decel_ The commanded deceleration in RPM/s.
+ *  @param kp_ The proportional gain in duty per RPM/s of deceleration error.
+ *  @param ki_ The integral gain in duty per RPM of accumulated error.
+ *  @param taper_ The time constant in seconds of the approach to the target. The
+ *  commanded deceleration is reduced to the speed error divided by this time, so the
+ *  speed eases onto the target instead of braking hard right up to it.
+ */
+BrakeController::BrakeController(float decel_, float kp_, float ki_, float taper_)
+{
+    set_decel(decel_);
+    set_gains(kp_, ki_);
+    taper = (taper_ > 0.0f) ? taper_ : 0.1f;
+    alpha = 0.3f;
+
+    integral = 0.0f;
+    duty = 0.0f;
+    decel_est = 0.0f;
+    last_rpm = 0.0f;
+    last_us = 0;
+
+    active = false;
+    start_us = 0;
+    start_rpm = 0.0f;
+    target_rpm = 0.0f;
+    overshoot = 0.0f;
+    settle_ms = 0;
+}
+
+
+
+/** @brief A function which changes the commanded deceleration
+ *
+ *  @param decel_ The commanded deceleration in RPM/s.
+ */
+void BrakeController::set_decel(float decel_)
+{
+    decel_cmd = (decel_ > 0.0f) ? decel_ : 1000.0f;
+}
+
+
+
+/** @brief A function which changes the PI gains
+ *
+ *  @param kp_ The proportional gain in duty per RPM/s of deceleration error.
+ *  @param ki_ The integral gain in duty per RPM of accumulated error.
+ */
+void BrakeController::set_gains(float kp_, float ki_)
+{
+    kp = kp_;
+    ki = ki_;
+}
+
+
+
+/** @brief A function which starts a braking maneuver
+ *
+ *  @details Without a direction change the motor slows to the command; with one it slows
+ *  to zero. The first duty cycle is full brake, since there is no deceleration estimate yet.
+ *
+ *  @param now_us The current time in microseconds.
+ *  @param speed The measured speed.
+ *  @param command The commanded speed.
+ *
+ *  @return The duty cycle to apply, 0 to 1.
+ */
+float BrakeController::start(uint64_t now_us, rpm_t speed, rpm_t command)
+{
+    bool same_sign = (speed >= 0) == (command >= 0);
+
+    active = true;
+    start_us = now_us;
+    start_rpm = rpm_to_float(rpm_abs(speed));
+    target_rpm = same_sign ? rpm_to_float(rpm_abs(command)) : 0.0f;
+    overshoot = 0.0f;
+
+    last_rpm = start_rpm;
+    last_us = now_us;
+    decel_est = 0.0f;
+    integral = 1.0f;
+    duty = 1.0f;
+    return duty;
+}
+
+
+
+/** @brief A function which updates the duty cycle from a new speed measurement
+ *
+ *  @details The deceleration is the drop in speed magnitude divided by the time since the
+ *  previous measurement, smoothed with a first order filter. The deceleration commanded at
+ *  this speed is the smaller of the set deceleration and the remaining speed error divided
+ *  by the taper time. The integral is limited to the duty range so it cannot wind up.
+ *
+ *  @param now_us The time of the measurement in microseconds.
+ *  @param speed The measured speed.
+ *
+ *  @return The duty cycle to apply, 0 to 1.
+ */
+float BrakeController::update(uint64_t now_us, rpm_t speed)
+{
+    if (!active)
+    {
+        return 0.0f;
+    }
+
+    float rpm = rpm_to_float(rpm_abs(speed));
+    if (target_rpm - rpm > overshoot)
+    {
+        overshoot = target_rpm - rpm;
+    }
+
+    // a measurement older than the last one is ignored rather than wrapped into a huge dt
+    float dt = (float)(int64_t)(now_us - last_us) * 1.0e-6f;
+    if (dt <= 0.0f)
+    {
+        return duty;
+    }
+    float measured = (last_rpm - rpm) / dt;
+    decel_est += alpha * (measured - decel_est);
+    last_rpm = rpm;
+    last_us = now_us;
+
+    float remaining = rpm - target_rpm;
+    float wanted = remaining / taper;
+    if (wanted > decel_cmd) wanted = decel_cmd;
+    if (wanted < 0.0f) wanted = 0.0f;
+
+    float error = wanted - decel_est;
+    integral += ki * error * dt;
+    if (integral > 1.0f) integral = 1.0f;
+    if (integral < 0.0f) integral = 0.0f;
+
+    duty = integral + kp * error;
+    if (duty > 1.0f) duty = 1.0f;
+    if (duty < 0.0f) duty = 0.0f;
+    return duty;
+}
+
+
+
+/** @brief A function which ends a braking maneuver and records how it went
+ *
+ *  @param now_us The current time in microseconds.
+ *  @param speed The measured speed.
+ */
+void BrakeController::finish(uint64_t now_us, rpm_t speed)
+{
+    if (!active)
+    {
+        return;
+    }
+    update(now_us, speed);
+    active = false;
+    duty = 0.0f;
+    settle_ms = (uint32_t)((now_us - start_us) / 1000u);
+}
@@ -0,0 +1,109 @@
+/** @file BrakeController.h
+ *  This file contains the BrakeController class, which sets the duty cycle of the BRAKE
+ *  pin so the motor slows down at a commanded rate instead of as fast as the brake allows.
+ *  The deceleration is estimated from successive speed measurements and a PI controller
+ *  on the deceleration error sets the duty cycle. The class also measures how long each
+ *  braking maneuver took and how far the speed fell past its target.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _BRAKECONTROLLER_H_
+#define _BRAKECONTROLLER_H_
+
+#include <stdint.h>
+#include "SpeedType.h"
+
+/** This class is used to modulate the brake to track a commanded deceleration */
+class BrakeController
+{
+    protected:
+
+        float decel_cmd;            // commanded deceleration in RPM/s
+        float taper;                // time constant of the approach to the target in s
+        float kp;                   // proportional gain, duty per RPM/s of error
+        float ki;                   // integral gain, duty per RPM of error
+        float alpha;                // smoothing factor of the deceleration estimate
+
+        float integral;             // integral term of the PI controller
+        float duty;                 // latest duty cycle, 0 to 1
+        float decel_est;            // smoothed measured deceleration in RPM/s
+        float last_rpm;             // speed magnitude at the previous update
+        uint64_t last_us;           // time of the previous update
+
+        bool active;                // true during a maneuver
+        uint64_t start_us;          // time the maneuver started
+        float start_rpm;            // speed magnitude when the maneuver started
+        float target_rpm;           // speed magnitude the maneuver slows down to
+        float overshoot;            // largest drop of the speed below the target
+        uint32_t settle_ms;         // length of the last maneuver
+
+    public:
+
+        /** Non-inline functions are commented in BrakeController.cpp */
+        BrakeController(float decel_ = 1000.0f, float kp_ = 0.0005f, float ki_ = 0.004f,
+                        float taper_ = 0.1f);
+
+        void set_decel(float decel_);
+        void set_gains(float kp_, float ki_);
+        float start(uint64_t now_us, rpm_t speed, rpm_t command);
+        float update(uint64_t now_us, rpm_t speed);
+        void finish(uint64_t now_us, rpm_t speed);
+
+
+
+        /** @brief A function which reports whether a maneuver is in progress
+         *
+         *  @return True between start() and finish().
+         */
+        bool is_active(void)
+        {
+            return active;
+        }
+
+
+
+        /** @brief A function which returns the length of the last maneuver
+         *
+         *  @return The time from start() to finish() in milliseconds.
+         */
+        uint32_t get_settle_ms(void)
+        {
+            return settle_ms;
+        }
+
+
+
+        /** @brief A function which returns how far the last maneuver undershot its target
+         *
+         *  @return The largest drop of the speed below the target in RPM.
+         */
+        float get_overshoot(void)
+        {
+            return overshoot;
+        }
+
+
+
+        /** @brief A function which returns the speed the last maneuver started from
+         *
+         *  @return The speed magnitude in RPM.
+         */
+        float get_start_rpm(void)
+        {
+            return start_rpm;
+        }
+
+
+
+        /** @brief A function which returns the speed the last maneuver slowed down to
+         *
+         *  @return The target speed magnitude in RPM.
+         */
+        float get_target_rpm(void)
+        {
+            return target_rpm;
+        }
+};
+
+#endif
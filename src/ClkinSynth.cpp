@@ -0,0 +1,113 @@
+/** @file ClkinSynth.cpp
+ *  This file contains the ClkinSynth class, which works out the MCPWM timer settings that
+ *  put a requested frequency on the DRV8308 CLKIN pin.
+*/
+
+#include "ClkinSynth.h"
+
+
+
+/** @brief Constructor for the ClkinSynth class
+ *
+ *  @details The output starts stopped, with the largest prescaler so that the first
+ *  frequency chooses its own.
+ *
+ *  @param group_hz_ The rate of the clock feeding the timer prescaler.
+ */
+ClkinSynth::ClkinSynth(uint32_t group_hz_)
+{
+    group_hz = group_hz_;
+    prescale = CLKIN_PRESCALE_MAX;
+    period = CLKIN_PERIOD_MAX;
+    running = false;
+}
+
+
+
+/** @brief A function which returns the timer period closest to a frequency
+ *
+ *  @param freq_mhz The frequency in millihertz, which must not be zero.
+ *  @param divider The timer prescaler.
+ *
+ *  @return The number of prescaled ticks in one cycle, rounded to the nearest.
+ */
+uint64_t ClkinSynth::period_for(uint32_t freq_mhz, uint16_t divider)
+{
+    uint64_t ticks_mhz = (uint64_t)freq_mhz * divider;
+    return ((uint64_t)group_hz * 1000u + ticks_mhz / 2) / ticks_mhz;
+}
+
+
+
+/** @brief A function which calculates the timer settings for a frequency
+ *
+ *  @details The period is the number of timer ticks closest to one cycle at the requested
+ *  frequency. The prescaler is kept if that period fits in the register and is at least
+ *  CLKIN_PERIOD_MIN (or the prescaler is already 1). Otherwise a new prescaler is chosen
+ *  so that the period lands near CLKIN_PERIOD_TARGET, which leaves room to retune by a
+ *  factor of four either way before it has to change again.
+ *
+ *  @param freq_mhz The requested frequency in millihertz. Zero, or anything below
+ *  min_mhz(), stops the output.
+ *
+ *  @return True if the prescaler changed.
+ */
+bool ClkinSynth::tune(uint32_t freq_mhz)
+{
+    if (freq_mhz == 0 || freq_mhz < min_mhz())
+    {
+        running = false;
+        return false;
+    }
+    running = true;
+
+    // timer ticks in one cycle at a prescaler of 1
+    uint64_t cycle = ((uint64_t)group_hz * 1000u + freq_mhz / 2) / freq_mhz;
+
+    // the period is rounded once from the exact cycle, not from the rounded one
+    uint64_t n = period_for(freq_mhz, prescale);
+    if (n <= CLKIN_PERIOD_MAX && (n >= CLKIN_PERIOD_MIN || prescale == 1))
+    {
+        period = (uint16_t)n;
+        return false;
+    }
+
+    uint64_t p = (cycle + CLKIN_PERIOD_TARGET / 2) / CLKIN_PERIOD_TARGET;
+    if (p < 1) p = 1;
+    if (p > CLKIN_PRESCALE_MAX) p = CLKIN_PRESCALE_MAX;
+    n = period_for(freq_mhz, (uint16_t)p);
+    if (n > CLKIN_PERIOD_MAX) n = CLKIN_PERIOD_MAX;
+
+    bool changed = (p != prescale);
+    prescale = (uint16_t)p;
+    period = (uint16_t)n;
+    return changed;
+}
+
+
+
+/** @brief A function which returns the frequency the current settings produce
+ *
+ *  @return The CLKIN frequency in millihertz, or zero if the output is stopped.
+ */
+uint32_t ClkinSynth::actual_mhz(void)
+{
+    if (!running)
+    {
+        return 0;
+    }
+    uint64_t ticks = (uint64_t)prescale * period;
+    return (uint32_t)(((uint64_t)group_hz * 1000u + ticks / 2) / ticks);
+}
+
+
+
+/** @brief A function which returns the lowest frequency the timer can produce
+ *
+ *  @return The frequency with the largest prescaler and period, in millihertz. This is
+ *  about 0.6 Hz, well below the 1.5 Hz the DRV8308 commutation timer needs.
+ */
+uint32_t ClkinSynth::min_mhz(void)
+{
+    return (uint32_t)(((uint64_t)group_hz * 1000u) / ((uint64_t)CLKIN_PRESCALE_MAX * CLKIN_PERIOD_MAX)) + 1;
+}
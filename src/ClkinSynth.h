@@ -0,0 +1,87 @@
+/** @file ClkinSynth.h
+ *  This file contains the ClkinSynth class, which works out the MCPWM timer settings that
+ *  put a requested frequency on the DRV8308 CLKIN pin. The timer counts at the group clock
+ *  divided by an 8-bit prescaler, and its 16-bit period register is double buffered, so
+ *  the frequency can be retuned at the end of a cycle without stopping the output. The
+ *  prescaler is not double buffered, so it is only changed when the period would leave
+ *  the range where the frequency resolution is good.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC and
+ *  used as a model of the frequency error for any speed.
+*/
+
+#ifndef _CLKINSYNTH_H_
+#define _CLKINSYNTH_H_
+
+#include <stdint.h>
+
+// MCPWM group clock used for CLKIN: the 160 MHz source divided by 16
+#define CLKIN_GROUP_HZ 10000000
+
+// Limits of the timer prescaler and period registers
+#define CLKIN_PRESCALE_MAX 256
+#define CLKIN_PERIOD_MAX 65535
+
+// Shortest period kept before a smaller prescaler is chosen; at 170 Hz a period this long
+// still gives 0.04 Hz steps
+#define CLKIN_PERIOD_MIN 4096
+
+// Period aimed for when the prescaler has to change, halfway between the limits in log scale
+#define CLKIN_PERIOD_TARGET 16384
+
+/** This class is used to calculate the CLKIN timer settings for a frequency */
+class ClkinSynth
+{
+    protected:
+
+        uint32_t group_hz;          // rate of the clock feeding the timer prescaler
+        uint16_t prescale;          // timer prescaler, 1 to CLKIN_PRESCALE_MAX
+        uint16_t period;            // timer period in prescaled ticks
+        bool running;               // false when the output is held low
+
+        uint64_t period_for(uint32_t freq_mhz, uint16_t divider);
+
+    public:
+
+        /** Non-inline functions are commented in ClkinSynth.cpp */
+        ClkinSynth(uint32_t group_hz_ = CLKIN_GROUP_HZ);
+
+        bool tune(uint32_t freq_mhz);
+        uint32_t actual_mhz(void);
+        uint32_t min_mhz(void);
+
+
+
+        /** @brief A function which returns the timer prescaler
+         *
+         *  @return The divider from the group clock to the timer clock.
+         */
+        uint16_t get_prescale(void)
+        {
+            return prescale;
+        }
+
+
+
+        /** @brief A function which returns the timer period
+         *
+         *  @return The length of one CLKIN cycle in timer ticks.
+         */
+        uint16_t get_period(void)
+        {
+            return period;
+        }
+
+
+
+        /** @brief A function which reports whether CLKIN should be running
+         *
+         *  @return False if the last frequency was zero or below what the timer can make.
+         */
+        bool is_running(void)
+        {
+            return running;
+        }
+};
+
+#endif
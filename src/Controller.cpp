@@ -1,6 +1,6 @@
 /** @file Controller.cpp
  *  This file contains the Controller class which currently contains an integrator
- *  that calculates speed values from commanded torques.
+ *  that calculates speed values from commanded torques using a wheel model.
 */
 
 #include <Arduino.h>
@@ -8,66 +8,102 @@
 #include "Shares.h"
 #include <PrintStream.h>
 
-/** @brief Constructor which sets up a Controller class defining a constant flywheel 
- *  moment of inertia and initializing values for the integrator.
+/** @brief Constructor which sets up a Controller class with a frictionless wheel model of 
+ *  the motor and load and initializing values for the integrator.
+ * 
+ *  @details The exact zero-order-hold integrator is used by default, since the torque loop 
+ *  holds each torque for a whole step. Without friction every method gives the same result.
+ * 
+ *  @param dt_s_ The time between calls to calculate_omega() in seconds.
  */
-Controller::Controller(void)
-    : J(0.001712) // kg * m^2, moment of inertia for the motor and load
+Controller::Controller(float dt_s_)
+    : model(0.001712f) // kg * m^2, moment of inertia for the motor and load
 {
-    last_update_ms = 0;
-    omega_rad_s    = 0.0f;
+    mode = INTEGRATE_ZOH;
+    omega_rpm = 0.0f;
+    set_period(dt_s_);
 }
 
-/** @brief This function integrates torque to get speed.
+
+
+/** @brief This function sets the integration step.
  * 
- *  @details This function uses a forward Euler integrator to integrate a commanded torque input to 
- *  convert it to a speed.
+ *  @param dt_s_ The time between calls to calculate_omega() in seconds, which is the period of the 
+ *  torque loop. Values outside 10 us to 1 s are clamped so a bad setting cannot produce an 
+ *  unreasonable speed.
+ */
+void Controller::set_period(float dt_s_)
+{
+    if (dt_s_ < 1.0e-5f) dt_s_ = 1.0e-5f;
+    if (dt_s_ > 1.0f)    dt_s_ = 1.0f;
+    dt_s = dt_s_;
+    model.set_step(dt_s);
+}
+
+
+
+/** @brief This function replaces the wheel model.
  * 
- *  @param torque_cmd_ The torque to integrate into a speed. The time used is the time between the 
- *  last command and this command.
+ *  @details The model's step is set to the period of the torque loop, so the caller does not 
+ *  need to know it.
  * 
- *  @return The calculated speed command in RPM, which is then passed to the state machine to command the motor.
+ *  @param model_ The new model, for example with friction coefficients measured on the wheel.
  */
-float Controller::calculate_omega(float torque_cmd_)
+void Controller::set_model(const WheelModel& model_)
 {
+    model = model_;
+    model.set_step(dt_s);
+}
 
-    // These variables are declared inside the calculate_omega command so we can keep them separate from the PID task 
-    // we will implement later
-    // set now_ms as the amount of milliseconds since system boot
-    unsigned long now_ms = millis();
-
-    // declare dt_s
-    float dt_s;
-
-    dt_s = (now_ms - last_update_ms) / 1000.0f;
-    if (dt_s <= 0.0f) // Guard against millis() wrap or weirdness
-    {
-        dt_s = 0.001f;
-    }
-    else if (dt_s >= 1.0f) // Clamp dt_s at 1 second so incase a command drops, it doesn't calculate an unreasonable speed
-    {
-        dt_s = 1.0f;
-    }
-    
-    // set last_update_ms to now_ms for the next iteration
-    last_update_ms = now_ms;
-
-    // Calculate angular acceleration [rad/s^2]
-    float alpha = torque_cmd_ / J;
-
-    // Forward Euler Integrator
-    // Integrate to get new angular speed [rad/s]
-    float torque_add = alpha * dt_s;
-    // Add the actual speed converted to rad/s
-    omega_rad_s = torque_add + speed_actual.get() * (2.0f * PI / 60.0f); 
 
-    // Clamp omega to the physical limit of the BLDC motor (<2760 RPM)
-    const float omega_max_rad_s = 2.0f * PI * 2500.0f / 60.0f; // ~2500 RPM
-    if (omega_rad_s > omega_max_rad_s)  omega_rad_s = omega_max_rad_s;
-    if (omega_rad_s < -omega_max_rad_s) omega_rad_s = -omega_max_rad_s;
 
-    // Convert rad/s → RPM
-    float omega_rpm = omega_rad_s * (60.0f / (2.0f * PI));
+/** @brief This function chooses the integration method.
+ * 
+ *  @param mode_ One of the methods in Integrator.h.
+ */
+void Controller::set_integrator(IntegratorMode mode_)
+{
+    mode = mode_;
+}
+
+
+
+/** @brief This function starts the integration from a known speed.
+ * 
+ *  @details This is called when torque control starts, so the speed command continues from the 
+ *  speed the wheel is actually turning at instead of jumping.
+ * 
+ *  @param speed The speed to start integrating from.
+ */
+void Controller::reset(rpm_t speed)
+{
+    omega_rpm = rpm_to_float(speed);
+}
+
+
+
+/** @brief This function integrates torque to get speed.
+ * 
+ *  @details This function integrates the wheel model under a commanded torque input to convert it 
+ *  to a speed, using the method chosen with set_integrator(). The model works in rad/s, so the speed 
+ *  is converted from RPM and back around the step. It is called at a fixed rate by the torque loop, 
+ *  so every step covers the same time dt_s.
+ * 
+ *  @param torque_cmd_ The torque to integrate into a speed over one step.
+ * 
+ *  @return The calculated speed command, which is then passed to the state machine to command the motor.
+ */
+rpm_t Controller::calculate_omega(float torque_cmd_)
+{
+    // Integrate the model over one fixed step to get the new speed [rad/s], then convert it to [RPM]
+    const float rad_s_to_rpm = 60.0f / (2.0f * PI);
+    float omega_rad_s = integrate(mode, model, omega_rpm / rad_s_to_rpm, torque_cmd_);
+    omega_rpm = omega_rad_s * rad_s_to_rpm;
+
+    // Clamp omega to the physical limit of the BLDC motor (<2760 RPM)
+    const float omega_max_rpm = 2500.0f; // ~2500 RPM
+    if (omega_rpm > omega_max_rpm)  omega_rpm = omega_max_rpm;
+    if (omega_rpm < -omega_max_rpm) omega_rpm = -omega_max_rpm;
 
-    return omega_rpm;
+    return rpm_from_float(omega_rpm);
 }
@@ -1,27 +1,58 @@
 /** @file Controller.h
  *  This file contains the Controller class which currently contains an integrator
- *  that calculates speed values from commanded torques.
+ *  that calculates speed values from commanded torques. The wheel is described by a
+ *  WheelModel and the integration method can be chosen from those in Integrator.h.
 */
 
 #ifndef _CONTROLLER_H_
 #define _CONTROLLER_H_
 
 #include <Arduino.h>
+#include "SpeedType.h"
+#include "WheelModel.h"
+#include "Integrator.h"
 
 /** This class is used to calculate speed commands for the state machine */
 class Controller 
 {
     protected:
     
-        const float J;                  // moment of inertia
-        unsigned long last_update_ms;   // last time calculate_omega() was called (ms)
-        float omega_rad_s;              // wheel speed in rad/s for integration
+        WheelModel model;               // moment of inertia and friction of the wheel
+        IntegratorMode mode;            // method used to integrate the model
+        float dt_s;                     // fixed integration step (s)
+        float omega_rpm;                // wheel speed in RPM for integration
         
     public:
         
         // These functions are commented in Controller.cpp
-        Controller(void);
-        float calculate_omega(float torque_cmd_);
+        Controller(float dt_s_ = 0.001f);
+        void set_period(float dt_s_);
+        void set_model(const WheelModel& model_);
+        void set_integrator(IntegratorMode mode_);
+        void reset(rpm_t speed);
+        rpm_t calculate_omega(float torque_cmd_);
+
+
+
+        /** @brief This function returns the wheel model used by the integrator.
+         * 
+         *  @return The model, with its step set to the period of the torque loop.
+         */
+        const WheelModel& get_model(void)
+        {
+            return model;
+        }
+
+
+
+        /** @brief This function returns the integration method.
+         * 
+         *  @return The method set with set_integrator().
+         */
+        IntegratorMode get_integrator(void)
+        {
+            return mode;
+        }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -6,296 +6,893 @@
 #include "Shares.h"
 #include "Driver.h"
 #include "Controller.h"
+#include "SpeedEstimator.h"
+#include "StallDetector.h"
+#include "DirectionEstimator.h"
+#include "LatencyHistogram.h"
+#include "SpeedFsm.h"
+#include "BrakeController.h"
+#include "WheelEstimator.h"
+#include "SpeedPid.h"
+#include "esp_timer.h"
 #include "taskshare.h"
 #include "taskqueue.h"
 #include "CtrlTasks.h"
+#include "ProfileTask.h"
 
 /** Extern declarations for the objects created in main.cpp */
 extern Driver Peripheral;
 extern Controller Controller_1;
 
 /** Extern declarations for the shares defined in main.cpp */
-extern Queue<float> torque_cmd;
-extern Queue<float> speed_cmd; 
-extern Share<float> speed_actual;
-extern Queue<uint32_t> edge_time;
+extern Mailbox<float> torque_cmd;
+extern Mailbox<rpm_t> speed_cmd;
+extern Share<rpm_t> speed_actual;
+extern Share<rpm_t> speed_raw;
+extern EdgeRing edge_ring;
+extern Queue<DrvRequest> drv_requests;
+extern Mailbox<WheelModel> wheel_model;
+extern Mailbox<PidGains> pid_gains;
+extern SpscRing<TelemetrySample, TELEMETRY_RING_SIZE> telemetry_ring;
+extern SpscRing<TelemetrySample, TELEMETRY_EVENT_RING_SIZE> telemetry_events;
 
 
-/** @brief Function which returns the sign of the input
+// Longest time readActual waits for an edge notification before processing the edges that have arrived (ms)
+const uint32_t EDGE_TIMEOUT_MS = 20;
+
+// Filter used by readActual for speed_actual, the largest averaging window K and the median length N
+const EstimatorMode ESTIMATOR_MODE = ESTIMATE_ADAPTIVE;
+const uint16_t ESTIMATOR_WINDOW = 8;
+const uint16_t ESTIMATOR_MEDIAN = 5;
+
+// Periods readActual waits for an edge beyond the batch it is notified of before decaying the speed
+const float STALL_MARGIN = 0.5f;
+
+// Ticks the driver I/O task waits after the first request so the rest of a batch can arrive
+const TickType_t DRV_BATCH_TICKS = 1;
+
+// Most requests the driver I/O task handles in one batch
+const uint8_t DRV_BATCH_MAX = DRV_REQUEST_QUEUE_SIZE;
+
+// Shortest time between latency reports from the driver I/O task over serial (ms)
+const uint32_t DRV_REPORT_MS = 10000;
+
+// True to estimate the wheel inertia and friction in readActual and pass them to the Controller
+const bool WHEEL_ADAPT = true;
+
+// Samples the wheel estimator must use before its model replaces the Controller's, and between updates
+const uint32_t WHEEL_MIN_SAMPLES = 50;
+const uint32_t WHEEL_POST_SAMPLES = 25;
+
+// Rate of the torque loop in calcSetpoint (Hz); vTaskDelayUntil() limits it to the FreeRTOS tick rate
+const uint32_t TORQUE_LOOP_HZ = 1000;
+
+// Smallest change in the integrated speed which the torque loop posts to speedControl
+const rpm_t TORQUE_POST_STEP = rpm_from_float(1.0f);
+
+// Shortest time between jitter reports from the torque loop over serial (ms)
+const uint32_t TORQUE_REPORT_MS = 10000;
+
+// Longest time speedControl waits for an event while a transition is running (ms)
+const uint32_t FSM_TIMEOUT_MS = 50;
+
+// Shortest time between command reaction reports from speedControl over serial (ms)
+const uint32_t FSM_REPORT_MS = 10000;
+
+// True to modulate the brake to a commanded deceleration, false for a plain on/off brake
+const bool BRAKE_MODULATION = true;
+
+// Deceleration the brake controller tracks (RPM/s)
+const float BRAKE_DECEL = 1000.0f;
+
+// True to trim CLKIN and the brake with the outer PID speed loop once the state machine has reached the command
+const bool PID_ENABLE = true;
+
+// Period of the outer PID speed loop (us)
+const uint32_t PID_PERIOD_US = 5000;
+
+// Starting gains of the outer PID speed loop: kp, ki (1/s), kd (s) and the feedforward of the command
+const PidGains PID_GAINS = { 1.0f, 4.0f, 0.01f, 1.0f };
+
+// Deadband around the commanded speed, and around zero for direction changes, used by speedControl
+const rpm_t SPEED_DEADBAND = rpm_from_float(20.0f);
+
+
+
+// Handle of the speedControl task, which is woken with events by the other tasks
+static TaskHandle_t speedControl_handle = NULL;
+
+// Handle of the calcSetpoint task, which is woken when a torque command is posted
+static TaskHandle_t calcSetpoint_handle = NULL;
+
+// Whether the speed command comes from the web page directly or from the torque loop
+static volatile ControlMode control_mode = MODE_SPEED;
+
+// Latest speed posted directly, which the torque loop re-posts if it loses a race with a mode switch
+static volatile rpm_t direct_speed = 0;
+
+// Torque the torque loop is integrating, for the wheel estimator (N*m)
+static volatile float loop_torque = 0.0f;
+
+// Duty cycle speedControl has set on the brake, and whether it is in the deceleration state
+static volatile float brake_level = 0.0f;
+static volatile bool decelerating = false;
+
+// Latest speed measured by readActual with the time of the edge it was measured from, so the brake 
+// controller in speedControl works out the deceleration over the true time between measurements
+static Mailbox<rpm_t> speed_sample;
+
+// Speed commanded to the speedControl state machine and its state, for the telemetry samples
+static volatile rpm_t fsm_command = 0;
+static volatile uint8_t fsm_state = FSM_IDLE;
+
+
+/** @brief Function which ends a braking maneuver and reports it over serial
+ * 
+ *  @param brake The brake controller running the maneuver.
+ *  @param actual The measured speed.
+ *  @param actual_us The time the speed was measured.
+ */
+static void finish_brake(BrakeController& brake, rpm_t actual, uint64_t actual_us)
+{
+    if (!brake.is_active())
+    {
+        return;
+    }
+    brake.finish(actual_us, actual);
+    Serial.printf("Brake %.0f -> %.0f rpm: %lu ms, overshoot %.1f rpm\n", brake.get_start_rpm(), 
+                  brake.get_target_rpm(), (unsigned long)brake.get_settle_ms(), brake.get_overshoot());
+}
+
+
+
+/** @brief Function which applies the outputs of the speed state machine to the Driver
+ * 
+ *  @details The outputs are applied in a fixed order: CLKIN goes to zero before the brake is 
+ *  set, and DIR changes before the brake is released and CLKIN is ramped up again. Setting the 
+ *  brake starts a maneuver in the brake controller, which then sets the brake duty cycle on 
+ *  every new speed measurement until the brake is released. Commands and timeouts bring no new 
+ *  measurement, so they leave the duty cycle alone rather than feed the same speed in again as 
+ *  if the wheel had stopped decelerating.
+ * 
+ *  @param out The outputs produced by SpeedFsm::dispatch().
+ *  @param brake The brake controller.
+ *  @param sample The measured speed the state machine acted on and the time it was measured.
+ *  @param fresh True if the event was a new speed measurement.
+ *  @param command The commanded speed the state machine acted on.
+ */
+static void apply_fsm_output(const FsmOutput& out, BrakeController& brake, const Mail<rpm_t>& sample, 
+                             bool fresh, rpm_t command)
+{
+    rpm_t actual = sample.value;
+
+    if (out.actions & FSM_OUT_STOP)    Peripheral.cmd_speed_PWM(0);
+    if (out.actions & FSM_OUT_BRAKE)
+    {
+        finish_brake(brake, actual, sample.posted_us);
+        float duty = brake.start(sample.posted_us, actual, command);
+        brake_level = BRAKE_MODULATION ? duty : 1.0f;
+        Peripheral.brake_duty(brake_level);
+    }
+    else if (fresh && brake.is_active() && !(out.actions & FSM_OUT_UNBRAKE))
+    {
+        float duty = brake.update(sample.posted_us, actual);
+        brake_level = BRAKE_MODULATION ? duty : 1.0f;
+        Peripheral.brake_duty(brake_level);
+    }
+    if (out.actions & FSM_OUT_DIR)     Peripheral.set_dir(out.dir);
+    if (out.actions & FSM_OUT_UNBRAKE)
+    {
+        finish_brake(brake, actual, sample.posted_us);
+        brake_level = 0.0f;
+        Peripheral.unbrake();
+    }
+    if (out.actions & FSM_OUT_SET)     Peripheral.cmd_speed_PWM(out.speed);
+    if (out.actions & FSM_OUT_RAMP)    Peripheral.cmd_speed_ramp(out.speed);
+}
+
+
+
+/** @brief Callback for the one-shot stall timer
+ * 
+ *  @details This runs in the esp_timer task when no FGOUT edge has arrived within the time 
+ *  implied by the last speed measurement, and wakes the readActual task to decay the speed.
+ * 
+ *  @param arg The handle of the readActual task.
+ */
+static void stall_callback(void* arg)
+{
+    xTaskNotify((TaskHandle_t)arg, NOTIFY_STALL, eSetBits);
+}
+
+
+
+/** @brief Callback for the periodic PID timer
+ * 
+ *  @details This runs in the esp_timer task every PID period while the PID loop is on, and 
+ *  wakes the speedControl task to run the next step, so the steps keep to the period rather 
+ *  than to the FreeRTOS tick.
  * 
- *  @param x Floating point integer
+ *  @param arg The handle of the speedControl task.
+ */
+static void pid_callback(void* arg)
+{
+    xTaskNotify((TaskHandle_t)arg, NOTIFY_PID, eSetBits);
+}
+
+
+
+/** @brief Function which restarts a one-shot timer
  * 
- *  @return Sign of x
+ *  @param timer The timer to restart.
+ *  @param delay_us The new delay in microseconds, or zero to leave the timer stopped.
  */
-inline int sign(float x) {
-    return (x >= 0.0f) ? +1 : -1;  // 0.0 → +1
+static void rearm_timer(esp_timer_handle_t timer, uint32_t delay_us)
+{
+    esp_timer_stop(timer);
+    if (delay_us > 0)
+    {
+        esp_timer_start_once(timer, delay_us);
+    }
 }
 
 
+
+/** @brief Function which fills in a telemetry sample with the time and the controller state
+ * 
+ *  @param rpm The filtered speed.
+ *  @param rpm_raw The unfiltered speed.
+ *  @param command The speed commanded to the state machine.
+ *  @param state The state of the state machine.
+ *  @param flags TELEMETRY_COMMAND or TELEMETRY_TRANSITION if the sample records an event; the 
+ *  control mode is added here, as are the profile and step playing.
+ * 
+ *  @return The sample, timestamped now.
+ */
+static TelemetrySample make_sample(rpm_t rpm, rpm_t rpm_raw, rpm_t command, uint8_t state, uint8_t flags)
+{
+    TelemetrySample sample;
+    sample.t_us = (uint32_t)esp_timer_get_time();
+    sample.actual = rpm;
+    sample.raw = rpm_raw;
+    sample.command = command;
+    sample.state = state;
+    sample.flags = flags | ((control_mode == MODE_TORQUE) ? TELEMETRY_TORQUE : 0);
+    sample.brake = (uint16_t)(brake_level * 1000.0f + 0.5f);
+    uint32_t tag = profile_tag();
+    sample.profile = (uint16_t)(tag >> 16);
+    sample.step = (uint16_t)(tag & 0xFFFF);
+    return sample;
+}
+
+
+
+/** @brief Function which records a speed measurement for the live plot and the log
+ * 
+ *  @details Only the readActual task may call this function, as it is the one producer of the 
+ *  telemetry ring. A sample which does not fit because the webserver task has fallen behind is 
+ *  counted by the ring and lost.
+ * 
+ *  @param rpm The filtered speed.
+ *  @param rpm_raw The unfiltered speed.
+ */
+static void record_telemetry(rpm_t rpm, rpm_t rpm_raw)
+{
+    telemetry_ring.push(make_sample(rpm, rpm_raw, fsm_command, fsm_state, 0));
+}
+
+
+
 /** @brief Task which reads the speed of the motor
  * 
  *  @details The BLDC motor has Hall sensors which output a square wave at the electrical
  *  frequency of the motor. The DRV8308 chip outputs a square wave of this frequency, which is
- *  read by an ISR that puts a timestamp in the edge_time queue each time there is a rising edge. 
- *  This task gets that timestamp, compares it to the previous timestamp, calculates the frequency 
- *  of the motor in RPM and places that in the speed_actual queue. This task does not run until 
- *  there is a value in the edge_time queue, so it runs at the period of the motor spinning. The 
- *  motor speed is clamped to 2500 RPM by the Controller class, so the maximum speed of this task is 
- *  (2500/15) = 166.67 Hz or 6 ms.
+ *  timestamped by the capture backend in the Driver class (the MCPWM capture unit by default). 
+ *  The backend pushes each timestamp into the edge_ring buffer and notifies this task once every 
+ *  four edges. This task drains the ring and passes every edge to a SpeedEstimator, which keeps 
+ *  the latest timestamps in fixed circular storage and filters the periods in constant time per 
+ *  edge (sliding average over K edges, median of N edges, or an average whose K adapts to the 
+ *  speed). The filtered speed goes in the speed_actual share and the speed from the latest single 
+ *  period goes in the speed_raw share, and the speedControl task is notified. If fewer than four 
+ *  edges arrive within 20 ms the task times out and processes the edges it has, so it runs once 
+ *  per four edges at high speed and every 20 ms at slow speeds. The motor speed is clamped to 
+ *  2500 RPM by the Controller class, so the maximum edge rate is (2500/15) = 166.67 Hz or 6 ms.
+ * 
+ *  After each measurement a one-shot esp_timer is armed to expire 4.5 periods implied by the speed 
+ *  after the latest edge arrived, as timed by the capture ISR rather than by this task, since the 
+ *  next batch of four edges cannot be seen any sooner. If it expires before the next edge, the 
+ *  wheel must be slower than 15 / t RPM after t seconds without an edge, so the StallDetector 
+ *  decays the reported speed along that bound and re-arms the timer 25% further out each time, 
+ *  until the bound drops below 10 RPM (1.5 s after the last edge) and zero is reported. This lets 
+ *  the speedControl deadbands be reached after a stop.
+ * 
+ *  FGOUT only gives the speed magnitude, so the sign comes from a DirectionEstimator. When DIR 
+ *  is reversed the wheel keeps turning the old way until it passes through zero, so the old sign 
+ *  is kept until the measured speed rises 10 RPM above its minimum or the wheel is reported 
+ *  stopped. The commanded direction is cached by the Driver, so no pin is read per edge.
+ * 
+ *  Each speed is also given to a WheelEstimator along with the torque on the wheel, when it is known: 
+ *  zero while the wheel coasts in the deceleration state with the brake off, or the torque being 
+ *  integrated while the torque loop runs without the brake. The speed is an average over the 
+ *  estimator's span of edges, so it is given the time halfway through that span. The recursive 
+ *  least squares estimate of the inertia and friction is posted to the wheel_model mailbox for the 
+ *  Controller every 25 samples once 50 samples have been used.
+ * 
+ *  Every speed, including the decayed ones, is also pushed into telemetry_ring as a timestamped 
+ *  sample with the command and state of speedControl, which the webserver task logs and streams.
 */
 void task_readActual(void* parameters) 
 {
     
-    uint32_t last_time = micros();  // initialize the last_time to the time at setup
-    uint32_t current_time = 0;      // initialize current_time to zero    
-    float frequency = 0.0;          // initialize electrical frequency to zero
-    float rpm = 0.0;                // initialize RPM to zero
-    uint32_t dt_us = 0;             // initialize timestamp delta to zero
-    bool direction = LOW;           // initialize direction boolean to low
+    // Filters the edge timestamps into a speed
+    SpeedEstimator estimator(ESTIMATOR_MODE, ESTIMATOR_WINDOW, ESTIMATOR_MEDIAN, Peripheral.capture_ticks_per_us());
+
+    // Decays the speed toward zero when no edges arrive, driven by a one-shot timer
+    StallDetector stall(STALL_MARGIN);
+    esp_timer_handle_t stall_timer;
+    esp_timer_create_args_t stall_args = {};
+    stall_args.callback = stall_callback;
+    stall_args.arg = xTaskGetCurrentTaskHandle();
+    stall_args.name = "Stall Timer";
+    esp_timer_create(&stall_args, &stall_timer);
+
+    uint32_t bits = 0;              // initialize the notification bits received by the task
+    uint32_t ticks = 0;             // initialize the edge timestamp read from the ring
+    bool updated = false;           // initialize flag which is set when a new period was measured
+    rpm_t rpm = 0;                  // initialize filtered RPM to zero
+    rpm_t rpm_raw = 0;              // initialize unfiltered RPM to zero
+
+    // Signs the speed, following a reversal of DIR through the zero crossing of the wheel
+    DirectionEstimator direction;
+
+    // Estimates the wheel inertia and friction, starting from the model the Controller uses
+    WheelEstimator wheel;
+    wheel.reset(Controller_1.get_model());
+    WheelModel estimate;
 
     while (true) 
     {
-        current_time = edge_time.get();     // Task only runs once there is a value in edge_time
-        dt_us = current_time - last_time;   // calculate dt between rising edges
-        last_time = current_time;           // set last_time to the current time after dt calculation
+        // Wait for the capture backend to report a group of edges or the stall timer to expire, 
+        // or time out at slow speeds
+        bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, pdMS_TO_TICKS(EDGE_TIMEOUT_MS));
+
+        // pick up any change of the commanded direction, which the Driver caches
+        direction.command(Peripheral.get_dir() == HIGH);
 
-        // prevent dividing by zero error
-        if (dt_us == 0)                     
+        updated = false;
+        while (edge_ring.pop(ticks))
         {
-          continue;
+            updated |= estimator.add_edge(ticks);
         }
 
-        // Calculate electrical frequency of motor by inverting dt_us and converting to seconds (Hz)
-        frequency = 1 / (((float)dt_us) / 1000000); 
+        // no edge arrived in time, decay the reported speed toward zero
+        if (!updated && (bits & NOTIFY_STALL))
+        {
+            rearm_timer(stall_timer, stall.expire(esp_timer_get_time(), rpm));
+            if (stall.is_stalled())
+            {
+                // the next edge only restarts the estimator instead of making one giant period
+                estimator.reset();
 
-        // Use the direction of current motor spin to calculate positive or negative rpm
-        direction = Peripheral.get_dir(); 
-        if (direction == LOW) {rpm = frequency * 15.0f;}
-        else {rpm = frequency * -15.0f;}
+                // a stopped wheel can only start again in the commanded direction
+                direction.stopped();
+            }
+            speed_raw.put(rpm);
+            speed_actual.put(rpm);
+            speed_sample.post(rpm, esp_timer_get_time());
+            notify_speedControl(NOTIFY_SPEED);
+            record_telemetry(rpm, rpm);
+            continue;
+        }
 
-        // Place the calculated speed in the speed_actual share
+        // skip this run if no whole period has arrived, which also prevents dividing by zero
+        if (!updated)
+        {
+          continue;
+        }
+
+        // Use the direction of rotation to calculate positive or negative rpm
+        rpm = direction.update(estimator.rpm()); 
+        rpm_raw = estimator.raw_rpm();
+        if (direction.is_negative()) {rpm_raw = -rpm_raw;}
+
+        // Place the calculated speeds in the speed_actual and speed_raw shares, and the speed with the 
+        // time of the latest edge in the speed_sample mailbox
+        int64_t edge_us = Peripheral.edge_time_us(estimator.last_edge());
+        speed_raw.put(rpm_raw);
         speed_actual.put(rpm);
+        speed_sample.post(rpm, edge_us);
+        notify_speedControl(NOTIFY_SPEED);
+        record_telemetry(rpm, rpm_raw);
+
+        // The wheel torque is known while it coasts (CLKIN stopped, brake off), or while the torque 
+        // loop runs without the brake; then update the estimate and pass it on every few samples
+        if (WHEEL_ADAPT)
+        {
+            bool coasting = decelerating && brake_level == 0.0f;
+            bool known = brake_level == 0.0f && (coasting || get_control_mode() == MODE_TORQUE);
+            int64_t mid_us = edge_us - (int64_t)(estimator.span() / Peripheral.capture_ticks_per_us() / 2);
+            if (wheel.sample(mid_us, rpm, coasting ? 0.0f : loop_torque, known)
+                && wheel.samples() % WHEEL_POST_SAMPLES == 0 && wheel.model(estimate, WHEEL_MIN_SAMPLES))
+            {
+                wheel_model.post(estimate, esp_timer_get_time());
+            }
+        }
+
+        // Expect the next batch of edges within half a period of when it is due after the latest 
+        // edge, otherwise the stall timer decays the speed
+        stall.set_batch(Peripheral.edges_per_notify());
+        rearm_timer(stall_timer, stall.edge(edge_us, esp_timer_get_time(), rpm));
     }
 }
 
 
 
+/** @brief Function which passes a speed command to the speedControl task
+ * 
+ *  @details The command overwrites the one in the speed_cmd mailbox, so the caller never blocks 
+ *  and a command which has not been acted on yet is replaced instead of queued. The speedControl 
+ *  task is woken with a NOTIFY_COMMAND event. The mailbox stamps the command with the time it was 
+ *  posted, so the speedControl task can measure how long the command took to reach the pins.
+ * 
+ *  @param speed The commanded speed.
+ */
+static void send_speed_cmd(rpm_t speed)
+{
+    speed_cmd.post(speed, esp_timer_get_time());
+    notify_speedControl(NOTIFY_COMMAND);
+}
+
+
+
 /** @brief Task which calculates the speed from a commanded torque
  * 
- *  @details This task calls the Controller class integrator to calculate a speed 
- *  command from a torque command. It runs once it detects a value in the torque_cmd queue
- *  so we can define the period of this task as the frequency of our control loop once we 
- *  expand the project.
+ *  @details This task is the torque loop. It sleeps while speeds are commanded directly. When a 
+ *  torque is posted it starts the Controller class integrator from the measured speed, then wakes 
+ *  at a fixed rate of TORQUE_LOOP_HZ with vTaskDelayUntil(), holds the newest torque from the 
+ *  torque_cmd mailbox and integrates it over one period. The speed is posted to speedControl 
+ *  whenever it has moved by TORQUE_POST_STEP, so a constant torque does not wake speedControl on 
+ *  every step. A direct speed command stops the loop at its next step.
+ * 
+ *  The time between wakeups is checked against the period. Its error is kept in a histogram and 
+ *  printed over serial, along with the number of late steps, at most once every 10 s while the loop 
+ *  is running.
  */
 void task_calcSetpoint(void* parameters) 
 {
+    calcSetpoint_handle = xTaskGetCurrentTaskHandle();
+
+    uint32_t hz = (TORQUE_LOOP_HZ < configTICK_RATE_HZ) ? TORQUE_LOOP_HZ : configTICK_RATE_HZ;
+    TickType_t period = pdMS_TO_TICKS(1000 / hz);
+    if (period < 1) period = 1;
+    uint32_t period_us = period * portTICK_PERIOD_MS * 1000;
+    Controller_1.set_period(period_us * 1.0e-6f);
+
+    Mail<float> mail;               // latest torque command with its sequence number and time
+    Mail<WheelModel> model;         // latest wheel model from the estimator in readActual
+    float torque = 0.0f;            // torque held between commands
+    rpm_t posted = 0;               // speed last posted to speedControl
+    LatencyHistogram jitter;        // error of the time between steps
+    uint32_t late = 0;              // steps which started after the next one was due
+    char line[160];                 // text of the serial report
+
     while (true) 
     {
-        float torque = torque_cmd.get();
-        float omega = Controller_1.calculate_omega(torque);
-        speed_cmd.put(omega);
+        // Sleep until a torque command switches the task into torque mode
+        while (control_mode != MODE_TORQUE)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+
+        // Start integrating from the measured speed, so the command does not jump
+        Controller_1.reset(speed_actual.get());
+        posted = speed_actual.get();
+        TickType_t last_wake = xTaskGetTickCount();
+        uint64_t last_us = esp_timer_get_time();
+        uint32_t last_report = millis();
+
+        while (control_mode == MODE_TORQUE)
+        {
+            if (xTaskDelayUntil(&last_wake, period) == pdFALSE)
+            {
+                late++;
+            }
+            uint64_t now_us = esp_timer_get_time();
+            int32_t error = (int32_t)(now_us - last_us) - (int32_t)period_us;
+            jitter.add((uint32_t)((error < 0) ? -error : error));
+            last_us = now_us;
+
+            if (torque_cmd.take(mail))
+            {
+                torque = mail.value;
+                loop_torque = torque;
+            }
+            if (wheel_model.take(model))
+            {
+                Controller_1.set_model(model.value);
+            }
+            rpm_t omega = Controller_1.calculate_omega(torque);
+
+            if (rpm_abs(omega - posted) >= TORQUE_POST_STEP && control_mode == MODE_TORQUE)
+            {
+                send_speed_cmd(omega);
+                posted = omega;
+
+                // a direct command posted while this one was being sent must win
+                if (control_mode != MODE_TORQUE)
+                {
+                    send_speed_cmd(direct_speed);
+                }
+            }
+
+            if (millis() - last_report >= TORQUE_REPORT_MS)
+            {
+                jitter.report(line, sizeof(line), "Torque loop jitter");
+                Serial.println(line);
+                Serial.printf("Torque loop: %lu Hz, %lu late steps\n", (unsigned long)(1000000 / period_us), 
+                              (unsigned long)late);
+                const WheelModel& wm = Controller_1.get_model();
+                Serial.printf("Wheel model: J=%.6f kg*m^2, b=%.3e N*m*s/rad, c=%.5f N*m\n", 
+                              wm.get_J(), wm.get_b(), wm.get_c());
+                jitter.reset();
+                late = 0;
+                last_report = millis();
+            }
+        }
     }
 }
 
 
+
+/** @brief Function which posts a new torque command to the calcSetpoint task
+ * 
+ *  @details The command overwrites the one in the torque_cmd mailbox, so the caller never 
+ *  blocks. The motor switches to torque control, and the calcSetpoint task is woken in case 
+ *  it was waiting in speed mode.
+ * 
+ *  @param torque The commanded torque in N*m.
+ */
+void post_torque_cmd(float torque)
+{
+    torque_cmd.post(torque, esp_timer_get_time());
+    control_mode = MODE_TORQUE;
+    if (calcSetpoint_handle != NULL)
+    {
+        xTaskNotifyGive(calcSetpoint_handle);
+    }
+}
+
+
+
+/** @brief Function which posts a new speed command to the speedControl task
+ * 
+ *  @details The motor switches to direct speed control, so the torque loop stops posting speeds 
+ *  and this command stays in effect until the next speed or torque command.
+ * 
+ *  @param speed The commanded speed.
+ */
+void post_speed_cmd(rpm_t speed)
+{
+    direct_speed = speed;
+    control_mode = MODE_SPEED;
+    send_speed_cmd(speed);
+}
+
+
+
+/** @brief Function which returns where the speed command comes from
+ * 
+ *  @return MODE_TORQUE while the torque loop is running, otherwise MODE_SPEED.
+ */
+ControlMode get_control_mode(void)
+{
+    return control_mode;
+}
+
+
+
+/** @brief Function which wakes the speedControl task with an event
+ * 
+ *  @param bits The NOTIFY_ bits for the events which happened.
+ */
+void notify_speedControl(uint32_t bits)
+{
+    if (speedControl_handle != NULL)
+    {
+        xTaskNotify(speedControl_handle, bits, eSetBits);
+    }
+}
+
+
+
 /** @brief Task which commands the speed using a state machine
  *  
  *  @details This task uses a state machine to command the speed of the motor. The motor driver has an 
  *  internal control loop for acceleration but not for deceleration. It has a pin that applies an on/off 
- *  BRAKE and a pin to control the direction. The state machine uses the commanded speed and actual speed 
- *  torques to switch between an idle / stable state (acceleration = zero), an acceleration state (which 
- *  uses the internal control loop of the driver), a deceleration state (which uses the brake pin), and 
- *  zero crossing states in each direction which switch the direction pin polarity in a deadband of 20rpm. 
- *  In the future, we will write a controller to apply a bang-bang brake PWM to control the deceleration torque.
- *  This state machine triggers from state 0 (idle/stable) when there is a value in the speed_cmd queue then 
- *  runs every 10ms until the respective deadband is met.
+ *  BRAKE and a pin to control the direction. The SpeedFsm class uses the commanded speed and actual speed 
+ *  to switch between an idle / stable state, an acceleration state (which ramps CLKIN and uses the internal 
+ *  control loop of the driver), and a deceleration state (which uses the brake pin); the zero crossings which 
+ *  switch the direction pin polarity in a deadband of 20rpm happen on the way out of the deceleration state. 
+ *  In the deceleration state a BrakeController PWMs the brake pin so the speed falls at 1000 RPM/s, using 
+ *  the change between the speeds readActual posts to speed_sample, over the time between the edges they 
+ *  were measured from, as the measured deceleration. The length of each braking 
+ *  maneuver and how far the speed fell past its target are printed over serial when the brake is released.
+ * 
+ *  The task sleeps until it is notified of an event: NOTIFY_SPEED from readActual after each speed update, 
+ *  or NOTIFY_COMMAND from post_speed_cmd(). A new command is handled in every state, so it replaces a 
+ *  transition in progress straight away. When a command and a speed arrive together the command is 
+ *  handled first and then the speed, so neither is lost. Commands which were replaced in the speed_cmd 
+ *  mailbox before the task woke are never acted on and are counted as drops. If the mailbox cannot be 
+ *  read because a producer was preempted halfway through a post, the task waits a tick and looks again. 
+ *  While a transition is running the task also times out after 50 ms without an event and re-checks the 
+ *  speed. The time from posting a command to changing the pins is kept in a histogram, which is 
+ *  printed over serial at most once every 10 s.
+ * 
+ *  The DRV8308 loop alone settles with an error that depends on the load, and the state machine stops 
+ *  correcting inside its deadband, so once the state machine is idle (or accelerating with CLKIN already 
+ *  at the command) an outer SpeedPid loop takes over. A periodic esp_timer wakes the task with NOTIFY_PID 
+ *  every 5 ms, whatever the tick rate, and each step compares speed_actual with the command and trims 
+ *  CLKIN by up to 200 RPM, applying the brake when the wheel is well above the command. Its gains can be 
+ *  changed from the web page through the pid_gains mailbox. A new command within the deadband of the one 
+ *  the idle state machine settled on, such as the 1 RPM steps the torque loop posts, only moves the 
+ *  PID's setpoint, so the loop is not reset by them. Any other command hands control back to the state 
+ *  machine until that command is reached.
+ * 
+ *  Each new command and state transition is pushed into the telemetry_events ring with its time, so the 
+ *  telemetry log has them between the speed samples from readActual.
  */
 void task_speedControl(void* parameters)
 {
-    // 0 = idle / stable, 1 = accel, 2 = decel, 3 = hi to lo crossing, 4 = lo to hi crossing
-    uint8_t speed_state = 0; 
-
-    float speed_command = 0.0;      // initialize internal speed command variable to zero
-    float speed_real = 0.0;         // initialize internal actual speed variable to zero
-    bool direction = LOW;           // initialize direction to positive (LO = + in this convention)
-    Peripheral.set_dir(direction);  // set initial direction to positive
+    speedControl_handle = xTaskGetCurrentTaskHandle();
+
+    SpeedFsm fsm(SPEED_DEADBAND);   // decides how to drive the motor toward the command
+    BrakeController brake(BRAKE_DECEL); // sets the brake duty cycle while decelerating
+    rpm_t speed_real = 0;           // latest measured speed
+    Mail<rpm_t> sample = {};        // latest measured speed with the time it was measured
+    FsmOutput out;                  // outputs of the latest event
+    LatencyHistogram reaction;      // time from posting a command to changing the pins
+    uint32_t last_report = millis();// time of the last serial report
+    char line[160];                 // text of the serial report
+    uint32_t bits = 0;              // notification bits received by the task
+    rpm_t speed_command = 0;        // latest speed command from the mailbox
+    Mail<rpm_t> mail;               // latest command with its sequence number and time
+    uint64_t event_us = 0;          // time of the latest command, speed or timeout event
+    SpeedPid pid(PID_PERIOD_US * 1.0e-6f);  // trims CLKIN and the brake once the command is reached
+    Mail<PidGains> gains;           // latest PID gains from the webserver
+    bool pid_on = false;            // true while the PID loop is driving CLKIN
+    uint64_t pid_last_us = 0;       // time of the latest PID step
+    uint32_t pid_overruns = 0;      // PID periods which passed without a step
+
+    // Wakes the task for each PID step while the loop is on
+    esp_timer_handle_t pid_timer;
+    esp_timer_create_args_t pid_args = {};
+    pid_args.callback = pid_callback;
+    pid_args.arg = speedControl_handle;
+    pid_args.name = "PID Timer";
+    esp_timer_create(&pid_args, &pid_timer);
+
+    // the starting gains go in the mailbox so the web page can show them
+    pid.set_gains(PID_GAINS);
+    pid_gains.post(PID_GAINS, esp_timer_get_time());
+
+    Peripheral.set_dir(fsm.get_dir());  // set initial direction to positive
 
     while (true) 
     {        
-        speed_real = speed_actual.get();  // every time the while loop runs it reads the actual speed
-        direction = Peripheral.get_dir(); // read direction pin
-
-        // idle / stable state
-        // includes logic for each of six possibilities for speed comparisons
-        // pos to larger or smaller pos, neg to larger or smaller neg, pos to neg, neg to pos
-        // includes state transitions to accel or decel for each case
-        if (speed_state == 0) 
+        // Sleep until an event arrives; while a transition is running, time out 50 ms after the latest 
+        // event and re-check the speed, counting from the event since the PID timer also wakes the task
+        bits = 0;
+        TickType_t wait = portMAX_DELAY;
+        if (fsm.get_state() != FSM_IDLE)
         {
-            // when speed is zero or stable (+/-20rpm), the task will not run until it gets a speed command
-            speed_command = speed_cmd.get(); 
+            int64_t until_us = (int64_t)(event_us + FSM_TIMEOUT_MS * 1000 - esp_timer_get_time());
+            wait = (until_us > 0) ? (TickType_t)((until_us * configTICK_RATE_HZ + 999999) / 1000000) : 0;
+        }
+        xTaskNotifyWait(0, UINT32_MAX, &bits, wait);
+        uint64_t now_us = esp_timer_get_time();
+
+        bool sampled = speed_sample.take(sample);
+        speed_real = sample.value;
+        fsm.set_actual(speed_real);
+        bool took_command = false;
 
-            // logic for + > ++, - > --, or - > +
-            if (speed_command > speed_real) 
+        if (bits & NOTIFY_COMMAND)
+        {
+            // the mailbox only holds the latest command; older ones count as drops
+            uint32_t failures = speed_cmd.failures();
+            took_command = speed_cmd.take(mail);
+            if (!took_command && speed_cmd.failures() != failures)
+            {
+                // a producer was preempted halfway through a post; let it finish and look again
+                vTaskDelay(1);
+                xTaskNotify(speedControl_handle, NOTIFY_COMMAND, eSetBits);
+            }
+            if (took_command && pid_on && fsm.holds(mail.value))
+            {
+                // a step inside the deadband moves the PID's setpoint without a transition or a reset
+                speed_command = mail.value;
+            }
+            else if (took_command)
             {
-                if (sign(speed_command) == sign(speed_real)) 
+                // the state machine takes over from the PID loop until it reaches the new command
+                if (pid_on && brake_level > 0.0f)
                 {
-                    // positive to larger positive
-                    if (direction == LOW) 
-                    {
-                        // Command speed 
-                        Peripheral.cmd_speed_PWM(fabsf(speed_command)); 
-
-                        // accel
-                        speed_state = 1; 
-                    }
-
-                    // negative to smaller negative
-                    else 
-                    {
-                        // Command zero and brake the motor
-                        Peripheral.cmd_speed_PWM(0);
-                        Peripheral.brake();
-
-                        // decel
-                        speed_state = 2; 
-                    }
+                    brake_level = 0.0f;
+                    Peripheral.unbrake();
                 }
-
-                // negative to positive
-                else
+                if (pid_on)
                 {
-                    Peripheral.cmd_speed_PWM(0);
-                    Peripheral.brake();
-                    // decel
-                    speed_state = 2; 
+                    esp_timer_stop(pid_timer);
+                    pid_on = false;
                 }
-            }
 
-            // logic for ++ > +, -- > -, or + > -
-            else if (speed_command < speed_real) 
-            {
-                if (sign(speed_command) == sign(speed_real))
+                speed_command = mail.value;
+                fsm.set_command(speed_command);
+                out = fsm.dispatch(EV_NEW_COMMAND);
+                apply_fsm_output(out, brake, sample, false, speed_command);
+                if (out.actions != 0)
                 {
-                    // positive to smaller positive
-                    if (direction == LOW)
-                    {
-                        // Command zero and brake the motor
-                        Peripheral.cmd_speed_PWM(0);
-                        Peripheral.brake();
-
-                        // decel
-                        speed_state = 2; 
-                    }
-
-                    // negative to larger negative
-                    else 
-                    {
-                        // Command speed
-                        Peripheral.cmd_speed_PWM(fabsf(speed_command));
-
-                        // accel
-                        speed_state = 1; 
-                    }
+                    reaction.add((uint32_t)(esp_timer_get_time() - mail.posted_us));
                 }
+            }
+        }
 
-                 // positive to negative
-                else
-                {
-                    // Command zero and brake the motor
-                    Peripheral.cmd_speed_PWM(0); 
-                    Peripheral.brake();
+        // a speed which arrived with the command is still acted on, after the command
+        if ((bits & NOTIFY_SPEED) || sampled)
+        {
+            apply_fsm_output(fsm.dispatch(EV_SPEED_UPDATED), brake, sample, sampled, speed_command);
+            event_us = now_us;
+        }
+        else if (!took_command && fsm.get_state() != FSM_IDLE && now_us - event_us >= FSM_TIMEOUT_MS * 1000)
+        {
+            apply_fsm_output(fsm.dispatch(EV_TIMEOUT), brake, sample, false, speed_command);
+            event_us = now_us;
+        }
+        event_us = took_command ? now_us : event_us;
+        decelerating = fsm.get_state() == FSM_DECEL;
+
+        // Log each new command and state transition between the speed samples
+        uint8_t event = (took_command ? TELEMETRY_COMMAND : 0) 
+                        | ((uint8_t)fsm.get_state() != fsm_state ? TELEMETRY_TRANSITION : 0);
+        fsm_command = speed_command;
+        fsm_state = (uint8_t)fsm.get_state();
+        if (event != 0)
+        {
+            telemetry_events.push(make_sample(speed_real, speed_raw.get(), speed_command, fsm_state, event));
+        }
 
-                    // decel
-                    speed_state = 2;
-                }
-            }
+        // The PID loop runs once the state machine is idle, or accelerating with CLKIN already at the 
+        // command because the DRV8308 loop alone leaves the speed outside the deadband
+        bool pid_ready = PID_ENABLE && speed_command != 0 && (fsm.get_state() == FSM_IDLE 
+                         || (fsm.get_state() == FSM_ACCEL && Peripheral.ramp_done()));
+        if (pid_ready && !pid_on)
+        {
+            pid.reset(speed_real);
+            pid_last_us = now_us;
+            esp_timer_start_periodic(pid_timer, PID_PERIOD_US);
+            pid_on = true;
         }
-        
-        // acceleration state, cmd_speed_PWM to desired speed
-        // includes state transition from acceleration state back to idle state
-        else if (speed_state == 1) 
+        else if (!pid_ready && pid_on)
         {
-            // state transition from accel back to idle, deadband 20rpm
-            if (fabsf(speed_real-speed_command) <= 20) 
+            if (brake_level > 0.0f && !decelerating)
             {
-                speed_state = 0;
+                brake_level = 0.0f;
+                Peripheral.unbrake();
             }
-
-            // or delay 10ms until the deadband is reached
-            else {vTaskDelay(10);}
+            esp_timer_stop(pid_timer);
+            pid_on = false;
         }
 
-        // deceleration state, cmd_speed_PWM is at zero
-        // includes logic for no direction change and state transitions for direction changes
-        else if (speed_state == 2) 
+        if (pid_on && (bits & NOTIFY_PID))
         {
-            // no direction change
-            if (sign(speed_command) == sign(speed_real))
-            { 
-                // state transition from decel back to idle, deadband 20rpm
-                if (fabsf(speed_real-speed_command) <= 20) 
-                {
-                    // unbrake first, then command speed to speed command
-                    Peripheral.unbrake();
-                    Peripheral.cmd_speed_PWM(fabsf(speed_command));
-
-                    // return to stable state
-                    speed_state = 0;
-                }
+            if (pid_gains.take(gains))
+            {
+                pid.set_gains(gains.value);
             }
-
-            // direction change
-            else
+            PidOutput trim = pid.update(speed_command, speed_real);
+            Peripheral.cmd_speed_PWM(rpm_abs(trim.clkin));
+            if (trim.brake != brake_level)
             {
-                if (direction == HIGH) // negative to positive
-                {
-                    if (fabsf(speed_real) < 20.0f) // deadband 20rpm
-                    speed_state = 3;
-                }
-                else // positive to negative
-                {
-                    if (fabsf(speed_real) < 20.0f) // deadband 20rpm
-                    speed_state = 4;
-                }
-            }   
+                brake_level = trim.brake;
+                Peripheral.brake_duty(brake_level);
+            }
 
-            // or delay 10ms if the deadband conditions are not met and a state transition
-            // does not occur
-            vTaskDelay(10); 
+            // the timer's notifications merge if the task falls a whole period behind
+            if (now_us - pid_last_us >= 2 * PID_PERIOD_US)
+            {
+                pid_overruns++;
+            }
+            pid_last_us = now_us;
         }
 
-        // HI to LO zero crossing
-        // negative to positive speed
-        // then state transition to accel
-        else if (speed_state == 3) 
+        if (reaction.count() > 0 && millis() - last_report >= FSM_REPORT_MS)
         {
-            // change direction
-            direction = LOW;
-            Peripheral.set_dir(direction);
+            reaction.report(line, sizeof(line), "Speed command reaction");
+            Serial.println(line);
+            Serial.printf("Commands: speed #%lu, %lu dropped, torque %lu dropped, %lu collisions, "
+                          "%lu failed reads\n", (unsigned long)mail.seq, (unsigned long)speed_cmd.drops(), 
+                          (unsigned long)torque_cmd.drops(), 
+                          (unsigned long)(speed_cmd.collisions() + torque_cmd.collisions()),
+                          (unsigned long)(speed_cmd.failures() + torque_cmd.failures()));
+            Serial.printf("Speed PID: %s, integral %.1f rpm, %lu overruns\n", pid_on ? "on" : "off", 
+                          pid.get_integral(), (unsigned long)pid_overruns);
+            reaction.reset();
+            last_report = millis();
+        }
+    }
+}
+
+
+
+/** @brief Task which owns the SPI bus to the DRV8308
+ * 
+ *  @details Other tasks post register writes and reads to the drv_requests queue instead of 
+ *  using SPI themselves, so an HTTP handler never waits for the bus and two tasks can never 
+ *  interleave their frames. The task sleeps until a request arrives, then waits one tick so 
+ *  that every request posted in that tick (such as several gains from one web form) is handled 
+ *  together. Writes go into the register shadow and are sent in one burst by flush(), then reads 
+ *  are done on the chip, so a read sees any write posted before it. Tasks waiting on a read are 
+ *  answered through Driver::complete_read().
+ * 
+ *  The time from posting each request to its completion is kept in a histogram, which is printed 
+ *  over serial with the next batch at most once every 10 s.
+ */
+void task_driverIO(void* parameters)
+{
+    DrvRequest batch[DRV_BATCH_MAX];        // requests handled together
+    uint8_t count = 0;                      // number of requests in batch
+    LatencyHistogram latency;               // time from posting to completion
+    uint32_t last_report = millis();        // time of the last serial report
+    char line[160];                         // text of the serial report
 
-            // unbrake the motor and command the proper speed
-            Peripheral.unbrake();
-            Peripheral.cmd_speed_PWM(fabsf(speed_command));
+    while (true)
+    {
+        // Sleep until a request arrives, then give the rest of this tick's requests time to arrive
+        drv_requests.get(batch[0]);
+        count = 1;
+        vTaskDelay(DRV_BATCH_TICKS);
+        while (count < DRV_BATCH_MAX && drv_requests.any())
+        {
+            drv_requests.get(batch[count++]);
+        }
 
-            // accel
-            speed_state = 1;
+        // Writes are coalesced in the shadow and sent in one burst
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (batch[i].op == DRV_OP_WRITE)
+            {
+                Peripheral.reg_set(batch[i].addr, batch[i].value);
+            }
         }
+        Peripheral.flush();
 
-        // LO to HI zero crossing
-        // positive to negative speed
-        // then state transition to accel
-        else if (speed_state == 4) 
+        // Reads go to the chip after the writes
+        for (uint8_t i = 0; i < count; i++)
         {
-            // change direction
-            direction = HIGH;
-            Peripheral.set_dir(direction);
+            if (batch[i].op == DRV_OP_READ)
+            {
+                batch[i].value = Peripheral.reg_get(batch[i].addr, true);
+            }
+        }
 
-            // unbrake the motor and command the proper speed
-            Peripheral.unbrake();
-            Peripheral.cmd_speed_PWM(fabsf(speed_command));
+        // Report completion
+        uint32_t now = micros();
+        for (uint8_t i = 0; i < count; i++)
+        {
+            latency.add(now - batch[i].posted_us);
+            if (batch[i].op == DRV_OP_READ)
+            {
+                Peripheral.complete_read(batch[i]);
+            }
+        }
 
-            // accel
-            speed_state = 1;
+        if (millis() - last_report >= DRV_REPORT_MS)
+        {
+            latency.report(line, sizeof(line), "DRV I/O latency");
+            Serial.println(line);
+            latency.reset();
+            last_report = millis();
         }
     }
-}
\ No newline at end of file
+}
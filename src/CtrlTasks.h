@@ -5,9 +5,25 @@
 #ifndef _CTRLTASKS_H_
 #define _CTRLTASKS_H_
 
+#include "SpeedType.h"
+
+/** Where the speed command for speedControl comes from */
+enum ControlMode
+{
+    MODE_SPEED,     // speeds posted directly with post_speed_cmd()
+    MODE_TORQUE     // speeds integrated from torques by the torque loop in calcSetpoint
+};
+
+/** These functions are commented in CtrlTasks.cpp */
+void post_speed_cmd(rpm_t speed);
+void post_torque_cmd(float torque);
+ControlMode get_control_mode(void);
+void notify_speedControl(uint32_t bits);
+
 /** These tasks are commented in CtrlTasks.cpp */
 void task_readActual(void* p_params);
 void task_calcSetpoint(void* p_params);
 void task_speedControl(void* p_params);
+void task_driverIO(void* p_params);
 
 #endif
@@ -0,0 +1,100 @@
+/** @file DirectionEstimator.cpp
+ *  This file contains the DirectionEstimator class, which gives the measured speed its
+ *  sign by following the commanded direction through the zero crossing of the wheel.
+*/
+
+#include "DirectionEstimator.h"
+
+
+
+/** @brief Constructor for the DirectionEstimator class
+ *
+ *  @details The wheel is assumed to start stopped with the positive direction commanded,
+ *  which is how Driver::begin() leaves DIR.
+ *
+ *  @param rise_rpm_ How far the speed has to rise above its minimum after a reversal
+ *  before the new direction is accepted. This keeps noise on a falling speed from being
+ *  taken as the turnaround.
+ */
+DirectionEstimator::DirectionEstimator(float rise_rpm_)
+{
+    measured_neg = false;
+    commanded_neg = false;
+    pending = false;
+    min_speed = 0;
+    rise = rpm_from_float(rise_rpm_);
+}
+
+
+
+/** @brief A function which records the direction commanded on DIR
+ *
+ *  @details Commanding the direction the wheel is already turning cancels any reversal
+ *  in progress. Commanding the other direction starts watching for the turnaround.
+ *
+ *  @param negative True if DIR now commands the negative direction.
+ */
+void DirectionEstimator::command(bool negative)
+{
+    if (negative == commanded_neg)
+    {
+        return;
+    }
+    commanded_neg = negative;
+
+    if (commanded_neg == measured_neg)
+    {
+        pending = false;
+    }
+    else
+    {
+        pending = true;
+        min_speed = INT32_MAX;
+    }
+}
+
+
+
+/** @brief A function which signs a new speed measurement
+ *
+ *  @details While a reversal is pending the speed magnitude falls until the wheel stops
+ *  and then grows in the new direction. The FGOUT speed never reaches zero because the
+ *  periods near a stop are very long, so the turnaround is taken to be the point where
+ *  the speed has risen @c rise above the smallest speed seen since DIR changed.
+ *
+ *  @param speed The speed magnitude from the estimator.
+ *
+ *  @return The speed with the sign of the direction of rotation.
+ */
+rpm_t DirectionEstimator::update(rpm_t speed)
+{
+    speed = rpm_abs(speed);
+
+    if (pending)
+    {
+        if (speed < min_speed)
+        {
+            min_speed = speed;
+        }
+        else if (speed - min_speed > rise)
+        {
+            measured_neg = commanded_neg;
+            pending = false;
+        }
+    }
+
+    return measured_neg ? -speed : speed;
+}
+
+
+
+/** @brief A function which records that the wheel has stopped
+ *
+ *  @details Once zero speed is reported the wheel can only start again in the commanded
+ *  direction, so any pending reversal is complete.
+ */
+void DirectionEstimator::stopped(void)
+{
+    measured_neg = commanded_neg;
+    pending = false;
+}
@@ -0,0 +1,62 @@
+/** @file DirectionEstimator.h
+ *  This file contains the DirectionEstimator class, which gives the measured speed its
+ *  sign. FGOUT only carries the speed magnitude and the Hall signals are not routed to
+ *  the ESP32, so the direction of rotation has to be inferred. When DIR is reversed while
+ *  the wheel is turning, the DRV8308 drives against the rotation: the wheel keeps its old
+ *  direction while the speed falls, passes through zero, and only then speeds up the new
+ *  way. The estimator holds the old sign until the measured speed stops falling and rises
+ *  again, or the wheel is reported stopped.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _DIRECTIONESTIMATOR_H_
+#define _DIRECTIONESTIMATOR_H_
+
+#include <stdint.h>
+#include "SpeedType.h"
+
+/** This class is used to track the direction of rotation from the commanded direction */
+class DirectionEstimator
+{
+    protected:
+
+        bool measured_neg;          // direction the wheel is believed to be turning, true = negative
+        bool commanded_neg;         // direction most recently commanded on DIR, true = negative
+        bool pending;               // true while a reversal has been commanded but not yet seen
+        rpm_t min_speed;            // smallest speed magnitude seen since the reversal was commanded
+        rpm_t rise;                 // rise above min_speed which shows the wheel has turned around
+
+    public:
+
+        /** Non-inline functions are commented in DirectionEstimator.cpp */
+        DirectionEstimator(float rise_rpm_ = 10.0f);
+
+        void command(bool negative);
+        rpm_t update(rpm_t speed);
+        void stopped(void);
+
+
+
+        /** @brief A function which reports the direction of rotation
+         *
+         *  @return True if the wheel is believed to be turning in the negative direction.
+         */
+        bool is_negative(void)
+        {
+            return measured_neg;
+        }
+
+
+
+        /** @brief A function which reports whether a reversal is still in progress
+         *
+         *  @return True if DIR has been reversed but the wheel has not turned around yet.
+         */
+        bool is_pending(void)
+        {
+            return pending;
+        }
+};
+
+#endif
@@ -12,6 +12,10 @@
 #include <SPI.h>
 #include "Driver.h"
 #include "Shares.h"
+#include "hal/mcpwm_ll.h"
+#include "soc/mcpwm_struct.h"
+#include "driver/periph_ctrl.h"
+#include "esp_intr_alloc.h"
 #include <PrintStream.h>
 
 
@@ -21,9 +25,13 @@ SPIClass vspi(VSPI);
 
 
 
-// A queue which uses an ISR to trigger the readActual task and calculate the motor speed by reading the square wave 
-// frequency on the FGOUT pin
-extern Queue<uint32_t> edge_time;
+// A ring buffer which the FGOUT capture backend fills with edge timestamps for the readActual task
+extern EdgeRing edge_ring;
+
+
+
+// A queue of register accesses which the driver I/O task performs for other tasks
+extern Queue<DrvRequest> drv_requests;
 
 
 
@@ -38,6 +46,7 @@ Driver* Driver::_instance = nullptr;
  *  and during both idle and transient states.
  */
 Driver::Driver(void)
+    : spi_bus(&vspi), registers(spi_bus)
 {
     data16 = 0;
     msb = 0;
@@ -59,6 +68,21 @@ Driver::Driver(void)
     COMPK1 = 100;
     COMPK2 = 100;
     _lastEdgeTime = 0;
+    dir_state = LOW;
+    set_capture_mode(CAPTURE_MCPWM);
+    set_clkin_mode(CLKIN_MCPWM);
+    ramp.set_period(RAMP_PERIOD_US * 1.0e-6f);
+    ramp_timer = NULL;
+    portMUX_INITIALIZE(&ramp_mux);
+    portMUX_INITIALIZE(&edge_mux);
+    edge_ref_ticks = 0;
+    read_mutex = NULL;
+    read_done = NULL;
+    read_seq = 0;
+    reply_seq = 0;
+    reply_value = 0;
+    edge_ref_us = 0;
+    set_edge_notify(NULL, 4);
     _instance = this;
 }
 
@@ -74,6 +98,7 @@ Driver::Driver(void)
  *  @param COMPK2_ setting the coefficient for the compensator zero
  */
 Driver::Driver(uint8_t FILK1_, uint8_t FILK2_, uint8_t COMPK1_, uint8_t COMPK2_)
+    : spi_bus(&vspi), registers(spi_bus)
 {
     data16 = 0;
     msb = 0;
@@ -95,6 +120,21 @@ Driver::Driver(uint8_t FILK1_, uint8_t FILK2_, uint8_t COMPK1_, uint8_t COMPK2_)
     COMPK1 = COMPK1_;
     COMPK2 = COMPK2_;
     _lastEdgeTime = 0;
+    dir_state = LOW;
+    set_capture_mode(CAPTURE_MCPWM);
+    set_clkin_mode(CLKIN_MCPWM);
+    ramp.set_period(RAMP_PERIOD_US * 1.0e-6f);
+    ramp_timer = NULL;
+    portMUX_INITIALIZE(&ramp_mux);
+    portMUX_INITIALIZE(&edge_mux);
+    edge_ref_ticks = 0;
+    read_mutex = NULL;
+    read_done = NULL;
+    read_seq = 0;
+    reply_seq = 0;
+    reply_value = 0;
+    edge_ref_us = 0;
+    set_edge_notify(NULL, 4);
     _instance = this;
 }
 
@@ -103,13 +143,15 @@ Driver::Driver(uint8_t FILK1_, uint8_t FILK2_, uint8_t COMPK1_, uint8_t COMPK2_)
 /** @brief A function which initializes the DRV8308
  * 
  *  @details This function sets each pin as an input or output, 
- *  attaches an interrupt to FGOUT so it can read square wave rising edges,
+ *  attaches the FGOUT capture backend (MCPWM capture or a GPIO interrupt, see
+ *  set_capture_mode()) so it can read square wave rising edges,
  *  enables the DRV8308, 
  *  unbrakes it from any previous operation,
  *  initializes the direction to be forward,
  *  begins SPI communication,
  *  writes initial gains to the DRV8308 chip,
- *  and sets up the CLKIN pin to output a square wave to output 50% duty cycle.
+ *  and sets up the CLKIN pin to output a square wave with 50% duty cycle (MCPWM or LEDC,
+ *  see set_clkin_mode()), held low until a speed is commanded.
  * 
  *  @bug The unbrake() does not actually work, sometimes you have to manually
  *  spin the motor before it starts taking commands again.
@@ -117,7 +159,6 @@ Driver::Driver(uint8_t FILK1_, uint8_t FILK2_, uint8_t COMPK1_, uint8_t COMPK2_)
 void Driver::begin() 
 {
     // Pin input/output definitions
-    pinMode(PIN_SCS, OUTPUT);
     pinMode(PIN_EN, OUTPUT);
     pinMode(PIN_FGOUT, INPUT);
     pinMode(PIN_FAULTn, INPUT);
@@ -126,10 +167,38 @@ void Driver::begin()
     pinMode(PIN_RESET, OUTPUT);
     digitalWrite(PIN_RESET, LOW); // Keep RESET low for nominal operation
     pinMode(PIN_BRAKE, OUTPUT);   
+    ledcSetup(BRAKE_LEDC_CHANNEL, BRAKE_PWM_HZ, BRAKE_PWM_BITS); // PWM on BRAKE for the brake controller
+    ledcAttachPin(PIN_BRAKE, BRAKE_LEDC_CHANNEL);
     pinMode(PIN_DIR, OUTPUT);
 
-    // Attach interrupt on fgout pin (rising edge only)
-    attachInterrupt(digitalPinToInterrupt(PIN_FGOUT), ISR_wrapper, RISING);
+    // Timestamp rising edges on FGOUT
+    if (capture_mode == CAPTURE_MCPWM)
+    {
+        // The capture unit latches the APB clock timer on each rising edge in hardware. The
+        // driver's own capture interrupt is only in IRAM if the IDF is built with
+        // CONFIG_MCPWM_ISR_IN_IRAM, which the Arduino core is not, so the channel is set up
+        // directly and capture_isr is registered with ESP_INTR_FLAG_IRAM to keep taking
+        // edges while the recorder writes or erases the flash
+        periph_module_enable(PERIPH_PWM0_MODULE);
+        mcpwm_gpio_init(MCPWM_UNIT_0, MCPWM_CAP_0, PIN_FGOUT);
+        mcpwm_ll_capture_enable_timer(&MCPWM0, true);
+        mcpwm_ll_capture_enable_channel(&MCPWM0, 0, true);
+        mcpwm_ll_capture_enable_posedge(&MCPWM0, 0, true);
+        mcpwm_ll_capture_enable_negedge(&MCPWM0, 0, false);
+        mcpwm_ll_capture_set_prescale(&MCPWM0, 0, 1);
+        mcpwm_ll_intr_clear_capture_status(&MCPWM0, 1 << 0);
+        mcpwm_ll_intr_enable_capture(&MCPWM0, 0, true);
+        mcpwm_isr_register(MCPWM_UNIT_0, capture_isr, NULL, ESP_INTR_FLAG_IRAM, NULL);
+    }
+    else
+    {
+        // Attach interrupt on fgout pin (rising edge only)
+        attachInterrupt(digitalPinToInterrupt(PIN_FGOUT), ISR_wrapper, RISING);
+    }
+
+    // Register reads from other tasks are answered through a semaphore, not their notifications
+    read_mutex = xSemaphoreCreateMutex();
+    read_done = xSemaphoreCreateBinary();
 
     // Initialize the driver
     enable();  // Enable the driver
@@ -137,56 +206,92 @@ void Driver::begin()
     set_dir(LOW); // Set direction forward
 
     // SPI setup
-    // PIN_SCS is set to -1 because we control that manually using scs_begin() and scs_end()
-    // SPI defaults to ACTIVE LOW but the DRV8308 is ACTIVE HIGH so we control it manually
-    vspi.begin(PIN_SCLK, PIN_MISO, PIN_MOSI, -1);  // VSPI pins
-
-    // Initial register programming
-    drv_write(0x00, 0x2000);
-    Serial.print("0x00 expect 0x2000, got 0x"); Serial.println(drv_read(0x00), HEX);
-
-    // set MOD120 to 3970 as per DRV8308EVM users guide
-    drv_write(0x03, 0b00000111110000010);
-    Serial.print("0x03 expect 0xF82, got 0x"); Serial.println(drv_read(0x03), HEX);
-
-    // set AUTOGAIN to 1
-    drv_write(0x04, 0x0200);
-    Serial.print("0x04 expect 0x0200, got 0x"); Serial.println(drv_read(0x04), HEX);
-
-    // set SPDGAIN to 2048 and intclk to 000
-    drv_write(0x05, 0x0800);
-    Serial.print("0x05 expect 0x0800, got 0x"); Serial.println(drv_read(0x05), HEX);
-
-    // set FILK1
-    drv_write(0x06, FILK1);
-    Serial.print("0x06 expect 0x007F, got 0x"); Serial.println(drv_read(0x06), HEX);
+    // SPI defaults to ACTIVE LOW but the DRV8308 is ACTIVE HIGH, so spi_bus drives SCS itself
+    spi_bus.begin(PIN_SCLK, PIN_MISO, PIN_MOSI, PIN_SCS);
+
+    // Initial register programming, written in one burst and then read back to check it
+    DrvReg boot_regs[] =
+    {
+        {0x00, 0x2000},     // set the control register
+        {0x03, 0x0F82},     // set MOD120 to 3970 as per DRV8308EVM users guide
+        {0x04, 0x0200},     // set AUTOGAIN to 1
+        {0x05, 0x0800},     // set SPDGAIN to 2048 and intclk to 000
+        {0x06, FILK1},      // set FILK1
+        {0x07, FILK2},      // set FILK2
+        {0x08, COMPK1},     // set COMPK1
+        {0x09, COMPK2},     // set COMPK2, AUTOADV is here, setting to zero for now
+        {0x0A, 0x0200},     // set LOOPGAIN to 512
+        {0x0B, 0x0500}      // set SPEED to 1280
+    };
+    const uint8_t boot_count = sizeof(boot_regs) / sizeof(boot_regs[0]);
+
+    // The chip keeps its registers through a reset of the ESP32, so every one is written
+    for (uint8_t i = 0; i < boot_count; i++)
+    {
+        registers.set(boot_regs[i].addr, boot_regs[i].value, true);
+    }
 
-    // set FILK2
-    drv_write(0x07, FILK2);
-    Serial.print("0x07 expect 0x01FB, got 0x"); Serial.println(drv_read(0x07), HEX);
+    unsigned long start_us = micros();
+    uint8_t written = flush();
+    unsigned long burst_us = micros() - start_us;
+    Serial.print("Wrote "); Serial.print(written); Serial.print(" registers at ");
+    Serial.print(spi_bus.get_clock() / 1000); Serial.print(" kHz in "); Serial.print(burst_us); Serial.println(" us");
+
+    for (uint8_t i = 0; i < boot_count; i++)
+    {
+        Serial.print("0x"); Serial.print(boot_regs[i].addr, HEX);
+        Serial.print(" expect 0x"); Serial.print(boot_regs[i].value, HEX);
+        Serial.print(", got 0x"); Serial.println(reg_get(boot_regs[i].addr, true), HEX);
+    }
 
-    // set COMPK1
-    drv_write(0x08, COMPK1);
-    Serial.print("0x08 expect 0x007F, got 0x"); Serial.println(drv_read(0x08), HEX);
+    // Setup CLKIN for square wave output
+    // The internal control loop in the DRV8308 matches the frequency input on CLKIN 
+    // to the motor electrical frequency output on FGOUT
+    if (clkin_mode == CLKIN_MCPWM)
+    {
+        // MCPWM unit 1 timer 0 counts up from the 10 MHz group clock and drives CLKIN from 
+        // operator 0 output A; unit 0 is used by the FGOUT capture
+        mcpwm_gpio_init(MCPWM_UNIT_1, MCPWM0A, PIN_CLKIN);
+        mcpwm_config_t pwm_conf;
+        pwm_conf.frequency = 100;
+        pwm_conf.cmpr_a = 50.0;
+        pwm_conf.cmpr_b = 0.0;
+        pwm_conf.duty_mode = MCPWM_DUTY_MODE_0;
+        pwm_conf.counter_mode = MCPWM_UP_COUNTER;
+        mcpwm_init(MCPWM_UNIT_1, MCPWM_TIMER_0, &pwm_conf);
+
+        // New periods and compare values only take effect when the timer wraps to zero, 
+        // so retuning never cuts a cycle short
+        mcpwm_ll_timer_enable_update_period_on_tez(&MCPWM1, 0, true);
+        mcpwm_ll_operator_enable_update_compare_on_tez(&MCPWM1, 0, 0, true);
+        cmd_clkin(0);
+    }
+    else
+    {
+        ledcSetup(0, 100, 8); // channel 0, 20 kHz, 8-bit resolution
+        ledcAttachPin(PIN_CLKIN, 0); // attach PIN_CLKIN to
+    }
 
-    // set COMPK2
-    // AUTOADV is here, setting to zero for now
-    drv_write(0x09, COMPK2);
-    Serial.print("0x09 expect 0x22A3, got 0x"); Serial.println(drv_read(0x09), HEX);
+    // Periodic timer which streams the speed ramp to CLKIN, started by cmd_speed_ramp()
+    esp_timer_create_args_t ramp_args = {};
+    ramp_args.callback = ramp_callback;
+    ramp_args.arg = this;
+    ramp_args.name = "Speed Ramp";
+    esp_timer_create(&ramp_args, &ramp_timer);
+}
 
-    // set LOOPGAIN to 512
-    drv_write(0x0A, 0x00000200);
-    Serial.print("0x0A expect 0x0200, got 0x"); Serial.println(drv_read(0x0A), HEX);
 
-    // set SPEED to 1280
-    drv_write(0x0B, 0x0500);
-    Serial.print("0x0B expect 0x0500, got 0x"); Serial.println(drv_read(0x0B), HEX);
 
-    // Setup CLKIN for square wave output
-    // The internal control loop in the DRV8308 matches the frequency input on CLKIN 
-    // to the motor electrical frequency output on FGOUT
-    ledcSetup(0, 100, 8); // channel 0, 20 kHz, 8-bit resolution
-    ledcAttachPin(PIN_CLKIN, 0); // attach PIN_CLKIN to
+/** @brief A function which sets the SPI clock used for the DRV8308
+ * 
+ *  @details The clock is limited to 16 MHz by the 62 ns minimum tCYC in the DRV8308 
+ *  datasheet; see DrvSpiBus::set_clock().
+ * 
+ *  @param hz The desired SPI clock in Hz.
+ */
+void Driver::set_spi_clock(uint32_t hz)
+{
+    spi_bus.set_clock(hz);
 }
 
 
@@ -205,16 +310,25 @@ void Driver::begin()
  */
 void Driver::drv_write(uint8_t addr7, uint16_t message) 
 {
-    vspi.beginTransaction(SPISettings(10000, MSBFIRST, SPI_MODE0)); // 1 MHz, Mode 0
-    scs_begin();
-    delayMicroseconds(1); // Setup time for SCS
-    vspi.transfer((0u << 7) | (addr7 & 0x7F));
-    vspi.transfer((uint8_t)(message >> 8));
-    vspi.transfer((uint8_t)(message & 0xFF));
-    delayMicroseconds(1); // Hold time for data
-    scs_end();
-    vspi.endTransaction();
-    delayMicroseconds(5); // Recovery time between transactions
+    registers.write(addr7, message);
+}
+
+
+
+/** @brief A function which writes several registers on the DRV8308
+ * 
+ *  @details Each register is its own 24-bit frame with SCS high (1 write bit, 7 address 
+ *  bits and 16 data bits), but the bus is only acquired once and SCS is held low for just 
+ *  the 100 ns the datasheet requires between frames. At 1 MHz a frame takes 24 us, so a 
+ *  burst costs little more than the bits themselves. The frames are built by DrvRegisters 
+ *  and sent through the SpiBus interface, so they can be checked on a PC.
+ * 
+ *  @param regs The registers to write, in order.
+ *  @param count The number of registers in regs.
+ */
+void Driver::drv_write_burst(const DrvReg* regs, uint8_t count)
+{
+    registers.write_burst(regs, count);
 }
 
 
@@ -235,17 +349,150 @@ void Driver::drv_write(uint8_t addr7, uint16_t message)
  */
 uint16_t Driver::drv_read(uint8_t addr7)  
 {
-    vspi.beginTransaction(SPISettings(10000, MSBFIRST, SPI_MODE0)); // Same mode as write
-    scs_begin();
-    delayMicroseconds(1); // Setup time for SCS
-    vspi.transfer((1u << 7) | (addr7 & 0x7F));
-    msb = vspi.transfer(0x00);
-    lsb = vspi.transfer(0x00);
-    delayMicroseconds(1); // Hold time for data
-    scs_end();
-    vspi.endTransaction();
-    delayMicroseconds(5); // Recovery time
-    return (uint16_t(msb) << 8) | lsb;
+    uint16_t value = registers.read(addr7);
+    msb = (uint8_t)(value >> 8);
+    lsb = (uint8_t)(value & 0xFF);
+    return value;
+}
+
+
+
+/** @brief A function which changes a register in the shadow copy
+ * 
+ *  @details Nothing is sent to the chip until flush() is called, so several changes to 
+ *  the same register cost one write, and setting a register to the value it already has 
+ *  costs nothing; see DrvRegisters::set().
+ * 
+ *  After the tasks start, only the driver I/O task calls this; other tasks use 
+ *  request_write().
+ * 
+ *  @param addr7 The 7-bit register address.
+ *  @param value The new 16-bit register value.
+ */
+void Driver::reg_set(uint8_t addr7, uint16_t value)
+{
+    registers.set(addr7, value);
+}
+
+
+
+/** @brief A function which returns the value of a register
+ * 
+ *  @details The value comes from the shadow copy without any SPI traffic, unless a 
+ *  hardware read is forced or the address is outside the shadow; see DrvRegisters::get().
+ * 
+ *  @param addr7 The 7-bit register address.
+ *  @param force True to read the register from the chip.
+ * 
+ *  @return The 16-bit register value.
+ */
+uint16_t Driver::reg_get(uint8_t addr7, bool force)
+{
+    return registers.get(addr7, force);
+}
+
+
+
+/** @brief A function which writes every changed register to the chip
+ * 
+ *  @details The changed registers are collected in address order and written in a 
+ *  single burst.
+ * 
+ *  @return The number of registers written.
+ */
+uint8_t Driver::flush(void)
+{
+    return registers.flush();
+}
+
+
+
+/** @brief A function which asks the driver I/O task to write a register
+ * 
+ *  @details Once the tasks are running the I/O task owns the SPI bus, so other tasks 
+ *  post their register changes instead of calling reg_set() and flush(). This returns 
+ *  as soon as the request is queued; the I/O task collects the changes posted within 
+ *  one tick and writes them in a single burst.
+ * 
+ *  @param addr7 The 7-bit register address.
+ *  @param value The new 16-bit register value.
+ */
+void Driver::request_write(uint8_t addr7, uint16_t value)
+{
+    DrvRequest request;
+    request.op = DRV_OP_WRITE;
+    request.addr = addr7;
+    request.value = value;
+    request.seq = 0;
+    request.posted_us = micros();
+    drv_requests.put(request);
+}
+
+
+
+/** @brief A function which asks the driver I/O task to read a register from the chip
+ * 
+ *  @details The calling task blocks until the I/O task has read the register and answered 
+ *  through complete_read(). The answer comes through a semaphore rather than a task 
+ *  notification, so any task can read, including those woken with NOTIFY_ bits. One task 
+ *  at a time waits on a read; each read is numbered, and a late answer to a read which timed 
+ *  out is skipped. Values in the shadow can be read at any time with reg_get(), which needs 
+ *  no SPI traffic.
+ * 
+ *  @param addr7 The 7-bit register address.
+ *  @param value Filled in with the 16-bit register value.
+ *  @param wait The longest time to wait for the read, in ticks.
+ * 
+ *  @return True if the read completed in time.
+ */
+bool Driver::request_read(uint8_t addr7, uint16_t& value, TickType_t wait)
+{
+    TickType_t start = xTaskGetTickCount();
+    if (read_mutex == NULL || xSemaphoreTake(read_mutex, wait) != pdTRUE)
+    {
+        return false;
+    }
+
+    DrvRequest request;
+    request.op = DRV_OP_READ;
+    request.addr = addr7;
+    request.value = 0;
+    request.seq = (++read_seq != 0) ? read_seq : ++read_seq;
+    request.posted_us = micros();
+    drv_requests.put(request);
+
+    bool answered = false;
+    while (!answered)
+    {
+        TickType_t spent = xTaskGetTickCount() - start;
+        if (spent >= wait || xSemaphoreTake(read_done, wait - spent) != pdTRUE)
+        {
+            break;
+        }
+        answered = reply_seq == request.seq;
+    }
+    if (answered)
+    {
+        value = reply_value;
+    }
+    xSemaphoreGive(read_mutex);
+    return answered;
+}
+
+
+
+/** @brief A function which answers a read posted by request_read()
+ * 
+ *  @details Only the driver I/O task calls this, once it has read the register into the 
+ *  request.
+ * 
+ *  @param request The completed read.
+ */
+void Driver::complete_read(const DrvRequest& request)
+{
+    reply_value = request.value;
+    reply_seq = request.seq;
+    xSemaphoreGive(read_done);
 }
 
 
@@ -256,13 +503,144 @@ uint16_t Driver::drv_read(uint8_t addr7)
  *  at the desired electrical frequency of the motor. From an equation on the 
  *  DRV8308 datasheet, the electrical frequency is equal to RPM / 15. 
  * 
- *  @param SPEED_CMD The desired rpm speed of the motor.
+ *  @param SPEED_CMD The desired rpm speed of the motor. The sign is ignored; the 
+ *  direction is set with set_dir().
+ */
+void Driver::cmd_speed_PWM(rpm_t SPEED_CMD)
+{
+    uint32_t freq_mhz = rpm_to_clkin_mhz(SPEED_CMD);
+
+    // A direct command cancels any ramp, and the next ramp starts from this speed
+    if (ramp_timer != NULL)
+    {
+        esp_timer_stop(ramp_timer);
+    }
+    portENTER_CRITICAL(&ramp_mux);
+    ramp.reset(rpm_abs(SPEED_CMD));
+    if (clkin_mode == CLKIN_MCPWM)
+    {
+        cmd_clkin(freq_mhz);
+    }
+    portEXIT_CRITICAL(&ramp_mux);
+
+    if (clkin_mode == CLKIN_LEDC)
+    {
+        ledcWriteTone(0, freq_mhz / 1000.0); // Set the frequency of the PWM signal on channel 0
+    }
+}
+
+
+
+/** @brief A function which ramps the CLKIN frequency to a new speed
+ * 
+ *  @details Instead of stepping CLKIN to the new speed, which saturates the DRV8308 speed 
+ *  loop, a SpeedRamp moves the commanded speed from the speed currently on CLKIN with 
+ *  limited acceleration and jerk. A periodic esp_timer steps the ramp every RAMP_PERIOD_US 
+ *  and writes each step to CLKIN, so the profile timing does not depend on task scheduling. 
+ *  The timer stops itself when the target is reached. A new target in the middle of a ramp 
+ *  continues smoothly from the current speed and acceleration.
+ * 
+ *  @param SPEED_CMD The desired rpm speed of the motor. The sign is ignored; the 
+ *  direction is set with set_dir().
+ */
+void Driver::cmd_speed_ramp(rpm_t SPEED_CMD)
+{
+    if (ramp_timer == NULL)
+    {
+        cmd_speed_PWM(SPEED_CMD);
+        return;
+    }
+
+    portENTER_CRITICAL(&ramp_mux);
+    ramp.set_target(rpm_abs(SPEED_CMD));
+    portEXIT_CRITICAL(&ramp_mux);
+
+    // restarting also covers a timer which stopped itself just before the new target
+    esp_timer_stop(ramp_timer);
+    esp_timer_start_periodic(ramp_timer, RAMP_PERIOD_US);
+}
+
+
+
+/** @brief Callback for the speed ramp timer
+ * 
+ *  @details This runs in the esp_timer task every RAMP_PERIOD_US while a ramp is in 
+ *  progress. It advances the ramp by one step and writes the new speed to CLKIN, and
+ *  stops the timer once the target is reached unless a new target has been set since.
+ * 
+ *  @param arg The Driver object which owns the ramp.
  */
-void Driver::cmd_speed_PWM(float SPEED_CMD)
+void Driver::ramp_callback(void* arg)
 {
-    double freq = SPEED_CMD / 15;
-    ledcWriteTone(0, freq); // Set the frequency of the PWM signal on channel 0
+    Driver* drv = (Driver*)arg;
+
+    portENTER_CRITICAL(&drv->ramp_mux);
+    rpm_t speed = drv->ramp.step();
+    bool finished = drv->ramp.done();
+    if (drv->clkin_mode == CLKIN_MCPWM)
+    {
+        drv->cmd_clkin(rpm_to_clkin_mhz(speed));
+    }
+    portEXIT_CRITICAL(&drv->ramp_mux);
 
+    // The LEDC driver takes a lock, so it cannot be retuned inside the critical section
+    if (drv->clkin_mode == CLKIN_LEDC)
+    {
+        ledcWriteTone(0, rpm_to_clkin_mhz(speed) / 1000.0);
+    }
+
+    // A task can set a new target between the check above and the stop, and restart the
+    // timer before this stops it, so the ramp is checked again under the lock afterwards
+    if (finished)
+    {
+        esp_timer_stop(drv->ramp_timer);
+
+        portENTER_CRITICAL(&drv->ramp_mux);
+        bool retargeted = !drv->ramp.done();
+        portEXIT_CRITICAL(&drv->ramp_mux);
+        if (retargeted)
+        {
+            // fails harmlessly if the task's own restart came after the stop
+            esp_timer_start_periodic(drv->ramp_timer, RAMP_PERIOD_US);
+        }
+    }
+}
+
+
+
+/** @brief A function which sets the frequency of the MCPWM CLKIN output
+ * 
+ *  @details The ClkinSynth picks the timer prescaler and period. The period and the 50% 
+ *  compare value are double buffered and load when the timer wraps, so the output changes 
+ *  frequency at the end of a cycle without a glitch. The prescaler is not buffered, so the 
+ *  one cycle in progress when it changes may be stretched or shortened; the ClkinSynth only 
+ *  changes it when the frequency moves by about a factor of four. Below about 0.6 Hz the 
+ *  output is held low.
+ * 
+ *  @param freq_mhz The CLKIN frequency in millihertz.
+ */
+void Driver::cmd_clkin(uint32_t freq_mhz)
+{
+    bool was_running = clkin.is_running();
+    bool new_prescale = clkin.tune(freq_mhz);
+
+    if (!clkin.is_running())
+    {
+        mcpwm_set_signal_low(MCPWM_UNIT_1, MCPWM_TIMER_0, MCPWM_OPR_A);
+        return;
+    }
+
+    if (new_prescale || !was_running)
+    {
+        mcpwm_ll_timer_set_count_prescale(&MCPWM1, 0, clkin.get_prescale());
+    }
+    mcpwm_ll_timer_set_peak(&MCPWM1, 0, clkin.get_period(), false);
+    mcpwm_ll_operator_set_compare_value(&MCPWM1, 0, 0, clkin.get_period() / 2);
+
+    if (!was_running)
+    {
+        mcpwm_set_duty_type(MCPWM_UNIT_1, MCPWM_TIMER_0, MCPWM_OPR_A, MCPWM_DUTY_MODE_0);
+    }
 }
 
 
@@ -272,7 +650,7 @@ void Driver::cmd_speed_PWM(float SPEED_CMD)
 /** @brief An ISR wrapper function which calls a different 
  *  function once the ISR is triggered.
  */
-void Driver::ISR_wrapper() 
+void IRAM_ATTR Driver::ISR_wrapper() 
 {
     if (_instance) {
         _instance->handleISR();
@@ -281,14 +659,92 @@ void Driver::ISR_wrapper()
 
 
 
-/** @brief an ISR handler which puts the timestamp at which
- *  the function is called into the edge_time queue.
+/** @brief An ISR for the MCPWM capture unit which passes the hardware timestamp
+ *  of a rising edge on to the driver object.
+ * 
+ *  @details It is registered with ESP_INTR_FLAG_IRAM, so it runs while the flash
+ *  cache is off. The LL helpers it calls are inlined register accesses.
+ */
+void IRAM_ATTR Driver::capture_isr(void* arg)
+{
+    uint32_t status = mcpwm_ll_intr_get_capture_status(&MCPWM0);
+    mcpwm_ll_intr_clear_capture_status(&MCPWM0, status);
+    if ((status & 1) && _instance && _instance->handleEdge(mcpwm_ll_capture_get_value(&MCPWM0, 0)))
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+
+
+/** @brief an ISR handler which timestamps a rising edge with micros()
+ *  when the GPIO capture backend is selected.
  */
-void Driver::handleISR() 
+void IRAM_ATTR Driver::handleISR() 
 {
     // Very fast: capture timestamp and set flag
     _lastEdgeTime = micros();
 
-    edge_time.put(_lastEdgeTime);
+    if (handleEdge(_lastEdgeTime))
+    {
+        portYIELD_FROM_ISR();
+    }
 }
 
+
+
+/** @brief A function which pushes a rising edge timestamp into edge_ring and
+ *  notifies the readActual task once every notify_edges edges.
+ * 
+ *  @details Pushing into the ring is wait-free, so no kernel critical section is taken
+ *  for each edge. If the ring is full the edge is counted in edge_ring.overflows(). The
+ *  esp_timer time of the edge is also kept as the reference for edge_time_us(); the
+ *  critical section for it is only a few instructions long.
+ * 
+ *  @param ticks The edge timestamp in capture ticks (see capture_ticks_per_us()).
+ * 
+ *  @return True if the notified task has a higher priority than the interrupted one.
+ */
+bool IRAM_ATTR Driver::handleEdge(uint32_t ticks)
+{
+    edge_ring.push(ticks);
+
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&edge_mux);
+    edge_ref_ticks = ticks;
+    edge_ref_us = now_us;
+    portEXIT_CRITICAL_ISR(&edge_mux);
+
+    BaseType_t woken = pdFALSE;
+    if (edge_task != NULL && ++_pending_edges >= notify_edges)
+    {
+        _pending_edges = 0;
+        xTaskNotifyFromISR(edge_task, NOTIFY_EDGES, eSetBits, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+
+
+/** @brief A function which converts an edge timestamp to the esp_timer clock
+ * 
+ *  @details The capture timer cannot be read by software, so the ISR keeps the esp_timer
+ *  time at which it handled the latest edge along with that edge's timestamp. Other edges
+ *  are placed from their distance to it in capture ticks, so the result is off only by the
+ *  interrupt latency of the latest edge, however long the task took to get to the edges.
+ * 
+ *  @param ticks An edge timestamp in capture ticks, within about 26 s of the latest edge.
+ * 
+ *  @return The time at which the edge arrived, on the esp_timer_get_time() clock.
+ */
+int64_t Driver::edge_time_us(uint32_t ticks)
+{
+    portENTER_CRITICAL(&edge_mux);
+    uint32_t ref_ticks = edge_ref_ticks;
+    int64_t ref_us = edge_ref_us;
+    portEXIT_CRITICAL(&edge_mux);
+
+    // edges before the latest one give a negative distance
+    int32_t distance = (int32_t)(ticks - ref_ticks);
+    return ref_us + distance / (int32_t)capture_ticks_per_us();
+}
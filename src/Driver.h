@@ -13,6 +13,53 @@
 
 #include <Arduino.h>
 #include <SPI.h>
+#include "driver/mcpwm.h"
+#include "SpeedType.h"
+#include "ClkinSynth.h"
+#include "SpeedRamp.h"
+#include "esp_timer.h"
+#include "DrvSpiBus.h"
+#include "DrvRegisters.h"
+
+/** The operations the driver I/O task performs for other tasks */
+enum DrvOp
+{
+    DRV_OP_WRITE,       // change a register in the shadow, written in the next flush
+    DRV_OP_READ         // read a register from the chip
+};
+
+/** A register access posted to the driver I/O task */
+struct DrvRequest
+{
+    DrvOp op;               // what to do
+    uint8_t addr;           // 7-bit register address
+    uint16_t value;         // value to write, unused for reads
+    uint32_t seq;           // number of the read, matched by request_read() to its answer, or 0
+    uint32_t posted_us;     // time the request was posted, for the latency histogram
+};
+
+/** The peripheral used to timestamp rising edges on FGOUT */
+enum CaptureMode
+{
+    CAPTURE_GPIO,       // GPIO interrupt which timestamps each edge with micros()
+    CAPTURE_MCPWM       // MCPWM capture unit which timestamps each edge in hardware
+};
+
+// Time between speed ramp steps streamed to CLKIN (us)
+#define RAMP_PERIOD_US 2000
+
+// LEDC channel, frequency and resolution of the PWM on the BRAKE pin; channel 2 runs from 
+// LEDC timer 1, so it does not share a timer with the LEDC CLKIN output on channel 0
+#define BRAKE_LEDC_CHANNEL 2
+#define BRAKE_PWM_HZ 2000
+#define BRAKE_PWM_BITS 10
+
+/** The peripheral used to generate the CLKIN square wave */
+enum ClkinMode
+{
+    CLKIN_LEDC,         // LEDC channel retuned with ledcWriteTone(), whole hertz only
+    CLKIN_MCPWM         // MCPWM timer whose period is retuned at the end of each cycle
+};
 
 /** This class is used to control the motor driver */
 class Driver 
@@ -42,12 +89,40 @@ class Driver
         // initialize time for ISR
         volatile unsigned long _lastEdgeTime;   
 
+        // polarity last written to the direction pin, read by other tasks
+        volatile bool dir_state;
+
+        CaptureMode capture_mode;   // which backend begin() uses to timestamp FGOUT edges
+        ClkinMode clkin_mode;       // which backend begin() uses to generate CLKIN
+        ClkinSynth clkin;           // MCPWM timer settings for the commanded CLKIN frequency
+        SpeedRamp ramp;             // acceleration and jerk limited profile streamed to CLKIN
+        esp_timer_handle_t ramp_timer;  // periodic timer which steps the ramp
+        portMUX_TYPE ramp_mux;      // protects the ramp and CLKIN from the timer and the tasks
+        TaskHandle_t edge_task;     // task notified when edges are waiting in edge_ring
+        uint16_t notify_edges;      // number of edges between notifications of edge_task
+        uint16_t _pending_edges;    // edges pushed since edge_task was last notified
+        portMUX_TYPE edge_mux;      // keeps the edge time reference whole between the ISR and the tasks
+        uint32_t edge_ref_ticks;    // capture timestamp of the latest edge
+        int64_t edge_ref_us;        // esp_timer time at which the ISR handled the latest edge
+
+        DrvSpiBus spi_bus;          // the VSPI bus the DRV8308 is on
+        DrvRegisters registers;     // register shadow, turned into frames on spi_bus
+        SemaphoreHandle_t read_mutex;   // lets one task at a time wait on a register read
+        SemaphoreHandle_t read_done;    // given by the driver I/O task when a read is answered
+        uint32_t read_seq;          // number of the latest read posted by request_read()
+        volatile uint32_t reply_seq;    // number of the read answered last
+        volatile uint16_t reply_value;  // register value of the read answered last
+
+
         // Static instance pointer for ISR callback
         static Driver* _instance;
 
         // ISR functions
         static void ISR_wrapper();
+        static void ramp_callback(void* arg);
+        static void capture_isr(void* arg);
         void handleISR();
+        bool handleEdge(uint32_t ticks);
 
     public:
 
@@ -61,30 +136,6 @@ class Driver
 
 
 
-        /** @brief A function which sets the chip select pin to HIGH
-         *  
-         *  @details The DRV8308 SPI communication works on CS HIGH. Calling this 
-         *  function begins a SPI transaction.
-         */
-        void scs_begin(void)
-        {
-            digitalWrite(PIN_SCS, HIGH);
-        }
-        
-
-
-        /** @brief A function which sets the chip select pin to LOW
-         *  
-         *  @details The DRV8308 SPI communication works on CS HIGH. Calling this 
-         *  function ends a SPI transaction.
-         */
-        void scs_end(void)
-        {
-            digitalWrite(PIN_SCS, LOW);
-        }
-
-
-
         /** @brief A function which sets the enable pin to HIGH
          *  
          *  @details This initializes the DRV8308. It does not run on EN LOW.
@@ -119,7 +170,7 @@ class Driver
          */
         void brake(void)
         {
-            digitalWrite(PIN_BRAKE, HIGH);
+            brake_duty(1.0f);
         }
 
 
@@ -132,25 +183,44 @@ class Driver
          */
         void unbrake(void)
         {
-            digitalWrite(PIN_BRAKE, LOW);
+            brake_duty(0.0f);
+        }
+
+
+
+        /** @brief A function which applies the brake for part of each PWM cycle
+         * 
+         *  @details The BRAKE pin is driven by an LEDC channel, so the hardware timer keeps the 
+         *  PWM running between calls. This is used by the BrakeController in the speedControl 
+         *  task to slow the motor at a commanded rate instead of as fast as the brake allows.
+         * 
+         *  @param duty The fraction of each cycle the brake is on, from 0 (released) to 1 
+         *  (always on, the same as brake()).
+         */
+        void brake_duty(float duty)
+        {
+            if (duty < 0.0f) duty = 0.0f;
+            if (duty > 1.0f) duty = 1.0f;
+            ledcWrite(BRAKE_LEDC_CHANNEL, (uint32_t)(duty * (1u << BRAKE_PWM_BITS) + 0.5f));
         }
 
     
 
-        /** @brief A function which reads the direction
+        /** @brief A function which reads the commanded direction
          * 
-         *  @details This function reads the current polarity of the direction pin, which 
-         *  tells us whether the motor is spinning in the positive or negative direction. 
-         *  The convention defined for this project is 
+         *  @details This function returns the polarity last written to the direction pin 
+         *  by set_dir(), which is cached so no GPIO read is needed. This is the commanded 
+         *  direction, not the direction the wheel is turning; while braking through zero 
+         *  after a reversal they differ, which the DirectionEstimator in the readActual 
+         *  task accounts for. The convention defined for this project is 
          *  polarity LO = positive direction and 
          *  polarity HI = negative direction.
          * 
-         *  @return The state of the direction pin. Logic for this is handled in the 
-         *  readActual task.
+         *  @return The commanded state of the direction pin.
          */
         bool get_dir(void)
         {
-            return digitalRead(PIN_DIR);
+            return dir_state;
         }
 
 
@@ -167,12 +237,145 @@ class Driver
         void set_dir(bool direction)
         {
             digitalWrite(PIN_DIR, direction);
+            dir_state = direction;
+        }
+
+        /** @brief A function which selects how FGOUT edges are timestamped
+         *
+         *  @details This must be called before begin(). The MCPWM capture backend latches
+         *  the timer in hardware on the edge, so interrupt latency does not add jitter to
+         *  the measured period.
+         *
+         *  @param mode CAPTURE_GPIO or CAPTURE_MCPWM.
+         */
+        void set_capture_mode(CaptureMode mode)
+        {
+            capture_mode = mode;
+        }
+
+
+
+        /** @brief A function which selects how the CLKIN square wave is generated
+         *
+         *  @details This must be called before begin(). The MCPWM backend changes the
+         *  frequency in steps of a few millihertz without stopping the output, while
+         *  ledcWriteTone() reconfigures the LEDC timer and only sets whole hertz.
+         *
+         *  @param mode CLKIN_LEDC or CLKIN_MCPWM.
+         */
+        void set_clkin_mode(ClkinMode mode)
+        {
+            clkin_mode = mode;
         }
 
+
+
+        /** @brief A function which selects the task woken up by FGOUT edges
+         *
+         *  @details Every edge timestamp is pushed into edge_ring, but the task is only
+         *  notified once every @c edges edges. The task is expected to wait with a timeout
+         *  so that a partial batch at slow speeds is still processed.
+         *
+         *  @param task The handle of the task which drains edge_ring.
+         *  @param edges The number of edges between notifications (at least 1).
+         */
+        void set_edge_notify(TaskHandle_t task, uint16_t edges)
+        {
+            notify_edges = (edges == 0) ? 1 : edges;
+            _pending_edges = 0;
+            edge_task = task;
+        }
+
+
+
+        /** @brief A function which returns how many edges arrive between notifications
+         *
+         *  @return The number of edges set with set_edge_notify().
+         */
+        uint16_t edges_per_notify(void)
+        {
+            return notify_edges;
+        }
+
+
+
+        /** @brief A function which returns the tick rate of the capture backend
+         *
+         *  @return The number of capture ticks per microsecond, which is 1 for micros()
+         *  and 80 for the MCPWM capture timer (APB clock).
+         */
+        uint32_t capture_ticks_per_us(void)
+        {
+            return (capture_mode == CAPTURE_MCPWM) ? 80 : 1;
+        }
+
+        int64_t edge_time_us(uint32_t ticks);
+        void set_spi_clock(uint32_t hz);
         void drv_write(uint8_t spdmode, uint16_t message);
+        void drv_write_burst(const DrvReg* regs, uint8_t count);
         uint16_t drv_read(uint8_t addr7);
 
-        void cmd_speed_PWM(float SPEED_CMD);
+        void reg_set(uint8_t addr7, uint16_t value);
+        uint16_t reg_get(uint8_t addr7, bool force = false);
+        uint8_t flush(void);
+
+        void request_write(uint8_t addr7, uint16_t value);
+        bool request_read(uint8_t addr7, uint16_t& value, TickType_t wait);
+        void complete_read(const DrvRequest& request);
+
+
+
+        /** @brief A function which reports whether register changes are waiting
+         *
+         *  @return True if reg_set() has changed a register which flush() has not written.
+         */
+        bool is_dirty(void)
+        {
+            return registers.is_dirty();
+        }
+
+
+
+        /** @brief A function which returns the SPI clock used for the DRV8308
+         *
+         *  @return The clock requested with set_spi_clock(), in Hz.
+         */
+        uint32_t get_spi_clock(void)
+        {
+            return spi_bus.get_clock();
+        }
+
+        void cmd_speed_PWM(rpm_t SPEED_CMD);
+        void cmd_clkin(uint32_t freq_mhz);
+        void cmd_speed_ramp(rpm_t SPEED_CMD);
+
+
+
+        /** @brief A function which reports whether the speed ramp has reached its target
+         * 
+         *  @return True once CLKIN is at the speed last commanded, false while it is still ramping.
+         */
+        bool ramp_done(void)
+        {
+            portENTER_CRITICAL(&ramp_mux);
+            bool done = ramp.done();
+            portEXIT_CRITICAL(&ramp_mux);
+            return done;
+        }
+
+
+
+        /** @brief A function which changes the limits of the speed ramp
+         *
+         *  @param max_accel The acceleration limit in RPM/s.
+         *  @param max_jerk The jerk limit in RPM/s^2, or zero for an acceleration limit only.
+         */
+        void set_ramp_limits(float max_accel, float max_jerk)
+        {
+            portENTER_CRITICAL(&ramp_mux);
+            ramp.set_limits(max_accel, max_jerk);
+            portEXIT_CRITICAL(&ramp_mux);
+        }
 };
 
 #endif
\ No newline at end of file
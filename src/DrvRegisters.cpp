@@ -0,0 +1,189 @@
+/** @file DrvRegisters.cpp
+ *  This file contains the DrvRegisters class, which reads and writes DRV8308 registers as
+ *  24-bit SPI frames through an SpiBus and keeps a shadow copy of the configuration
+ *  registers.
+*/
+
+#include "DrvRegisters.h"
+
+
+
+/** @brief Constructor for the DrvRegisters class
+ *
+ *  @details The shadow starts at zero with nothing to flush; nothing is sent to the chip.
+ *
+ *  @param bus_ The bus the DRV8308 is on.
+ */
+DrvRegisters::DrvRegisters(SpiBus& bus_)
+    : bus(bus_)
+{
+    for (uint8_t addr = 0; addr < DRV_REG_COUNT; addr++)
+    {
+        shadow[addr] = 0;
+    }
+    dirty = 0;
+}
+
+
+
+/** @brief A function which writes one register
+ *
+ *  @param addr7 The 7-bit register address.
+ *  @param value The 16-bit register value.
+ */
+void DrvRegisters::write(uint8_t addr7, uint16_t value)
+{
+    DrvReg reg = {addr7, value};
+    write_burst(&reg, 1);
+}
+
+
+
+/** @brief A function which writes several registers in one transaction
+ *
+ *  @details Each register is its own 24-bit frame (1 write bit, 7 address bits and 16 data
+ *  bits, most significant first), but the bus is only taken once and chip select is held
+ *  inactive between frames for just the time the chip requires. Nothing is sent if
+ *  @c count is zero.
+ *
+ *  @param regs The registers to write, in order.
+ *  @param count The number of registers in regs.
+ */
+void DrvRegisters::write_burst(const DrvReg* regs, uint8_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    uint8_t frame[3];
+    bus.begin_transaction();
+    for (uint8_t i = 0; i < count; i++)
+    {
+        frame[0] = (0u << 7) | (regs[i].addr & 0x7F);
+        frame[1] = (uint8_t)(regs[i].value >> 8);
+        frame[2] = (uint8_t)(regs[i].value & 0xFF);
+
+        if (i > 0)
+        {
+            bus.frame_gap();
+        }
+        bus.frame(frame, nullptr, 3);
+    }
+    bus.end_transaction();
+}
+
+
+
+/** @brief A function which reads one register
+ *
+ *  @details The frame sends the read bit and the address, and the chip shifts the value
+ *  out during the last 16 bits.
+ *
+ *  @param addr7 The 7-bit register address.
+ *
+ *  @return The 16-bit register value.
+ */
+uint16_t DrvRegisters::read(uint8_t addr7)
+{
+    uint8_t tx[3] = {(uint8_t)((1u << 7) | (addr7 & 0x7F)), 0x00, 0x00};
+    uint8_t rx[3] = {0, 0, 0};
+
+    bus.begin_transaction();
+    bus.frame(tx, rx, 3);
+    bus.end_transaction();
+
+    return ((uint16_t)rx[1] << 8) | rx[2];
+}
+
+
+
+/** @brief A function which changes a register in the shadow copy
+ * 
+ *  @details Nothing is sent to the chip until flush() is called, so several changes to 
+ *  the same register cost one write, and setting a register to the value it already has 
+ *  costs nothing unless @c force is set. Addresses outside the shadow are written straight 
+ *  to the chip.
+ * 
+ *  @param addr7 The 7-bit register address.
+ *  @param value The new 16-bit register value.
+ *  @param force True to write the register in the next flush even if the shadow already 
+ *  holds this value, as after a reset of the ESP32, when the shadow does not know the chip.
+ */
+void DrvRegisters::set(uint8_t addr7, uint16_t value, bool force)
+{
+    if (addr7 >= DRV_REG_COUNT)
+    {
+        write(addr7, value);
+        return;
+    }
+
+    if (force || shadow[addr7] != value)
+    {
+        shadow[addr7] = value;
+        dirty |= (1u << addr7);
+    }
+}
+
+
+
+/** @brief A function which returns the value of a register
+ * 
+ *  @details The value comes from the shadow copy without any SPI traffic, unless a 
+ *  hardware read is forced or the address is outside the shadow (such as the fault 
+ *  register 0x2A). A forced read updates the shadow unless a change is waiting to be 
+ *  flushed, in which case the pending value is kept.
+ * 
+ *  @param addr7 The 7-bit register address.
+ *  @param force True to read the register from the chip.
+ * 
+ *  @return The 16-bit register value.
+ */
+uint16_t DrvRegisters::get(uint8_t addr7, bool force)
+{
+    if (addr7 >= DRV_REG_COUNT)
+    {
+        return read(addr7);
+    }
+
+    if (force)
+    {
+        uint16_t value = read(addr7);
+        if (!(dirty & (1u << addr7)))
+        {
+            shadow[addr7] = value;
+        }
+        return value;
+    }
+
+    return shadow[addr7];
+}
+
+
+
+/** @brief A function which writes every changed register to the chip
+ * 
+ *  @details The changed registers are collected in address order and written in a 
+ *  single burst with write_burst().
+ * 
+ *  @return The number of registers written.
+ */
+uint8_t DrvRegisters::flush(void)
+{
+    DrvReg regs[DRV_REG_COUNT];
+    uint8_t count = 0;
+
+    for (uint8_t addr = 0; addr < DRV_REG_COUNT; addr++)
+    {
+        if (dirty & (1u << addr))
+        {
+            regs[count].addr = addr;
+            regs[count].value = shadow[addr];
+            count++;
+        }
+    }
+    dirty = 0;
+
+    write_burst(regs, count);
+    return count;
+}
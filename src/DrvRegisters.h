@@ -0,0 +1,59 @@
+/** @file DrvRegisters.h
+ *  This file contains the DrvRegisters class, which reads and writes DRV8308 registers as
+ *  24-bit SPI frames through an SpiBus, and keeps a shadow copy of the configuration
+ *  registers so that changes can be collected and written in one burst.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _DRVREGISTERS_H_
+#define _DRVREGISTERS_H_
+
+#include <stdint.h>
+#include "SpiBus.h"
+
+// Number of DRV8308 configuration registers (0x00 to 0x0B) kept in the shadow copy
+#define DRV_REG_COUNT 0x0C
+
+/** One DRV8308 register address and the 16-bit value to write to it */
+struct DrvReg
+{
+    uint8_t addr;       // 7-bit register address
+    uint16_t value;     // 16-bit register value
+};
+
+/** This class turns DRV8308 register accesses into frames on an SPI bus */
+class DrvRegisters
+{
+    protected:
+
+        SpiBus& bus;                    // the bus the DRV8308 is on
+        uint16_t shadow[DRV_REG_COUNT]; // last value written or read for each register
+        uint16_t dirty;                 // bit n set if shadow[n] has not been written to the chip
+
+    public:
+
+        /** Non-inline functions are commented in DrvRegisters.cpp */
+        DrvRegisters(SpiBus& bus_);
+
+        void write(uint8_t addr7, uint16_t value);
+        void write_burst(const DrvReg* regs, uint8_t count);
+        uint16_t read(uint8_t addr7);
+
+        void set(uint8_t addr7, uint16_t value, bool force = false);
+        uint16_t get(uint8_t addr7, bool force = false);
+        uint8_t flush(void);
+
+
+
+        /** @brief A function which reports whether register changes are waiting
+         *
+         *  @return True if set() has changed a register which flush() has not written.
+         */
+        bool is_dirty(void)
+        {
+            return dirty != 0;
+        }
+};
+
+#endif
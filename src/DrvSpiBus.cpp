@@ -0,0 +1,96 @@
+/** @file DrvSpiBus.cpp
+ *  This file contains the DrvSpiBus class, which puts the DRV8308 on an ESP32 SPI
+ *  peripheral with chip select driven by hand.
+*/
+
+#include "DrvSpiBus.h"
+
+
+
+/** @brief Constructor for the DrvSpiBus class
+ *
+ *  @param spi_ The SPI peripheral the DRV8308 is on. It is not touched until begin().
+ */
+DrvSpiBus::DrvSpiBus(SPIClass* spi_)
+{
+    spi = spi_;
+    pin_scs = 0;
+    set_clock(DRV_SPI_DEFAULT_HZ);
+}
+
+
+
+/** @brief A function which starts the SPI peripheral
+ *
+ *  @details The peripheral is given no chip select pin, since it would drive it active
+ *  LOW; SCS is set as an output and driven in frame() instead.
+ *
+ *  @param pin_sclk The serial clock pin.
+ *  @param pin_miso The MISO pin.
+ *  @param pin_mosi The MOSI pin.
+ *  @param pin_scs_ The chip select pin.
+ */
+void DrvSpiBus::begin(uint8_t pin_sclk, uint8_t pin_miso, uint8_t pin_mosi, uint8_t pin_scs_)
+{
+    pin_scs = pin_scs_;
+    pinMode(pin_scs, OUTPUT);
+    digitalWrite(pin_scs, LOW);
+    spi->begin(pin_sclk, pin_miso, pin_mosi, -1);
+}
+
+
+
+/** @brief A function which sets the SPI clock used for the DRV8308
+ * 
+ *  @details The clock is limited to 16 MHz by the 62 ns minimum tCYC in the DRV8308 
+ *  datasheet. The SPISettings are built here once instead of on every transfer, and 
+ *  the SCS inactive time between frames is converted to CPU cycles.
+ * 
+ *  @param hz The desired SPI clock in Hz.
+ */
+void DrvSpiBus::set_clock(uint32_t hz)
+{
+    if (hz == 0) hz = DRV_SPI_DEFAULT_HZ;
+    if (hz > DRV_SPI_MAX_HZ) hz = DRV_SPI_MAX_HZ;
+    clock_hz = hz;
+    settings = SPISettings(clock_hz, MSBFIRST, SPI_MODE0);
+    gap_cycles = (DRV_SCS_GAP_NS * ESP.getCpuFreqMHz() + 999) / 1000;
+}
+
+
+
+/** @brief A function which takes the SPI peripheral with the DRV8308 clock and mode */
+void DrvSpiBus::begin_transaction(void)
+{
+    spi->beginTransaction(settings);
+}
+
+
+
+/** @brief A function which gives up the SPI peripheral */
+void DrvSpiBus::end_transaction(void)
+{
+    spi->endTransaction();
+}
+
+
+
+/** @brief A function which sends one frame with SCS HIGH
+ *
+ *  @param tx The bytes to send.
+ *  @param rx Filled in with the bytes received, or NULL if they are not needed.
+ *  @param length The number of bytes in the frame.
+ */
+void DrvSpiBus::frame(const uint8_t* tx, uint8_t* rx, uint8_t length)
+{
+    digitalWrite(pin_scs, HIGH);
+    if (rx != NULL)
+    {
+        spi->transferBytes(tx, rx, length);
+    }
+    else
+    {
+        spi->writeBytes(tx, length);
+    }
+    digitalWrite(pin_scs, LOW);
+}
@@ -0,0 +1,69 @@
+/** @file DrvSpiBus.h
+ *  This file contains the DrvSpiBus class, which puts the DRV8308 on an ESP32 SPI
+ *  peripheral. The DRV8308 selects on SCS HIGH, the opposite of what the SPI driver does,
+ *  so chip select is driven by hand.
+*/
+
+#ifndef _DRVSPIBUS_H_
+#define _DRVSPIBUS_H_
+
+#include <Arduino.h>
+#include <SPI.h>
+#include "SpiBus.h"
+
+// DRV8308 SPI limits from the datasheet: tCYC is at least 62 ns and SCS must be 
+// inactive for at least 100 ns between frames. The 5 ns SCS setup and 1 ns hold times 
+// are much shorter than a digitalWrite(), so they need no delay.
+#define DRV_SPI_MAX_HZ 16000000
+#define DRV_SPI_DEFAULT_HZ 1000000
+#define DRV_SCS_GAP_NS 100
+
+/** This class is the SPI bus the DRV8308 is on */
+class DrvSpiBus : public SpiBus
+{
+    protected:
+
+        SPIClass* spi;              // the SPI peripheral the DRV8308 is on
+        uint8_t pin_scs;            // chip select pin, driven by hand
+        SPISettings settings;       // clock and mode used for every DRV8308 transaction
+        uint32_t clock_hz;          // SPI clock in Hz
+        uint32_t gap_cycles;        // CPU cycles SCS is held inactive between frames
+
+    public:
+
+        /** Non-inline functions are commented in DrvSpiBus.cpp */
+        DrvSpiBus(SPIClass* spi_);
+
+        void begin(uint8_t pin_sclk, uint8_t pin_miso, uint8_t pin_mosi, uint8_t pin_scs_);
+        void set_clock(uint32_t hz);
+        void begin_transaction(void) override;
+        void end_transaction(void) override;
+        void frame(const uint8_t* tx, uint8_t* rx, uint8_t length) override;
+
+
+
+        /** @brief A function which holds SCS inactive between two frames
+         *
+         *  @details The DRV8308 needs SCS low for at least 100 ns between frames. This
+         *  spins on the CPU cycle counter, since delayMicroseconds() would wait ten times
+         *  longer than needed.
+         */
+        void frame_gap(void) override
+        {
+            uint32_t start = ESP.getCycleCount();
+            while (ESP.getCycleCount() - start < gap_cycles) {}
+        }
+
+
+
+        /** @brief A function which returns the SPI clock
+         *
+         *  @return The clock set with set_clock(), in Hz.
+         */
+        uint32_t get_clock(void)
+        {
+            return clock_hz;
+        }
+};
+
+#endif
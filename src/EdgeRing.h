@@ -0,0 +1,21 @@
+/** @file EdgeRing.h
+ *  This file contains the size and type of edge_ring, the SpscRing through which the FGOUT
+ *  capture backend passes edge timestamps to the readActual task. It is kept apart from
+ *  Shares.h so the host tests can stress a ring of exactly the size the firmware uses.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _EDGERING_H_
+#define _EDGERING_H_
+
+#include <stdint.h>
+#include "SpscRing.h"
+
+// Number of FGOUT edge timestamps the capture backend can buffer for the readActual task
+#define EDGE_RING_SIZE 64
+
+/** The ring of capture timestamps between the capture backend and readActual */
+typedef SpscRing<uint32_t, EDGE_RING_SIZE> EdgeRing;
+
+#endif
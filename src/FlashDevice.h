@@ -0,0 +1,51 @@
+/** @file FlashDevice.h
+ *  This file contains the FlashDevice interface, through which the RunLog class stores test
+ *  runs in NOR flash. NOR flash is erased a whole sector at a time to all ones, and a write
+ *  can only change ones to zeros. PartitionFlash in Recorder.h gives the log the ESP32's data
+ *  partition, and the host tests give it FileFlash, which emulates NOR flash in a file.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _FLASHDEVICE_H_
+#define _FLASHDEVICE_H_
+
+#include <stdint.h>
+
+/** This class is the interface to a region of NOR flash divided into erasable sectors */
+class FlashDevice
+{
+    public:
+
+        virtual ~FlashDevice(void) {}
+
+        /** @brief A function which reads bytes from the flash
+         *  @param addr The offset of the first byte from the start of the region.
+         *  @param data Filled in with the bytes read.
+         *  @param len The number of bytes to read.
+         *  @return True if the bytes were read.
+         */
+        virtual bool read(uint32_t addr, void* data, uint32_t len) = 0;
+
+        /** @brief A function which writes bytes to erased flash
+         *  @param addr The offset of the first byte from the start of the region.
+         *  @param data The bytes to write. Bits which are already zero stay zero.
+         *  @param len The number of bytes to write.
+         *  @return True if all the bytes were written.
+         */
+        virtual bool write(uint32_t addr, const void* data, uint32_t len) = 0;
+
+        /** @brief A function which erases one sector to all ones
+         *  @param sector The index of the sector, from zero to sector_count() - 1.
+         *  @return True if the sector was erased.
+         */
+        virtual bool erase(uint32_t sector) = 0;
+
+        /** @brief A function which returns the size of one sector in bytes */
+        virtual uint32_t sector_size(void) = 0;
+
+        /** @brief A function which returns the number of sectors in the region */
+        virtual uint32_t sector_count(void) = 0;
+};
+
+#endif
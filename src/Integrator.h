@@ -0,0 +1,141 @@
+/** @file Integrator.h
+ *  This file contains the integrators the Controller can use to step a wheel model forward
+ *  in time under a torque held for one step: forward Euler, the implicit trapezoidal rule,
+ *  fourth order Runge-Kutta, and the exact zero-order-hold solution. Each one is a template
+ *  specialized on the method at compile time, so a loop which always uses one method calls
+ *  it directly with no switch or function pointer per step.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _INTEGRATOR_H_
+#define _INTEGRATOR_H_
+
+#include <stdint.h>
+
+/** The method used to integrate the wheel model */
+enum IntegratorMode
+{
+    INTEGRATE_EULER,        // forward Euler, first order
+    INTEGRATE_TRAPEZOID,    // implicit trapezoidal rule, second order and unconditionally stable
+    INTEGRATE_RK4,          // classic fourth order Runge-Kutta
+    INTEGRATE_ZOH           // exact solution for a torque held over the step
+};
+
+/** This template is specialized for each IntegratorMode below.
+ *
+ *  @details Each specialization has a step() function taking a plant such as WheelModel,
+ *  the speed at the start of the step in rad/s, the torque in N*m and the Coulomb friction
+ *  sign from the plant, and returning the speed at the end of the step in rad/s.
+ *
+ *  @tparam M The integration method.
+ */
+template <IntegratorMode M>
+struct Integrator;
+
+/** Forward Euler: w1 = w0 + dt f(w0) */
+template <>
+struct Integrator<INTEGRATE_EULER>
+{
+    template <class Plant>
+    static float step(const Plant& plant, float omega, float torque, float sign)
+    {
+        return omega + plant.get_step() * plant.accel(omega, torque, sign);
+    }
+};
+
+/** Implicit trapezoidal rule, solved ahead of time by the plant */
+template <>
+struct Integrator<INTEGRATE_TRAPEZOID>
+{
+    template <class Plant>
+    static float step(const Plant& plant, float omega, float torque, float sign)
+    {
+        return plant.trapezoid_step(omega, torque, sign);
+    }
+};
+
+/** Classic fourth order Runge-Kutta with four evaluations of the plant */
+template <>
+struct Integrator<INTEGRATE_RK4>
+{
+    template <class Plant>
+    static float step(const Plant& plant, float omega, float torque, float sign)
+    {
+        float h = plant.get_step();
+        float k1 = plant.accel(omega, torque, sign);
+        float k2 = plant.accel(omega + 0.5f * h * k1, torque, sign);
+        float k3 = plant.accel(omega + 0.5f * h * k2, torque, sign);
+        float k4 = plant.accel(omega + h * k3, torque, sign);
+        return omega + (h / 6.0f) * (k1 + 2.0f * (k2 + k3) + k4);
+    }
+};
+
+/** Exact solution of the linear model with the torque held over the step */
+template <>
+struct Integrator<INTEGRATE_ZOH>
+{
+    template <class Plant>
+    static float step(const Plant& plant, float omega, float torque, float sign)
+    {
+        return plant.zoh_step(omega, torque, sign);
+    }
+};
+
+
+
+/** @brief Function which steps a plant forward in time with a method chosen at compile time
+ *
+ *  @details Coulomb friction can stop the wheel but never turn it backward, so a step which
+ *  would carry the speed through zero ends at zero instead, and a stuck wheel stays at
+ *  zero. The next step then starts from rest with the friction sign worked out again.
+ *
+ *  @tparam M The integration method.
+ *  @tparam Plant The plant type, such as WheelModel.
+ *
+ *  @param plant The plant model, which holds the step size.
+ *  @param omega The speed at the start of the step in rad/s.
+ *  @param torque The torque held over the step in N*m.
+ *
+ *  @return The speed at the end of the step in rad/s.
+ */
+template <IntegratorMode M, class Plant>
+inline float integrate(const Plant& plant, float omega, float torque)
+{
+    float sign = plant.friction_sign(omega, torque);
+    if (sign == 0.0f)
+    {
+        return 0.0f;
+    }
+    float next = Integrator<M>::step(plant, omega, torque, sign);
+    return (next * sign < 0.0f) ? 0.0f : next;
+}
+
+
+
+/** @brief Function which steps a plant forward in time with a method chosen at run time
+ *
+ *  @details This only picks one of the compile-time specializations, so its cost over
+ *  calling integrate<M>() directly is one switch.
+ *
+ *  @param mode The integration method.
+ *  @param plant The plant model, which holds the step size.
+ *  @param omega The speed at the start of the step in rad/s.
+ *  @param torque The torque held over the step in N*m.
+ *
+ *  @return The speed at the end of the step in rad/s.
+ */
+template <class Plant>
+inline float integrate(IntegratorMode mode, const Plant& plant, float omega, float torque)
+{
+    switch (mode)
+    {
+        case INTEGRATE_EULER:       return integrate<INTEGRATE_EULER>(plant, omega, torque);
+        case INTEGRATE_TRAPEZOID:   return integrate<INTEGRATE_TRAPEZOID>(plant, omega, torque);
+        case INTEGRATE_RK4:         return integrate<INTEGRATE_RK4>(plant, omega, torque);
+        case INTEGRATE_ZOH:
+        default:                    return integrate<INTEGRATE_ZOH>(plant, omega, torque);
+    }
+}
+
+#endif
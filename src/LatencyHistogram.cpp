@@ -0,0 +1,128 @@
+/** @file LatencyHistogram.cpp
+ *  This file contains the LatencyHistogram class, which records how long something took
+ *  in logarithmic buckets.
+*/
+
+#include <stdio.h>
+#include "LatencyHistogram.h"
+
+
+
+/** @brief Constructor for the LatencyHistogram class
+ */
+LatencyHistogram::LatencyHistogram(void)
+{
+    reset();
+}
+
+
+
+/** @brief A function which discards all samples
+ */
+void LatencyHistogram::reset(void)
+{
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        buckets[i] = 0;
+    }
+    samples = 0;
+    min_us = UINT32_MAX;
+    max_us = 0;
+    total_us = 0;
+}
+
+
+
+/** @brief A function which records one time
+ *
+ *  @details The bucket is found from the position of the leading one, so recording a
+ *  sample takes the same few instructions for any time.
+ *
+ *  @param us The time in microseconds.
+ */
+void LatencyHistogram::add(uint32_t us)
+{
+    uint8_t i = (us < 2) ? 0 : (uint8_t)(31 - __builtin_clz(us));
+    if (i >= LATENCY_BUCKETS)
+    {
+        i = LATENCY_BUCKETS - 1;
+    }
+
+    buckets[i]++;
+    samples++;
+    total_us += us;
+    if (us < min_us) min_us = us;
+    if (us > max_us) max_us = us;
+}
+
+
+
+/** @brief A function which estimates a percentile of the recorded times
+ *
+ *  @param pct The percentile, from 0 to 100.
+ *
+ *  @return The upper edge of the bucket holding that percentile, in microseconds, limited
+ *  to the longest time recorded. Zero if there are no samples.
+ */
+uint32_t LatencyHistogram::percentile(uint8_t pct)
+{
+    if (samples == 0)
+    {
+        return 0;
+    }
+
+    uint64_t target = ((uint64_t)samples * pct + 99) / 100;
+    uint64_t seen = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        seen += buckets[i];
+        if (seen >= target && buckets[i] > 0)
+        {
+            uint32_t edge = (i == LATENCY_BUCKETS - 1) ? UINT32_MAX : (2u << i) - 1;
+            return (edge < max_us) ? edge : max_us;
+        }
+    }
+    return max_us;
+}
+
+
+
+/** @brief A function which writes a one line summary of the histogram
+ *
+ *  @details The line has the count, minimum, mean, 99th percentile and maximum, then
+ *  the count in each nonempty bucket labelled with its lower edge, for example
+ *  "SPI: n=12 min=35 mean=80 p99=110 max=110 us | 32:5 64:7".
+ *
+ *  @param buf The buffer which receives the text.
+ *  @param len The size of buf in bytes.
+ *  @param name A label printed at the start of the line.
+ *
+ *  @return The number of characters written, not counting the terminating null.
+ */
+size_t LatencyHistogram::report(char* buf, size_t len, const char* name)
+{
+    if (len == 0)
+    {
+        return 0;
+    }
+
+    int used = snprintf(buf, len, "%s: n=%lu min=%lu mean=%lu p99=%lu max=%lu us |", name,
+                        (unsigned long)samples, (unsigned long)((samples == 0) ? 0 : min_us),
+                        (unsigned long)mean(), (unsigned long)percentile(99), (unsigned long)max_us);
+
+    for (uint8_t i = 0; i < LATENCY_BUCKETS && used >= 0 && (size_t)used < len; i++)
+    {
+        if (buckets[i] > 0)
+        {
+            used += snprintf(buf + used, len - used, " %lu:%lu",
+                             (unsigned long)((i == 0) ? 0 : (1u << i)), (unsigned long)buckets[i]);
+        }
+    }
+
+    if (used < 0)
+    {
+        buf[0] = '\0';
+        return 0;
+    }
+    return ((size_t)used < len) ? (size_t)used : len - 1;
+}
@@ -0,0 +1,74 @@
+/** @file LatencyHistogram.h
+ *  This file contains the LatencyHistogram class, which records how long something took
+ *  in logarithmic buckets so the spread of the times can be reported over serial without
+ *  storing every sample.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _LATENCYHISTOGRAM_H_
+#define _LATENCYHISTOGRAM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Number of buckets; bucket i holds times from 2^i to 2^(i+1) microseconds and the last
+// bucket holds everything longer
+#define LATENCY_BUCKETS 16
+
+/** This class is used to collect a histogram of times in microseconds */
+class LatencyHistogram
+{
+    protected:
+
+        uint32_t buckets[LATENCY_BUCKETS];  // number of samples in each power of two range
+        uint32_t samples;                   // total number of samples
+        uint32_t min_us;                    // shortest time recorded
+        uint32_t max_us;                    // longest time recorded
+        uint64_t total_us;                  // sum of all times, for the mean
+
+    public:
+
+        /** Non-inline functions are commented in LatencyHistogram.cpp */
+        LatencyHistogram(void);
+
+        void reset(void);
+        void add(uint32_t us);
+        uint32_t percentile(uint8_t pct);
+        size_t report(char* buf, size_t len, const char* name);
+
+
+
+        /** @brief A function which returns the number of samples
+         *
+         *  @return The number of times recorded since the last reset().
+         */
+        uint32_t count(void)
+        {
+            return samples;
+        }
+
+
+
+        /** @brief A function which returns the longest time recorded
+         *
+         *  @return The longest time in microseconds, or zero if there are no samples.
+         */
+        uint32_t max(void)
+        {
+            return max_us;
+        }
+
+
+
+        /** @brief A function which returns the mean time
+         *
+         *  @return The mean time in microseconds, or zero if there are no samples.
+         */
+        uint32_t mean(void)
+        {
+            return (samples == 0) ? 0 : (uint32_t)(total_us / samples);
+        }
+};
+
+#endif
@@ -0,0 +1,277 @@
+/** @file Mailbox.h
+ *  This file contains a wait-free mailbox which holds only the latest value posted to it,
+ *  for passing setpoints from any number of producer tasks to one consumer task. Posting
+ *  overwrites the previous value instead of queueing behind it, so a producer never blocks
+ *  and the consumer always acts on the freshest command. Every value is stamped with a
+ *  sequence number and the time it was posted, and values the consumer never saw are counted.
+ *
+ *  The mailbox only uses std::atomic, so it can be compiled and stress tested on a PC.
+*/
+
+#ifndef _MAILBOX_H_
+#define _MAILBOX_H_
+
+#include <stdint.h>
+#include <atomic>
+
+// Number of times peek() reads the newest value again while producers keep changing it before it
+// gives up and counts a failure
+#define MAILBOX_READ_TRIES 64
+
+// Hook which the stress test defines to let other threads run at the named point of post(); it
+// does nothing in the firmware
+#ifndef MAILBOX_PREEMPT
+#define MAILBOX_PREEMPT(point)
+#endif
+
+/** A value taken from a Mailbox along with when it was posted */
+template <typename T>
+struct Mail
+{
+    T value;                // the posted value
+    uint32_t seq;           // sequence number, counting up from 1 for each post
+    uint64_t posted_us;     // time given to post(), in microseconds
+};
+
+/** This class is a multiple-producer/single-consumer latest-value mailbox.
+ *
+ *  @details Each post claims a free slot, writes the value there and publishes the slot
+ *  before releasing it, so a producer never writes into a slot that another producer is
+ *  using or that holds the newest value. Each slot is guarded by a sequence lock: its stamp
+ *  is odd while a producer holds it, and a reader that sees the stamp change while it copies
+ *  the value throws the copy away and tries again, a bounded number of times.
+ *
+ *  @tparam T The type of value stored in the mailbox; it should be small and trivially copyable.
+ *  @tparam N The number of slots. Must be a power of two no larger than 16, and larger than
+ *  the number of producers which can be posting at the same time.
+ */
+template <typename T, uint32_t N = 4>
+class Mailbox
+{
+    static_assert(N >= 2 && N <= 16 && (N & (N - 1)) == 0, "Mailbox size must be a power of two up to 16");
+
+    protected:
+
+        /** One slot of the mailbox and the sequence lock that guards it */
+        struct Slot
+        {
+            std::atomic<uint32_t> stamp;        // odd while a producer is writing the slot
+            Mail<T> mail;                       // the value and its sequence number
+        };
+
+        Slot slots[N];                          // storage for values being written or published
+        std::atomic<uint32_t> next_seq;         // sequence number of the latest post
+        std::atomic<uint32_t> latest;           // sequence number << 4 | slot of the newest value, 0 if none
+        std::atomic<uint32_t> collision_count;  // posts lost because every slot was busy
+        std::atomic<uint32_t> retry_count;      // reads repeated because a producer changed the slot
+        std::atomic<uint32_t> fail_count;       // reads given up after MAILBOX_READ_TRIES tries
+        uint32_t taken_seq;                     // sequence number of the latest value taken (consumer only)
+        uint32_t drop_count;                    // values overwritten before they were taken (consumer only)
+
+    public:
+
+        /** @brief Constructor which creates an empty mailbox */
+        Mailbox(void)
+            : next_seq(0), latest(0), collision_count(0), retry_count(0), fail_count(0)
+        {
+            for (uint32_t i = 0; i < N; i++)
+            {
+                slots[i].stamp.store(0, std::memory_order_relaxed);
+            }
+            taken_seq = 0;
+            drop_count = 0;
+        }
+
+
+
+        /** @brief A function which posts a new value, replacing the one in the mailbox
+         *
+         *  @details Any task may call this function. It never blocks and takes at most N
+         *  attempts to claim a slot. The slot holding the newest value is never claimed: the
+         *  index read before the search can be stale by the time a slot is claimed, so it
+         *  is checked again afterwards and a slot which turns out to be published is given
+         *  back. If an older post finishes after a newer one, the older value is not
+         *  published and shows up as a drop.
+         *
+         *  @param value The value to copy into the mailbox.
+         *  @param now_us The time of the post in microseconds, passed on to the consumer.
+         *
+         *  @return The sequence number given to the value, or zero if every slot was busy.
+         */
+        uint32_t post(const T& value, uint64_t now_us)
+        {
+            // the tag only holds the low 28 bits of the sequence number, and zero would read as empty
+            uint32_t seq = next_seq.fetch_add(1, std::memory_order_relaxed) + 1;
+            if ((seq & 0x0FFFFFFF) == 0)
+            {
+                seq = next_seq.fetch_add(1, std::memory_order_relaxed) + 1;
+            }
+            uint32_t published = latest.load(std::memory_order_relaxed) & 0x0F;
+            MAILBOX_PREEMPT(read_published);
+
+            // claim a slot which is neither being written nor holding the newest value
+            uint32_t index = N;
+            uint32_t stamp = 0;
+            for (uint32_t i = 0; i < N && index == N; i++)
+            {
+                uint32_t k = (published + 1 + i) & (N - 1);
+                stamp = slots[k].stamp.load(std::memory_order_relaxed);
+                if (k == published || (stamp & 1) != 0
+                    || !slots[k].stamp.compare_exchange_strong(stamp, stamp + 1, std::memory_order_acquire))
+                {
+                    continue;
+                }
+                MAILBOX_PREEMPT(claimed);
+
+                // another producer may have published this slot since the index was read
+                if (k == (latest.load(std::memory_order_acquire) & 0x0F))
+                {
+                    slots[k].stamp.store(stamp, std::memory_order_release);
+                    continue;
+                }
+                index = k;
+            }
+            if (index == N)
+            {
+                collision_count.fetch_add(1, std::memory_order_relaxed);
+                return 0;
+            }
+
+            std::atomic_thread_fence(std::memory_order_release);
+            slots[index].mail.value = value;
+            slots[index].mail.seq = seq;
+            slots[index].mail.posted_us = now_us;
+            MAILBOX_PREEMPT(written);
+
+            // publish the slot unless a newer value got there first, while it is still held so no 
+            // other producer can claim it in between; the compare is safe across wraparound
+            uint32_t tag = (seq << 4) | index;
+            uint32_t current = latest.load(std::memory_order_relaxed);
+            while (current == 0 || (int32_t)((tag & ~0x0Fu) - (current & ~0x0Fu)) > 0)
+            {
+                if (latest.compare_exchange_weak(current, tag, std::memory_order_release, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            MAILBOX_PREEMPT(published);
+            slots[index].stamp.store(stamp + 2, std::memory_order_release);
+            return seq;
+        }
+
+
+
+        /** @brief A function which copies the newest value without taking it
+         *
+         *  @details Any task may call this function. It does not change the drop counter.
+         *  If producers change the newest value every time it is copied, it gives up after
+         *  MAILBOX_READ_TRIES tries and counts a failure rather than spin.
+         *
+         *  @param mail Filled in with the newest value if there is one.
+         *
+         *  @return True if a value was copied, false if nothing has been posted yet or the
+         *  read failed.
+         */
+        bool peek(Mail<T>& mail)
+        {
+            for (uint32_t tries = 0; tries < MAILBOX_READ_TRIES; tries++)
+            {
+                uint32_t tag = latest.load(std::memory_order_acquire);
+                if (tag == 0)
+                {
+                    return false;
+                }
+
+                Slot& slot = slots[tag & 0x0F];
+                uint32_t before = slot.stamp.load(std::memory_order_acquire);
+                if ((before & 1) == 0)
+                {
+                    mail = slot.mail;
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    uint32_t after = slot.stamp.load(std::memory_order_relaxed);
+
+                    // the tag only has room for the low 28 bits of the sequence number
+                    if (before == after && (mail.seq & 0x0FFFFFFF) == (tag >> 4))
+                    {
+                        return true;
+                    }
+                }
+                retry_count.fetch_add(1, std::memory_order_relaxed);
+            }
+            fail_count.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+
+
+        /** @brief A function which takes the newest value if it has not been taken yet
+         *
+         *  @details Only the consumer may call this function. Values posted since the last
+         *  take which were replaced before this call are added to the drop counter.
+         *
+         *  @param mail Filled in with the newest value if it is new.
+         *
+         *  @return True if a value newer than the last one taken was found.
+         */
+        bool take(Mail<T>& mail)
+        {
+            Mail<T> newest;
+            if (!peek(newest) || newest.seq == taken_seq)
+            {
+                return false;
+            }
+            drop_count += newest.seq - taken_seq - 1;
+            taken_seq = newest.seq;
+            mail = newest;
+            return true;
+        }
+
+
+
+        /** @brief A function which returns how many values were never taken
+         *
+         *  @return The number of posts since startup which were replaced by a newer value
+         *  before the consumer took them, including posts lost to collisions.
+         */
+        uint32_t drops(void)
+        {
+            return drop_count;
+        }
+
+
+
+        /** @brief A function which returns how many posts found every slot busy
+         *
+         *  @return The number of post() calls which returned zero since startup.
+         */
+        uint32_t collisions(void)
+        {
+            return collision_count.load(std::memory_order_relaxed);
+        }
+
+
+
+        /** @brief A function which returns how many reads had to be repeated
+         *
+         *  @return The number of times peek() or take() saw a producer change the slot it
+         *  was copying and read it again.
+         */
+        uint32_t retries(void)
+        {
+            return retry_count.load(std::memory_order_relaxed);
+        }
+
+
+
+        /** @brief A function which returns how many reads gave up
+         *
+         *  @return The number of times peek() or take() returned false after
+         *  MAILBOX_READ_TRIES tries since startup.
+         */
+        uint32_t failures(void)
+        {
+            return fail_count.load(std::memory_order_relaxed);
+        }
+};
+
+#endif
@@ -0,0 +1,495 @@
+/** @file Profile.cpp
+ *  This file contains the ProfilePlayer class, which turns the steps of a command profile
+ *  into commands at the times they are due, and reads profiles written as text.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Profile.h"
+
+// Most words on one line of a profile, and the longest word
+#define PROFILE_LINE_WORDS 8
+#define PROFILE_WORD_LEN 16
+
+
+
+/** @brief Function which copies the next word of a line of profile text
+ *
+ *  @param p The text; moved past the word.
+ *  @param word Filled in with the word, or an empty string at the end of the line.
+ *
+ *  @return False if the word is too long.
+ */
+static bool next_word(const char*& p, char* word)
+{
+    while (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r')
+    {
+        p++;
+    }
+    size_t len = 0;
+    while (*p != '\0' && *p != ' ' && *p != '\t' && *p != ',' && *p != '\r' && *p != '\n'
+           && *p != ';' && *p != '#')
+    {
+        if (len + 1 >= PROFILE_WORD_LEN)
+        {
+            return false;
+        }
+        word[len++] = *p++;
+    }
+    word[len] = '\0';
+    return true;
+}
+
+
+
+/** @brief Function which reads a number from a word
+ *
+ *  @param word The word.
+ *  @param value Filled in with the number.
+ *
+ *  @return True if the whole word is a finite number.
+ */
+static bool to_number(const char* word, float& value)
+{
+    char* end;
+    value = strtof(word, &end);
+    return end != word && *end == '\0' && isfinite(value);
+}
+
+
+
+/** @brief Constructor for the ProfilePlayer class
+ *
+ *  @details The player starts with no steps, so start() does nothing until a profile is
+ *  loaded.
+ */
+ProfilePlayer::ProfilePlayer(void)
+{
+    step_count = 0;
+    end_ms = 0;
+    playing = false;
+    start_us = 0;
+    index = 0;
+    offset_us = 0;
+    ending = false;
+}
+
+
+
+/** @brief A function which loads a profile from a list of steps
+ *
+ *  @details The steps must start in order, each later than the one before, and a ramp or
+ *  sweep must have time to run, so if the last step is one it needs an end after its start.
+ *  A profile which is being played is stopped. If the steps are no good the player is left
+ *  empty.
+ *
+ *  @param new_steps The steps.
+ *  @param count The number of steps, from 1 to PROFILE_MAX_STEPS.
+ *  @param end The time the profile ends from its start (ms), or zero to end it with the
+ *  last step, after the pulse if the last step is a pulse.
+ *
+ *  @return True if the profile was loaded.
+ */
+bool ProfilePlayer::set_steps(const ProfileStep* new_steps, uint16_t count, uint32_t end)
+{
+    playing = false;
+    step_count = 0;
+    if (count == 0 || count > PROFILE_MAX_STEPS)
+    {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        const ProfileStep& step = new_steps[i];
+        if (step.start_ms > PROFILE_MAX_MS || (i > 0 && step.start_ms <= new_steps[i - 1].start_ms)
+            || step.target > PROFILE_TORQUE || step.shape > SHAPE_PULSE
+            || (step.shape == SHAPE_PULSE && (step.c < 1.0f || step.c > PROFILE_MAX_MS))
+            || (step.shape == SHAPE_SINE && (step.c < 0.0f || step.d < 0.0f)))
+        {
+            return false;
+        }
+    }
+
+    const ProfileStep& last = new_steps[count - 1];
+    if (end == 0)
+    {
+        end = last.start_ms + ((last.shape == SHAPE_PULSE) ? (uint32_t)last.c : 0);
+    }
+    if (end < last.start_ms || end > PROFILE_MAX_MS
+        || ((last.shape == SHAPE_RAMP || last.shape == SHAPE_SINE) && end == last.start_ms))
+    {
+        return false;
+    }
+
+    if (new_steps != steps)
+    {
+        memcpy(steps, new_steps, count * sizeof(ProfileStep));
+    }
+    step_count = count;
+    end_ms = end;
+    return true;
+}
+
+
+
+/** @brief A function which loads a profile written as text
+ *
+ *  @details Each line, or each part of a line between semicolons, is one step:
+ *
+ *      T speed|torque [hold] V
+ *      T speed|torque ramp V0 V1
+ *      T speed|torque sine OFFSET AMPLITUDE F0 [F1]
+ *      T speed|torque pulse AMPLITUDE WIDTH [BASE]
+ *      end T
+ *
+ *  T is the time the step starts from the start of the profile in ms, speeds are in RPM
+ *  and torques in N*m. A ramp runs from V0 to V1 until the next step; a sine sweep runs
+ *  from F0 Hz to F1 Hz (F0 if not given) until the next step; a pulse holds AMPLITUDE for
+ *  WIDTH ms and then BASE (zero if not given). The @c end line sets when the profile ends,
+ *  which it must if the last step is a ramp or sweep. Words may also be separated by
+ *  commas, so a profile can be kept as a CSV file, and anything after a # is ignored.
+ *  If the text is no good the player is left empty.
+ *
+ *  @param text The profile, ending with a null character.
+ *  @param error Filled in with what is wrong with the profile, if it is no good.
+ *  @param error_size The size of @c error in bytes.
+ *
+ *  @return True if the profile was loaded.
+ */
+bool ProfilePlayer::parse(const char* text, char* error, size_t error_size)
+{
+    playing = false;
+    step_count = 0;
+    uint16_t count = 0;
+    uint32_t end = 0;
+    uint16_t line = 1;
+    const char* p = text;
+
+    while (*p != '\0')
+    {
+        char words[PROFILE_LINE_WORDS][PROFILE_WORD_LEN];
+        uint8_t n = 0;
+        while (true)
+        {
+            char word[PROFILE_WORD_LEN];
+            if (!next_word(p, word))
+            {
+                snprintf(error, error_size, "line %u: word too long", line);
+                return false;
+            }
+            if (word[0] == '\0')
+            {
+                break;
+            }
+            if (n == PROFILE_LINE_WORDS)
+            {
+                snprintf(error, error_size, "line %u: too many words", line);
+                return false;
+            }
+            memcpy(words[n++], word, PROFILE_WORD_LEN);
+        }
+        if (*p == '#')
+        {
+            while (*p != '\0' && *p != '\n')
+            {
+                p++;
+            }
+        }
+        uint16_t this_line = line;
+        if (*p == '\n')
+        {
+            line++;
+        }
+        if (*p != '\0')
+        {
+            p++;
+        }
+        if (n == 0)
+        {
+            continue;
+        }
+
+        float t;
+        if (strcmp(words[0], "end") == 0)
+        {
+            if (n != 2 || !to_number(words[1], t) || t < 0.0f || t > PROFILE_MAX_MS)
+            {
+                snprintf(error, error_size, "line %u: expected end T", this_line);
+                return false;
+            }
+            end = (uint32_t)t;
+            continue;
+        }
+        if (count == PROFILE_MAX_STEPS)
+        {
+            snprintf(error, error_size, "line %u: more than %u steps", this_line, PROFILE_MAX_STEPS);
+            return false;
+        }
+        if (!to_number(words[0], t) || t < 0.0f || t > PROFILE_MAX_MS)
+        {
+            snprintf(error, error_size, "line %u: bad start time", this_line);
+            return false;
+        }
+
+        ProfileStep& step = steps[count];
+        step.start_ms = (uint32_t)t;
+        step.a = step.b = step.c = step.d = 0.0f;
+        if (n > 1 && strcmp(words[1], "speed") == 0)
+        {
+            step.target = PROFILE_SPEED;
+        }
+        else if (n > 1 && strcmp(words[1], "torque") == 0)
+        {
+            step.target = PROFILE_TORQUE;
+        }
+        else
+        {
+            snprintf(error, error_size, "line %u: expected speed or torque", this_line);
+            return false;
+        }
+
+        // a hold may leave out its name; the parameters follow the shape
+        uint8_t first = 3;
+        uint8_t least, most;
+        if (n > 2 && strcmp(words[2], "ramp") == 0)
+        {
+            step.shape = SHAPE_RAMP;
+            least = most = 2;
+        }
+        else if (n > 2 && strcmp(words[2], "sine") == 0)
+        {
+            step.shape = SHAPE_SINE;
+            least = 3;
+            most = 4;
+        }
+        else if (n > 2 && strcmp(words[2], "pulse") == 0)
+        {
+            step.shape = SHAPE_PULSE;
+            least = 2;
+            most = 3;
+        }
+        else
+        {
+            step.shape = SHAPE_HOLD;
+            first = (n > 2 && strcmp(words[2], "hold") == 0) ? 3 : 2;
+            least = most = 1;
+        }
+
+        float params[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        uint8_t given = n - first;
+        if (n < first || given < least || given > most)
+        {
+            snprintf(error, error_size, "line %u: wrong number of values", this_line);
+            return false;
+        }
+        for (uint8_t i = 0; i < given; i++)
+        {
+            if (!to_number(words[first + i], params[i]))
+            {
+                snprintf(error, error_size, "line %u: bad number %s", this_line, words[first + i]);
+                return false;
+            }
+        }
+
+        step.a = params[0];
+        step.b = params[1];
+        if (step.shape == SHAPE_SINE)
+        {
+            step.c = params[2];
+            step.d = (given == 4) ? params[3] : params[2];
+        }
+        else if (step.shape == SHAPE_PULSE)
+        {
+            // the width is stored in c so a and b are the two levels
+            step.c = params[1];
+            step.b = params[2];
+        }
+        count++;
+    }
+
+    if (count == 0)
+    {
+        snprintf(error, error_size, "no steps");
+        return false;
+    }
+
+    // set_steps() checks the order and the end; the steps are already in place
+    if (!set_steps(steps, count, end))
+    {
+        snprintf(error, error_size, "steps out of order, bad pulse width or sweep, or bad end");
+        return false;
+    }
+    return true;
+}
+
+
+
+/** @brief A function which starts playing the profile from its first step
+ *
+ *  @param now_us The time now; all due times are counted from it.
+ */
+void ProfilePlayer::start(int64_t now_us)
+{
+    if (step_count == 0)
+    {
+        return;
+    }
+    start_us = now_us;
+    index = 0;
+    offset_us = steps[0].start_ms * 1000;
+    ending = false;
+    playing = true;
+}
+
+
+
+/** @brief A function which stops playing the profile, leaving the last command in effect */
+void ProfilePlayer::stop(void)
+{
+    playing = false;
+}
+
+
+
+/** @brief A function which takes the next command due, or the end of the profile
+ *
+ *  @details The caller should wait until next_due() before calling this function. If it is
+ *  late, it can call this function until next_due() is in the future and post only the
+ *  last command; the commands after it are due at the same times they would have been.
+ *
+ *  @param command Filled in with the command, due at the time next_due() returned.
+ *
+ *  @return True if there was a command, false at the end of the profile, after which
+ *  the player is stopped.
+ */
+bool ProfilePlayer::next(ProfileCommand& command)
+{
+    if (!playing)
+    {
+        return false;
+    }
+    if (ending)
+    {
+        playing = false;
+        return false;
+    }
+
+    const ProfileStep& step = steps[index];
+    uint32_t begin_us = step.start_ms * 1000;
+    uint32_t length_us = step_length_us(index);
+    uint32_t t_us = offset_us - begin_us;
+    bool last = (index + 1 == step_count);
+
+    command.due_us = start_us + offset_us;
+    command.target = step.target;
+    command.step = index;
+    command.value = value_at(step, t_us, length_us);
+
+    uint32_t next_us;
+    if (next_in_step(step, t_us, length_us, last, next_us))
+    {
+        offset_us = begin_us + next_us;
+    }
+    else if (!last)
+    {
+        index++;
+        offset_us = steps[index].start_ms * 1000;
+    }
+    else
+    {
+        offset_us = end_ms * 1000;
+        ending = true;
+    }
+    return true;
+}
+
+
+
+/** @brief A function which returns how long a step lasts
+ *
+ *  @param i The index of the step.
+ *
+ *  @return The time from the start of the step to the start of the next, or to the end of
+ *  the profile for the last step (us).
+ */
+uint32_t ProfilePlayer::step_length_us(uint16_t i)
+{
+    uint32_t until_ms = (i + 1 < step_count) ? steps[i + 1].start_ms : end_ms;
+    return (until_ms - steps[i].start_ms) * 1000;
+}
+
+
+
+/** @brief A function which works out the command a step gives at a time
+ *
+ *  @param step The step.
+ *  @param t_us The time from the start of the step.
+ *  @param length_us How long the step lasts.
+ *
+ *  @return The speed or torque.
+ */
+float ProfilePlayer::value_at(const ProfileStep& step, uint32_t t_us, uint32_t length_us)
+{
+    float fraction = (length_us == 0) ? 0.0f : (float)t_us / (float)length_us;
+    switch (step.shape)
+    {
+        case SHAPE_RAMP:
+            return step.a + (step.b - step.a) * fraction;
+
+        case SHAPE_SINE:
+        {
+            // the frequency rises linearly, so the phase is its integral; only the fraction
+            // of a cycle is kept so the sine is as accurate late in a long sweep as early on
+            float t = t_us * 1.0e-6f;
+            float cycles = step.c * t + 0.5f * (step.d - step.c) * t * fraction;
+            cycles -= floorf(cycles);
+            return step.a + step.b * sinf(2.0f * (float)M_PI * cycles);
+        }
+
+        case SHAPE_PULSE:
+            return (t_us < (uint32_t)step.c * 1000) ? step.a : step.b;
+
+        default:
+            return step.a;
+    }
+}
+
+
+
+/** @brief A function which finds when a step gives its next command
+ *
+ *  @param step The step.
+ *  @param t_us The time of the command just given, from the start of the step.
+ *  @param length_us How long the step lasts.
+ *  @param last True for the last step, which also gives its value at the end of the profile.
+ *  @param next_us Filled in with the time of the next command from the start of the step.
+ *
+ *  @return True if the step gives another command, false if the next one comes from the
+ *  next step or the profile is over.
+ */
+bool ProfilePlayer::next_in_step(const ProfileStep& step, uint32_t t_us, uint32_t length_us, bool last,
+                                 uint32_t& next_us)
+{
+    switch (step.shape)
+    {
+        case SHAPE_RAMP:
+        case SHAPE_SINE:
+            next_us = t_us + PROFILE_UPDATE_US;
+            if (next_us < length_us)
+            {
+                return true;
+            }
+            next_us = length_us;
+            return last && t_us < length_us;
+
+        case SHAPE_PULSE:
+            next_us = (uint32_t)step.c * 1000;
+            return t_us == 0 && (next_us < length_us || (last && next_us == length_us));
+
+        default:
+            return false;
+    }
+}
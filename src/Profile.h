@@ -0,0 +1,149 @@
+/** @file Profile.h
+ *  This file contains the ProfilePlayer class, which plays a command profile: a list of
+ *  timestamped steps, each holding a speed or torque or running a ramp, a sine sweep or a
+ *  pulse, which are turned into commands at exact times from the start of the profile.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Most steps in one profile
+#define PROFILE_MAX_STEPS 64
+
+// Time between the commands of a ramp or sine sweep (us)
+#define PROFILE_UPDATE_US 5000
+
+// Latest time a step may start or a profile may end, an hour (ms)
+#define PROFILE_MAX_MS 3600000
+
+/** What a step of a profile commands */
+enum ProfileTarget
+{
+    PROFILE_SPEED,      // speeds in RPM, posted with post_speed_cmd()
+    PROFILE_TORQUE      // torques in N*m, posted with post_torque_cmd()
+};
+
+/** How the command changes during a step */
+enum ProfileShape
+{
+    SHAPE_HOLD,         // a, from the start of the step
+    SHAPE_RAMP,         // from a at the start of the step to b at its end
+    SHAPE_SINE,         // a + b sin(phase), sweeping from c Hz at the start to d Hz at the end
+    SHAPE_PULSE         // a for c ms from the start of the step, then b
+};
+
+/** One step of a profile, which lasts until the next one starts or the profile ends */
+struct ProfileStep
+{
+    uint32_t start_ms;  // time the step starts from the start of the profile
+    uint8_t target;     // a ProfileTarget
+    uint8_t shape;      // a ProfileShape
+    float a;            // first parameter of the shape
+    float b;            // second parameter of the shape
+    float c;            // third parameter of the shape
+    float d;            // fourth parameter of the shape
+};
+
+/** A command to be posted, and when */
+struct ProfileCommand
+{
+    int64_t due_us;     // time the command is due, on the clock given to ProfilePlayer::start()
+    uint8_t target;     // a ProfileTarget
+    uint16_t step;      // index of the step which gave the command
+    float value;        // the speed in RPM or torque in N*m
+};
+
+/** This class turns the steps of a profile into commands at the times they are due.
+ *
+ *  @details Every due time is an offset from the start, which is worked out from the steps
+ *  rather than added up from the times commands were actually posted, so a player which is
+ *  late for one command is not late for the next and a long profile does not drift. A hold
+ *  gives one command at the start of its step and a pulse gives two; ramps and sine sweeps
+ *  give one every PROFILE_UPDATE_US from the start of the step, and the last step also gives
+ *  its value at the end of the profile. The last command stays in effect after the end.
+ */
+class ProfilePlayer
+{
+    protected:
+
+        ProfileStep steps[PROFILE_MAX_STEPS];   // the steps, in order of their start times
+        uint16_t step_count;                    // number of steps
+        uint32_t end_ms;                        // time the profile ends from its start
+        bool playing;                           // true from start() until the end or stop()
+        int64_t start_us;                       // time the profile was started
+        uint16_t index;                         // step which gives the next command
+        uint32_t offset_us;                     // time of the next event from the start
+        bool ending;                            // true if the next event is the end
+
+        uint32_t step_length_us(uint16_t i);
+        float value_at(const ProfileStep& step, uint32_t t_us, uint32_t length_us);
+        bool next_in_step(const ProfileStep& step, uint32_t t_us, uint32_t length_us, bool last,
+                          uint32_t& next_us);
+
+    public:
+
+        /** Non-inline functions are commented in Profile.cpp */
+        ProfilePlayer(void);
+
+        bool set_steps(const ProfileStep* new_steps, uint16_t count, uint32_t end);
+        bool parse(const char* text, char* error, size_t error_size);
+        void start(int64_t now_us);
+        void stop(void);
+        bool next(ProfileCommand& command);
+
+
+
+        /** @brief A function which says whether the profile is being played
+         *
+         *  @return True from start() until the end of the profile or stop().
+         */
+        bool is_playing(void)
+        {
+            return playing;
+        }
+
+
+
+        /** @brief A function which returns the time the next command or the end is due
+         *
+         *  @return The time on the clock given to start(); only meaningful while playing.
+         */
+        int64_t next_due(void)
+        {
+            return start_us + offset_us;
+        }
+
+
+
+        /** @brief A function which returns the time the profile was started
+         *
+         *  @return The time given to start(), which may be in the future.
+         */
+        int64_t start_time(void)
+        {
+            return start_us;
+        }
+
+
+
+        /** @brief A function which returns the number of steps in the profile */
+        uint16_t steps_loaded(void)
+        {
+            return step_count;
+        }
+
+
+
+        /** @brief A function which returns the length of the profile in milliseconds */
+        uint32_t duration_ms(void)
+        {
+            return end_ms;
+        }
+};
+
+#endif
@@ -0,0 +1,298 @@
+/** @file ProfileTask.cpp
+ *  This file contains the task which plays command profiles. A profile is uploaded as text
+ *  to the webserver, which loads it into the ProfilePlayer here; when it is started, this task
+ *  posts each command through post_speed_cmd() or post_torque_cmd() at the time it is due,
+ *  woken by a one-shot esp_timer, so the commands land within tens of microseconds of their
+ *  times instead of on the 1 ms FreeRTOS tick. Every telemetry sample taken while a profile
+ *  plays is tagged with the profile and the step which gave the latest command.
+*/
+
+#include <Arduino.h>
+#include <atomic>
+#include "esp_timer.h"
+#include "Shares.h"
+#include "CtrlTasks.h"
+#include "ProfileTask.h"
+#include "LatencyHistogram.h"
+
+// Time from starting a recorded profile to its first step, so the recorder task has opened
+// the run before the first command (ms)
+#define PROFILE_RECORD_LEAD_MS 300
+
+// Shortest time between profile timing reports over serial while a profile plays (ms)
+#define PROFILE_REPORT_MS 10000
+
+ProfilePlayer profile_player;                   // the loaded profile, used only with profile_mutex held
+SemaphoreHandle_t profile_mutex = NULL;         // keeps the profile task and the webserver apart
+TaskHandle_t profile_handle = NULL;             // the profile task, woken by the timer and the webserver
+char profile_name[RUNLOG_PROFILE_LEN];          // name the loaded profile was uploaded with
+uint16_t profile_number = 0;                    // number of the latest profile started since power-up
+bool profile_recording = false;                 // true if the profile playing is being recorded as a run
+uint32_t profile_late_max = 0;                  // latest any command of this profile was posted (us)
+uint32_t profile_skipped = 0;                   // commands of this profile replaced before they were posted
+std::atomic<uint32_t> profile_tag_word (0);     // profile number and step for telemetry, or zero
+
+
+
+/** @brief Function which sets up the profile player, to be called once from setup() */
+void profile_begin(void)
+{
+    profile_mutex = xSemaphoreCreateMutex();
+    profile_name[0] = '\0';
+}
+
+
+
+/** @brief Function which asks the recorder task to start or stop a run for the profile
+ *
+ *  @param start True to start a run named after the profile, false to end it.
+ *  @param epoch_s The wall-clock time given by the client (Unix s), or zero.
+ */
+static void post_recorder(bool start, uint32_t epoch_s)
+{
+    RecorderCommand command;
+    memset(&command, 0, sizeof(command));
+    command.start = start;
+    command.epoch_s = epoch_s;
+    memcpy(command.profile, profile_name, sizeof(command.profile));
+    recorder_cmd.post(command, esp_timer_get_time());
+}
+
+
+
+/** @brief Function which loads a profile written as text
+ *
+ *  @details The text is read as by ProfilePlayer::parse(). A profile which is playing is
+ *  stopped first, leaving its last command in effect.
+ *
+ *  @param text The profile.
+ *  @param name A name for the profile, which recorded runs of it are given.
+ *  @param error Filled in with what is wrong with the profile, if it is no good.
+ *  @param error_size The size of @c error in bytes.
+ *
+ *  @return True if the profile was loaded.
+ */
+bool profile_load(const char* text, const char* name, char* error, size_t error_size)
+{
+    profile_stop();
+    xSemaphoreTake(profile_mutex, portMAX_DELAY);
+    bool loaded = profile_player.parse(text, error, error_size);
+    strncpy(profile_name, loaded ? name : "", sizeof(profile_name) - 1);
+    profile_name[sizeof(profile_name) - 1] = '\0';
+    xSemaphoreGive(profile_mutex);
+    return loaded;
+}
+
+
+
+/** @brief Function which starts playing the loaded profile from its first step
+ *
+ *  @details A profile which is already playing starts again. If it is recorded, a run named
+ *  after the profile is started, and the profile is started a moment later so the run holds
+ *  the first command.
+ *
+ *  @param record True to record the profile as a test run.
+ *  @param epoch_s The wall-clock time given by the client (Unix s), or zero.
+ *
+ *  @return True if a profile was loaded and has been started.
+ */
+bool profile_start(bool record, uint32_t epoch_s)
+{
+    xSemaphoreTake(profile_mutex, portMAX_DELAY);
+    bool loaded = profile_player.steps_loaded() > 0;
+    if (loaded)
+    {
+        if (record)
+        {
+            post_recorder(true, epoch_s);
+        }
+        else if (profile_recording)
+        {
+            post_recorder(false, 0);
+        }
+        profile_recording = record;
+        profile_number++;
+        profile_late_max = 0;
+        profile_skipped = 0;
+        profile_tag_word.store(0, std::memory_order_relaxed);
+        profile_player.start(esp_timer_get_time() + (record ? PROFILE_RECORD_LEAD_MS * 1000 : 0));
+    }
+    xSemaphoreGive(profile_mutex);
+
+    if (loaded && profile_handle != NULL)
+    {
+        xTaskNotifyGive(profile_handle);
+    }
+    return loaded;
+}
+
+
+
+/** @brief Function which stops the profile playing, if one is
+ *
+ *  @details The webserver calls this when a speed or torque is commanded by hand, so the
+ *  profile does not overwrite it. The last command of the profile stays in effect until then.
+ */
+void profile_stop(void)
+{
+    xSemaphoreTake(profile_mutex, portMAX_DELAY);
+    bool was_playing = profile_player.is_playing();
+    profile_player.stop();
+    if (profile_recording)
+    {
+        post_recorder(false, 0);
+        profile_recording = false;
+    }
+    profile_tag_word.store(0, std::memory_order_relaxed);
+    xSemaphoreGive(profile_mutex);
+
+    if (was_playing && profile_handle != NULL)
+    {
+        xTaskNotifyGive(profile_handle);
+    }
+}
+
+
+
+/** @brief Function which returns what telemetry samples are tagged with
+ *
+ *  @details The control tasks call this for every sample, so it only reads one word.
+ *
+ *  @return The number of the profile playing in the upper 16 bits and the step which gave
+ *  the latest command in the lower 16 bits, or zero if no profile is playing.
+ */
+uint32_t profile_tag(void)
+{
+    return profile_tag_word.load(std::memory_order_relaxed);
+}
+
+
+
+/** @brief Function which copies what the profile task is doing
+ *
+ *  @param status Filled in with the state of the player and the loaded profile.
+ */
+void profile_status(ProfileStatus& status)
+{
+    xSemaphoreTake(profile_mutex, portMAX_DELAY);
+    status.playing = profile_player.is_playing();
+    status.number = profile_number;
+    status.step = (uint16_t)(profile_tag_word.load(std::memory_order_relaxed) & 0xFFFF);
+    status.steps = profile_player.steps_loaded();
+    status.duration_ms = profile_player.duration_ms();
+    int64_t elapsed = esp_timer_get_time() - profile_player.start_time();
+    status.elapsed_ms = (status.playing && elapsed > 0) ? (uint32_t)(elapsed / 1000) : 0;
+    status.late_max_us = profile_late_max;
+    status.skipped = profile_skipped;
+    memcpy(status.name, profile_name, sizeof(status.name));
+    xSemaphoreGive(profile_mutex);
+}
+
+
+
+/** @brief Callback for the one-shot profile timer
+ *
+ *  @details This runs in the esp_timer task, which has a higher priority than any other, at
+ *  the time the next command is due, and wakes the profile task to post it.
+ *
+ *  @param arg The handle of the profile task.
+ */
+static void profile_callback(void* arg)
+{
+    xTaskNotifyGive((TaskHandle_t)arg);
+}
+
+
+
+/** @brief Task which posts the commands of the profile playing at the times they are due
+ *
+ *  @details The task sleeps until the one-shot timer, profile_start() or profile_stop() wakes
+ *  it. It then takes every command which is due: if it woke late and more than one is due,
+ *  only the latest is posted, as the mailboxes only keep the latest command anyway, and the
+ *  others are counted as skipped. The timer is then armed for the next command, from its due
+ *  time rather than from now, so lateness never adds up over a profile. The time from each
+ *  command being due to it being posted is printed over serial every 10 s while a profile
+ *  plays and when it ends. This task has a higher priority than the control tasks so their
+ *  work does not delay a command, but it only runs for a few microseconds at a time.
+ */
+void task_profile(void* p_params)
+{
+    profile_handle = xTaskGetCurrentTaskHandle();
+
+    esp_timer_handle_t timer;
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = profile_callback;
+    timer_args.arg = profile_handle;
+    timer_args.name = "Profile Timer";
+    esp_timer_create(&timer_args, &timer);
+
+    LatencyHistogram lateness;              // time from each command being due to it being posted
+    uint32_t last_report = millis();        // time of the last serial report
+    char line[160];                         // text of the serial report
+
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        esp_timer_stop(timer);
+
+        xSemaphoreTake(profile_mutex, portMAX_DELAY);
+        int64_t now_us = esp_timer_get_time();
+        ProfileCommand command;
+        bool have = false;
+        bool ended = false;
+        while (profile_player.is_playing() && profile_player.next_due() <= now_us)
+        {
+            if (profile_player.next(command))
+            {
+                profile_skipped += have ? 1 : 0;
+                have = true;
+            }
+            else
+            {
+                ended = true;
+            }
+        }
+
+        if (have)
+        {
+            if (command.target == PROFILE_TORQUE)
+            {
+                post_torque_cmd(command.value);
+            }
+            else
+            {
+                post_speed_cmd(rpm_from_float(command.value));
+            }
+            uint32_t late_us = (uint32_t)(esp_timer_get_time() - command.due_us);
+            lateness.add(late_us);
+            profile_late_max = (late_us > profile_late_max) ? late_us : profile_late_max;
+            profile_tag_word.store(((uint32_t)profile_number << 16) | command.step, std::memory_order_relaxed);
+        }
+
+        if (ended)
+        {
+            profile_tag_word.store(0, std::memory_order_relaxed);
+            if (profile_recording)
+            {
+                post_recorder(false, 0);
+                profile_recording = false;
+            }
+        }
+        else if (profile_player.is_playing())
+        {
+            int64_t delay_us = profile_player.next_due() - esp_timer_get_time();
+            esp_timer_start_once(timer, (delay_us > 0) ? (uint64_t)delay_us : 1);
+        }
+        xSemaphoreGive(profile_mutex);
+
+        if (lateness.count() > 0 && (ended || millis() - last_report >= PROFILE_REPORT_MS))
+        {
+            lateness.report(line, sizeof(line), "Profile command lateness");
+            Serial.println(line);
+            Serial.printf("Profile %u: %lu commands skipped\n", (unsigned)profile_number,
+                          (unsigned long)profile_skipped);
+            lateness.reset();
+            last_report = millis();
+        }
+    }
+}
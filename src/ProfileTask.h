@@ -0,0 +1,38 @@
+/** @file ProfileTask.h
+ *  This file contains the task which plays command profiles uploaded from the web page, and
+ *  the functions the webserver uses to load, start and stop them.
+*/
+
+#ifndef _PROFILETASK_H_
+#define _PROFILETASK_H_
+
+#include <Arduino.h>
+#include "Profile.h"
+#include "RunLog.h"
+
+/** What the profile task is doing, for the web page */
+struct ProfileStatus
+{
+    bool playing;                   // true while a profile is being played
+    uint16_t number;                // number of the latest profile started since power-up, or zero
+    uint16_t step;                  // step which gave the latest command
+    uint16_t steps;                 // number of steps in the loaded profile
+    uint32_t elapsed_ms;            // time since the profile started, or zero if it is not playing
+    uint32_t duration_ms;           // length of the loaded profile
+    uint32_t late_max_us;           // latest any command of the profile was posted after it was due
+    uint32_t skipped;               // commands of the profile replaced by a later one before they were posted
+    char name[RUNLOG_PROFILE_LEN];  // name the profile was uploaded with
+};
+
+/** These functions are commented in ProfileTask.cpp */
+void profile_begin(void);
+bool profile_load(const char* text, const char* name, char* error, size_t error_size);
+bool profile_start(bool record, uint32_t epoch_s);
+void profile_stop(void);
+uint32_t profile_tag(void);
+void profile_status(ProfileStatus& status);
+
+/** This task is commented in ProfileTask.cpp */
+void task_profile(void* p_params);
+
+#endif
@@ -0,0 +1,322 @@
+/** @file Recorder.cpp
+ *  This file contains the task which records test runs to flash, so they survive the browser
+ *  tab closing or the ESP32 resetting. The webserver task copies every sample it logs into
+ *  record_ring while a run is being recorded, and this task, which has the lowest priority,
+ *  writes them to the RunLog in batches. No control task ever touches the flash or waits for
+ *  this task.
+ *
+ *  The log is kept in the data partition which the default ESP32 partition table sets aside
+ *  for SPIFFS. This program does not use SPIFFS, so the partition is used raw and the
+ *  partition table does not need to change.
+*/
+
+#include <Arduino.h>
+#include <atomic>
+#include "Shares.h"
+#include "Recorder.h"
+#include "LatencyHistogram.h"
+
+// Time between passes of the recorder task (ms)
+#define RECORDER_PERIOD_MS 100
+
+// Longest time samples wait in the batch before they are written, even if it is not full (ms)
+#define RECORDER_FLUSH_MS 1000
+
+// Sectors kept erased for the next runs, so no erase stalls the flash cache while one is
+// recorded. At full speed a run fills a sector every few seconds
+#define RECORDER_SPARE_SECTORS 128
+
+// Shortest time between recorder reports over serial (ms)
+#define RECORDER_REPORT_MS 10000
+
+PartitionFlash run_flash;                   // the partition the runs are stored in
+RunLog run_log (&run_flash);                // the log of runs, used only with log_mutex held
+SemaphoreHandle_t log_mutex = NULL;         // keeps the recorder task and the webserver apart
+bool log_mounted = false;                   // true once the log has been found in the partition
+std::atomic<bool> log_recording (false);    // true while the webserver should copy samples to record_ring
+
+
+
+/** @brief Constructor for the PartitionFlash class
+ *
+ *  @details The partition is not looked up until begin() is called from setup().
+ */
+PartitionFlash::PartitionFlash(void)
+{
+    partition = NULL;
+}
+
+
+
+/** @brief A function which finds the SPIFFS data partition
+ *
+ *  @return True if the partition table has one.
+ */
+bool PartitionFlash::begin(void)
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, NULL);
+    return partition != NULL;
+}
+
+
+
+/** @brief A function which reads bytes from the partition
+ *
+ *  @param addr The offset of the first byte from the start of the partition.
+ *  @param data Filled in with the bytes read.
+ *  @param len The number of bytes to read.
+ *
+ *  @return True if the bytes were read.
+ */
+bool PartitionFlash::read(uint32_t addr, void* data, uint32_t len)
+{
+    return partition != NULL && esp_partition_read(partition, addr, data, len) == ESP_OK;
+}
+
+
+
+/** @brief A function which writes bytes to erased flash in the partition
+ *
+ *  @param addr The offset of the first byte from the start of the partition.
+ *  @param data The bytes to write.
+ *  @param len The number of bytes to write.
+ *
+ *  @return True if the bytes were written.
+ */
+bool PartitionFlash::write(uint32_t addr, const void* data, uint32_t len)
+{
+    return partition != NULL && esp_partition_write(partition, addr, data, len) == ESP_OK;
+}
+
+
+
+/** @brief A function which erases one sector of the partition
+ *
+ *  @param sector The index of the sector.
+ *
+ *  @return True if the sector was erased.
+ */
+bool PartitionFlash::erase(uint32_t sector)
+{
+    return partition != NULL
+           && esp_partition_erase_range(partition, sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) == ESP_OK;
+}
+
+
+
+/** @brief Function which finds the log of runs in flash, to be called once from setup()
+ *
+ *  @details Reading the whole partition to rebuild the index takes a moment, so this is done
+ *  before the tasks start. A run which was being recorded when the ESP32 reset is closed.
+ *
+ *  @return True if the log is ready to record runs.
+ */
+bool recorder_begin(void)
+{
+    log_mutex = xSemaphoreCreateMutex();
+    log_mounted = run_flash.begin() && run_log.mount();
+    if (log_mounted)
+    {
+        run_log.set_spare(RECORDER_SPARE_SECTORS);
+        run_log.prepare();
+        Serial.printf("Run log: %u runs kept in %lu of %lu sectors\n", (unsigned)run_log.runs_kept(),
+                      (unsigned long)run_log.segments_used(), (unsigned long)run_flash.sector_count());
+    }
+    else
+    {
+        Serial.println("Run log: no SPIFFS data partition, runs will not be recorded");
+    }
+    return log_mounted;
+}
+
+
+
+/** @brief Function which says whether a run is being recorded
+ *
+ *  @details The webserver task calls this for every sample it logs, so it only reads a flag.
+ *
+ *  @return True if samples should be pushed into record_ring.
+ */
+bool recorder_recording(void)
+{
+    return log_recording.load(std::memory_order_relaxed);
+}
+
+
+
+/** @brief Function which copies the index of the recorded runs
+ *
+ *  @param runs Filled in with the runs, oldest first.
+ *  @param max The number of runs which fit in @c runs.
+ *
+ *  @return The number of runs copied.
+ */
+uint8_t recorder_runs(RunInfo* runs, uint8_t max)
+{
+    if (!log_mounted)
+    {
+        return 0;
+    }
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    uint8_t count = (run_log.runs_kept() < max) ? run_log.runs_kept() : max;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        runs[i] = run_log.run(i);
+    }
+    xSemaphoreGive(log_mutex);
+    return count;
+}
+
+
+
+/** @brief Function which gets ready to read the samples of a run
+ *
+ *  @param id The id of the run.
+ *  @param cursor Filled in with the position of the first samples.
+ *
+ *  @return True if the run is in the log.
+ */
+bool recorder_open(uint32_t id, RunCursor& cursor)
+{
+    if (!log_mounted)
+    {
+        return false;
+    }
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    bool found = run_log.open_run(id, cursor);
+    xSemaphoreGive(log_mutex);
+    return found;
+}
+
+
+
+/** @brief Function which reads the next batch of samples of a run
+ *
+ *  @details The lock is only held for one record, so the recorder task can write between
+ *  batches of a long download.
+ *
+ *  @param cursor The position from recorder_open() or the last call.
+ *  @param out Filled in with the samples; it must hold RUNLOG_RECORD_SAMPLES samples.
+ *
+ *  @return The number of samples read, or zero at the end of the run.
+ */
+uint16_t recorder_read(RunCursor& cursor, TelemetrySample* out)
+{
+    if (!log_mounted)
+    {
+        return 0;
+    }
+    xSemaphoreTake(log_mutex, portMAX_DELAY);
+    uint16_t count = run_log.read_run(cursor, out);
+    xSemaphoreGive(log_mutex);
+    return count;
+}
+
+
+
+/** @brief Task which writes the samples of the run being recorded to flash
+ *
+ *  @details Every 100 ms the task takes the samples the webserver has pushed into record_ring
+ *  and adds them to a batch, which is written as one record when it is full or has waited 1 s,
+ *  so the flash is written a few times a second at most. Starting and stopping a run is posted
+ *  by the webserver to the recorder_cmd mailbox; the batch is written first so it stays in the
+ *  run it was recorded in. Samples which arrive while no run is open are thrown away.
+ *
+ *  This task has the lowest priority, so it only runs when the control tasks and the
+ *  webserver are waiting, and nothing waits for it: if it falls behind, record_ring overflows
+ *  and the lost samples are counted. The time taken by each flash write is printed over
+ *  serial every 10 s while recording.
+ *
+ *  Sectors are only erased on passes when no run is open, one per pass, until
+ *  RECORDER_SPARE_SECTORS are waiting. A run which uses them all up stops being written, and
+ *  the segments refused are counted in the report, rather than erasing while it runs.
+ */
+void task_recorder(void* p_params)
+{
+    TelemetrySample batch[RUNLOG_RECORD_SAMPLES];   // samples waiting to be written
+    uint16_t count = 0;                             // number of samples in batch
+    uint32_t batch_ms = millis();                   // time the first sample went into batch
+    Mail<RecorderCommand> mail;                     // latest start or stop from the webserver
+    LatencyHistogram flash_time;                    // time taken by each write to the log
+    uint32_t last_report = millis();                // time of the last serial report
+    char line[160];                                 // text of the serial report
+
+    while (true)
+    {
+        vTaskDelay(RECORDER_PERIOD_MS);
+        if (!log_mounted)
+        {
+            continue;
+        }
+
+        bool command = recorder_cmd.take(mail);
+        do
+        {
+            while (count < RUNLOG_RECORD_SAMPLES && record_ring.pop(batch[count]))
+            {
+                if (count++ == 0)
+                {
+                    batch_ms = millis();
+                }
+            }
+
+            if (count > 0 && (count == RUNLOG_RECORD_SAMPLES || command || millis() - batch_ms >= RECORDER_FLUSH_MS))
+            {
+                uint32_t start = micros();
+                xSemaphoreTake(log_mutex, portMAX_DELAY);
+                run_log.append(batch, count);
+                xSemaphoreGive(log_mutex);
+                flash_time.add(micros() - start);
+                count = 0;
+            }
+        }
+        while (record_ring.available() > 0 && count == 0);
+
+        if (command)
+        {
+            // the webserver stops copying samples before the run is closed
+            log_recording.store(false, std::memory_order_relaxed);
+            uint32_t start = micros();
+            xSemaphoreTake(log_mutex, portMAX_DELAY);
+            bool started = false;
+            if (mail.value.start)
+            {
+                started = run_log.start_run(mail.value.profile, millis(), mail.value.epoch_s);
+            }
+            else
+            {
+                run_log.end_run();
+            }
+            xSemaphoreGive(log_mutex);
+            flash_time.add(micros() - start);
+
+            // samples left over from the last run are not part of the new one
+            TelemetrySample stale;
+            while (record_ring.pop(stale))
+            {
+            }
+            count = 0;
+            log_recording.store(started, std::memory_order_relaxed);
+        }
+
+        if (!command)
+        {
+            xSemaphoreTake(log_mutex, portMAX_DELAY);
+            run_log.prepare();
+            xSemaphoreGive(log_mutex);
+        }
+
+        if (millis() - last_report >= RECORDER_REPORT_MS && flash_time.count() > 0)
+        {
+            flash_time.report(line, sizeof(line), "Run log write");
+            Serial.println(line);
+            Serial.printf("Run log: %u runs, %lu sectors used, %lu erased, wear %lu erases, %lu write failures, "
+                          "%lu segments refused, %lu samples lost\n", (unsigned)run_log.runs_kept(),
+                          (unsigned long)run_log.segments_used(), (unsigned long)run_log.spare_sectors(),
+                          (unsigned long)run_log.wear(), (unsigned long)run_log.write_failures(),
+                          (unsigned long)run_log.spare_refusals(), (unsigned long)record_ring.overflows());
+            flash_time.reset();
+            last_report = millis();
+        }
+    }
+}
@@ -0,0 +1,70 @@
+/** @file Recorder.h
+ *  This file contains the task which records test runs to flash, the PartitionFlash class
+ *  which gives the RunLog the ESP32's data partition, and the functions the webserver uses to
+ *  start and stop runs and read them back.
+*/
+
+#ifndef _RECORDER_H_
+#define _RECORDER_H_
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include "FlashDevice.h"
+#include "RunLog.h"
+
+// Number of samples the webserver can hand to the recorder task before it writes them
+#define RECORD_RING_SIZE 256
+
+/** A request from the webserver to start or stop recording a run */
+struct RecorderCommand
+{
+    bool start;                         // true to start a new run, false to end the one being recorded
+    uint32_t epoch_s;                   // wall-clock time given by the client (Unix s), or zero
+    char profile[RUNLOG_PROFILE_LEN];   // name of the command profile of the new run
+};
+
+/** This class is the FlashDevice for a data partition in the ESP32's SPI flash */
+class PartitionFlash : public FlashDevice
+{
+    protected:
+
+        const esp_partition_t* partition;   // the partition, or NULL if it was not found
+
+    public:
+
+        /** Non-inline functions are commented in Recorder.cpp */
+        PartitionFlash(void);
+        bool begin(void);
+
+        bool read(uint32_t addr, void* data, uint32_t len);
+        bool write(uint32_t addr, const void* data, uint32_t len);
+        bool erase(uint32_t sector);
+
+
+
+        /** @brief A function which returns the size of one sector in bytes */
+        uint32_t sector_size(void)
+        {
+            return SPI_FLASH_SEC_SIZE;
+        }
+
+
+
+        /** @brief A function which returns the number of sectors in the partition */
+        uint32_t sector_count(void)
+        {
+            return (partition == NULL) ? 0 : partition->size / SPI_FLASH_SEC_SIZE;
+        }
+};
+
+/** These functions are commented in Recorder.cpp */
+bool recorder_begin(void);
+bool recorder_recording(void);
+uint8_t recorder_runs(RunInfo* runs, uint8_t max);
+bool recorder_open(uint32_t id, RunCursor& cursor);
+uint16_t recorder_read(RunCursor& cursor, TelemetrySample* out);
+
+/** This task is commented in Recorder.cpp */
+void task_recorder(void* p_params);
+
+#endif
@@ -0,0 +1,915 @@
+/** @file RunLog.cpp
+ *  This file contains the RunLog class, which records test runs of telemetry samples in a
+ *  circular log in flash.
+*/
+
+#include <string.h>
+#include "RunLog.h"
+#include "TelemetryCodec.h"
+
+// Tag at the start of every segment, the bytes "RSEG"
+#define SEGMENT_MAGIC 0x47455352
+
+// Record types
+#define RECORD_RUN_START 1      // a run began: RunStartRecord
+#define RECORD_SAMPLES   2      // samples of a run: its id, then TelemetrySample[]
+#define RECORD_RUN_END   3      // a run ended: RunEndRecord
+#define RECORD_PACKED    4      // samples of a run: its id, then one TelemetryCodec block
+#define RECORD_ERASED    0xFF   // erased flash, where the next record will go
+
+/** The header at the start of every sector */
+struct SegmentHeader
+{
+    uint32_t magic;             // SEGMENT_MAGIC
+    uint32_t seq;               // sequence number of the segment
+    uint32_t erases;            // times the sector has been erased, including for this segment
+    uint32_t crc;               // CRC-32 of the fields above
+};
+
+/** The header in front of every record, written after the payload */
+struct RecordHeader
+{
+    uint8_t type;               // RECORD_ type
+    uint8_t reserved;           // zero
+    uint16_t length;            // bytes of payload, which is padded to a multiple of four
+    uint32_t crc;               // CRC-32 of the type, reserved and length bytes and the payload
+};
+
+/** The payload of a run start record */
+struct RunStartRecord
+{
+    uint32_t id;
+    uint32_t boot;
+    uint32_t start_ms;
+    uint32_t epoch_s;
+    char profile[RUNLOG_PROFILE_LEN];
+};
+
+/** The payload of a run end record */
+struct RunEndRecord
+{
+    uint32_t id;
+    uint32_t samples;
+};
+
+// Size of the longest record payload, which must fit in a segment after its headers. A packed
+// record is only written if it is shorter than the samples as they are
+#define RECORD_MAX (sizeof(uint32_t) + RUNLOG_RECORD_SAMPLES * sizeof(TelemetrySample))
+
+
+
+/** @brief Function which adds bytes to a CRC-32 (the one used by Ethernet and zip)
+ *
+ *  @details A 16 entry table handles four bits at a time, which is fast enough for the few
+ *  kilobytes a second the log writes and keeps the table out of the way.
+ *
+ *  @param crc The CRC of the bytes before these, or zero to start.
+ *  @param data The bytes.
+ *  @param len The number of bytes.
+ *
+ *  @return The CRC of all the bytes so far.
+ */
+static uint32_t crc32(uint32_t crc, const void* data, uint32_t len)
+{
+    static const uint32_t table[16] =
+    {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    const uint8_t* bytes = (const uint8_t*)data;
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc ^= bytes[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+
+
+/** @brief Function which reads a segment header and checks it
+ *
+ *  @param flash The flash holding the log.
+ *  @param sector The sector to read.
+ *  @param header Filled in with the header.
+ *
+ *  @return True if the sector starts with a valid segment header.
+ */
+static bool read_header(FlashDevice* flash, uint32_t sector, SegmentHeader& header)
+{
+    return flash->read(sector * flash->sector_size(), &header, sizeof(header))
+           && header.magic == SEGMENT_MAGIC
+           && header.crc == crc32(0, &header, sizeof(header) - sizeof(uint32_t));
+}
+
+
+
+/** @brief Function which counts the samples in a record
+ *
+ *  @param type The record type.
+ *  @param length The length of the payload.
+ *  @param payload The start of the payload: the run id and, for a packed record, the block
+ *  header after it.
+ *
+ *  @return The number of samples in the record, or zero if it does not hold samples.
+ */
+static uint32_t samples_in(uint8_t type, uint16_t length, const uint8_t* payload)
+{
+    if (type == RECORD_SAMPLES && length >= sizeof(uint32_t))
+    {
+        return (length - sizeof(uint32_t)) / sizeof(TelemetrySample);
+    }
+    if (type == RECORD_PACKED && length >= sizeof(uint32_t) + sizeof(TelemetryBlockHeader))
+    {
+        TelemetryBlockHeader block;
+        memcpy(&block, payload + sizeof(uint32_t), sizeof(block));
+        return block.count;
+    }
+    return 0;
+}
+
+
+
+/** @brief Constructor for the RunLog class
+ *
+ *  @details The log is empty until mount() has read the flash, so the flash does not need to
+ *  be ready when this object is made.
+ *
+ *  @param flash_ The flash to keep the log in. It needs at least two sectors of at least
+ *  2 kB, so that a full record fits in a segment.
+ */
+RunLog::RunLog(FlashDevice* flash_)
+{
+    flash = flash_;
+    sector_bytes = 0;
+    sectors = 0;
+    have_head = false;
+    head_seq = 0;
+    head_sector = 0;
+    head_offset = 0;
+    oldest_seq = 0;
+    boot = 1;
+    next_id = 1;
+    run_count = 0;
+    recording = false;
+    max_erases = 0;
+    failures = 0;
+    spare_target = 0;
+    spares = 0;
+    refusals = 0;
+}
+
+
+
+/** @brief A function which finds the log in the flash and rebuilds the index of runs
+ *
+ *  @details The segment with the highest sequence number is the newest. Going back from it,
+ *  the segments with consecutive sequence numbers are the ones kept, and their records are
+ *  read oldest first to rebuild the index. Writing carries on after the last good record of
+ *  the newest segment, or in a fresh segment if that one was cut off part way through a
+ *  write. A run which was still being recorded when the power went is closed.
+ *
+ *  @return True if the flash is big enough to hold the log. Nothing else can be done with the
+ *  log until this has succeeded.
+ */
+bool RunLog::mount(void)
+{
+    sector_bytes = flash->sector_size();
+    sectors = flash->sector_count();
+    have_head = false;
+    run_count = 0;
+    recording = false;
+    max_erases = 0;
+    boot = 1;
+    next_id = 1;
+    spares = 0;
+    if (sectors < 2 || sector_bytes < sizeof(SegmentHeader) + sizeof(RecordHeader) + RECORD_MAX)
+    {
+        sectors = 0;
+        return false;
+    }
+
+    SegmentHeader header;
+    for (uint32_t sector = 0; sector < sectors; sector++)
+    {
+        if (read_header(flash, sector, header))
+        {
+            if (!have_head || header.seq > head_seq)
+            {
+                head_seq = header.seq;
+                head_sector = sector;
+                have_head = true;
+            }
+            if (header.erases > max_erases)
+            {
+                max_erases = header.erases;
+            }
+        }
+    }
+    if (!have_head)
+    {
+        return true;
+    }
+
+    oldest_seq = head_seq;
+    for (uint32_t back = 1; back < sectors && back <= head_seq; back++)
+    {
+        if (!read_header(flash, sector_of(head_seq - back), header) || header.seq != head_seq - back)
+        {
+            break;
+        }
+        oldest_seq = head_seq - back;
+    }
+
+    bool clean = true;
+    for (uint32_t seq = oldest_seq; seq <= head_seq; seq++)
+    {
+        head_offset = scan_segment(seq, clean);
+    }
+
+    // a record cut off part way through leaves bytes which cannot be written again until erased
+    if (!clean)
+    {
+        head_offset = sector_bytes;
+    }
+
+    for (uint8_t i = 0; i < run_count; i++)
+    {
+        runs[i].open = false;
+        if (runs[i].boot >= boot)
+        {
+            boot = runs[i].boot + 1;
+        }
+    }
+    return true;
+}
+
+
+
+/** @brief A function which sets how many sectors prepare() keeps erased
+ *
+ *  @details Erasing a sector takes tens of milliseconds, and on the ESP32 the flash cache is
+ *  off meanwhile, so every task running from flash waits. Once this is set above zero the
+ *  log only erases in prepare(), which the caller runs while nothing needs the processor on
+ *  time, and a segment which finds no erased sector waiting is refused and counted instead.
+ *
+ *  @param count The number of sectors, which is limited to RUNLOG_MAX_SPARE and to one less
+ *  than the sectors in the log, so the log must be mounted first. Zero makes the log erase
+ *  each sector when it needs it.
+ */
+void RunLog::set_spare(uint32_t count)
+{
+    count = (count < RUNLOG_MAX_SPARE) ? count : RUNLOG_MAX_SPARE;
+    spare_target = (sectors > 1 && count > sectors - 1) ? sectors - 1 : count;
+}
+
+
+
+/** @brief A function which erases one more sector ahead of the segment being written
+ *
+ *  @details Nothing is erased while a run is being recorded. Segments which the new spare
+ *  sector overwrites are dropped from the log first, as they would be when it is used, and a
+ *  sector which reads back as erased already, as spare sectors do after a reset, is not erased
+ *  again.
+ *
+ *  @return True if a sector was made ready, false if none was needed or the erase failed.
+ */
+bool RunLog::prepare(void)
+{
+    if (sectors == 0 || recording || spares >= spare_target)
+    {
+        return false;
+    }
+
+    uint32_t seq = have_head ? head_seq + 1 + spares : spares;
+    uint32_t sector = have_head ? (head_sector + 1 + spares) % sectors : spares;
+    while (have_head && seq - oldest_seq >= sectors)
+    {
+        drop_oldest();
+    }
+    if (!erase_sector(sector, seq, spare_erases[spares]))
+    {
+        return false;
+    }
+    spares++;
+    return true;
+}
+
+
+
+/** @brief A function which starts recording a new run
+ *
+ *  @details A run being recorded is ended first.
+ *
+ *  @param profile The name of the command profile the run follows, which is cut short to
+ *  fit RUNLOG_PROFILE_LEN.
+ *  @param now_ms The time since power-up (ms).
+ *  @param epoch_s The wall-clock time (Unix seconds), or zero if it is not known.
+ *
+ *  @return True if the start of the run was written.
+ */
+bool RunLog::start_run(const char* profile, uint32_t now_ms, uint32_t epoch_s)
+{
+    if (recording)
+    {
+        end_run();
+    }
+
+    RunStartRecord start;
+    memset(&start, 0, sizeof(start));
+    start.id = next_id;
+    start.boot = boot;
+    start.start_ms = now_ms;
+    start.epoch_s = epoch_s;
+    strncpy(start.profile, (profile != NULL) ? profile : "", sizeof(start.profile) - 1);
+    if (!append_record(RECORD_RUN_START, &start, sizeof(start), NULL, 0))
+    {
+        return false;
+    }
+    next_id++;
+
+    RunInfo& run = add_run(start.id);
+    run.boot = start.boot;
+    run.start_ms = start.start_ms;
+    run.epoch_s = start.epoch_s;
+    memcpy(run.profile, start.profile, sizeof(run.profile));
+    run.open = true;
+    recording = true;
+    return true;
+}
+
+
+
+/** @brief A function which adds samples to the run being recorded
+ *
+ *  @details The samples are compressed with TelemetryEncoder, which about halves their size,
+ *  and stored as they are only in the rare case that this does not make them smaller.
+ *
+ *  @param samples The samples.
+ *  @param count The number of samples, at most RUNLOG_RECORD_SAMPLES.
+ *
+ *  @return True if the samples were written, false if no run is open or the write failed.
+ */
+bool RunLog::append(const TelemetrySample* samples, uint16_t count)
+{
+    if (!recording || run_count == 0 || count == 0 || count > RUNLOG_RECORD_SAMPLES)
+    {
+        return false;
+    }
+
+    // starting a segment can drop older runs from the index, which moves the open one down
+    uint32_t id = runs[run_count - 1].id;
+    TelemetryEncoder encoder;
+    memcpy(packed, &id, sizeof(id));
+    encoder.begin(packed + sizeof(id), sizeof(packed) - sizeof(id), 0, count);
+    while (encoder.samples() < count && encoder.add(samples[encoder.samples()]))
+    {
+    }
+    size_t length = (encoder.samples() == count) ? encoder.finish() : 0;
+    bool ok = (length > 0 && length < count * sizeof(TelemetrySample))
+              ? append_record(RECORD_PACKED, packed, sizeof(id) + length, NULL, 0)
+              : append_record(RECORD_SAMPLES, &id, sizeof(id), samples, count * sizeof(TelemetrySample));
+    if (!ok)
+    {
+        return false;
+    }
+    RunInfo& run = runs[run_count - 1];
+    run.samples += count;
+    run.last_seq = head_seq;
+    return true;
+}
+
+
+
+/** @brief A function which ends the run being recorded
+ *
+ *  @return True if the end of the run was written.
+ */
+bool RunLog::end_run(void)
+{
+    if (!recording || run_count == 0)
+    {
+        return false;
+    }
+
+    RunInfo& run = runs[run_count - 1];
+    RunEndRecord end = { run.id, run.samples };
+    run.open = false;
+    recording = false;
+    return append_record(RECORD_RUN_END, &end, sizeof(end), NULL, 0);
+}
+
+
+
+/** @brief A function which gets ready to read the samples of a run
+ *
+ *  @param id The id of the run.
+ *  @param cursor Filled in with the position of the first record of the run.
+ *
+ *  @return True if the run is in the index.
+ */
+bool RunLog::open_run(uint32_t id, RunCursor& cursor)
+{
+    int index = find_run(id);
+    if (index < 0)
+    {
+        return false;
+    }
+    cursor.id = id;
+    cursor.seq = (runs[index].first_seq > oldest_seq) ? runs[index].first_seq : oldest_seq;
+    cursor.offset = sizeof(SegmentHeader);
+    return true;
+}
+
+
+
+/** @brief A function which reads the next batch of samples of a run
+ *
+ *  @details Records of other runs are skipped, and so is the rest of a segment after a
+ *  record which fails its CRC. If the log has wrapped around past the cursor since the last
+ *  call, reading carries on from the oldest segment kept. A run being recorded can be read
+ *  while it grows, as long as the caller keeps this call and the writer apart.
+ *
+ *  @param cursor The position from open_run() or the last call, which is moved along.
+ *  @param out Filled in with the samples; it must hold RUNLOG_RECORD_SAMPLES samples.
+ *
+ *  @return The number of samples read, or zero at the end of the run.
+ */
+uint16_t RunLog::read_run(RunCursor& cursor, TelemetrySample* out)
+{
+    int index = find_run(cursor.id);
+    if (index < 0 || !have_head)
+    {
+        return 0;
+    }
+
+    while (cursor.seq <= runs[index].last_seq && cursor.seq <= head_seq)
+    {
+        if (cursor.seq < oldest_seq)
+        {
+            cursor.seq = oldest_seq;
+            cursor.offset = sizeof(SegmentHeader);
+        }
+
+        uint32_t base = sector_of(cursor.seq) * sector_bytes;
+        uint32_t end = (cursor.seq == head_seq) ? head_offset : sector_bytes;
+        RecordHeader header;
+        if (cursor.offset + sizeof(header) > end || !flash->read(base + cursor.offset, &header, sizeof(header))
+            || header.type == RECORD_ERASED || cursor.offset + sizeof(header) + header.length > end)
+        {
+            cursor.seq++;
+            cursor.offset = sizeof(SegmentHeader);
+            continue;
+        }
+
+        uint32_t payload = base + cursor.offset + sizeof(header);
+        cursor.offset += sizeof(header) + ((header.length + 3) & ~3u);
+
+        uint32_t id = 0;
+        if ((header.type != RECORD_SAMPLES && header.type != RECORD_PACKED) || header.length < sizeof(id)
+            || header.length > RECORD_MAX || !flash->read(payload, packed, header.length))
+        {
+            continue;
+        }
+        memcpy(&id, packed, sizeof(id));
+        if (id != cursor.id)
+        {
+            continue;
+        }
+        if (crc32(crc32(0, &header, 4), packed, header.length) != header.crc)
+        {
+            cursor.seq++;
+            cursor.offset = sizeof(SegmentHeader);
+            continue;
+        }
+
+        uint16_t count = 0;
+        if (header.type == RECORD_SAMPLES)
+        {
+            count = (header.length - sizeof(id)) / sizeof(TelemetrySample);
+            memcpy(out, packed + sizeof(id), count * sizeof(TelemetrySample));
+        }
+        else
+        {
+            TelemetryDecoder decoder;
+            uint32_t seq;
+            decoder.begin(packed + sizeof(id), header.length - sizeof(id));
+            while (count < RUNLOG_RECORD_SAMPLES && decoder.next(out[count], seq))
+            {
+                count++;
+            }
+        }
+        if (count > 0)
+        {
+            return count;
+        }
+    }
+    return 0;
+}
+
+
+
+/** @brief A function which finds the sector holding a segment
+ *
+ *  @details Segments are written to the sectors in turn, so a segment is as many sectors
+ *  behind the newest one as its sequence number is.
+ *
+ *  @param seq The sequence number of a segment kept in the log.
+ *
+ *  @return The index of its sector.
+ */
+uint32_t RunLog::sector_of(uint32_t seq)
+{
+    return (head_sector + sectors - (head_seq - seq) % sectors) % sectors;
+}
+
+
+
+/** @brief A function which starts a segment in the next sector
+ *
+ *  @details The sector is one prepare() erased if there is one. Otherwise it is erased here,
+ *  unless set_spare() was used, in which case the segment is refused. Once every sector is
+ *  in use this overwrites the oldest segment, and the runs which had samples in it lose them.
+ *
+ *  @return True if the new segment was started.
+ */
+bool RunLog::new_segment(void)
+{
+    uint32_t sector = have_head ? (head_sector + 1) % sectors : 0;
+    uint32_t seq = have_head ? head_seq + 1 : 0;
+    uint32_t erases;
+    if (spares > 0)
+    {
+        erases = spare_erases[0];
+        spares--;
+        memmove(&spare_erases[0], &spare_erases[1], spares * sizeof(uint32_t));
+    }
+    else if (spare_target > 0)
+    {
+        refusals++;
+        return false;
+    }
+    else
+    {
+        if (have_head && seq - oldest_seq >= sectors)
+        {
+            drop_oldest();
+        }
+        if (!erase_sector(sector, seq, erases))
+        {
+            return false;
+        }
+    }
+
+    SegmentHeader header;
+    header.magic = SEGMENT_MAGIC;
+    header.seq = seq;
+    header.erases = erases;
+    header.crc = crc32(0, &header, sizeof(header) - sizeof(uint32_t));
+    if (!flash->write(sector * sector_bytes, &header, sizeof(header)))
+    {
+        failures++;
+        return false;
+    }
+
+    if (!have_head)
+    {
+        oldest_seq = seq;
+    }
+    have_head = true;
+    head_seq = seq;
+    head_sector = sector;
+    head_offset = sizeof(header);
+    return true;
+}
+
+
+
+/** @brief A function which erases a sector for a new segment
+ *
+ *  @details The erase count is carried over from the old header, so the wear of each sector
+ *  is known. A sector which is already erased is left as it is.
+ *
+ *  @param sector The sector to erase.
+ *  @param seq The sequence number of the segment which will be written in it.
+ *  @param erases Filled in with the erase count for the new segment header.
+ *
+ *  @return True if the sector is erased.
+ */
+bool RunLog::erase_sector(uint32_t sector, uint32_t seq, uint32_t& erases)
+{
+    SegmentHeader header;
+    bool valid = read_header(flash, sector, header);
+    // a sector whose header was lost to a reset during its erase is counted as the most worn
+    erases = valid ? header.erases + 1 : ((seq < sectors) ? 1 : max_erases);
+    if ((valid || !is_erased(sector)) && !flash->erase(sector))
+    {
+        failures++;
+        return false;
+    }
+    if (erases > max_erases)
+    {
+        max_erases = erases;
+    }
+    return true;
+}
+
+
+
+/** @brief A function which checks whether every byte of a sector is erased
+ *
+ *  @param sector The sector to check.
+ *
+ *  @return True if the sector reads back as all ones.
+ */
+bool RunLog::is_erased(uint32_t sector)
+{
+    uint32_t chunk[16];
+    for (uint32_t at = 0; at < sector_bytes; at += sizeof(chunk))
+    {
+        uint32_t n = (sector_bytes - at < sizeof(chunk)) ? sector_bytes - at : sizeof(chunk);
+        if (!flash->read(sector * sector_bytes + at, chunk, n))
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < n / sizeof(uint32_t); i++)
+        {
+            if (chunk[i] != 0xFFFFFFFF)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+
+/** @brief A function which writes one record at the end of the log
+ *
+ *  @details The payload comes in two parts so samples can be written straight from the
+ *  caller's buffer behind the run id. The payload is written first and the header last, so
+ *  the record only counts once it is complete. After a failed write the segment is closed,
+ *  because the bytes it left cannot be written again.
+ *
+ *  @param type The record type.
+ *  @param head The first part of the payload.
+ *  @param head_len The size of the first part.
+ *  @param body The second part of the payload, or NULL.
+ *  @param body_len The size of the second part.
+ *
+ *  @return True if the record was written.
+ */
+bool RunLog::append_record(uint8_t type, const void* head, uint16_t head_len, const void* body, uint16_t body_len)
+{
+    RecordHeader header;
+    header.type = type;
+    header.reserved = 0;
+    header.length = head_len + body_len;
+    uint32_t padded = (header.length + 3) & ~3u;
+
+    if (sectors == 0)
+    {
+        return false;
+    }
+    if (!have_head || head_offset + sizeof(header) + padded > sector_bytes)
+    {
+        if (!new_segment())
+        {
+            return false;
+        }
+    }
+
+    header.crc = crc32(0, &header, 4);
+    header.crc = crc32(header.crc, head, head_len);
+    header.crc = crc32(header.crc, body, body_len);
+
+    uint32_t addr = head_sector * sector_bytes + head_offset;
+    bool ok = flash->write(addr + sizeof(header), head, head_len);
+    if (ok && body_len > 0)
+    {
+        ok = flash->write(addr + sizeof(header) + head_len, body, body_len);
+    }
+    if (ok)
+    {
+        ok = flash->write(addr, &header, sizeof(header));
+    }
+    if (!ok)
+    {
+        failures++;
+        head_offset = sector_bytes;
+        return false;
+    }
+    head_offset += sizeof(header) + padded;
+    return true;
+}
+
+
+
+/** @brief A function which reads the records of one segment into the index
+ *
+ *  @param seq The sequence number of the segment.
+ *  @param clean Set to false if the segment ends in a record which was cut off, or in bytes
+ *  which are not erased, and to true otherwise.
+ *
+ *  @return The offset after the last good record.
+ */
+uint32_t RunLog::scan_segment(uint32_t seq, bool& clean)
+{
+    uint32_t base = sector_of(seq) * sector_bytes;
+    uint32_t offset = sizeof(SegmentHeader);
+    uint8_t chunk[64];
+    clean = true;
+
+    while (offset + sizeof(RecordHeader) <= sector_bytes)
+    {
+        RecordHeader header;
+        if (!flash->read(base + offset, &header, sizeof(header)))
+        {
+            break;
+        }
+        if (header.type == RECORD_ERASED)
+        {
+            // the rest of the segment must be erased, or a write was cut off here
+            for (uint32_t at = offset; at < sector_bytes && clean; at += sizeof(chunk))
+            {
+                uint32_t n = (sector_bytes - at < sizeof(chunk)) ? sector_bytes - at : sizeof(chunk);
+                flash->read(base + at, chunk, n);
+                for (uint32_t i = 0; i < n; i++)
+                {
+                    clean &= (chunk[i] == 0xFF);
+                }
+            }
+            return offset;
+        }
+        if (offset + sizeof(header) + header.length > sector_bytes)
+        {
+            clean = false;
+            return offset;
+        }
+
+        // check the CRC while keeping the start of the payload, which is all the index needs
+        RunStartRecord start;
+        memset(&start, 0, sizeof(start));
+        uint32_t crc = crc32(0, &header, 4);
+        for (uint32_t done = 0; done < header.length; )
+        {
+            uint32_t n = (header.length - done < sizeof(chunk)) ? header.length - done : sizeof(chunk);
+            flash->read(base + offset + sizeof(header) + done, chunk, n);
+            crc = crc32(crc, chunk, n);
+            if (done < sizeof(start))
+            {
+                memcpy((uint8_t*)&start + done, chunk, (n < sizeof(start) - done) ? n : sizeof(start) - done);
+            }
+            done += n;
+        }
+        if (crc != header.crc)
+        {
+            clean = false;
+            return offset;
+        }
+        offset += sizeof(header) + ((header.length + 3) & ~3u);
+
+        if (header.type == RECORD_RUN_START)
+        {
+            RunInfo& run = add_run(start.id);
+            run.boot = start.boot;
+            run.start_ms = start.start_ms;
+            run.epoch_s = start.epoch_s;
+            memcpy(run.profile, start.profile, sizeof(run.profile));
+            run.profile[sizeof(run.profile) - 1] = '\0';
+            run.first_seq = seq;
+            run.last_seq = seq;
+        }
+        else if (header.type == RECORD_SAMPLES || header.type == RECORD_PACKED)
+        {
+            // samples whose run start has been overwritten still make a run, without its details
+            int index = find_run(start.id);
+            RunInfo& run = (index >= 0) ? runs[index] : add_run(start.id);
+            if (index < 0)
+            {
+                run.first_seq = seq;
+                run.truncated = true;
+            }
+            run.samples += samples_in(header.type, header.length, (const uint8_t*)&start);
+            run.last_seq = seq;
+        }
+        else if (header.type == RECORD_RUN_END)
+        {
+            int index = find_run(start.id);
+            if (index >= 0)
+            {
+                runs[index].open = false;
+            }
+        }
+    }
+    return offset;
+}
+
+
+
+/** @brief A function which finds a run in the index
+ *
+ *  @param id The id of the run.
+ *
+ *  @return The position of the run in the index, or -1 if it is not there.
+ */
+int RunLog::find_run(uint32_t id)
+{
+    for (int i = run_count - 1; i >= 0; i--)
+    {
+        if (runs[i].id == id)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+
+/** @brief A function which adds a run to the end of the index
+ *
+ *  @details If the index is full the oldest run is forgotten, though its samples stay in
+ *  the flash until they are overwritten.
+ *
+ *  @param id The id of the run.
+ *
+ *  @return The new index entry, with only the id and segments filled in.
+ */
+RunInfo& RunLog::add_run(uint32_t id)
+{
+    if (run_count == RUNLOG_MAX_RUNS)
+    {
+        memmove(&runs[0], &runs[1], (RUNLOG_MAX_RUNS - 1) * sizeof(RunInfo));
+        run_count--;
+    }
+
+    RunInfo& run = runs[run_count++];
+    memset(&run, 0, sizeof(run));
+    run.id = id;
+    run.first_seq = have_head ? head_seq : 0;
+    run.last_seq = run.first_seq;
+    run.open = true;
+    if (id >= next_id)
+    {
+        next_id = id + 1;
+    }
+    return run;
+}
+
+
+
+/** @brief A function which drops the oldest segment from the log before it is overwritten
+ *
+ *  @details The record headers of the segment are read so the runs which had samples in it
+ *  can take them off their counts. Runs with no samples left are removed from the index, and
+ *  runs which lose their first segment are marked as truncated.
+ */
+void RunLog::drop_oldest(void)
+{
+    uint32_t base = sector_of(oldest_seq) * sector_bytes;
+    uint32_t end = (oldest_seq == head_seq) ? head_offset : sector_bytes;
+    for (uint32_t offset = sizeof(SegmentHeader); offset + sizeof(RecordHeader) <= end; )
+    {
+        RecordHeader header;
+        uint8_t start[sizeof(uint32_t) + sizeof(TelemetryBlockHeader)];
+        if (!flash->read(base + offset, &header, sizeof(header)) || header.type == RECORD_ERASED
+            || offset + sizeof(header) + header.length > end)
+        {
+            break;
+        }
+        flash->read(base + offset + sizeof(header), start, (header.length < sizeof(start)) ? header.length : sizeof(start));
+        uint32_t count = samples_in(header.type, header.length, start);
+        if (count > 0)
+        {
+            uint32_t id;
+            memcpy(&id, start, sizeof(id));
+            int index = find_run(id);
+            if (index >= 0)
+            {
+                runs[index].samples -= (runs[index].samples < count) ? runs[index].samples : count;
+            }
+        }
+        offset += sizeof(header) + ((header.length + 3) & ~3u);
+    }
+
+    oldest_seq++;
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < run_count; i++)
+    {
+        if (runs[i].last_seq < oldest_seq && !runs[i].open)
+        {
+            continue;
+        }
+        if (runs[i].first_seq < oldest_seq)
+        {
+            runs[i].first_seq = oldest_seq;
+            runs[i].truncated = true;
+        }
+        runs[kept++] = runs[i];
+    }
+    run_count = kept;
+}
@@ -0,0 +1,189 @@
+/** @file RunLog.h
+ *  This file contains the RunLog class, which records test runs of telemetry samples in NOR
+ *  flash so they survive a reset, and keeps an index of the runs it holds. The flash is used
+ *  as a circular log of append-only segments, one per sector, which are written in turn and
+ *  erased only when the log wraps around, so every sector is erased equally often. Sectors
+ *  can be erased ahead of time while no run is being recorded, so a run never waits for an
+ *  erase. Each record carries a CRC, so after a reset the log finds where it stopped, even
+ *  part way through a write, and rebuilds its index from the flash.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _RUNLOG_H_
+#define _RUNLOG_H_
+
+#include <stdint.h>
+#include "FlashDevice.h"
+#include "Telemetry.h"
+
+// Most runs kept in the index; when it is full the oldest run is forgotten
+#define RUNLOG_MAX_RUNS 32
+
+// Longest name of the command profile of a run, including the terminating null
+#define RUNLOG_PROFILE_LEN 24
+
+// Most sectors which can be kept erased ahead of the segment being written
+#define RUNLOG_MAX_SPARE 128
+
+// Most samples in one record, and so the size of the buffer passed to read_run()
+#define RUNLOG_RECORD_SAMPLES 64
+
+/** What the index knows about one test run */
+struct RunInfo
+{
+    uint32_t id;                        // run number, counting up from 1 over the life of the flash
+    uint32_t boot;                      // number of the power-up during which the run was recorded
+    uint32_t start_ms;                  // time since power-up at which the run started (ms)
+    uint32_t epoch_s;                   // wall-clock start time given by the client, or zero (Unix s)
+    char profile[RUNLOG_PROFILE_LEN];   // name of the command profile the run followed
+    uint32_t first_seq;                 // oldest segment still holding samples of the run
+    uint32_t last_seq;                  // newest segment holding samples of the run
+    uint32_t samples;                   // samples of the run still in the log
+    bool open;                          // true while the run is being recorded
+    bool truncated;                     // true if the start of the run has been overwritten
+};
+
+/** A reader's position in a run, filled in by open_run() and moved along by read_run() */
+struct RunCursor
+{
+    uint32_t id;                        // the run being read
+    uint32_t seq;                       // segment holding the next record to look at
+    uint32_t offset;                    // offset of that record in its segment
+};
+
+/** This class stores test runs of telemetry samples in a circular log in flash.
+ *
+ *  @details Each sector starts with a segment header holding its sequence number, which
+ *  counts up as segments are written, and how many times the sector has been erased. The
+ *  records after it are a run start (id, time and profile), a batch of samples from one run,
+ *  compressed by TelemetryEncoder to about half their size, or a run end. A record is
+ *  written payload first and header last, so a reset part way through leaves the header
+ *  erased and the record is ignored; the rest of that segment is then skipped. The class
+ *  has no locking, so the caller must keep writers and readers apart.
+ */
+class RunLog
+{
+    protected:
+
+        FlashDevice* flash;                 // the flash the log is stored in
+        uint32_t sector_bytes;              // size of one sector and segment
+        uint32_t sectors;                   // number of sectors, or zero if the log is not mounted
+        bool have_head;                     // false until a segment has been written
+        uint32_t head_seq;                  // sequence number of the segment being written
+        uint32_t head_sector;               // sector holding that segment
+        uint32_t head_offset;               // offset of the next record in that segment
+        uint32_t oldest_seq;                // sequence number of the oldest segment kept
+        uint32_t boot;                      // number of this power-up
+        uint32_t next_id;                   // id of the next run
+        RunInfo runs[RUNLOG_MAX_RUNS];      // index of the runs, oldest first
+        uint8_t run_count;                  // number of runs in the index
+        bool recording;                     // true if the newest run is open
+        uint32_t max_erases;                // most times any sector has been erased
+        uint32_t failures;                  // flash writes or erases which failed
+        uint32_t spare_target;              // sectors prepare() keeps erased, or zero to erase as needed
+        uint32_t spares;                    // erased sectors waiting after the segment being written
+        uint32_t spare_erases[RUNLOG_MAX_SPARE];    // erase count each of those sectors will carry
+        uint32_t refusals;                  // segments not started for want of an erased sector
+        uint8_t packed[sizeof(uint32_t) + RUNLOG_RECORD_SAMPLES * sizeof(TelemetrySample)];  // payload being compressed or read
+
+        uint32_t sector_of(uint32_t seq);
+        bool new_segment(void);
+        bool erase_sector(uint32_t sector, uint32_t seq, uint32_t& erases);
+        bool is_erased(uint32_t sector);
+        bool append_record(uint8_t type, const void* head, uint16_t head_len, const void* body, uint16_t body_len);
+        uint32_t scan_segment(uint32_t seq, bool& clean);
+        int find_run(uint32_t id);
+        RunInfo& add_run(uint32_t id);
+        void drop_oldest(void);
+
+    public:
+
+        /** Non-inline functions are commented in RunLog.cpp */
+        RunLog(FlashDevice* flash_);
+
+        bool mount(void);
+        void set_spare(uint32_t count);
+        bool prepare(void);
+        bool start_run(const char* profile, uint32_t now_ms, uint32_t epoch_s);
+        bool append(const TelemetrySample* samples, uint16_t count);
+        bool end_run(void);
+        bool open_run(uint32_t id, RunCursor& cursor);
+        uint16_t read_run(RunCursor& cursor, TelemetrySample* out);
+
+
+
+        /** @brief A function which returns the number of runs in the index
+         *
+         *  @return The number of runs, which can be read with run() from 0 (the oldest).
+         */
+        uint8_t runs_kept(void)
+        {
+            return run_count;
+        }
+
+
+
+        /** @brief A function which returns what the index knows about one run
+         *
+         *  @param index The position of the run in the index, from 0 (the oldest).
+         *
+         *  @return The index entry of the run.
+         */
+        const RunInfo& run(uint8_t index)
+        {
+            return runs[index];
+        }
+
+
+
+        /** @brief A function which reports whether a run is being recorded */
+        bool is_recording(void)
+        {
+            return recording;
+        }
+
+
+
+        /** @brief A function which returns how many segments hold data */
+        uint32_t segments_used(void)
+        {
+            return have_head ? head_seq - oldest_seq + 1 : 0;
+        }
+
+
+
+        /** @brief A function which returns the most times any sector has been erased */
+        uint32_t wear(void)
+        {
+            return max_erases;
+        }
+
+
+
+        /** @brief A function which returns how many flash writes or erases have failed */
+        uint32_t write_failures(void)
+        {
+            return failures;
+        }
+
+
+
+        /** @brief A function which returns how many sectors are erased and waiting to be used */
+        uint32_t spare_sectors(void)
+        {
+            return spares;
+        }
+
+
+
+        /** @brief A function which returns how many times a segment could not be started
+         *  because set_spare() was used and no erased sector was left
+         */
+        uint32_t spare_refusals(void)
+        {
+            return refusals;
+        }
+};
+
+#endif
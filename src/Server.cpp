@@ -12,13 +12,27 @@
 #include "taskshare.h"
 #include "taskqueue.h"
 #include "WebServer.h"
+#include "CtrlTasks.h"
+#include "LatencyHistogram.h"
+#include "WebPage.h"
+#include "Telemetry.h"
+#include "TelemetryLog.h"
+#include "Recorder.h"
+#include "TelemetryCodec.h"
+#include "ProfileTask.h"
+#include "esp_heap_caps.h"
 
 /** Extern declarations for the shares defined in main.cpp */
-extern Queue<float> torque_cmd;
-extern Queue<float> speed_cmd;
+extern Mailbox<float> torque_cmd;
+extern Mailbox<rpm_t> speed_cmd;
+extern Mailbox<PidGains> pid_gains;
 
 /** Extern declarations for the objects created in main.cpp */
 extern Driver Peripheral;
+extern SpscRing<TelemetrySample, TELEMETRY_RING_SIZE> telemetry_ring;
+extern SpscRing<TelemetrySample, TELEMETRY_EVENT_RING_SIZE> telemetry_events;
+extern SpscRing<TelemetrySample, RECORD_RING_SIZE> record_ring;
+extern Mailbox<RecorderCommand> recorder_cmd;
 
 // Credentials and network parameters for ESP32
 const char* ssid = "project_name";   // SSID, network name seen on LAN lists
@@ -37,6 +51,70 @@ IPAddress subnet (255, 255, 255, 0); // Network mask; just leave this as is
 */
 WebServer server (80);
 
+// Shortest time between web server reports over serial (ms)
+#define WEB_REPORT_MS 10000
+
+LatencyHistogram page_time;     // time taken to answer requests for the page
+LatencyHistogram cmd_time;      // time taken to carry out requests to /cmd
+uint32_t page_bytes = 0;        // page bytes sent since the last report
+uint32_t page_304s = 0;         // page requests answered with 304 Not Modified since the last report
+
+// Most clients which can stream telemetry at the same time
+#define SSE_CLIENTS 2
+
+// Size of the text of one telemetry message; a batch which does not fit is split into several messages
+#define SSE_EVENT_SIZE 1400
+
+/** A client connected to the telemetry stream, with its own sample rate */
+struct SseClient
+{
+    WiFiClient client;          // connection kept open after the request has been handled
+    TelemetryEvent event;       // formats messages at the rate this client asked for
+};
+
+SseClient sse_clients[SSE_CLIENTS];             // clients streaming telemetry
+char sse_text[SSE_EVENT_SIZE];                  // text of the message being sent, shared by the clients
+LatencyHistogram sse_time;      // time taken to send one batch to every client
+uint32_t sse_seq = 0;           // sequence number of the next sample to stream
+uint32_t sse_samples = 0;       // samples taken from the rings since the last report
+uint32_t sse_events = 0;        // messages sent since the last report
+uint32_t sse_bytes = 0;         // bytes sent since the last report
+
+// Number of samples kept for the /telemetry and /log.csv endpoints; must be a power of two. 
+// At 24 bytes each this is 96 kB, about 100 s of samples at the rate readActual measures at full speed
+#define TELEMETRY_LOG_SIZE 4096
+
+// Fewest samples the log is allowed to shrink to when the heap cannot hold TELEMETRY_LOG_SIZE
+#define TELEMETRY_LOG_MIN 256
+
+// Most samples sent in one /telemetry frame, so one request cannot hold up the server for long
+#define TELEMETRY_FRAME_MAX 1024
+
+// The latest samples taken from telemetry_ring, which only this task writes and reads; its 
+// storage is taken from the heap by allocate_telemetry_log() rather than kept in .bss
+TelemetryLog telemetry_log;
+LatencyHistogram frame_time;    // time taken to answer requests to /telemetry
+uint32_t frame_bytes = 0;       // bytes of telemetry frames sent since the last report
+
+// Size of the text of one chunk of /log.csv, which holds about a dozen rows
+#define CSV_CHUNK_SIZE 1024
+
+char csv_text[CSV_CHUNK_SIZE];  // rows of /log.csv being formatted
+LatencyHistogram csv_time;      // time taken to answer requests to /log.csv
+uint32_t csv_rows = 0;          // rows of /log.csv sent since the last report
+
+uint8_t block_buf[TELEMETRY_BLOCK_SIZE(TELEMETRY_BLOCK_SAMPLES)];  // compressed block being sent
+LatencyHistogram packed_time;   // time taken to answer requests to /log.tlz
+uint32_t packed_samples = 0;    // samples compressed since the last report
+uint32_t packed_bytes = 0;      // bytes of compressed blocks sent since the last report
+uint32_t packed_cycles = 0;     // CPU cycles spent compressing since the last report
+
+// Longest command profile which can be uploaded, in characters
+#define PROFILE_TEXT_MAX 4096
+
+RunInfo run_list[RUNLOG_MAX_RUNS];                  // copy of the index of recorded runs for /runs
+TelemetrySample run_samples[RUNLOG_RECORD_SAMPLES]; // samples of a recorded run being sent by /runs/get
+
 
 
 /** @brief   Get the WiFi running so we can serve some web pages. esp32 acts as a hotspot
@@ -477,11 +555,48 @@ void HTML_header (String& a_string, const char* page_title)
 // }
 
 
+/** @brief   Callback function that responds to HTTP requests without a subpage
+ *  name.
+ * 
+ *  @details The page, with forms to command speed and torque, live gain tuning and a live 
+ *  readout of the commanded and actual speed, is built ahead of time from web/index.html by 
+ *  tools/embed_page.py and sent gzip compressed straight from flash, so no String is built. 
+ *  A browser which already has this version of the page sends its ETag back and gets an empty 
+ *  304 reply. The time taken and bytes sent are added to the statistics printed by 
+ *  task_webserver.
+ */
 void handle_DocumentRoot ()
 {
-    Serial << "HTTP request from client #" << server.client () << endl;
+    uint32_t start = micros();
+
+    if (server.header("If-None-Match") == WEB_PAGE_ETAG)
+    {
+        server.sendHeader("ETag", WEB_PAGE_ETAG);
+        server.send(304);
+        page_time.add(micros() - start);
+        page_304s++;
+        return;
+    }
+
+    server.sendHeader("Content-Encoding", "gzip");
+    server.sendHeader("Cache-Control", "no-cache");
+    server.sendHeader("ETag", WEB_PAGE_ETAG);
+    server.send_P(200, "text/html", (const char*)WEB_PAGE_GZ, WEB_PAGE_GZ_LEN);
+    page_time.add(micros() - start);
+    page_bytes += WEB_PAGE_GZ_LEN;
+}
+
+
+
+/** @brief   HTTP handler which carries out commands from the web page forms.
+ *  @details The forms submit to the @c /cmd endpoint in the background, so a command only 
+ *  posts to the mailboxes or the driver I/O queue and replies with a short text, instead of 
+ *  sending the whole page back. Any number of commands can be given in one request.
+ */
+void handle_Command (void)
+{
+    uint32_t start = micros();
 
-    // --- Handle incoming GET parameters on the server side ---
 
     // Torque command (in N·m, goes to outer loop)
     if (server.hasArg("torque"))
@@ -489,8 +604,9 @@ void handle_DocumentRoot ()
         String torque_str = server.arg("torque");
         float torque_web = torque_str.toFloat();
 
-        // Outer-loop command: torque -> Controller -> speed_cmd
-        torque_cmd.put(torque_web);
+        // Outer-loop command: torque -> Controller -> speed_cmd; a command by hand stops any profile
+        profile_stop();
+        post_torque_cmd(torque_web);
     }
 
     // Direct speed command (RPM, bypass torque loop)
@@ -499,8 +615,9 @@ void handle_DocumentRoot ()
         String speed_cmd_str = server.arg("speed_cmd");
         float speed_cmd_rpm = speed_cmd_str.toFloat();
 
-        // Inner-loop command: direct speed command in RPM
-        speed_cmd.put(speed_cmd_rpm);
+        // Inner-loop command: direct speed command in RPM; a command by hand stops any profile
+        profile_stop();
+        post_speed_cmd(rpm_from_float(speed_cmd_rpm));
     }
 
     // Write FILK1 gain to the DRV8308
@@ -508,7 +625,7 @@ void handle_DocumentRoot ()
     {
         String filk1_str = server.arg("FILK1");
         uint16_t filk1_val = filk1_str.toInt();
-        Peripheral.drv_write(0x06, filk1_val);
+        Peripheral.request_write(0x06, filk1_val);
     }
 
     // Write FILK2 gain to the DRV8308
@@ -516,7 +633,7 @@ void handle_DocumentRoot ()
     {
         String filk2_str = server.arg("FILK2");
         uint16_t filk2_val = filk2_str.toInt();
-        Peripheral.drv_write(0x07, filk2_val);
+        Peripheral.request_write(0x07, filk2_val);
     }
 
     // Write COMPK1 gain to the DRV8308
@@ -524,7 +641,7 @@ void handle_DocumentRoot ()
     {
         String compk1_str = server.arg("COMPK1");
         uint16_t compk1_val = compk1_str.toInt();
-        Peripheral.drv_write(0x08, compk1_val);
+        Peripheral.request_write(0x08, compk1_val);
     }
 
     // Write COMPK2 gain to the DRV8308
@@ -532,7 +649,7 @@ void handle_DocumentRoot ()
     {
         String compk2_str = server.arg("COMPK2");
         uint16_t compk2_val = compk2_str.toInt();
-        Peripheral.drv_write(0x09, compk2_val);
+        Peripheral.request_write(0x09, compk2_val);
     }
 
     // Write SPDGAIN to the DRV8308
@@ -540,7 +657,7 @@ void handle_DocumentRoot ()
     {
         String spdgain_str = server.arg("SPDGAIN");
         uint16_t spdgain_val = spdgain_str.toInt();
-        Peripheral.drv_write(0x05, spdgain_val);
+        Peripheral.request_write(0x05, spdgain_val);
     }
 
     // Write LOOPGAIN to the DRV8308
@@ -548,7 +665,7 @@ void handle_DocumentRoot ()
     {
         String loopgain_str = server.arg("LOOPGAIN");
         uint16_t loopgain_val = loopgain_str.toInt();
-        Peripheral.drv_write(0x0A, loopgain_val);
+        Peripheral.request_write(0x0A, loopgain_val);
     }
 
     // Write SPEED to the DRV8308
@@ -556,346 +673,45 @@ void handle_DocumentRoot ()
     {
         String speed_str = server.arg("SPEED");
         uint16_t speed_val = speed_str.toInt();
-        Peripheral.drv_write(0x0B, speed_val);
-    }
-
-    // --- Build HTML page ---
-    String a_str;
-    HTML_header(a_str, "Motor Control");
-
-    // ============== The following layout was built by ChatGPT 5.1 ==============
-
-    // Simple layout + typography to fit on one screen
-    a_str += "<style>\n";
-    a_str += "  body { margin: 8px; font-family: Arial, sans-serif; font-size: 13px; }\n";
-    a_str += "  #layout { display: flex; flex-direction: row; align-items: flex-start; gap: 12px; }\n";
-    a_str += "  #leftPanel { flex: 0 0 280px; max-width: 320px; }\n";
-    a_str += "  #rightPanel { flex: 1 1 auto; }\n";
-    a_str += "  h1 { font-size: 18px; margin: 4px 0 8px 0; }\n";
-    a_str += "  h2 { font-size: 14px; margin: 8px 0 4px 0; }\n";
-    a_str += "  h3 { font-size: 13px; margin: 4px 0; }\n";
-    a_str += "  form { margin: 4px 0 6px 0; padding: 4px; border: 1px solid #ddd; border-radius: 4px; }\n";
-    a_str += "  form p { margin: 2px 0 4px 0; font-size: 12px; }\n";
-    a_str += "  input[type=\"number\"] { width: 100%; box-sizing: border-box; font-size: 12px; }\n";
-    a_str += "  input[type=\"submit\"] { margin-top: 4px; font-size: 12px; padding: 2px 6px; }\n";
-    a_str += "  p.status { margin: 0 0 2px 0; font-size: 11px; min-height: 1em; }\n";
-    a_str += "</style>\n";
-
-    a_str += "<body>\n";
-    a_str += "<div id=\"layout\">\n";
-
-    // ===== LEFT PANEL: forms =====
-    a_str += "<div id=\"leftPanel\">\n";
-
-    a_str += "<h1>Motor Control Interface</h1>\n";
-
-    // ----- Torque command form -----
-    a_str += "<h2>Torque Command</h2>\n";
-    a_str += "<form id=\"torqueForm\" action=\"/\" method=\"GET\">\n";
-    a_str += "  <p>Enter torque command (N·m):</p>\n";
-    a_str += "  <input type=\"number\" step=\"0.001\" name=\"torque\" required>\n";
-    a_str += "  <input type=\"submit\" value=\"Send\">\n";
-    a_str += "</form>\n";
-    a_str += "<p id=\"status_torque\" class=\"status\"></p>\n";
-
-    // ----- Speed command form -----
-    a_str += "<h2>Speed Command</h2>\n";
-    a_str += "<form id=\"speedCmdForm\" action=\"/\" method=\"GET\">\n";
-    a_str += "  <p>Enter speed command (RPM):</p>\n";
-    a_str += "  <input type=\"number\" step=\"1\" name=\"speed_cmd\" required>\n";
-    a_str += "  <input type=\"submit\" value=\"Send\">\n";
-    a_str += "</form>\n";
-    a_str += "<p id=\"status_speed_cmd\" class=\"status\"></p>\n";
-
-    // ----- Gain forms -----
-    a_str += "<h2>Gain Settings</h2>\n";
-
-    // FILK1
-    a_str += "<p id=\"status_FILK1\" class=\"status\"></p>\n";
-    a_str += "<form id=\"FILK1Form\" action=\"/\" method=\"GET\">\n";
-    a_str += "  <p>FILK1 gain (0 to 4095):</p>\n";
-    a_str += "  <input type=\"number\" step=\"1\" min=\"0\" max=\"4095\" name=\"FILK1\" required>\n";
-    a_str += "  <input type=\"submit\" value=\"Set FILK1\">\n";
-    a_str += "</form>\n";
-
-    // FILK2
-    a_str += "<p id=\"status_FILK2\" class=\"status\"></p>\n";
-    a_str += "<form id=\"FILK2Form\" action=\"/\" method=\"GET\">\n";
-    a_str += "  <p>FILK2 gain (0 to 4095):</p>\n";
-    a_str += "  <input type=\"number\" step=\"1\" min=\"0\" max=\"4095\" name=\"FILK2\" required>\n";
-    a_str += "  <input type=\"submit\" value=\"Set FILK2\">\n";
-    a_str += "</form>\n";
-
-    // COMPK1
-    a_str += "<p id=\"status_COMPK1\" class=\"status\"></p>\n";
-    a_str += "<form id=\"COMPK1Form\" action=\"/\" method=\"GET\">\n";
-    a_str += "  <p>COMPK1 gain (0 to 4095):</p>\n";
-    a_str += "  <input type=\"number\" step=\"1\" min=\"0\" max=\"4095\" name=\"COMPK1\" required>\n";
-    a_str += "  <input type=\"submit\" value=\"Set COMPK1\">\n";
-    a_str += "</form>\n";
-
-    // COMPK2
-    a_str += "<p id=\"status_COMPK2\" class=\"status\"></p>\n";
-    a_str += "<form id=\"COMPK2Form\" action=\"/\" method=\"GET\">\n";
-    a_str += "  <p>COMPK2 gain (0 to 4095):</p>\n";
-    a_str += "  <input type=\"number\" step=\"1\" min=\"0\" max=\"4095\" name=\"COMPK2\" required>\n";
-    a_str += "  <input type=\"submit\" value=\"Set COMPK2\">\n";
-    a_str += "</form>\n";
-
-    // SPDGAIN
-    a_str += "<p id=\"status_SPDGAIN\" class=\"status\"></p>\n";
-    a_str += "<form id=\"SPDGAINForm\" action=\"/\" method=\"GET\">\n";
-    a_str += "  <p>SPDGAIN (0 to 4095):</p>\n";
-    a_str += "  <input type=\"number\" step=\"1\" min=\"0\" max=\"4095\" name=\"SPDGAIN\" required>\n";
-    a_str += "  <input type=\"submit\" value=\"Set SPDGAIN\">\n";
-    a_str += "</form>\n";
-
-    // LOOPGAIN
-    a_str += "<p id=\"status_LOOPGAIN\" class=\"status\"></p>\n";
-    a_str += "<form id=\"LOOPGAINForm\" action=\"/\" method=\"GET\">\n";
-    a_str += "  <p>LOOPGAIN (0 to 1023):</p>\n";
-    a_str += "  <input type=\"number\" step=\"1\" min=\"0\" max=\"1023\" name=\"LOOPGAIN\" required>\n";
-    a_str += "  <input type=\"submit\" value=\"Set LOOPGAIN\">\n";
-    a_str += "</form>\n";
-
-    // SPEED reference
-    a_str += "<p id=\"status_SPEED\" class=\"status\"></p>\n";
-    a_str += "<form id=\"SPEEDForm\" action=\"/\" method=\"GET\">\n";
-    a_str += "  <p>SPEED reference (0 to 4095):</p>\n";
-    a_str += "  <input type=\"number\" step=\"1\" min=\"0\" max=\"4095\" name=\"SPEED\" required>\n";
-    a_str += "  <input type=\"submit\" value=\"Set SPEED Ref\">\n";
-    a_str += "</form>\n";
-
-    a_str += "</div>\n"; // end leftPanel
-
-    // ===== RIGHT PANEL: plot =====
-    a_str += "<div id=\"rightPanel\">\n";
-    a_str += "<h2>Actual Speed vs Time</h2>\n";
-    a_str += "<h3>Live RPM Plot</h3>\n";
-    a_str += "<canvas id=\"speedCanvas\" width=\"600\" height=\"350\" ";
-    a_str += "style=\"border:1px solid #000000;\"></canvas>\n";
-    a_str += "<br/>\n";
-    a_str += "<button id=\"downloadBtn\" type=\"button\" onclick=\"downloadCSV()\">Download CSV</button>\n";
-    a_str += "</div>\n"; // end rightPanel
-    a_str += "</div>\n"; // end layout
-
-    // ----- JavaScript: forms + plot -----
-    a_str += "<script>\n";
-
-    // Data arrays
-    a_str += "let data = [];\n";        // actual RPM
-    a_str += "let timeData = [];\n";    // time stamps
-    a_str += "let cmdData = [];\n";     // commanded RPM history
-    a_str += "let currentCmd = NaN;\n"; // latest commanded RPM
-    // a_str += "let maxPoints = 200;\n";
-    a_str += "let startTime = Date.now();\n";
-    a_str += "const canvas = document.getElementById('speedCanvas');\n";
-    a_str += "const ctx = canvas.getContext('2d');\n";
-
-    // Helper: attach AJAX behavior so forms don't refresh the page
-    a_str += "function attachAjaxForm(formId, paramName, statusId, label, updateCmd){\n";
-    a_str += "  const form = document.getElementById(formId);\n";
-    a_str += "  if (!form) return;\n";
-    a_str += "  form.addEventListener('submit', function(e){\n";
-    a_str += "    e.preventDefault();\n";
-    a_str += "    const formData = new FormData(form);\n";
-    a_str += "    const val = formData.get(paramName);\n";
-    a_str += "    if (val === null || val === '') return;\n";
-    a_str += "    if (updateCmd) {\n";
-    a_str += "      const num = parseFloat(val);\n";
-    a_str += "      if (!isNaN(num)) currentCmd = num;\n";
-    a_str += "    }\n";
-    a_str += "    const url = '/?' + encodeURIComponent(paramName) + '=' + encodeURIComponent(val);\n";
-    a_str += "    fetch(url)\n";
-    a_str += "      .then(r => r.text())\n";
-    a_str += "      .then(function(txt){\n";
-    a_str += "        const st = document.getElementById(statusId);\n";
-    a_str += "        if (st) st.innerHTML = '<b>' + label + val + '</b>';\n";
-    a_str += "      })\n";
-    a_str += "      .catch(function(err){ console.log(err); });\n";
-    a_str += "  });\n";
-    a_str += "}\n";
-
-    // Attach handlers for all forms (no page reload)
-    a_str += "attachAjaxForm('torqueForm',    'torque',    'status_torque',    'Last torque command sent: ', false);\n";
-    a_str += "attachAjaxForm('speedCmdForm',  'speed_cmd', 'status_speed_cmd', 'Last speed command sent: ', true);\n";
-    a_str += "attachAjaxForm('FILK1Form',     'FILK1',     'status_FILK1',     'Last FILK1 gain value: ', false);\n";
-    a_str += "attachAjaxForm('FILK2Form',     'FILK2',     'status_FILK2',     'Last FILK2 gain value: ', false);\n";
-    a_str += "attachAjaxForm('COMPK1Form',    'COMPK1',    'status_COMPK1',    'Last COMPK1 gain value: ', false);\n";
-    a_str += "attachAjaxForm('COMPK2Form',    'COMPK2',    'status_COMPK2',    'Last COMPK2 gain value: ', false);\n";
-    a_str += "attachAjaxForm('SPDGAINForm',   'SPDGAIN',   'status_SPDGAIN',   'Last SPDGAIN value: ', false);\n";
-    a_str += "attachAjaxForm('LOOPGAINForm',  'LOOPGAIN',  'status_LOOPGAIN',  'Last LOOPGAIN value: ', false);\n";
-    a_str += "attachAjaxForm('SPEEDForm',     'SPEED',     'status_SPEED',     'Last SPEED reference value: ', false);\n";
-
-    // Fetch latest RPM from /speed
-    a_str += "function fetchSpeed(){\n";
-    a_str += "  fetch('/speed').then(r => r.text()).then(txt => {\n";
-    a_str += "    let rpm = parseFloat(txt);\n";
-    a_str += "    let t = (Date.now() - startTime)/1000.0; // seconds\n";
-    a_str += "    if(!isNaN(rpm)){\n";
-    a_str += "      data.push(rpm);\n";
-    a_str += "      timeData.push(t);\n";
-    a_str += "      cmdData.push(currentCmd);\n";
-    // a_str += "      if(data.length > maxPoints){\n";
-    // a_str += "        data.shift();\n";
-    // a_str += "        timeData.shift();\n";
-    // a_str += "        cmdData.shift();\n";
-    // a_str += "      }\n";
-    a_str += "      drawPlot();\n";
-    a_str += "    }\n";
-    a_str += "  }).catch(e => { console.log(e); });\n";
-    a_str += "}\n";
-
-    // Draw the plot on the canvas
-    a_str += "function drawPlot(){\n";
-    a_str += "  ctx.clearRect(0,0,canvas.width,canvas.height);\n";
-    a_str += "  if(data.length < 2) return;\n";
-
-    // Determine bounds (include both actual and commanded where defined)
-    a_str += "  let tmin = timeData[0];\n";
-    a_str += "  let tmax = timeData[timeData.length-1];\n";
-    a_str += "  let ymin = Math.min.apply(null, data);\n";
-    a_str += "  let ymax = Math.max.apply(null, data);\n";
-    a_str += "  let hasCmd = false;\n";
-    a_str += "  for (let i = 0; i < cmdData.length; i++) {\n";
-    a_str += "    let v = cmdData[i];\n";
-    a_str += "    if (!isNaN(v)) {\n";
-    a_str += "      if (!hasCmd) {\n";
-    a_str += "        ymin = Math.min(ymin, v);\n";
-    a_str += "        ymax = Math.max(ymax, v);\n";
-    a_str += "        hasCmd = true;\n";
-    a_str += "      } else {\n";
-    a_str += "        if (v < ymin) ymin = v;\n";
-    a_str += "        if (v > ymax) ymax = v;\n";
-    a_str += "      }\n";
-    a_str += "    }\n";
-    a_str += "  }\n";
-    a_str += "  if(ymax === ymin){ ymin -= 10; ymax += 10; }\n";
-
-    // Simple padding
-    a_str += "  let leftPad = 50, rightPad = 10, topPad = 10, bottomPad = 40;\n";
-
-    // Axes
-    a_str += "  ctx.beginPath();\n";
-    a_str += "  ctx.moveTo(leftPad, topPad);\n";
-    a_str += "  ctx.lineTo(leftPad, canvas.height-bottomPad);\n";
-    a_str += "  ctx.lineTo(canvas.width-rightPad, canvas.height-bottomPad);\n";
-    a_str += "  ctx.strokeStyle = '#000000';\n";
-    a_str += "  ctx.stroke();\n";
-
-    // Draw grid and Y-axis numeric labels (RPM)
-    a_str += "  ctx.font = '12px Helvetica';\n";
-    a_str += "  ctx.textAlign = 'right';\n";
-    a_str += "  ctx.textBaseline = 'middle';\n";
-    a_str += "  let yTicks = 5;\n";
-    a_str += "  for (let i = 0; i <= yTicks; i++) {\n";
-    a_str += "    let val = ymin + (i * (ymax - ymin) / yTicks);\n";
-    a_str += "    let y = canvas.height - bottomPad - (val - ymin) / (ymax - ymin) * (canvas.height - topPad - bottomPad);\n";
-    a_str += "    ctx.beginPath();\n";
-    a_str += "    ctx.moveTo(leftPad - 5, y);\n";
-    a_str += "    ctx.lineTo(canvas.width - rightPad, y);\n";
-    a_str += "    ctx.strokeStyle = '#cccccc';\n";
-    a_str += "    ctx.stroke();\n";
-    a_str += "    ctx.fillStyle = '#000000';\n";
-    a_str += "    ctx.fillText(val.toFixed(0), leftPad - 8, y);\n";
-    a_str += "  }\n";
-
-    // Draw X-axis numeric labels (time in seconds)
-    a_str += "  ctx.textAlign = 'center';\n";
-    a_str += "  ctx.textBaseline = 'top';\n";
-    a_str += "  let xTicks = 5;\n";
-    a_str += "  for (let i = 0; i <= xTicks; i++) {\n";
-    a_str += "    let tVal = tmin + (i * (tmax - tmin) / xTicks);\n";
-    a_str += "    let x = leftPad + (tVal - tmin) / (tmax - tmin) * (canvas.width - leftPad - rightPad);\n";
-    a_str += "    ctx.beginPath();\n";
-    a_str += "    ctx.moveTo(x, canvas.height - bottomPad);\n";
-    a_str += "    ctx.lineTo(x, canvas.height - bottomPad + 5);\n";
-    a_str += "    ctx.strokeStyle = '#000000';\n";
-    a_str += "    ctx.stroke();\n";
-    a_str += "    ctx.fillText(tVal.toFixed(1), x, canvas.height - bottomPad + 8);\n";
-    a_str += "  }\n";
-
-    // Plot actual speed line (black)
-    a_str += "  ctx.beginPath();\n";
-    a_str += "  ctx.strokeStyle = '#000000';\n";
-    a_str += "  for(let i=0;i<data.length;i++){\n";
-    a_str += "    let x = leftPad + (timeData[i]-tmin)/(tmax-tmin) * (canvas.width-leftPad-rightPad);\n";
-    a_str += "    let y = canvas.height-bottomPad - (data[i]-ymin)/(ymax-ymin) * (canvas.height-topPad-bottomPad);\n";
-    a_str += "    if(i===0) ctx.moveTo(x,y); else ctx.lineTo(x,y);\n";
-    a_str += "  }\n";
-    a_str += "  ctx.stroke();\n";
-
-    // Plot commanded speed line (red), skipping NaNs
-    a_str += "  ctx.beginPath();\n";
-    a_str += "  ctx.strokeStyle = '#ff0000';\n";
-    a_str += "  let firstCmd = true;\n";
-    a_str += "  for (let i=0; i<cmdData.length; i++) {\n";
-    a_str += "    let c = cmdData[i];\n";
-    a_str += "    if (isNaN(c)) continue;\n";
-    a_str += "    let x = leftPad + (timeData[i]-tmin)/(tmax-tmin) * (canvas.width-leftPad-rightPad);\n";
-    a_str += "    let y = canvas.height-bottomPad - (c-ymin)/(ymax-ymin) * (canvas.height-topPad-bottomPad);\n";
-    a_str += "    if (firstCmd) { ctx.moveTo(x,y); firstCmd = false; } else { ctx.lineTo(x,y); }\n";
-    a_str += "  }\n";
-    a_str += "  if (!firstCmd) ctx.stroke();\n";
-
-    // Labels + legend
-    a_str += "  ctx.font = '14px Helvetica';\n";
-    a_str += "  ctx.fillStyle = '#000000';\n";
-    a_str += "  ctx.textAlign = 'center';\n";
-    a_str += "  ctx.textBaseline = 'alphabetic';\n";
-    a_str += "  ctx.fillText('Time (s)', canvas.width/2, canvas.height-5);\n";
-    a_str += "  ctx.save();\n";
-    a_str += "  ctx.translate(15, canvas.height/2);\n";
-    a_str += "  ctx.rotate(-Math.PI/2);\n";
-    a_str += "  ctx.fillText('Speed (RPM)', 0, 0);\n";
-    a_str += "  ctx.restore();\n";
-
-    // Simple legend in top-right
-    a_str += "  let legendX = canvas.width - 10 - 100;\n";
-    a_str += "  let legendY = 10 + 10;\n";
-    a_str += "  ctx.textAlign = 'left';\n";
-    a_str += "  ctx.textBaseline = 'middle';\n";
-    a_str += "  // actual\n";
-    a_str += "  ctx.strokeStyle = '#000000';\n";
-    a_str += "  ctx.beginPath(); ctx.moveTo(legendX, legendY); ctx.lineTo(legendX+20, legendY); ctx.stroke();\n";
-    a_str += "  ctx.fillStyle = '#000000'; ctx.fillText('Actual', legendX+25, legendY);\n";
-    a_str += "  // commanded\n";
-    a_str += "  ctx.strokeStyle = '#ff0000';\n";
-    a_str += "  ctx.beginPath(); ctx.moveTo(legendX, legendY+15); ctx.lineTo(legendX+20, legendY+15); ctx.stroke();\n";
-    a_str += "  ctx.fillStyle = '#000000'; ctx.fillText('Command', legendX+25, legendY+15);\n";
-
-    a_str += "}\n";
-
-    // ----- CSV download helper -----
-    a_str += "function downloadCSV(){\n";
-    a_str += "  if (data.length === 0) { return; }\n";
-    a_str += "  let csv = 'time_s,actual_rpm,command_rpm\\n';\n";
-    a_str += "  for (let i = 0; i < data.length; i++) {\n";
-    a_str += "    let t = timeData[i].toFixed(3);\n";
-    a_str += "    let vAct = data[i].toFixed(3);\n";
-    a_str += "    let vCmd = cmdData[i];\n";
-    a_str += "    let vCmdStr = isNaN(vCmd) ? '' : vCmd.toFixed(3);\n";
-    a_str += "    csv += t + ',' + vAct + ',' + vCmdStr + '\\n';\n";
-    a_str += "  }\n";
-    a_str += "  let blob = new Blob([csv], {type: 'text/csv'});\n";
-    a_str += "  let url = URL.createObjectURL(blob);\n";
-    a_str += "  let a = document.createElement('a');\n";
-    a_str += "  a.href = url;\n";
-    a_str += "  a.download = 'speed_log.csv';\n";
-    a_str += "  document.body.appendChild(a);\n";
-    a_str += "  a.click();\n";
-    a_str += "  document.body.removeChild(a);\n";
-    a_str += "  URL.revokeObjectURL(url);\n";
-    a_str += "}\n";
-
-    // Poll every 200 ms
-    a_str += "setInterval(fetchSpeed, 200);\n";
-
-    a_str += "</script>\n";
-
-    a_str += "</body>\n</html>\n";
-
-    server.send (200, "text/html", a_str);
+        Peripheral.request_write(0x0B, speed_val);
+    }
+
+    // Change the gains of the outer PID speed loop; the others keep their latest values
+    if (server.hasArg("pid_kp") || server.hasArg("pid_ki") || server.hasArg("pid_kd"))
+    {
+        Mail<PidGains> latest;
+        PidGains gains = pid_gains.peek(latest) ? latest.value : PidGains { 0.0f, 0.0f, 0.0f, 1.0f };
+        if (server.hasArg("pid_kp")) gains.kp = server.arg("pid_kp").toFloat();
+        if (server.hasArg("pid_ki")) gains.ki = server.arg("pid_ki").toFloat();
+        if (server.hasArg("pid_kd")) gains.kd = server.arg("pid_kd").toFloat();
+        pid_gains.post(gains, esp_timer_get_time());
+    }
+
+    server.send(200, "text/plain", "OK");
+    cmd_time.add(micros() - start);
+}
+
+
+
+/** @brief   HTTP handler which reports the settings shown in the web page forms.
+ *  @details The page is the same for every request, so it fetches the current gains from the 
+ *  @c /settings endpoint when it loads and fills in the forms. The DRV8308 gains come from the 
+ *  register shadow, so no SPI transfer is needed, and the reply is formatted into a fixed buffer.
+ */
+void handle_Settings (void)
+{
+    Mail<PidGains> pid;
+    PidGains gains = pid_gains.peek(pid) ? pid.value : PidGains { 0.0f, 0.0f, 0.0f, 1.0f };
+
+    char json[256];
+    snprintf(json, sizeof(json), 
+             "{\"FILK1\":%u,\"FILK2\":%u,\"COMPK1\":%u,\"COMPK2\":%u,\"SPDGAIN\":%u,"
+             "\"LOOPGAIN\":%u,\"SPEED\":%u,\"pid_kp\":%.4f,\"pid_ki\":%.4f,\"pid_kd\":%.4f}", 
+             Peripheral.reg_get(0x06), Peripheral.reg_get(0x07), Peripheral.reg_get(0x08), 
+             Peripheral.reg_get(0x09), Peripheral.reg_get(0x05), Peripheral.reg_get(0x0A), 
+             Peripheral.reg_get(0x0B), gains.kp, gains.ki, gains.kd);
+    server.sendHeader("Cache-Control", "no-store");
+    server.send(200, "application/json", json);
 }
 
 
@@ -911,21 +727,560 @@ void handle_NotFound (void)
 
 
 
-/** @brief   HTTP handler which reports the current measured motor speed.
- *  @details When a client accesses the @c /speed endpoint, this function reads
- *  the latest RPM value from the shared variable @c speed_actual and
- *  returns it as plain text. This endpoint is intended for JavaScript
- *  polling to generate real-time plots in the browser UI.
+/** @brief   Function which gives the telemetry log its storage from the heap.
+ *  @details The 96 kB of a full log would take most of the static DRAM the linker can place 
+ *  in .dram0.bss, so it is allocated when the webserver task starts: from PSRAM on boards 
+ *  which have it, otherwise from internal RAM. If the heap cannot hold it, the log is halved 
+ *  until it fits, down to TELEMETRY_LOG_MIN samples, and the size it got is printed over serial. 
+ *  This runs at power-up, before any command can have been given.
+ * 
+ *  @return True if the log has storage.
  */
-void handle_Speed (void)
+bool allocate_telemetry_log (void)
 {
-    // Read the latest measured speed (RPM)
-    bool direction = Peripheral.get_dir(); // read direction pin
-    float rpm = speed_actual.get();  // Share<float> from Shares.h
+    for (uint32_t size = TELEMETRY_LOG_SIZE; size >= TELEMETRY_LOG_MIN; size /= 2)
+    {
+        size_t bytes = size * sizeof(TelemetrySample);
+        bool psram = true;
+        void* storage = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (storage == NULL)
+        {
+            psram = false;
+            storage = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        }
+        if (storage != NULL)
+        {
+            telemetry_log.begin((TelemetrySample*)storage, size);
+            Serial.printf("Telemetry log: %lu samples, %lu bytes in %s, %lu bytes of internal heap left\n", 
+                          (unsigned long)size, (unsigned long)bytes, psram ? "PSRAM" : "internal RAM", 
+                          (unsigned long)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+            return true;
+        }
+    }
+    Serial.println("Telemetry log: no memory");
+    return false;
+}
+
+
 
-    String out;
-    out += String(rpm, 2); // 2 decimal places
-    server.send(200, "text/plain", out);
+/** @brief   Function which moves the recorded telemetry from the rings into the log.
+ *  @details The speed samples from readActual and the commands and transitions from 
+ *  speedControl are merged in time order, and popped straight into the log's storage. At most 
+ *  two rings' worth are moved, so this cannot run forever while the samples keep coming.
+ * 
+ *  @return The number of samples added to the log.
+ */
+uint32_t drain_telemetry (void)
+{
+    uint32_t count = telemetry_log.merge(telemetry_ring, telemetry_events, 
+                                         TELEMETRY_RING_SIZE + TELEMETRY_EVENT_RING_SIZE);
+    if (recorder_recording())
+    {
+        for (uint32_t seq = telemetry_log.next_seq() - count; seq != telemetry_log.next_seq(); seq++)
+        {
+            record_ring.push(telemetry_log.at(seq));
+        }
+    }
+    sse_samples += count;
+    return count;
+}
+
+
+
+/** @brief   HTTP handler which sends the recorded telemetry as a binary frame.
+ *  @details The @c since argument is the sequence number of the first sample wanted, which is 
+ *  @c first_seq plus @c count from the previous frame; without it every sample in the log is 
+ *  sent. The reply is a TelemetryFrameHeader followed by up to TELEMETRY_FRAME_MAX samples, 
+ *  written to the client straight from the log in at most two spans, with no copy and no text 
+ *  formatting. Samples which were overwritten before they were asked for are counted in the 
+ *  header, and a number from before a restart of the ESP32 gets every sample in the log.
+ */
+void handle_Telemetry (void)
+{
+    uint32_t start = micros();
+    uint32_t first = telemetry_log.first_seq();
+    uint32_t next = telemetry_log.next_seq();
+
+    uint32_t seq = server.hasArg("since") ? strtoul(server.arg("since").c_str(), NULL, 10) : first;
+    uint32_t lost = 0;
+    if (seq > next)
+    {
+        seq = first;
+    }
+    else if (seq < first)
+    {
+        lost = first - seq;
+        seq = first;
+    }
+    uint32_t count = next - seq;
+    if (count > TELEMETRY_FRAME_MAX)
+    {
+        count = TELEMETRY_FRAME_MAX;
+    }
+
+    TelemetryFrameHeader header = { TELEMETRY_FRAME_MAGIC, seq, lost, (uint16_t)count, 
+                                    (uint16_t)sizeof(TelemetrySample) };
+    size_t length = sizeof(header) + count * sizeof(TelemetrySample);
+    server.sendHeader("Cache-Control", "no-store");
+    server.setContentLength(length);
+    server.send(200, "application/octet-stream", "");
+    server.sendContent((const char*)&header, sizeof(header));
+    while (count > 0)
+    {
+        uint32_t n = 0;
+        const TelemetrySample* samples = telemetry_log.span(seq, n, count);
+        server.sendContent((const char*)samples, n * sizeof(TelemetrySample));
+        seq += n;
+        count -= n;
+    }
+
+    frame_time.add(micros() - start);
+    frame_bytes += length;
+}
+
+
+
+/** @brief   HTTP handler which exports the telemetry log as CSV.
+ *  @details Every speed sample, command and state transition in the log is sent as a row, with 
+ *  the device timestamps in microseconds, so a test run can be downloaded with nothing missing. 
+ *  As with @c /telemetry, the @c since argument is the first sequence number wanted. The reply 
+ *  uses chunked transfer encoding: rows are formatted into a small buffer which is sent as one 
+ *  chunk whenever it fills, so the file is never built in memory. Between chunks the rings are 
+ *  drained into the log so they do not overflow during a long download; rows logged after the 
+ *  download started are left for the next one, and rows overwritten before they were sent are 
+ *  skipped.
+ */
+void handle_LogCsv (void)
+{
+    uint32_t start = micros();
+    uint32_t first = telemetry_log.first_seq();
+    uint32_t end = telemetry_log.next_seq();
+
+    uint32_t seq = server.hasArg("since") ? strtoul(server.arg("since").c_str(), NULL, 10) : first;
+    if (seq > end || seq < first)
+    {
+        seq = first;
+    }
+
+    server.sendHeader("Cache-Control", "no-store");
+    server.sendHeader("Content-Disposition", "attachment; filename=\"speed_log.csv\"");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/csv", TELEMETRY_CSV_HEADER);
+
+    while (seq != end)
+    {
+        size_t used = telemetry_log.csv(seq, end, csv_text, sizeof(csv_text), csv_rows);
+        if (used == 0)
+        {
+            break;
+        }
+        server.sendContent(csv_text, used);
+        drain_telemetry();
+    }
+
+    csv_time.add(micros() - start);
+}
+
+
+
+/** @brief   Function which compresses samples and sends them as chunks of the reply.
+ *  @details Each chunk is one TelemetryCodec block of up to TELEMETRY_BLOCK_SAMPLES samples, 
+ *  which a client can decode on its own. The CPU cycles spent compressing are counted for the 
+ *  report printed by task_webserver.
+ * 
+ *  @param seq The sequence number of the first sample.
+ *  @param samples The samples, one after another in memory.
+ *  @param count The number of samples.
+ */
+void send_packed (uint32_t seq, const TelemetrySample* samples, uint32_t count)
+{
+    TelemetryEncoder encoder;
+    while (count > 0)
+    {
+        uint32_t cycles = ESP.getCycleCount();
+        encoder.begin(block_buf, sizeof(block_buf), seq);
+        uint32_t n = 0;
+        while (n < count && encoder.add(samples[n]))
+        {
+            n++;
+        }
+        size_t len = encoder.finish();
+        packed_cycles += ESP.getCycleCount() - cycles;
+        packed_samples += n;
+        packed_bytes += len;
+
+        server.sendContent((const char*)block_buf, len);
+        seq += n;
+        samples += n;
+        count -= n;
+    }
+}
+
+
+
+/** @brief   HTTP handler which exports the telemetry log compressed.
+ *  @details This sends the same samples as @c /log.csv, with the same @c since argument, as a 
+ *  string of TelemetryCodec blocks (TelemetryCodec.h) which take about a sixth of the bytes of 
+ *  the CSV and half those of the binary frames. Blocks are compressed straight from the log, 
+ *  and the rings are drained between them as in handle_LogCsv(). 
+ *  @c tools/telemetry_decode.py turns the file into CSV.
+ */
+void handle_LogTlz (void)
+{
+    uint32_t start = micros();
+    uint32_t first = telemetry_log.first_seq();
+    uint32_t end = telemetry_log.next_seq();
+
+    uint32_t seq = server.hasArg("since") ? strtoul(server.arg("since").c_str(), NULL, 10) : first;
+    if (seq > end || seq < first)
+    {
+        seq = first;
+    }
+
+    server.sendHeader("Cache-Control", "no-store");
+    server.sendHeader("Content-Disposition", "attachment; filename=\"speed_log.tlz\"");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/octet-stream", "");
+
+    while ((int32_t)(end - telemetry_log.skip_lost(seq)) > 0)
+    {
+        seq = telemetry_log.skip_lost(seq);
+        uint32_t count = (end - seq < TELEMETRY_BLOCK_SAMPLES) ? end - seq : TELEMETRY_BLOCK_SAMPLES;
+        uint32_t n = 0;
+        const TelemetrySample* samples = telemetry_log.span(seq, n, count);
+        send_packed(seq, samples, n);
+        seq += n;
+        drain_telemetry();
+    }
+
+    packed_time.add(micros() - start);
+}
+
+
+
+/** @brief   HTTP handler which lists the test runs recorded in flash.
+ *  @details The reply is a JSON object with whether a run is being recorded and an array of 
+ *  the runs, oldest first, each with its id, the power-up it was recorded in, its start time 
+ *  since power-up (ms) and on the client's clock (Unix s, zero if not given), its profile, the 
+ *  samples kept and whether its start has been overwritten. One run is sent per chunk.
+ */
+void handle_Runs (void)
+{
+    uint8_t count = recorder_runs(run_list, RUNLOG_MAX_RUNS);
+
+    server.sendHeader("Cache-Control", "no-store");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", recorder_recording() ? "{\"recording\":true,\"runs\":[" 
+                                                              : "{\"recording\":false,\"runs\":[");
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const RunInfo& run = run_list[i];
+        int len = snprintf(csv_text, sizeof(csv_text), 
+                           "%s{\"id\":%lu,\"boot\":%lu,\"start_ms\":%lu,\"epoch\":%lu,\"profile\":\"%s\","
+                           "\"samples\":%lu,\"truncated\":%s}", (i == 0) ? "" : ",", (unsigned long)run.id, 
+                           (unsigned long)run.boot, (unsigned long)run.start_ms, (unsigned long)run.epoch_s, 
+                           run.profile, (unsigned long)run.samples, run.truncated ? "true" : "false");
+        server.sendContent(csv_text, len);
+    }
+    server.sendContent("]}", 2);
+}
+
+
+
+/** @brief   Function which makes a name safe to put in a JSON reply as it is.
+ *  @details Anything but letters, digits, spaces and @c _.- is replaced with an underscore.
+ *  @param   name The name, which is changed in place.
+ */
+static void clean_name (char* name)
+{
+    for (char* c = name; *c != '\0'; c++)
+    {
+        if (!isalnum((unsigned char)*c) && strchr(" _.-", *c) == NULL)
+        {
+            *c = '_';
+        }
+    }
+}
+
+
+
+/** @brief   HTTP handler which starts or stops recording a test run to flash.
+ *  @details @c /runs/start starts a new run, named by the @c profile argument and stamped with 
+ *  the client's clock from the @c time argument (Unix s), ending any run being recorded. 
+ *  @c /runs/stop ends the run. The request is only posted to the recorder task, which writes 
+ *  to flash within 100 ms. The profile name is cut short and anything but letters, digits, 
+ *  spaces and @c _.- is replaced, so it can go in the JSON list as it is.
+ */
+void handle_RunStart (void)
+{
+    RecorderCommand command;
+    memset(&command, 0, sizeof(command));
+    command.start = true;
+    command.epoch_s = server.hasArg("time") ? strtoul(server.arg("time").c_str(), NULL, 10) : 0;
+    strncpy(command.profile, server.hasArg("profile") ? server.arg("profile").c_str() : "", 
+            sizeof(command.profile) - 1);
+    clean_name(command.profile);
+    recorder_cmd.post(command, esp_timer_get_time());
+    server.send(200, "text/plain", "OK");
+}
+
+
+
+/** @brief   HTTP handler which stops recording a test run; see handle_RunStart() */
+void handle_RunStop (void)
+{
+    RecorderCommand command;
+    memset(&command, 0, sizeof(command));
+    recorder_cmd.post(command, esp_timer_get_time());
+    server.send(200, "text/plain", "OK");
+}
+
+
+
+/** @brief   HTTP handler which exports one recorded test run as CSV.
+ *  @details The run is named by the @c id argument. The columns are the same as @c /log.csv, 
+ *  with the samples numbered from zero within the run. The samples are read from flash one 
+ *  record at a time and sent with chunked transfer encoding, so a long run never has to fit 
+ *  in memory, and the recorder task can keep writing between records. With @c format=tlz the 
+ *  run is sent compressed, as from @c /log.tlz.
+ */
+void handle_RunGet (void)
+{
+    uint32_t start = micros();
+    RunCursor cursor;
+    uint32_t id = server.hasArg("id") ? strtoul(server.arg("id").c_str(), NULL, 10) : 0;
+    if (!recorder_open(id, cursor))
+    {
+        server.send(404, "text/plain", "No such run");
+        return;
+    }
+
+    bool packed = server.hasArg("format") && server.arg("format") == "tlz";
+    char name[64];
+    snprintf(name, sizeof(name), "attachment; filename=\"run_%lu.%s\"", (unsigned long)id, packed ? "tlz" : "csv");
+    server.sendHeader("Cache-Control", "no-store");
+    server.sendHeader("Content-Disposition", name);
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    if (packed)
+    {
+        server.send(200, "application/octet-stream", "");
+    }
+    else
+    {
+        server.send(200, "text/csv", TELEMETRY_CSV_HEADER);
+    }
+
+    uint32_t seq = 0;
+    uint16_t count;
+    while ((count = recorder_read(cursor, run_samples)) > 0)
+    {
+        if (packed)
+        {
+            send_packed(seq, run_samples, count);
+            seq += count;
+            drain_telemetry();
+            continue;
+        }
+
+        size_t used = 0;
+        for (uint16_t i = 0; i < count; i++)
+        {
+            size_t len = telemetry_csv(csv_text + used, sizeof(csv_text) - used, seq, run_samples[i]);
+            if (len == 0)
+            {
+                server.sendContent(csv_text, used);
+                used = 0;
+                len = telemetry_csv(csv_text, sizeof(csv_text), seq, run_samples[i]);
+            }
+            used += len;
+            seq++;
+        }
+        server.sendContent(csv_text, used);
+        drain_telemetry();
+    }
+    csv_rows += seq;
+    csv_time.add(micros() - start);
+}
+
+
+
+/** @brief   HTTP handler which loads a command profile to be played.
+ *  @details The profile is the body of a POST request, or the @c text argument, in the format 
+ *  read by ProfilePlayer::parse(), and is named by the @c name argument, which is cleaned up 
+ *  like a run name. A profile which is playing is stopped. The reply says how many steps were 
+ *  loaded and how long the profile lasts, or what is wrong with it.
+ */
+void handle_ProfileLoad (void)
+{
+    String text = server.hasArg("plain") ? server.arg("plain") : server.arg("text");
+    if (text.length() > PROFILE_TEXT_MAX)
+    {
+        server.send(413, "text/plain", "Profile too long");
+        return;
+    }
+
+    char name[RUNLOG_PROFILE_LEN];
+    memset(name, 0, sizeof(name));
+    strncpy(name, server.hasArg("name") ? server.arg("name").c_str() : "", sizeof(name) - 1);
+    clean_name(name);
+
+    char reply[80];
+    if (!profile_load(text.c_str(), name, reply, sizeof(reply)))
+    {
+        server.send(400, "text/plain", reply);
+        return;
+    }
+    ProfileStatus status;
+    profile_status(status);
+    snprintf(reply, sizeof(reply), "OK: %u steps, %lu ms", (unsigned)status.steps, 
+             (unsigned long)status.duration_ms);
+    server.send(200, "text/plain", reply);
+}
+
+
+
+/** @brief   HTTP handler which starts or stops playing the loaded command profile.
+ *  @details @c /profile/start plays the profile from its first step; with @c record=1 it is 
+ *  also recorded as a test run named after the profile and stamped with the @c time argument 
+ *  (Unix s), which ends when the profile does. @c /profile/stop stops it, leaving its last 
+ *  command in effect, as does any speed or torque commanded through @c /cmd.
+ */
+void handle_ProfileStart (void)
+{
+    bool record = server.hasArg("record") && server.arg("record") == "1";
+    uint32_t epoch_s = server.hasArg("time") ? strtoul(server.arg("time").c_str(), NULL, 10) : 0;
+    if (!profile_start(record, epoch_s))
+    {
+        server.send(409, "text/plain", "No profile loaded");
+        return;
+    }
+    server.send(200, "text/plain", "OK");
+}
+
+
+
+/** @brief   HTTP handler which stops the command profile; see handle_ProfileStart() */
+void handle_ProfileStop (void)
+{
+    profile_stop();
+    server.send(200, "text/plain", "OK");
+}
+
+
+
+/** @brief   HTTP handler which replies with the state of the command profile player as JSON.
+ *  @details The reply has the loaded profile's name, steps and length, whether it is playing, 
+ *  its number and current step, and the latest any of its commands was posted after it was 
+ *  due, so the page can show the progress of a profile and whether it kept time.
+ */
+void handle_ProfileStatus (void)
+{
+    ProfileStatus status;
+    profile_status(status);
+    char reply[256];
+    snprintf(reply, sizeof(reply), 
+             "{\"name\":\"%s\",\"steps\":%u,\"duration_ms\":%lu,\"playing\":%s,\"number\":%u,"
+             "\"step\":%u,\"elapsed_ms\":%lu,\"late_max_us\":%lu,\"skipped\":%lu}", 
+             status.name, (unsigned)status.steps, (unsigned long)status.duration_ms, 
+             status.playing ? "true" : "false", (unsigned)status.number, (unsigned)status.step, 
+             (unsigned long)status.elapsed_ms, (unsigned long)status.late_max_us, 
+             (unsigned long)status.skipped);
+    server.sendHeader("Cache-Control", "no-store");
+    server.send(200, "application/json", reply);
+}
+
+
+
+/** @brief   HTTP handler which starts a live telemetry stream.
+ *  @details The reply is a Server-Sent Events stream: the headers are written straight to the 
+ *  client, which is kept open after the handler returns, and the webserver task then writes 
+ *  a message to it each pass with the samples which readActual has recorded since the last 
+ *  one. The @c hz argument sets the most samples per second to send, and zero or no argument 
+ *  sends every speed which is measured. A browser reconnects by itself when the stream drops.
+ */
+void handle_Events (void)
+{
+    uint32_t hz = server.hasArg("hz") ? (uint32_t)server.arg("hz").toInt() : 0;
+
+    for (uint8_t i = 0; i < SSE_CLIENTS; i++)
+    {
+        SseClient& sse = sse_clients[i];
+        if (!sse.client.connected())
+        {
+            sse.client = server.client();
+            sse.client.setNoDelay(true);
+            sse.client.print("HTTP/1.1 200 OK\r\n"
+                             "Content-Type: text/event-stream\r\n"
+                             "Cache-Control: no-cache\r\n"
+                             "Connection: keep-alive\r\n\r\n"
+                             "retry: 2000\n\n");
+            sse.event.set_rate(hz);
+            return;
+        }
+    }
+    server.send(503, "text/plain", "Too many telemetry clients");
+}
+
+
+
+/** @brief   Function which sends the latest telemetry samples to the streaming clients.
+ *  @details The samples are moved from the rings into the log for @c /telemetry and 
+ *  @c /log.csv, even when nobody is streaming, so the rings never fill up. The ones which have 
+ *  not been streamed yet, including any logged while a handler was running, are then packed 
+ *  into as few messages as fit in the text buffer. A client whose connection has closed, or 
+ *  whose socket cannot take a whole message, is dropped so that it cannot hold up the web 
+ *  server; a browser will reconnect.
+ */
+void send_telemetry (void)
+{
+    drain_telemetry();
+
+    // samples which were overwritten before they could be streamed are skipped
+    uint32_t first = telemetry_log.first_seq();
+    uint32_t end = telemetry_log.next_seq();
+    if ((int32_t)(sse_seq - first) < 0)
+    {
+        sse_seq = first;
+    }
+    first = sse_seq;
+    sse_seq = end;
+    if (end == first)
+    {
+        return;
+    }
+
+    uint32_t start = micros();
+    for (uint8_t i = 0; i < SSE_CLIENTS; i++)
+    {
+        SseClient& sse = sse_clients[i];
+        if (!sse.client.connected())
+        {
+            continue;
+        }
+
+        uint32_t seq = first;
+        while (seq != end && sse.client.connected())
+        {
+            sse.event.begin(sse_text, sizeof(sse_text), (uint32_t)esp_timer_get_time());
+            while (seq != end && sse.event.add(telemetry_log.at(seq)))
+            {
+                seq++;
+            }
+            size_t len = sse.event.finish();
+            if (len == 0)
+            {
+                continue;
+            }
+            if (sse.client.write((const uint8_t*)sse_text, len) != len)
+            {
+                sse.client.stop();
+                break;
+            }
+            sse_events++;
+            sse_bytes += len;
+        }
+    }
+    sse_time.add(micros() - start);
 }
 
 
@@ -934,7 +1289,11 @@ void handle_Speed (void)
  *  @details After setup, function @c handleClient() must be run periodically
  *           to check for page requests from web clients. One could run this
  *           task as the lowest priority task with a short or no delay, as there
- *           generally isn't much rush in replying to web queries.
+ *           generally isn't much rush in replying to web queries. After each
+ *           request the telemetry recorded since the last pass is streamed to
+ *           the clients of @c /events, so the 10 ms delay sets the batch size.
+ *           The time taken by the page and command handlers and the telemetry
+ *           sends, and the bytes sent, are printed over serial every 10 s.
  */
 void task_webserver (void* p_params)
 {
@@ -942,17 +1301,92 @@ void task_webserver (void* p_params)
     // is accessed as a global object because not only this function but also
     // the page handling functions referenced below need access to the server
     server.on ("/", handle_DocumentRoot);
-    server.on ("/speed", handle_Speed);
+    server.on ("/cmd", handle_Command);
+    server.on ("/settings", handle_Settings);
+    server.on ("/telemetry", handle_Telemetry);
+    server.on ("/log.csv", handle_LogCsv);
+    server.on ("/log.tlz", handle_LogTlz);
+    server.on ("/events", handle_Events);
+    server.on ("/runs", handle_Runs);
+    server.on ("/runs/start", handle_RunStart);
+    server.on ("/runs/stop", handle_RunStop);
+    server.on ("/runs/get", handle_RunGet);
+    server.on ("/profile", handle_ProfileLoad);
+    server.on ("/profile/start", handle_ProfileStart);
+    server.on ("/profile/stop", handle_ProfileStop);
+    server.on ("/profile/status", handle_ProfileStatus);
     server.onNotFound (handle_NotFound);
 
+    // Every telemetry handler reads the log, so the server does not start without it; the motor 
+    // has not been commanded yet and stays stopped
+    if (!allocate_telemetry_log ())
+    {
+        vTaskDelete (NULL);
+    }
+
+    // The ETag check needs the If-None-Match header, which is not kept unless asked for
+    const char* headers[] = { "If-None-Match" };
+    server.collectHeaders (headers, 1);
+
     // Get the web server running
     server.begin ();
     Serial.println ("HTTP server started");
 
+    uint32_t last_report = millis ();
+    char line[160];
+
     for (;;)
     {
         // The web server must be periodically run to watch for page requests
         server.handleClient ();
+        send_telemetry ();
+
+        if (millis () - last_report >= WEB_REPORT_MS 
+            && page_time.count () + cmd_time.count () + sse_time.count () + frame_time.count () 
+               + csv_time.count () + packed_time.count () > 0)
+        {
+            page_time.report (line, sizeof (line), "Page handler");
+            Serial.println (line);
+            Serial.printf ("Page: %lu bytes sent, %lu not modified\n", (unsigned long)page_bytes, 
+                           (unsigned long)page_304s);
+            cmd_time.report (line, sizeof (line), "Command handler");
+            Serial.println (line);
+            sse_time.report (line, sizeof (line), "Telemetry send");
+            Serial.println (line);
+            frame_time.report (line, sizeof (line), "Telemetry frame");
+            Serial.println (line);
+            csv_time.report (line, sizeof (line), "Telemetry CSV");
+            Serial.println (line);
+            packed_time.report (line, sizeof (line), "Telemetry TLZ");
+            Serial.println (line);
+            if (packed_samples > 0)
+            {
+                Serial.printf ("Telemetry codec: %lu samples, %.2f bytes/sample (24 binary), %lu cycles/sample\n", 
+                               (unsigned long)packed_samples, (float)packed_bytes / packed_samples, 
+                               (unsigned long)(packed_cycles / packed_samples));
+            }
+            Serial.printf ("Telemetry: %lu samples in %lu messages, %lu bytes, %lu frame bytes, %lu CSV rows, "
+                           "%lu ring overflows\n", (unsigned long)sse_samples, (unsigned long)sse_events, 
+                           (unsigned long)sse_bytes, (unsigned long)frame_bytes, (unsigned long)csv_rows, 
+                           (unsigned long)(telemetry_ring.overflows () + telemetry_events.overflows ()));
+            page_time.reset ();
+            cmd_time.reset ();
+            sse_time.reset ();
+            frame_time.reset ();
+            csv_time.reset ();
+            packed_time.reset ();
+            page_bytes = 0;
+            page_304s = 0;
+            sse_samples = 0;
+            sse_events = 0;
+            sse_bytes = 0;
+            frame_bytes = 0;
+            csv_rows = 0;
+            packed_samples = 0;
+            packed_bytes = 0;
+            packed_cycles = 0;
+            last_report = millis ();
+        }
         vTaskDelay (10); 
     }
 }
@@ -9,18 +9,70 @@
 #include <PrintStream.h>  
 #include "taskqueue.h"
 #include "taskshare.h"
+#include "SpscRing.h"
+#include "EdgeRing.h"
+#include "Mailbox.h"
+#include "SpeedType.h"
+#include "Driver.h"
+#include "WheelModel.h"
+#include "SpeedPid.h"
+#include "Telemetry.h"
+#include "Recorder.h"
 
-// A queue which holds torque command values from the webserver and passes them to the calcSetpoint task
-extern Queue<float> torque_cmd;
+// Number of register accesses which can wait for the driver I/O task
+#define DRV_REQUEST_QUEUE_SIZE 16
 
-// A queue which holds speed command values from the webserver and passes them to the speedControl state machine
-extern Queue<float> speed_cmd;
+// Task notification bits used to wake the readActual task
+#define NOTIFY_EDGES 0x01   // the capture backend has pushed a group of edges into edge_ring
+#define NOTIFY_STALL 0x02   // the stall timer expired before the next edge arrived
 
-// A share which populates using an ISR and holds the current speed of the motor
-extern Share<float> speed_actual;
+// Task notification bits used to wake the speedControl task
+#define NOTIFY_SPEED 0x01   // readActual has put a new speed in speed_actual
+#define NOTIFY_COMMAND 0x02 // a new command has been posted to speed_cmd
+#define NOTIFY_PID 0x04     // the PID timer has started the next period of the speed loop
 
-// A queue which uses an ISR to trigger the readActual task and calculate the motor speed by reading the square wave 
-// frequency on the FGOUT pin
-extern Queue<uint32_t> edge_time;
+// A mailbox which holds the latest torque command from the webserver for the calcSetpoint task
+extern Mailbox<float> torque_cmd;
+
+// A mailbox which holds the latest speed command from the webserver or calcSetpoint for the speedControl 
+// state machine
+extern Mailbox<rpm_t> speed_cmd;
+
+// A share which populates using an ISR and holds the current filtered speed of the motor
+extern Share<rpm_t> speed_actual;
+
+// A share which holds the unfiltered speed of the motor calculated from the latest single FGOUT period
+extern Share<rpm_t> speed_raw;
+
+// A wait-free ring which the FGOUT capture backend fills with edge timestamps, so the readActual task can
+// calculate the motor speed from the square wave frequency on the FGOUT pin. Edges that do not fit are
+// counted by edge_ring.overflows()
+extern EdgeRing edge_ring;
+
+// A mailbox which holds the latest wheel model estimated by readActual for the torque loop in calcSetpoint
+extern Mailbox<WheelModel> wheel_model;
+
+// A mailbox which holds the latest gains of the outer PID speed loop from the webserver for speedControl
+extern Mailbox<PidGains> pid_gains;
+
+// A wait-free ring which readActual fills with a telemetry sample for every speed it measures, so the
+// webserver task can stream them to the live plot. Samples that do not fit are counted by
+// telemetry_ring.overflows()
+extern SpscRing<TelemetrySample, TELEMETRY_RING_SIZE> telemetry_ring;
+
+// A wait-free ring which speedControl fills with a telemetry sample for every new command and state 
+// transition, so the webserver task can log them between the speed samples
+extern SpscRing<TelemetrySample, TELEMETRY_EVENT_RING_SIZE> telemetry_events;
+
+// A wait-free ring which the webserver task fills with every sample it logs while a test run is being
+// recorded, so the recorder task can write them to flash. Samples that do not fit are counted by
+// record_ring.overflows()
+extern SpscRing<TelemetrySample, RECORD_RING_SIZE> record_ring;
+
+// A mailbox which holds the latest request from the webserver to start or stop recording a test run
+extern Mailbox<RecorderCommand> recorder_cmd;
+
+// A queue of register accesses which the driver I/O task performs on the DRV8308 for other tasks
+extern Queue<DrvRequest> drv_requests;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,241 @@
+/** @file SpeedEstimator.cpp
+ *  This file contains the SpeedEstimator class, which filters the FGOUT edge timestamps
+ *  into a motor speed using a sliding average, a median filter, or an average whose
+ *  window adapts to the speed.
+*/
+
+#include "SpeedEstimator.h"
+
+
+
+/** @brief Constructor for the SpeedEstimator class
+ *
+ *  @param mode_ The filter used for the filtered speed.
+ *  @param window_ K, the number of periods averaged. In adaptive mode this is the most
+ *  periods that will be averaged.
+ *  @param median_n_ N, the number of periods in the median filter.
+ *  @param ticks_per_us_ The tick rate of the capture backend which produces the timestamps.
+ */
+SpeedEstimator::SpeedEstimator(EstimatorMode mode_, uint16_t window_, uint16_t median_n_, uint32_t ticks_per_us_)
+{
+    ticks_per_us = (ticks_per_us_ == 0) ? 1 : ticks_per_us_;
+    configure(mode_, window_, median_n_);
+    set_adapt_time(20000);
+    reset();
+}
+
+
+
+/** @brief A function which changes the filter settings
+ *
+ *  @details The window is limited to what the fixed timestamp buffer can hold and the
+ *  median length to ESTIMATOR_MEDIAN_MAX. The stored history is discarded.
+ *
+ *  @param mode_ The filter used for the filtered speed.
+ *  @param window_ K, the number of periods averaged (maximum for adaptive mode).
+ *  @param median_n_ N, the number of periods in the median filter.
+ */
+void SpeedEstimator::configure(EstimatorMode mode_, uint16_t window_, uint16_t median_n_)
+{
+    mode = mode_;
+
+    if (window_ < 1) window_ = 1;
+    if (window_ > ESTIMATOR_STAMPS - 1) window_ = ESTIMATOR_STAMPS - 1;
+    window = window_;
+
+    if (median_n_ < 1) median_n_ = 1;
+    if (median_n_ > ESTIMATOR_MEDIAN_MAX) median_n_ = ESTIMATOR_MEDIAN_MAX;
+    median_n = median_n_;
+
+    reset();
+}
+
+
+
+/** @brief A function which sets how much time the adaptive window tries to cover
+ *
+ *  @details At high speed many edges fit in this time, so more periods are averaged and
+ *  the estimate is smoother; at low speed only a few are used so it stays responsive.
+ *
+ *  @param adapt_us The averaging time in microseconds.
+ */
+void SpeedEstimator::set_adapt_time(uint32_t adapt_us)
+{
+    adapt_ticks = adapt_us * ticks_per_us;
+}
+
+
+
+/** @brief A function which sets the tick rate of the timestamps
+ *
+ *  @param ticks_per_us_ The number of capture ticks per microsecond.
+ */
+void SpeedEstimator::set_ticks_per_us(uint32_t ticks_per_us_)
+{
+    uint32_t adapt_us = adapt_ticks / ticks_per_us;
+    ticks_per_us = (ticks_per_us_ == 0) ? 1 : ticks_per_us_;
+    set_adapt_time(adapt_us);
+    reset();
+}
+
+
+
+/** @brief A function which discards all stored edges
+ *
+ *  @details The next edge after a reset is only used as a reference, so a long pause
+ *  (such as a stopped motor) never shows up as one giant period.
+ */
+void SpeedEstimator::reset(void)
+{
+    head = 0;
+    stored = 0;
+    recent_head = 0;
+    recent_count = 0;
+    raw_ticks = 0;
+    filtered_span = 0;
+    filtered_edges = 0;
+}
+
+
+
+/** @brief A function which returns an older timestamp from the circular buffer
+ *
+ *  @param k How many edges back to look; zero is the latest edge.
+ *
+ *  @return The timestamp of that edge in ticks.
+ */
+uint32_t SpeedEstimator::stamp_back(uint16_t k)
+{
+    return stamps[(head + ESTIMATOR_STAMPS - 1 - k) % ESTIMATOR_STAMPS];
+}
+
+
+
+/** @brief A function which adds a period to the median filter
+ *
+ *  @details The oldest period is removed from the sorted array and the new one is inserted
+ *  in order, which takes at most ESTIMATOR_MEDIAN_MAX steps.
+ *
+ *  @param period The newest period in ticks.
+ */
+void SpeedEstimator::insert_period(uint32_t period)
+{
+    uint16_t n = recent_count;
+
+    if (recent_count == median_n)
+    {
+        // remove the oldest period from the sorted array
+        uint32_t oldest = recent[recent_head];
+        uint16_t i = 0;
+        while (i < n - 1 && sorted[i] != oldest) i++;
+        for (; i < n - 1; i++) sorted[i] = sorted[i + 1];
+        n--;
+    }
+    else
+    {
+        recent_count++;
+    }
+
+    recent[recent_head] = period;
+    recent_head = (recent_head + 1) % median_n;
+
+    // insertion step into the sorted array
+    uint16_t j = n;
+    while (j > 0 && sorted[j - 1] > period)
+    {
+        sorted[j] = sorted[j - 1];
+        j--;
+    }
+    sorted[j] = period;
+}
+
+
+
+/** @brief A function which adds one FGOUT rising edge to the estimator
+ *
+ *  @details This stores the timestamp, measures the period since the previous edge and
+ *  updates the filtered period. The sliding average uses the timestamp K edges ago, so it
+ *  costs the same for any K. Unsigned subtraction keeps this correct across timer wraparound.
+ *
+ *  @param ticks The timestamp of the edge in capture ticks.
+ *
+ *  @return True if a new speed is available.
+ */
+bool SpeedEstimator::add_edge(uint32_t ticks)
+{
+    // ignore duplicate timestamps, they would make a zero length period
+    if (stored > 0 && ticks == stamp_back(0))
+    {
+        return false;
+    }
+
+    stamps[head] = ticks;
+    head = (head + 1) % ESTIMATOR_STAMPS;
+    if (stored < ESTIMATOR_STAMPS) stored++;
+
+    if (stored < 2)
+    {
+        return false;
+    }
+
+    raw_ticks = ticks - stamp_back(1);
+
+    uint16_t k = window;
+    switch (mode)
+    {
+        case ESTIMATE_MEDIAN:
+            insert_period(raw_ticks);
+            if (recent_count % 2 == 1)
+            {
+                filtered_span = sorted[recent_count / 2];
+                filtered_edges = 1;
+            }
+            else
+            {
+                // average of the two middle periods
+                filtered_span = sorted[recent_count / 2 - 1] + sorted[recent_count / 2];
+                filtered_edges = 2;
+            }
+            return true;
+
+        case ESTIMATE_ADAPTIVE:
+            // use as many periods as fit in the adaptive time, but at least one
+            k = (uint16_t)((adapt_ticks / raw_ticks < window) ? adapt_ticks / raw_ticks : window);
+            if (k < 1) k = 1;
+            break;
+
+        case ESTIMATE_AVERAGE:
+        default:
+            break;
+    }
+
+    if (k > stored - 1) k = stored - 1;
+    filtered_span = ticks - stamp_back(k);
+    filtered_edges = k;
+    return true;
+}
+
+
+
+/** @brief A function which returns the speed from the latest single period
+ *
+ *  @return The unfiltered speed magnitude, or zero if no period is known.
+ */
+rpm_t SpeedEstimator::raw_rpm(void)
+{
+    return rpm_from_span(raw_ticks, 1, ticks_per_us);
+}
+
+
+
+/** @brief A function which returns the filtered speed
+ *
+ *  @details The filters work on periods, so the only divide per update is the one in
+ *  rpm_from_span(), which uses no divide instruction in the fixed-point build.
+ *
+ *  @return The filtered speed magnitude, or zero if no period is known.
+ */
+rpm_t SpeedEstimator::rpm(void)
+{
+    return rpm_from_span(filtered_span, filtered_edges, ticks_per_us);
+}
@@ -0,0 +1,111 @@
+/** @file SpeedEstimator.h
+ *  This file contains the SpeedEstimator class, which filters the FGOUT edge timestamps
+ *  into a motor speed. A single late interrupt makes one period look much longer than the
+ *  others, so the estimator can average the period over several edges, reject spikes with
+ *  a median filter, or adapt the averaging window to the speed.
+ *
+ *  All storage is fixed size and every edge is processed in bounded time. Nothing in this
+ *  file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _SPEEDESTIMATOR_H_
+#define _SPEEDESTIMATOR_H_
+
+#include <stdint.h>
+#include "SpeedType.h"
+
+// Number of timestamps kept by the estimator; the longest averaging window is one less
+#define ESTIMATOR_STAMPS 32
+
+// Longest median filter supported by the estimator
+#define ESTIMATOR_MEDIAN_MAX 9
+
+/** The filter used to turn edge periods into a speed */
+enum EstimatorMode
+{
+    ESTIMATE_AVERAGE,   // average period over the last K edges
+    ESTIMATE_MEDIAN,    // median period of the last N edges
+    ESTIMATE_ADAPTIVE   // average period over as many edges as fit in a fixed time, up to K
+};
+
+/** This class is used to estimate the motor speed from FGOUT edge timestamps */
+class SpeedEstimator
+{
+    protected:
+
+        EstimatorMode mode;                         // filter used for the filtered speed
+        uint16_t window;                            // K, number of periods averaged (maximum for adaptive)
+        uint16_t median_n;                          // N, number of periods in the median filter
+        uint32_t adapt_ticks;                       // time the adaptive window tries to span, in ticks
+        uint32_t ticks_per_us;                      // tick rate of the capture backend
+
+        uint32_t stamps[ESTIMATOR_STAMPS];          // circular buffer of the latest edge timestamps
+        uint16_t head;                              // index where the next timestamp is written
+        uint16_t stored;                            // number of valid timestamps in stamps[]
+
+        uint32_t recent[ESTIMATOR_MEDIAN_MAX];      // circular buffer of the latest periods for the median
+        uint32_t sorted[ESTIMATOR_MEDIAN_MAX];      // the same periods kept in ascending order
+        uint16_t recent_head;                       // index where the next period is written in recent[]
+        uint16_t recent_count;                      // number of valid periods in recent[] and sorted[]
+
+        uint32_t raw_ticks;                         // most recent single period, in ticks
+        uint32_t filtered_span;                     // time covered by the filtered periods, in ticks
+        uint16_t filtered_edges;                    // number of periods in filtered_span
+
+        void insert_period(uint32_t period);
+        uint32_t stamp_back(uint16_t k);
+
+    public:
+
+        /** Non-inline functions are commented in SpeedEstimator.cpp */
+        SpeedEstimator(EstimatorMode mode_ = ESTIMATE_ADAPTIVE, uint16_t window_ = 8,
+                       uint16_t median_n_ = 5, uint32_t ticks_per_us_ = 1);
+
+        void configure(EstimatorMode mode_, uint16_t window_, uint16_t median_n_);
+        void set_adapt_time(uint32_t adapt_us);
+        void set_ticks_per_us(uint32_t ticks_per_us_);
+        void reset(void);
+        bool add_edge(uint32_t ticks);
+
+        rpm_t raw_rpm(void);
+        rpm_t rpm(void);
+
+
+
+        /** @brief A function which returns the timestamp of the latest edge
+         *
+         *  @return The last timestamp passed to add_edge(), in capture ticks.
+         */
+        uint32_t last_edge(void)
+        {
+            return stamp_back(0);
+        }
+
+
+
+        /** @brief A function which returns the time the filtered speed was measured over
+         *
+         *  @details In the average and adaptive modes rpm() is the average speed over this much
+         *  time before the latest edge, which is the speed halfway through it while the
+         *  acceleration is constant. In median mode it is the length of the chosen periods.
+         *
+         *  @return The span of the filtered periods in capture ticks.
+         */
+        uint32_t span(void)
+        {
+            return filtered_span;
+        }
+
+
+
+        /** @brief A function which reports whether a speed is available
+         *
+         *  @return True once at least one whole period has been measured since reset().
+         */
+        bool valid(void)
+        {
+            return stored >= 2;
+        }
+};
+
+#endif
@@ -0,0 +1,212 @@
+/** @file SpeedFsm.cpp
+ *  This file contains the SpeedFsm class, the table driven state machine which decides
+ *  how to drive the motor toward a commanded speed.
+*/
+
+#include "SpeedFsm.h"
+
+
+
+/** The handler for every state and event. A new command is acted on in every state, so it
+ *  pre-empts a transition that is still running. A timeout re-checks the same conditions
+ *  as a speed update, in case the speed stops changing.
+ */
+const SpeedFsm::Handler SpeedFsm::table[FSM_STATES][FSM_EVENTS] =
+{
+    //                EV_SPEED_UPDATED          EV_NEW_COMMAND      EV_TIMEOUT
+    /* FSM_IDLE  */ { &SpeedFsm::ignore,        &SpeedFsm::start,   &SpeedFsm::ignore },
+    /* FSM_ACCEL */ { &SpeedFsm::check_accel,   &SpeedFsm::start,   &SpeedFsm::check_accel },
+    /* FSM_DECEL */ { &SpeedFsm::check_decel,   &SpeedFsm::start,   &SpeedFsm::check_decel }
+};
+
+
+
+/** @brief Function which returns the sign of the input
+ *
+ *  @param x Speed
+ *
+ *  @return Sign of x, with zero counted as positive
+ */
+static inline int sign(rpm_t x)
+{
+    return (x >= 0) ? +1 : -1;
+}
+
+
+
+/** @brief Constructor for the SpeedFsm class
+ *
+ *  @details The machine starts idle, stopped, with the brake off and the positive
+ *  direction commanded, which is how Driver::begin() leaves the pins.
+ *
+ *  @param deadband_ How close the speed has to get to the command to count as reached.
+ */
+SpeedFsm::SpeedFsm(rpm_t deadband_)
+{
+    state = FSM_IDLE;
+    command = 0;
+    actual = 0;
+    dir = false;
+    braking = false;
+    deadband = deadband_;
+}
+
+
+
+/** @brief A function which runs the handler for an event in the current state
+ *
+ *  @param event The event which happened.
+ *
+ *  @return The outputs to apply, with no bits set if nothing changes.
+ */
+FsmOutput SpeedFsm::dispatch(FsmEvent event)
+{
+    FsmOutput out;
+    out.actions = 0;
+    out.dir = dir;
+    out.speed = 0;
+
+    if (event < FSM_EVENTS)
+    {
+        state = (this->*table[state][event])(out);
+    }
+    return out;
+}
+
+
+
+/** @brief A function which tells whether a new command can be followed without a transition
+ *
+ *  @details While the machine is idle, a command within the deadband of the one it settled
+ *  on, on the same side of zero, would only be ramped to and found reached, so the caller
+ *  can leave it to the outer speed loop instead of dispatching EV_NEW_COMMAND. The machine
+ *  keeps the command it settled on, so a stream of small steps, such as the torque loop
+ *  posts, is dispatched once it has moved further than the deadband from that command.
+ *
+ *  @param command_ The new commanded speed.
+ *
+ *  @return True if the machine is idle and the new command is within its deadband.
+ */
+bool SpeedFsm::holds(rpm_t command_)
+{
+    return state == FSM_IDLE && command_ != 0 && command != 0 && sign(command_) == sign(command)
+           && rpm_abs(command_ - command) <= deadband;
+}
+
+
+
+/** @brief A handler for events which do not matter in the current state
+ *
+ *  @param out Unchanged.
+ *
+ *  @return The current state.
+ */
+FsmState SpeedFsm::ignore(FsmOutput& out)
+{
+    (void)out;
+    return state;
+}
+
+
+
+/** @brief A handler which starts moving toward a new command
+ *
+ *  @details If the command is further from zero than the speed in the direction already
+ *  commanded, the DRV8308 loop can accelerate to it, so CLKIN is ramped to the command.
+ *  Otherwise the motor has to slow down (possibly through zero), which the DRV8308 loop
+ *  cannot do, so CLKIN goes to zero and the brake is set. This runs in every state, so a
+ *  transition in progress is replaced straight away.
+ *
+ *  @param out Filled in with the outputs.
+ *
+ *  @return FSM_ACCEL or FSM_DECEL.
+ */
+FsmState SpeedFsm::start(FsmOutput& out)
+{
+    bool same_sign = sign(command) == sign(actual);
+    bool away_from_zero = dir ? (command < actual) : (command > actual);
+
+    if (same_sign && away_from_zero)
+    {
+        if (braking)
+        {
+            out.actions |= FSM_OUT_UNBRAKE;
+            braking = false;
+        }
+        out.actions |= FSM_OUT_RAMP;
+        out.speed = rpm_abs(command);
+        return FSM_ACCEL;
+    }
+
+    out.actions |= FSM_OUT_STOP | FSM_OUT_BRAKE;
+    braking = true;
+    return check_decel(out);
+}
+
+
+
+/** @brief A handler which checks whether an acceleration has reached the command
+ *
+ *  @param out Unchanged.
+ *
+ *  @return FSM_IDLE once the speed is within the deadband, otherwise FSM_ACCEL.
+ */
+FsmState SpeedFsm::check_accel(FsmOutput& out)
+{
+    (void)out;
+    if (rpm_abs(actual - command) <= deadband)
+    {
+        return FSM_IDLE;
+    }
+    return FSM_ACCEL;
+}
+
+
+
+/** @brief A handler which checks whether braking has slowed the motor enough
+ *
+ *  @details Without a direction change the brake is released once the speed is within
+ *  the deadband of the command, and the command goes straight to CLKIN. If braking has
+ *  already taken the speed further below the command, CLKIN is ramped back up instead.
+ *  With a direction change the brake stays on until the speed is within the deadband of
+ *  zero, then DIR is reversed, the brake is released and CLKIN is ramped to the command.
+ *
+ *  @param out Filled in with the outputs.
+ *
+ *  @return The next state.
+ */
+FsmState SpeedFsm::check_decel(FsmOutput& out)
+{
+    if (sign(command) == sign(actual))
+    {
+        if (rpm_abs(actual) > rpm_abs(command) + deadband)
+        {
+            return FSM_DECEL;
+        }
+
+        out.actions |= FSM_OUT_UNBRAKE;
+        braking = false;
+        out.speed = rpm_abs(command);
+
+        if (rpm_abs(actual) < rpm_abs(command) - deadband)
+        {
+            out.actions |= FSM_OUT_RAMP;
+            return FSM_ACCEL;
+        }
+        out.actions |= FSM_OUT_SET;
+        return FSM_IDLE;
+    }
+
+    if (rpm_abs(actual) >= deadband)
+    {
+        return FSM_DECEL;
+    }
+
+    // zero crossing
+    dir = (command < 0);
+    out.dir = dir;
+    out.actions |= FSM_OUT_DIR | FSM_OUT_UNBRAKE | FSM_OUT_RAMP;
+    braking = false;
+    out.speed = rpm_abs(command);
+    return FSM_ACCEL;
+}
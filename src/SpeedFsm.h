@@ -0,0 +1,126 @@
+/** @file SpeedFsm.h
+ *  This file contains the SpeedFsm class, the state machine which decides how to drive
+ *  the motor toward a commanded speed. It is table driven: each state has a handler for
+ *  each event, and a handler returns the next state along with the outputs to apply.
+ *  The class only calculates; the speedControl task applies the outputs to the Driver,
+ *  so the machine can be run on a PC against a recorded list of events.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _SPEEDFSM_H_
+#define _SPEEDFSM_H_
+
+#include <stdint.h>
+#include "SpeedType.h"
+
+/** The states of the speed state machine */
+enum FsmState
+{
+    FSM_IDLE,           // the speed is within the deadband of the command
+    FSM_ACCEL,          // CLKIN is ramping to the command and the DRV8308 loop is driving
+    FSM_DECEL,          // CLKIN is at zero and the brake is on
+    FSM_STATES          // number of states
+};
+
+/** The events which drive the speed state machine */
+enum FsmEvent
+{
+    EV_SPEED_UPDATED,   // readActual has put a new speed in speed_actual
+    EV_NEW_COMMAND,     // a new speed command has arrived
+    EV_TIMEOUT,         // no event arrived within the timeout while a transition is running
+    FSM_EVENTS          // number of events
+};
+
+// Output bits, applied by the speedControl task in this order
+#define FSM_OUT_STOP    0x01    // command zero speed on CLKIN
+#define FSM_OUT_BRAKE   0x02    // set the brake
+#define FSM_OUT_DIR     0x04    // set DIR to FsmOutput::dir
+#define FSM_OUT_UNBRAKE 0x08    // release the brake
+#define FSM_OUT_SET     0x10    // command FsmOutput::speed on CLKIN immediately
+#define FSM_OUT_RAMP    0x20    // ramp CLKIN to FsmOutput::speed
+
+/** The outputs produced by one event */
+struct FsmOutput
+{
+    uint8_t actions;    // FSM_OUT_ bits to apply
+    bool dir;           // new DIR polarity, HIGH (true) = negative
+    rpm_t speed;        // speed magnitude for FSM_OUT_SET or FSM_OUT_RAMP
+};
+
+/** This class is used to decide how to drive the motor toward the commanded speed */
+class SpeedFsm
+{
+    protected:
+
+        /** A handler for one event in one state, which returns the next state */
+        typedef FsmState (SpeedFsm::*Handler)(FsmOutput& out);
+
+        static const Handler table[FSM_STATES][FSM_EVENTS];    // handler for each state and event
+
+        FsmState state;         // current state
+        rpm_t command;          // latest commanded speed
+        rpm_t actual;           // latest measured speed
+        bool dir;               // DIR polarity last commanded, HIGH (true) = negative
+        bool braking;           // true while the brake is on
+        rpm_t deadband;         // how close to the command counts as reached
+
+        FsmState ignore(FsmOutput& out);
+        FsmState start(FsmOutput& out);
+        FsmState check_accel(FsmOutput& out);
+        FsmState check_decel(FsmOutput& out);
+
+    public:
+
+        /** Non-inline functions are commented in SpeedFsm.cpp */
+        SpeedFsm(rpm_t deadband_);
+
+        FsmOutput dispatch(FsmEvent event);
+        bool holds(rpm_t command_);
+
+
+
+        /** @brief A function which records a new speed command
+         *
+         *  @param command_ The commanded speed; dispatch EV_NEW_COMMAND to act on it.
+         */
+        void set_command(rpm_t command_)
+        {
+            command = command_;
+        }
+
+
+
+        /** @brief A function which records a new speed measurement
+         *
+         *  @param actual_ The measured speed; dispatch EV_SPEED_UPDATED to act on it.
+         */
+        void set_actual(rpm_t actual_)
+        {
+            actual = actual_;
+        }
+
+
+
+        /** @brief A function which returns the current state
+         *
+         *  @return The state after the last event.
+         */
+        FsmState get_state(void)
+        {
+            return state;
+        }
+
+
+
+        /** @brief A function which returns the commanded direction
+         *
+         *  @return The DIR polarity, HIGH (true) = negative.
+         */
+        bool get_dir(void)
+        {
+            return dir;
+        }
+};
+
+#endif
@@ -0,0 +1,160 @@
+/** @file SpeedPid.cpp
+ *  This file contains the SpeedPid class, an outer discrete PID speed loop which trims the
+ *  CLKIN frequency and brake duty cycle from the measured speed.
+*/
+
+#include "SpeedPid.h"
+
+
+
+/** @brief Constructor for the SpeedPid class
+ *
+ *  @details The gains start at a pure feedforward (CLKIN equals the command), so the loop
+ *  does nothing until set_gains() is called.
+ *
+ *  @param dt_ The time between calls to update() in seconds.
+ *  @param limit_ The largest correction the loop may add to or take from the command, in RPM.
+ *  @param tau_d_ The time constant of the low-pass filter on the derivative, in seconds.
+ *  Speed updates arrive in steps every few ms, so the unfiltered derivative is a train of spikes.
+ */
+SpeedPid::SpeedPid(float dt_, float limit_, float tau_d_)
+{
+    gains.kp = 0.0f;
+    gains.ki = 0.0f;
+    gains.kd = 0.0f;
+    gains.kff = 1.0f;
+    dt = 0.005f;
+    tau_d = (tau_d_ > 0.0f) ? tau_d_ : 0.0f;
+    set_period(dt_);
+    set_limit(limit_);
+    set_brake(50.0f, 0.01f);
+    reset(0);
+}
+
+
+
+/** @brief A function which changes the gains
+ *
+ *  @details The integral term is kept, so the CLKIN command does not jump when a gain is
+ *  changed while the loop is running.
+ *
+ *  @param gains_ The new gains; negative values are treated as zero.
+ */
+void SpeedPid::set_gains(const PidGains& gains_)
+{
+    gains.kp = (gains_.kp > 0.0f) ? gains_.kp : 0.0f;
+    gains.ki = (gains_.ki > 0.0f) ? gains_.ki : 0.0f;
+    gains.kd = (gains_.kd > 0.0f) ? gains_.kd : 0.0f;
+    gains.kff = (gains_.kff > 0.0f) ? gains_.kff : 0.0f;
+}
+
+
+
+/** @brief A function which changes the time between steps
+ *
+ *  @param dt_ The time between calls to update() in seconds; values that are not positive
+ *  are ignored.
+ */
+void SpeedPid::set_period(float dt_)
+{
+    if (dt_ > 0.0f)
+    {
+        dt = dt_;
+    }
+}
+
+
+
+/** @brief A function which changes the largest correction
+ *
+ *  @param limit_ The largest correction added to or taken from the command, in RPM.
+ */
+void SpeedPid::set_limit(float limit_)
+{
+    limit = (limit_ > 0.0f) ? limit_ : 0.0f;
+}
+
+
+
+/** @brief A function which sets how the brake is used for large negative corrections
+ *
+ *  @details The DRV8308 loop cannot slow the wheel, so when the loop wants CLKIN more than
+ *  brake_start_ below the command the brake is applied in proportion to the rest.
+ *
+ *  @param brake_start_ The correction in RPM at which the brake starts to be applied.
+ *  @param brake_gain_ The brake duty cycle per RPM of correction past brake_start_, or zero
+ *  to never brake.
+ */
+void SpeedPid::set_brake(float brake_start_, float brake_gain_)
+{
+    brake_start = (brake_start_ > 0.0f) ? brake_start_ : 0.0f;
+    brake_gain = (brake_gain_ > 0.0f) ? brake_gain_ : 0.0f;
+}
+
+
+
+/** @brief A function which restarts the loop without a bump
+ *
+ *  @details This is called when the loop takes over from the state machine. The integral
+ *  is cleared and the derivative starts from the measured speed, so the first step only
+ *  adds the proportional correction to the feedforward.
+ *
+ *  @param measured The measured speed.
+ */
+void SpeedPid::reset(rpm_t measured)
+{
+    integral = 0.0f;
+    deriv = 0.0f;
+    last_meas = rpm_to_float(measured);
+}
+
+
+
+/** @brief A function which runs one step of the loop
+ *
+ *  @details The correction is kp e + integral - kd dw/dt, where the derivative is taken on
+ *  the measurement rather than the error so a new command gives no kick, and filtered with
+ *  the time constant tau_d. The correction is limited to +/- limit; when it is, the integral
+ *  is pulled back by the excess (back-calculation), so it cannot wind up while the wheel
+ *  cannot follow. CLKIN is the feedforward kff * command plus the correction, never crossing
+ *  zero, and a correction toward zero larger than brake_start also applies the brake.
+ *
+ *  @param command The commanded speed.
+ *  @param measured The measured speed.
+ *
+ *  @return The CLKIN speed and brake duty cycle to apply.
+ */
+PidOutput SpeedPid::update(rpm_t command, rpm_t measured)
+{
+    float cmd = rpm_to_float(command);
+    float meas = rpm_to_float(measured);
+    float error = cmd - meas;
+
+    // filtered derivative of the measurement
+    float rate = (meas - last_meas) / dt;
+    deriv += (dt / (tau_d + dt)) * (rate - deriv);
+    last_meas = meas;
+
+    // integrate, then limit the correction and take the excess back out of the integral
+    integral += gains.ki * error * dt;
+    float wanted = gains.kp * error + integral - gains.kd * deriv;
+    float correction = wanted;
+    if (correction > limit)  correction = limit;
+    if (correction < -limit) correction = -limit;
+    integral += correction - wanted;
+
+    // the correction is applied in the direction of the command
+    float toward = (cmd < 0.0f) ? -correction : correction;
+    float speed = gains.kff * ((cmd < 0.0f) ? -cmd : cmd) + toward;
+    if (speed < 0.0f) speed = 0.0f;
+
+    PidOutput out;
+    out.clkin = rpm_from_float((cmd < 0.0f) ? -speed : speed);
+    out.brake = 0.0f;
+    if (-toward > brake_start)
+    {
+        out.brake = (-toward - brake_start) * brake_gain;
+        if (out.brake > 1.0f) out.brake = 1.0f;
+    }
+    return out;
+}
@@ -0,0 +1,83 @@
+/** @file SpeedPid.h
+ *  This file contains the SpeedPid class, an outer discrete PID speed loop which trims the
+ *  CLKIN frequency, and the brake duty cycle when the wheel is too fast, so the measured
+ *  speed settles on the command. The DRV8308 loop alone leaves a steady error that depends
+ *  on the load, and the speedControl state machine stops correcting inside its deadband.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _SPEEDPID_H_
+#define _SPEEDPID_H_
+
+#include <stdint.h>
+#include "SpeedType.h"
+
+/** Gains of the SpeedPid loop, which can be changed while it runs */
+struct PidGains
+{
+    float kp;               // proportional gain, RPM of CLKIN per RPM of error
+    float ki;               // integral gain, RPM of CLKIN per RPM*s of error
+    float kd;               // derivative gain, RPM of CLKIN per RPM/s of measured acceleration
+    float kff;              // feedforward gain from the command to CLKIN, normally 1
+};
+
+/** Outputs of one SpeedPid step */
+struct PidOutput
+{
+    rpm_t clkin;            // speed to command on CLKIN, with the sign of the command
+    float brake;            // brake duty cycle, 0 to 1
+};
+
+/** This class is used to correct the CLKIN command from the measured speed */
+class SpeedPid
+{
+    protected:
+
+        PidGains gains;             // current gains
+        float dt;                   // time between steps in seconds
+        float tau_d;                // time constant of the derivative filter in seconds
+        float limit;                // largest correction added to the feedforward, in RPM
+        float brake_start;          // correction below which the brake starts to be used, in RPM
+        float brake_gain;           // brake duty per RPM of correction past brake_start
+
+        float integral;             // integral term in RPM
+        float deriv;                // filtered rate of change of the measured speed in RPM/s
+        float last_meas;            // measured speed at the previous step in RPM
+
+    public:
+
+        /** Non-inline functions are commented in SpeedPid.cpp */
+        SpeedPid(float dt_ = 0.005f, float limit_ = 200.0f, float tau_d_ = 0.02f);
+
+        void set_gains(const PidGains& gains_);
+        void set_period(float dt_);
+        void set_limit(float limit_);
+        void set_brake(float brake_start_, float brake_gain_);
+        void reset(rpm_t measured);
+        PidOutput update(rpm_t command, rpm_t measured);
+
+
+
+        /** @brief A function which returns the current gains
+         *
+         *  @return The gains set with set_gains().
+         */
+        PidGains get_gains(void)
+        {
+            return gains;
+        }
+
+
+
+        /** @brief A function which returns the integral term
+         *
+         *  @return The correction the integral term is adding to CLKIN, in RPM.
+         */
+        float get_integral(void)
+        {
+            return integral;
+        }
+};
+
+#endif
@@ -0,0 +1,129 @@
+/** @file SpeedRamp.cpp
+ *  This file contains the SpeedRamp class, which moves the commanded speed toward a
+ *  target with limited acceleration and jerk.
+*/
+
+#include <math.h>
+#include "SpeedRamp.h"
+
+
+
+/** @brief Constructor for the SpeedRamp class
+ *
+ *  @param max_accel_ The acceleration limit in RPM/s.
+ *  @param max_jerk_ The jerk limit in RPM/s^2, or zero for an acceleration limit only.
+ *  @param dt_ The time between calls to step() in seconds.
+ */
+SpeedRamp::SpeedRamp(float max_accel_, float max_jerk_, float dt_)
+{
+    speed = 0.0f;
+    accel = 0.0f;
+    target = 0.0f;
+    set_limits(max_accel_, max_jerk_);
+    set_period(dt_);
+}
+
+
+
+/** @brief A function which changes the acceleration and jerk limits
+ *
+ *  @param max_accel_ The acceleration limit in RPM/s.
+ *  @param max_jerk_ The jerk limit in RPM/s^2, or zero for an acceleration limit only.
+ */
+void SpeedRamp::set_limits(float max_accel_, float max_jerk_)
+{
+    max_accel = (max_accel_ > 0.0f) ? max_accel_ : 1500.0f;
+    max_jerk = (max_jerk_ > 0.0f) ? max_jerk_ : 0.0f;
+}
+
+
+
+/** @brief A function which changes the time between steps
+ *
+ *  @param dt_ The time between calls to step() in seconds.
+ */
+void SpeedRamp::set_period(float dt_)
+{
+    dt = (dt_ > 0.0f) ? dt_ : 0.002f;
+}
+
+
+
+/** @brief A function which sets the speed the profile moves toward
+ *
+ *  @details The profile continues from its current speed and acceleration, so a new
+ *  target in the middle of a ramp does not make the acceleration jump.
+ *
+ *  @param target_ The new target speed.
+ */
+void SpeedRamp::set_target(rpm_t target_)
+{
+    target = rpm_to_float(target_);
+}
+
+
+
+/** @brief A function which moves the profile to a speed immediately
+ *
+ *  @details This is used when the speed is commanded directly, so the next ramp starts
+ *  from the speed actually on CLKIN.
+ *
+ *  @param speed_ The new speed, which also becomes the target.
+ */
+void SpeedRamp::reset(rpm_t speed_)
+{
+    speed = rpm_to_float(speed_);
+    target = speed;
+    accel = 0.0f;
+}
+
+
+
+/** @brief A function which advances the profile by one period
+ *
+ *  @details To stop exactly at the target with a jerk limit J, the acceleration has to
+ *  fall to zero as the remaining speed error e reaches zero, which means it can be at most
+ *  sqrt(2 J |e|). Each step the acceleration moves toward that value (limited to the
+ *  acceleration limit) by at most J dt, and the speed moves by the acceleration. If a step
+ *  would pass the target the profile stops on it.
+ *
+ *  @return The new speed of the profile.
+ */
+rpm_t SpeedRamp::step(void)
+{
+    float error = target - speed;
+
+    float want;
+    if (max_jerk > 0.0f)
+    {
+        want = sqrtf(2.0f * max_jerk * fabsf(error));
+        if (error < 0.0f) want = -want;
+    }
+    else
+    {
+        want = error / dt;
+    }
+    if (want > max_accel) want = max_accel;
+    if (want < -max_accel) want = -max_accel;
+
+    if (max_jerk > 0.0f)
+    {
+        float max_change = max_jerk * dt;
+        if (want > accel + max_change) want = accel + max_change;
+        if (want < accel - max_change) want = accel - max_change;
+    }
+    accel = want;
+
+    float next = speed + accel * dt;
+    if ((error >= 0.0f && next >= target) || (error <= 0.0f && next <= target))
+    {
+        speed = target;
+        accel = 0.0f;
+    }
+    else
+    {
+        speed = next;
+    }
+
+    return rpm_from_float(speed);
+}
@@ -0,0 +1,62 @@
+/** @file SpeedRamp.h
+ *  This file contains the SpeedRamp class, which moves the commanded speed toward a
+ *  target in small steps with limited acceleration and jerk. Stepping CLKIN straight to
+ *  a new speed saturates the DRV8308 speed loop, which draws current spikes and
+ *  overshoots; streaming a smooth profile keeps the loop in its linear range.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _SPEEDRAMP_H_
+#define _SPEEDRAMP_H_
+
+#include <stdint.h>
+#include "SpeedType.h"
+
+/** This class is used to generate an acceleration and jerk limited speed profile */
+class SpeedRamp
+{
+    protected:
+
+        float speed;                // current speed of the profile in RPM
+        float accel;                // current acceleration of the profile in RPM/s
+        float target;               // speed the profile is moving toward in RPM
+        float max_accel;            // acceleration limit in RPM/s
+        float max_jerk;             // jerk limit in RPM/s^2, zero for no limit
+        float dt;                   // time between steps in seconds
+
+    public:
+
+        /** Non-inline functions are commented in SpeedRamp.cpp */
+        SpeedRamp(float max_accel_ = 1500.0f, float max_jerk_ = 15000.0f, float dt_ = 0.002f);
+
+        void set_limits(float max_accel_, float max_jerk_);
+        void set_period(float dt_);
+        void set_target(rpm_t target_);
+        void reset(rpm_t speed_);
+        rpm_t step(void);
+
+
+
+        /** @brief A function which returns the current speed of the profile
+         *
+         *  @return The speed last returned by step().
+         */
+        rpm_t get_speed(void)
+        {
+            return rpm_from_float(speed);
+        }
+
+
+
+        /** @brief A function which reports whether the profile has reached its target
+         *
+         *  @return True once the speed equals the target and the acceleration is zero.
+         */
+        bool done(void)
+        {
+            return speed == target && accel == 0.0f;
+        }
+};
+
+#endif
@@ -0,0 +1,118 @@
+/** @file SpeedType.cpp
+ *  This file contains the conversions between FGOUT periods, rpm_t speeds and CLKIN
+ *  frequencies. In the default fixed-point build the divides are done with a reciprocal
+ *  lookup table and three Newton iterations, which only need 32x32 bit multiplies.
+*/
+
+#include "SpeedType.h"
+
+
+
+/** Reciprocal seeds in Q30 for a divisor normalized to [0.5, 1), indexed by the four bits
+ *  after the leading one. Each entry is 1 / the middle of its interval.
+ */
+static const uint32_t RECIP_SEED[16] =
+{
+    2082408386, 1963413621, 1857283155, 1762037865, 1676084798, 1598127366, 1527099483, 1462116526,
+    1402438301, 1347440720, 1296593901, 1249445032, 1205604855, 1164736894, 1126548799, 1090785345
+};
+
+
+
+/** @brief Function which divides two unsigned numbers without a divide instruction
+ *
+ *  @details The divisor is shifted so its leading one is at bit 31, giving a value D in
+ *  [0.5, 1). A 16 entry table gives 1/D to about 5 bits and each Newton step
+ *  R = R * (2 - D * R) doubles the number of correct bits. Two steps only reach about
+ *  20 bits, which is over a hundred counts of the Q16.16 result at 2500 RPM, so a third
+ *  step takes it to the 29 or so bits the Q30 reciprocal can hold, within a count or two.
+ *
+ *  @param num The numerator.
+ *  @param den The denominator, which must not be zero.
+ *  @param shift Number of fractional bits in the result.
+ *
+ *  @return (num * 2^shift) / den, saturated to UINT32_MAX.
+ */
+uint32_t fx_div(uint32_t num, uint32_t den, uint8_t shift)
+{
+    if (den == 0)
+    {
+        return UINT32_MAX;
+    }
+
+    // normalize the divisor so that D = d_norm / 2^32 is in [0.5, 1)
+    uint8_t n = (uint8_t)__builtin_clz(den);
+    uint32_t d_norm = den << n;
+
+    // reciprocal of D in Q30, seeded from the table and refined three times
+    uint32_t r = RECIP_SEED[(d_norm >> 27) & 0x0F];
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        uint32_t e = (uint32_t)(((uint64_t)d_norm * r) >> 32);        // D * R in Q30
+        r = (uint32_t)(((uint64_t)r * ((1u << 31) - e)) >> 30);       // R * (2 - D * R) in Q30
+    }
+
+    // num / den = num * R * 2^n / 2^62, then scale by 2^shift
+    int8_t s = 62 - (int8_t)n - (int8_t)shift;
+    uint64_t product = (uint64_t)num * r;
+    if (s <= 0)
+    {
+        return (product == 0) ? 0 : UINT32_MAX;
+    }
+    uint64_t result = (s >= 64) ? 0 : (product >> s);
+    return (result > UINT32_MAX) ? UINT32_MAX : (uint32_t)result;
+}
+
+
+
+/** @brief Function which calculates the speed from a span of FGOUT periods
+ *
+ *  @details From the DRV8308 datasheet the electrical frequency on FGOUT is RPM / 15,
+ *  so the speed is 15 s * edges / span.
+ *
+ *  @param span_ticks The time covered by the periods, in capture ticks.
+ *  @param edges The number of whole periods in the span.
+ *  @param ticks_per_us The tick rate of the capture backend.
+ *
+ *  @return The speed magnitude, or zero if the span is zero.
+ */
+rpm_t rpm_from_span(uint32_t span_ticks, uint16_t edges, uint32_t ticks_per_us)
+{
+    if (span_ticks == 0 || edges == 0)
+    {
+        return 0;
+    }
+
+#ifndef RPM_FLOAT
+    // speed of one period in Q16.16, then scaled by the number of periods
+    uint32_t per_edge = fx_div(15000000u * ticks_per_us, span_ticks, RPM_FRAC_BITS);
+    uint64_t speed = (uint64_t)per_edge * edges;
+    return (speed > INT32_MAX) ? INT32_MAX : (rpm_t)speed;
+#else
+    return 15.0e6f * (float)ticks_per_us * (float)edges / (float)span_ticks;
+#endif
+}
+
+
+
+/** @brief Function which converts a speed to the CLKIN frequency that commands it
+ *
+ *  @details From the DRV8308 datasheet the electrical frequency is RPM / 15. Dividing
+ *  by 15 is done as a multiply by 2^32 / 15 in the fixed-point build.
+ *
+ *  @param speed The commanded speed; the sign is ignored.
+ *
+ *  @return The CLKIN frequency in millihertz.
+ */
+uint32_t rpm_to_clkin_mhz(rpm_t speed)
+{
+    speed = rpm_abs(speed);
+
+#ifndef RPM_FLOAT
+    // mHz = rpm * 1000 / 15, with rpm in Q16.16 and 2^32 / 15 = 286331153.07
+    uint64_t hz_q16 = ((uint64_t)(uint32_t)speed * 286331153u) >> 32;
+    return (uint32_t)((hz_q16 * 1000u + (1u << (RPM_FRAC_BITS - 1))) >> RPM_FRAC_BITS);
+#else
+    return (uint32_t)(speed * (1000.0f / 15.0f) + 0.5f);
+#endif
+}
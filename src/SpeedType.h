@@ -0,0 +1,80 @@
+/** @file SpeedType.h
+ *  This file contains the rpm_t type which carries motor speeds through the control path,
+ *  from the FGOUT edge timestamps to the CLKIN command. By default rpm_t is a Q16.16
+ *  fixed-point number of RPM and the period-to-speed divide is done with a reciprocal
+ *  lookup table and Newton iteration, so no float divide is needed per edge. Building
+ *  with -DRPM_FLOAT selects a plain float instead.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _SPEEDTYPE_H_
+#define _SPEEDTYPE_H_
+
+#include <stdint.h>
+
+#ifndef RPM_FLOAT
+
+// Number of fractional bits in a fixed-point speed
+#define RPM_FRAC_BITS 16
+
+/** A motor speed in RPM, stored as Q16.16 fixed point (range +/-32767 RPM, step 15 uRPM) */
+typedef int32_t rpm_t;
+
+/** @brief Function which converts a speed in RPM to rpm_t
+ *  @param rpm The speed in RPM.
+ *  @return The speed as rpm_t, rounded to the nearest step.
+ */
+inline rpm_t rpm_from_float(float rpm)
+{
+    return (rpm_t)(rpm * (float)(1L << RPM_FRAC_BITS) + ((rpm >= 0.0f) ? 0.5f : -0.5f));
+}
+
+/** @brief Function which converts rpm_t to a speed in RPM
+ *  @param speed The speed as rpm_t.
+ *  @return The speed in RPM.
+ */
+inline float rpm_to_float(rpm_t speed)
+{
+    return (float)speed * (1.0f / (float)(1L << RPM_FRAC_BITS));
+}
+
+#else
+
+/** A motor speed in RPM, stored as a float */
+typedef float rpm_t;
+
+/** @brief Function which converts a speed in RPM to rpm_t
+ *  @param rpm The speed in RPM.
+ *  @return The speed as rpm_t.
+ */
+inline rpm_t rpm_from_float(float rpm)
+{
+    return rpm;
+}
+
+/** @brief Function which converts rpm_t to a speed in RPM
+ *  @param speed The speed as rpm_t.
+ *  @return The speed in RPM.
+ */
+inline float rpm_to_float(rpm_t speed)
+{
+    return speed;
+}
+
+#endif
+
+/** @brief Function which returns the magnitude of a speed
+ *  @param speed The speed as rpm_t.
+ *  @return The absolute value of speed.
+ */
+inline rpm_t rpm_abs(rpm_t speed)
+{
+    return (speed < 0) ? -speed : speed;
+}
+
+uint32_t fx_div(uint32_t num, uint32_t den, uint8_t shift);
+rpm_t rpm_from_span(uint32_t span_ticks, uint16_t edges, uint32_t ticks_per_us);
+uint32_t rpm_to_clkin_mhz(rpm_t speed);
+
+#endif
@@ -0,0 +1,46 @@
+/** @file SpiBus.h
+ *  This file contains the interface between the DRV8308 register code and the SPI bus. The
+ *  firmware implements it with the ESP32 VSPI peripheral (DrvSpiBus.h), and the host tests
+ *  implement it with a mock which records every transaction, so the frames sent to the chip
+ *  can be checked on a PC.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _SPIBUS_H_
+#define _SPIBUS_H_
+
+#include <stdint.h>
+
+/** This class is an SPI bus with one chip on it, seen as transactions made of frames.
+ *
+ *  @details A transaction holds the bus with the chip's clock and mode. Each frame is sent
+ *  with chip select active, and between two frames of one transaction chip select is held
+ *  inactive for the time the chip needs.
+ */
+class SpiBus
+{
+    public:
+
+        /** @brief A function which takes the bus with the clock and mode of the chip */
+        virtual void begin_transaction(void) = 0;
+
+        /** @brief A function which gives up the bus at the end of a transaction */
+        virtual void end_transaction(void) = 0;
+
+        /** @brief A function which sends one frame with chip select active
+         *
+         *  @param tx The bytes to send.
+         *  @param rx Filled in with the bytes received, or NULL if they are not needed.
+         *  @param length The number of bytes in the frame.
+         */
+        virtual void frame(const uint8_t* tx, uint8_t* rx, uint8_t length) = 0;
+
+        /** @brief A function which holds chip select inactive between two frames */
+        virtual void frame_gap(void) = 0;
+
+        /** @brief Destructor, so implementations can be deleted through this interface */
+        virtual ~SpiBus(void) {}
+};
+
+#endif
@@ -0,0 +1,141 @@
+/** @file SpscRing.h
+ *  This file contains a wait-free ring buffer for passing data from exactly one producer
+ *  (for example an ISR) to exactly one consumer task. Unlike a FreeRTOS queue, putting an
+ *  item in the ring never enters a kernel critical section, and items which do not fit are
+ *  counted instead of being dropped silently.
+ *
+ *  The ring only uses std::atomic, so it can be compiled and stress tested on a PC.
+*/
+
+#ifndef _SPSCRING_H_
+#define _SPSCRING_H_
+
+#include <stdint.h>
+#include <atomic>
+
+// On the ESP32 push() is called from ISRs which run while the flash cache is off, so it is
+// always inlined into them and any copy of it the compiler keeps is placed in IRAM
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#define SPSC_ISR_ATTR IRAM_ATTR __attribute__((always_inline))
+#else
+#define SPSC_ISR_ATTR
+#endif
+
+/** This class is a single-producer/single-consumer ring buffer.
+ *
+ *  @tparam T The type of item stored in the ring; it should be small and trivially copyable.
+ *  @tparam N The number of slots in the ring. Must be a power of two.
+ */
+template <typename T, uint32_t N>
+class SpscRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+    protected:
+
+        T buffer[N];                            // storage for the items in the ring
+        std::atomic<uint32_t> head;             // total number of items ever written (producer only)
+        std::atomic<uint32_t> tail;             // total number of items ever read (consumer only)
+        std::atomic<uint32_t> overflow_count;   // number of items rejected because the ring was full
+
+    public:
+
+        /** @brief Constructor which creates an empty ring */
+        SpscRing(void)
+            : head(0), tail(0), overflow_count(0)
+        {
+        }
+
+
+
+        /** @brief A function which puts an item into the ring
+         *
+         *  @details Only the producer may call this function. It never blocks; if the ring
+         *  is full the item is discarded and the overflow counter is incremented, so the
+         *  oldest unread items are kept in order.
+         *
+         *  @param item The item to copy into the ring.
+         *
+         *  @return True if the item was stored, false if the ring was full.
+         */
+        SPSC_ISR_ATTR bool push(const T& item)
+        {
+            uint32_t h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) >= N)
+            {
+                overflow_count.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            buffer[h & (N - 1)] = item;
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+
+
+        /** @brief A function which takes the oldest item out of the ring
+         *
+         *  @details Only the consumer may call this function. It never blocks.
+         *
+         *  @param item Filled in with the oldest item if one is available.
+         *
+         *  @return True if an item was read, false if the ring was empty.
+         */
+        bool pop(T& item)
+        {
+            uint32_t t = tail.load(std::memory_order_relaxed);
+            if (head.load(std::memory_order_acquire) == t)
+            {
+                return false;
+            }
+            item = buffer[t & (N - 1)];
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+
+
+        /** @brief A function which copies the oldest item without taking it out of the ring
+         *
+         *  @details Only the consumer may call this function. It never blocks.
+         *
+         *  @param item Filled in with the oldest item if one is available.
+         *
+         *  @return True if an item was copied, false if the ring was empty.
+         */
+        bool peek(T& item)
+        {
+            uint32_t t = tail.load(std::memory_order_relaxed);
+            if (head.load(std::memory_order_acquire) == t)
+            {
+                return false;
+            }
+            item = buffer[t & (N - 1)];
+            return true;
+        }
+
+
+
+        /** @brief A function which returns how many items are waiting in the ring
+         *
+         *  @return The number of unread items. This is exact when called by the consumer.
+         */
+        uint32_t available(void)
+        {
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+        }
+
+
+
+        /** @brief A function which returns how many items have been rejected
+         *
+         *  @return The number of push() calls that found the ring full since startup.
+         */
+        uint32_t overflows(void)
+        {
+            return overflow_count.load(std::memory_order_relaxed);
+        }
+};
+
+#endif
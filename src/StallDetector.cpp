@@ -0,0 +1,119 @@
+/** @file StallDetector.cpp
+ *  This file contains the StallDetector class, which brings the measured speed down to
+ *  zero when FGOUT stops producing edges.
+*/
+
+#include "StallDetector.h"
+
+
+
+/** @brief Constructor for the StallDetector class
+ *
+ *  @param margin_ How many of the periods implied by the last speed to wait for an edge,
+ *  beyond the batch of edges set with set_batch(), before the speed starts to decay.
+ *  @param growth_ The ratio between the elapsed times of successive checks once the speed
+ *  is decaying. Each check lowers the reported speed by this ratio.
+ *  @param zero_rpm_ The speed below which zero is reported and the checks stop. The
+ *  DRV8308 commutation timer cannot run the motor below about 23 RPM, so 10 RPM is
+ *  well below any real speed.
+ */
+StallDetector::StallDetector(float margin_, float growth_, float zero_rpm_)
+{
+    last_edge_us = 0;
+    last_rpm = 0;
+    margin = margin_;
+    batch = 1;
+    growth = (growth_ > 1.0f) ? growth_ : 1.25f;
+    zero_rpm = rpm_from_float(zero_rpm_);
+    stalled = true;
+}
+
+
+
+/** @brief A function which records a new speed measurement
+ *
+ *  @details The deadline for the next edge runs from the time the latest edge arrived,
+ *  not from the time it was processed, so a task which was slow to drain a batch does not
+ *  push the deadline out. It is the batch size plus the margin in periods implied by the
+ *  speed, since the next batch cannot be seen any sooner.
+ *
+ *  @param edge_us The time at which the latest edge arrived, in microseconds.
+ *  @param now_us The current time in microseconds.
+ *  @param rpm The measured speed in RPM.
+ *
+ *  @return How long from now to wait for the next edge before calling expire(), in
+ *  microseconds; at least 1 if the deadline has already passed.
+ */
+uint32_t StallDetector::edge(uint64_t edge_us, uint64_t now_us, rpm_t rpm)
+{
+    last_edge_us = edge_us;
+    last_rpm = rpm;
+    stalled = false;
+
+    rpm_t speed = rpm_abs(rpm);
+    if (speed < zero_rpm)
+    {
+        speed = zero_rpm;
+    }
+
+    // the period implied by the speed is 15 s / rpm, this only runs once per measurement
+    float wait_us = ((float)batch + margin) * 15.0e6f / rpm_to_float(speed);
+    uint64_t deadline_us = edge_us + (uint64_t)wait_us;
+    if (deadline_us <= now_us)
+    {
+        return 1;
+    }
+    return (deadline_us - now_us > UINT32_MAX) ? UINT32_MAX : (uint32_t)(deadline_us - now_us);
+}
+
+
+
+/** @brief A function which decays the speed because no edge arrived in time
+ *
+ *  @details If no edge has arrived for t seconds the wheel cannot be turning faster than
+ *  15 / t RPM, or another edge would have been seen. The reported speed is the smaller
+ *  of that bound and the last measurement, keeping its sign, so it follows a 1/t curve
+ *  down to zero_rpm and then reports zero.
+ *
+ *  @param now_us The current time in microseconds.
+ *  @param rpm Filled in with the speed to report.
+ *
+ *  @return How long to wait before calling expire() again, in microseconds, or zero
+ *  once zero speed has been reported.
+ */
+uint32_t StallDetector::expire(uint64_t now_us, rpm_t& rpm)
+{
+    if (stalled)
+    {
+        rpm = 0;
+        return 0;
+    }
+
+    uint64_t elapsed_us = now_us - last_edge_us;
+    if (elapsed_us == 0)
+    {
+        elapsed_us = 1;
+    }
+    else if (elapsed_us > UINT32_MAX)
+    {
+        elapsed_us = UINT32_MAX;
+    }
+
+    // the fastest the wheel can be turning is one period in the elapsed time
+    rpm_t bound = rpm_from_span((uint32_t)elapsed_us, 1, 1);
+    if (bound < zero_rpm)
+    {
+        stalled = true;
+        rpm = 0;
+        return 0;
+    }
+
+    rpm_t speed = rpm_abs(last_rpm);
+    if (bound < speed)
+    {
+        speed = bound;
+    }
+    rpm = (last_rpm < 0) ? -speed : speed;
+
+    return (uint32_t)((growth - 1.0f) * (float)elapsed_us);
+}
@@ -0,0 +1,64 @@
+/** @file StallDetector.h
+ *  This file contains the StallDetector class, which brings the measured speed down to
+ *  zero when FGOUT stops producing edges. The speed is only calculated when an edge
+ *  arrives, so without this the last nonzero speed would be reported forever after the
+ *  wheel stops.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _STALLDETECTOR_H_
+#define _STALLDETECTOR_H_
+
+#include <stdint.h>
+#include "SpeedType.h"
+
+/** This class is used to decay the measured speed when no edges arrive */
+class StallDetector
+{
+    protected:
+
+        uint64_t last_edge_us;      // time at which the latest edge arrived
+        rpm_t last_rpm;             // latest speed measured from the edges
+        float margin;               // how many expected periods to wait beyond a batch before decaying
+        uint16_t batch;             // number of edges the capture backend passes on at a time
+        float growth;               // ratio between successive checks once decaying
+        rpm_t zero_rpm;             // speed below which zero is reported
+        bool stalled;               // true once zero has been reported
+
+    public:
+
+        /** Non-inline functions are commented in StallDetector.cpp */
+        StallDetector(float margin_ = 0.5f, float growth_ = 1.25f, float zero_rpm_ = 10.0f);
+
+        uint32_t edge(uint64_t edge_us, uint64_t now_us, rpm_t rpm);
+        uint32_t expire(uint64_t now_us, rpm_t& rpm);
+
+
+
+        /** @brief A function which sets how many edges arrive between wakeups of the task
+         *
+         *  @details Edges are only passed on in batches, so the next one is not seen until
+         *  this many periods after the latest one, and no stall is declared before then.
+         *
+         *  @param edges The number of edges per batch (at least 1).
+         */
+        void set_batch(uint16_t edges)
+        {
+            batch = (edges == 0) ? 1 : edges;
+        }
+
+
+
+        /** @brief A function which reports whether zero speed has been reported
+         *
+         *  @return True if the last call to expire() reported zero speed and no edge has
+         *  arrived since.
+         */
+        bool is_stalled(void)
+        {
+            return stalled;
+        }
+};
+
+#endif
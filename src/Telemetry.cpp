@@ -0,0 +1,147 @@
+/** @file Telemetry.cpp
+ *  This file contains the TelemetryEvent class, which formats telemetry samples into
+ *  Server-Sent Events messages, and the function which formats them as CSV rows.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "Telemetry.h"
+
+// Longest text of one sample, from ";4294967295," to the brake duty cycle
+#define SAMPLE_TEXT_MAX 80
+
+
+
+/** @brief Constructor for the TelemetryEvent class
+ *
+ *  @param rate_hz The most samples per second to send, or zero to send every sample.
+ */
+TelemetryEvent::TelemetryEvent(uint32_t rate_hz)
+{
+    buffer = NULL;
+    size = 0;
+    used = 0;
+    count = 0;
+    set_rate(rate_hz);
+}
+
+
+
+/** @brief A function which sets the most samples per second to send
+ *
+ *  @param rate_hz The most samples per second to send, or zero to send every sample.
+ */
+void TelemetryEvent::set_rate(uint32_t rate_hz)
+{
+    interval_us = (rate_hz == 0) ? 0 : 1000000 / rate_hz;
+    next_us = 0;
+    started = false;
+}
+
+
+
+/** @brief A function which starts a new message
+ *
+ *  @param buffer_ The buffer to format the message into. It must hold at least 100 bytes.
+ *  @param size_ The size of the buffer in bytes.
+ *  @param now_us The time at which the message is being sent, in microseconds.
+ */
+void TelemetryEvent::begin(char* buffer_, size_t size_, uint32_t now_us)
+{
+    buffer = buffer_;
+    size = size_;
+    count = 0;
+    int len = snprintf(buffer, size, "data: %lu", (unsigned long)now_us);
+    used = (len > 0 && (size_t)len < size) ? (size_t)len : 0;
+}
+
+
+
+/** @brief A function which adds a sample to the message
+ *
+ *  @details A sample which comes sooner than the rate allows after the last one sent is
+ *  skipped, which counts as success. The comparison of times is safe across wraparound.
+ *
+ *  @param sample The sample to add.
+ *
+ *  @return True if the sample was added or skipped, false if the message is full. The
+ *  sample is not counted as sent, so it can be added again to the next message.
+ */
+bool TelemetryEvent::add(const TelemetrySample& sample)
+{
+    if (started && (int32_t)(sample.t_us - next_us) < 0)
+    {
+        return true;
+    }
+
+    // leave room for the blank line which ends the message
+    if (buffer == NULL || used + SAMPLE_TEXT_MAX + 2 > size)
+    {
+        return false;
+    }
+
+    int len = snprintf(buffer + used, size - used, ";%lu,%.1f,%.1f,%.1f,%u,%u,%u",
+                       (unsigned long)sample.t_us, rpm_to_float(sample.actual),
+                       rpm_to_float(sample.raw), rpm_to_float(sample.command),
+                       (unsigned)sample.state, (unsigned)sample.flags, (unsigned)sample.brake);
+    if (len <= 0 || used + (size_t)len + 2 >= size)
+    {
+        buffer[used] = '\0';
+        return false;
+    }
+    used += len;
+    count++;
+
+    next_us = sample.t_us + interval_us;
+    started = true;
+    return true;
+}
+
+
+
+/** @brief A function which ends the message
+ *
+ *  @return The length of the message text in bytes, or zero if no samples were added, in
+ *  which case nothing needs to be sent.
+ */
+size_t TelemetryEvent::finish(void)
+{
+    if (count == 0 || buffer == NULL)
+    {
+        return 0;
+    }
+    memcpy(buffer + used, "\n\n", 3);
+    used += 2;
+    return used;
+}
+
+
+
+/** @brief Function which formats one sample as a row of the CSV export
+ *
+ *  @details The columns are named by TELEMETRY_CSV_HEADER. The speeds are in RPM with three
+ *  decimals, the state is the name of the FsmState, and the event column says whether the row
+ *  is a speed measurement, a new command or a state transition. The last two columns are the
+ *  command profile being played and its step, both zero when no profile is playing.
+ *
+ *  @param buffer The buffer to format the row into.
+ *  @param size The size of the buffer; 112 bytes always fits a row.
+ *  @param seq The sequence number of the sample.
+ *  @param sample The sample.
+ *
+ *  @return The length of the row including its newline, or zero if it did not fit.
+ */
+size_t telemetry_csv(char* buffer, size_t size, uint32_t seq, const TelemetrySample& sample)
+{
+    static const char* const states[] = { "idle", "accel", "decel" };
+    const char* state = (sample.state < sizeof(states) / sizeof(states[0])) ? states[sample.state] : "?";
+    const char* event = (sample.flags & TELEMETRY_COMMAND) ? 
+                        ((sample.flags & TELEMETRY_TRANSITION) ? "command+transition" : "command") :
+                        ((sample.flags & TELEMETRY_TRANSITION) ? "transition" : "speed");
+
+    int len = snprintf(buffer, size, "%lu,%lu,%.3f,%.3f,%.3f,%s,%s,%.3f,%s,%u,%u\n", (unsigned long)seq,
+                       (unsigned long)sample.t_us, rpm_to_float(sample.actual), rpm_to_float(sample.raw),
+                       rpm_to_float(sample.command), state, (sample.flags & TELEMETRY_TORQUE) ? "torque" : "speed",
+                       sample.brake / 1000.0f, event, (unsigned)sample.profile, (unsigned)sample.step);
+    return (len > 0 && (size_t)len < size) ? (size_t)len : 0;
+}
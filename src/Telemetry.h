@@ -0,0 +1,116 @@
+/** @file Telemetry.h
+ *  This file contains the telemetry sample which the readActual task records for every speed
+ *  it measures and speedControl records for every command and state transition, the header
+ *  of the binary frames which send samples to other programs, the TelemetryEvent class,
+ *  which packs a batch of samples into the text of one Server-Sent Events message for the
+ *  live plot, and the CSV export of samples. Samples are timestamped where they are
+ *  measured, so the plot shows when each speed happened rather than when it was sent.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "SpeedType.h"
+
+// Number of samples readActual can buffer before the webserver task streams them
+#define TELEMETRY_RING_SIZE 128
+
+// Number of commands and state transitions speedControl can buffer before the webserver task logs them
+#define TELEMETRY_EVENT_RING_SIZE 32
+
+// Bits of TelemetrySample::flags
+#define TELEMETRY_TORQUE        0x01    // the torque loop was giving the commands
+#define TELEMETRY_COMMAND       0x02    // speedControl took a new command at this time
+#define TELEMETRY_TRANSITION    0x04    // the state machine changed state at this time
+
+// First line of the CSV export, naming the columns written by telemetry_csv()
+#define TELEMETRY_CSV_HEADER "seq,t_us,actual_rpm,raw_rpm,command_rpm,state,mode,brake,event,profile,step\n"
+
+/** One speed measurement, command or state transition with the state of the controller */
+struct TelemetrySample
+{
+    uint32_t t_us;      // time of the measurement, the low 32 bits of esp_timer_get_time()
+    rpm_t actual;       // filtered speed, as put in speed_actual
+    rpm_t raw;          // unfiltered speed from the latest single period, as put in speed_raw
+    rpm_t command;      // speed commanded to the speedControl state machine
+    uint8_t state;      // FsmState of the speedControl state machine
+    uint8_t flags;      // TELEMETRY_ bits; a speed measurement has no COMMAND or TRANSITION bit
+    uint16_t brake;     // brake duty cycle in thousandths
+    uint16_t profile;   // number of the command profile being played since power-up, or zero if none
+    uint16_t step;      // step of that profile which gave the latest command
+};
+
+// Tag at the start of every binary telemetry frame, the bytes "TLM1"
+#define TELEMETRY_FRAME_MAGIC 0x314D4C54
+
+/** The header of a binary telemetry frame.
+ *
+ *  @details The frame is the header followed by count samples, each exactly as a
+ *  TelemetrySample is stored in memory: little-endian, as on the ESP32 and a PC, with the
+ *  speeds in Q16.16 RPM. Sending the structures as they are lets a reply come straight from
+ *  the log with no formatting, and the sizes are fixed below so the format cannot change by
+ *  accident.
+ */
+struct TelemetryFrameHeader
+{
+    uint32_t magic;         // TELEMETRY_FRAME_MAGIC
+    uint32_t first_seq;     // sequence number of the first sample in the frame
+    uint32_t lost;          // samples asked for which were overwritten before the request
+    uint16_t count;         // number of samples after the header
+    uint16_t sample_size;   // size of one sample in bytes, so a decoder can check the layout
+};
+
+static_assert(sizeof(TelemetrySample) == 24, "TelemetrySample is sent as it is stored");
+static_assert(sizeof(TelemetryFrameHeader) == 16, "TelemetryFrameHeader is sent as it is stored");
+
+/** This class is used to format telemetry samples into Server-Sent Events messages.
+ *
+ *  @details One message is a single line, "data: <sent>;<sample>;<sample>...", followed by a
+ *  blank line. The first field is the time the message was formatted, and each sample is
+ *  "t_us,actual,raw,command,state,flags,brake" with the speeds in RPM. A client can limit the
+ *  rate of samples it is sent; the samples in between are skipped, and the skipping carries
+ *  over from one message to the next. Each client has its own TelemetryEvent, while the text
+ *  buffer can be shared by clients which are sent to one after another.
+ */
+class TelemetryEvent
+{
+    protected:
+
+        char* buffer;               // text of the message being formatted
+        size_t size;                // size of buffer in bytes
+        size_t used;                // bytes of buffer used so far
+        uint16_t count;             // samples in the message
+        uint32_t interval_us;       // shortest time between samples sent, zero to send every sample
+        uint32_t next_us;           // time from which the next sample may be sent
+        bool started;               // false until the first sample has been sent
+
+    public:
+
+        /** Non-inline functions are commented in Telemetry.cpp */
+        TelemetryEvent(uint32_t rate_hz = 0);
+
+        void set_rate(uint32_t rate_hz);
+        void begin(char* buffer_, size_t size_, uint32_t now_us);
+        bool add(const TelemetrySample& sample);
+        size_t finish(void);
+
+
+
+        /** @brief A function which returns how many samples are in the message
+         *
+         *  @return The number of samples added since begin().
+         */
+        uint16_t samples(void)
+        {
+            return count;
+        }
+};
+
+// Non-member functions are commented in Telemetry.cpp
+size_t telemetry_csv(char* buffer, size_t size, uint32_t seq, const TelemetrySample& sample);
+
+#endif
@@ -0,0 +1,321 @@
+/** @file TelemetryCodec.cpp
+ *  This file contains the TelemetryEncoder and TelemetryDecoder classes, which write and read
+ *  compressed blocks of telemetry samples.
+*/
+
+#include <string.h>
+#include "TelemetryCodec.h"
+
+// Bits of the mask byte in front of each sample
+#define FIELD_COMMAND   0x01    // the change in the command follows
+#define FIELD_STATE     0x02    // the state and flags follow
+#define FIELD_BRAKE     0x04    // the change in the brake duty cycle follows
+#define FIELD_PROFILE   0x08    // the profile and its step follow
+#define FIELD_ALL       0x0F    // every bit a block may use; any other is a damaged block
+
+
+
+/** @brief Function which maps a signed number to an unsigned one, small numbers to small
+ *
+ *  @param value The number, which may be negative.
+ *
+ *  @return 0, 1, 2, 3, 4... for 0, -1, 1, -2, 2...
+ */
+static inline uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+
+
+/** @brief Function which undoes zigzag()
+ *
+ *  @param value The mapped number.
+ *
+ *  @return The signed number.
+ */
+static inline int32_t unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+
+
+/** @brief Constructor for the TelemetryEncoder class
+ *
+ *  @details Nothing can be added until begin() has been given a buffer.
+ */
+TelemetryEncoder::TelemetryEncoder(void)
+{
+    buffer = NULL;
+    size = 0;
+    used = 0;
+    count = 0;
+    max_count = 0;
+    memset(&last, 0, sizeof(last));
+}
+
+
+
+/** @brief A function which starts a new block, which is a keyframe
+ *
+ *  @param buffer_ The buffer to write the block into, header first.
+ *  @param size_ The size of the buffer in bytes.
+ *  @param first_seq The sequence number of the first sample which will be added.
+ *  @param max_count_ The most samples to put in the block.
+ */
+void TelemetryEncoder::begin(uint8_t* buffer_, size_t size_, uint32_t first_seq, uint16_t max_count_)
+{
+    buffer = buffer_;
+    size = size_;
+    count = 0;
+    max_count = max_count_;
+    memset(&last, 0, sizeof(last));
+
+    TelemetryBlockHeader header = { TELEMETRY_BLOCK_MAGIC, first_seq, 0, 0 };
+    used = 0;
+    if (size >= sizeof(header))
+    {
+        memcpy(buffer, &header, sizeof(header));
+        used = sizeof(header);
+    }
+}
+
+
+
+/** @brief A function which adds one sample to the block
+ *
+ *  @param sample The sample.
+ *
+ *  @return True if the sample was added, false if the block is full, in which case the
+ *  sample should be added to the next block.
+ */
+bool TelemetryEncoder::add(const TelemetrySample& sample)
+{
+    if (used == 0 || count >= max_count || used + TELEMETRY_SAMPLE_MAX > size)
+    {
+        return false;
+    }
+
+    size_t mask_at = used++;
+    uint8_t mask = 0;
+    put_varint(zigzag((int32_t)(sample.t_us - last.t_us)));
+    put_varint(zigzag((int32_t)((uint32_t)sample.actual - (uint32_t)last.actual)));
+    put_varint(zigzag((int32_t)((uint32_t)sample.raw - (uint32_t)sample.actual)));
+    if (sample.command != last.command)
+    {
+        mask |= FIELD_COMMAND;
+        put_varint(zigzag((int32_t)((uint32_t)sample.command - (uint32_t)last.command)));
+    }
+    if (sample.state != last.state || sample.flags != last.flags)
+    {
+        mask |= FIELD_STATE;
+        buffer[used++] = sample.state;
+        buffer[used++] = sample.flags;
+    }
+    if (sample.brake != last.brake)
+    {
+        mask |= FIELD_BRAKE;
+        put_varint(zigzag((int32_t)sample.brake - (int32_t)last.brake));
+    }
+    if (sample.profile != last.profile || sample.step != last.step)
+    {
+        mask |= FIELD_PROFILE;
+        put_varint(sample.profile);
+        put_varint(sample.step);
+    }
+    buffer[mask_at] = mask;
+
+    last = sample;
+    count++;
+    return true;
+}
+
+
+
+/** @brief A function which ends the block by filling in its header
+ *
+ *  @return The size of the block including its header, or zero if it holds no samples.
+ */
+size_t TelemetryEncoder::finish(void)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    TelemetryBlockHeader* header = (TelemetryBlockHeader*)buffer;
+    header->count = count;
+    header->bytes = (uint16_t)(used - sizeof(TelemetryBlockHeader));
+    return used;
+}
+
+
+
+/** @brief A function which writes a number as a varint, seven bits to a byte
+ *
+ *  @param value The number.
+ */
+void TelemetryEncoder::put_varint(uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer[used++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[used++] = (uint8_t)value;
+}
+
+
+
+/** @brief Constructor for the TelemetryDecoder class
+ *
+ *  @details Nothing can be decoded until begin() has been given a block.
+ */
+TelemetryDecoder::TelemetryDecoder(void)
+{
+    data = NULL;
+    length = 0;
+    pos = 0;
+    remaining = 0;
+    seq = 0;
+    memset(&last, 0, sizeof(last));
+}
+
+
+
+/** @brief A function which starts decoding a block
+ *
+ *  @param block The block, starting with its header.
+ *  @param len The number of bytes available from @c block on, which may run past the block.
+ *
+ *  @return The size of the block including its header, which is where the next block in a
+ *  stream starts, or zero if this is not a whole block.
+ */
+size_t TelemetryDecoder::begin(const uint8_t* block, size_t len)
+{
+    TelemetryBlockHeader header;
+    remaining = 0;
+    if (len < sizeof(header))
+    {
+        return 0;
+    }
+    memcpy(&header, block, sizeof(header));
+    if (header.magic != TELEMETRY_BLOCK_MAGIC || sizeof(header) + header.bytes > len)
+    {
+        return 0;
+    }
+
+    data = block + sizeof(header);
+    length = header.bytes;
+    pos = 0;
+    remaining = header.count;
+    seq = header.first_seq;
+    memset(&last, 0, sizeof(last));
+    return sizeof(header) + header.bytes;
+}
+
+
+
+/** @brief A function which decodes the next sample of the block
+ *
+ *  @param sample Filled in with the sample.
+ *  @param sample_seq Filled in with its sequence number.
+ *
+ *  @details A block is damaged if a mask has a bit which is not a field, a sample runs past
+ *  the end of the block, or the last sample does not end where the block does.
+ *
+ *  @return True if a sample was decoded, false at the end of the block or if it is damaged.
+ */
+bool TelemetryDecoder::next(TelemetrySample& sample, uint32_t& sample_seq)
+{
+    if (remaining == 0 || pos >= length)
+    {
+        return false;
+    }
+
+    uint8_t mask = data[pos++];
+    uint32_t t, actual, raw;
+    if ((mask & ~FIELD_ALL) != 0 || !get_varint(t) || !get_varint(actual) || !get_varint(raw))
+    {
+        remaining = 0;
+        return false;
+    }
+    sample = last;
+    sample.t_us = last.t_us + (uint32_t)unzigzag(t);
+    sample.actual = (rpm_t)((uint32_t)last.actual + (uint32_t)unzigzag(actual));
+    sample.raw = (rpm_t)((uint32_t)sample.actual + (uint32_t)unzigzag(raw));
+
+    uint32_t change;
+    if (mask & FIELD_COMMAND)
+    {
+        if (!get_varint(change))
+        {
+            remaining = 0;
+            return false;
+        }
+        sample.command = (rpm_t)((uint32_t)last.command + (uint32_t)unzigzag(change));
+    }
+    if (mask & FIELD_STATE)
+    {
+        if (pos + 2 > length)
+        {
+            remaining = 0;
+            return false;
+        }
+        sample.state = data[pos++];
+        sample.flags = data[pos++];
+    }
+    if (mask & FIELD_BRAKE)
+    {
+        if (!get_varint(change))
+        {
+            remaining = 0;
+            return false;
+        }
+        sample.brake = (uint16_t)(last.brake + unzigzag(change));
+    }
+    if (mask & FIELD_PROFILE)
+    {
+        uint32_t profile, step;
+        if (!get_varint(profile) || !get_varint(step))
+        {
+            remaining = 0;
+            return false;
+        }
+        sample.profile = (uint16_t)profile;
+        sample.step = (uint16_t)step;
+    }
+    if (remaining == 1 && pos != length)
+    {
+        remaining = 0;
+        return false;
+    }
+
+    last = sample;
+    sample_seq = seq++;
+    remaining--;
+    return true;
+}
+
+
+
+/** @brief A function which reads a varint
+ *
+ *  @param value Filled in with the number.
+ *
+ *  @return True if a whole varint of at most five bytes was read from inside the block.
+ */
+bool TelemetryDecoder::get_varint(uint32_t& value)
+{
+    value = 0;
+    for (uint8_t shift = 0; shift < 35 && pos < length; shift += 7)
+    {
+        uint8_t byte = data[pos++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
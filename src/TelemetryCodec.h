@@ -0,0 +1,125 @@
+/** @file TelemetryCodec.h
+ *  This file contains the compressed block format for telemetry samples, and the
+ *  TelemetryEncoder and TelemetryDecoder classes which write and read it. The speeds change
+ *  little from one sample to the next and the command, state and brake hardly ever change, so
+ *  each sample is stored as the differences from the one before it, as zigzag varints, and the
+ *  fields which did not change are left out. A block starts from zero again, so it is a
+ *  keyframe which can be decoded on its own; a long stream is a string of blocks, and a reader
+ *  can skip from one to the next by their lengths to start anywhere.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _TELEMETRYCODEC_H_
+#define _TELEMETRYCODEC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Telemetry.h"
+
+// Tag at the start of every block, the bytes "TLZ1"
+#define TELEMETRY_BLOCK_MAGIC 0x315A4C54
+
+// Samples in a block sent over HTTP, and so the distance between keyframes
+#define TELEMETRY_BLOCK_SAMPLES 64
+
+// Most bytes one sample can take: a change mask, the time, speeds and command as varints of
+// up to five bytes, the state and flags, and the change in brake duty cycle, the profile and
+// its step in up to three bytes each
+#define TELEMETRY_SAMPLE_MAX 32
+
+// Size of a buffer which always holds a block of n samples
+#define TELEMETRY_BLOCK_SIZE(n) (sizeof(TelemetryBlockHeader) + (n) * TELEMETRY_SAMPLE_MAX)
+
+/** The header of a compressed block of telemetry samples.
+ *
+ *  @details The header is followed by @c bytes bytes holding @c count samples. Each sample
+ *  starts with a mask byte saying which of the rarely changing fields follow, then:
+ *  - the change in t_us, as a zigzag varint
+ *  - the change in the filtered speed, as a zigzag varint of Q16.16 RPM
+ *  - the raw speed minus the filtered speed, as a zigzag varint of Q16.16 RPM
+ *  - if mask bit 0 is set, the change in the command, as a zigzag varint of Q16.16 RPM
+ *  - if mask bit 1 is set, the state and then the flags, one byte each
+ *  - if mask bit 2 is set, the change in the brake duty cycle, as a zigzag varint
+ *  - if mask bit 3 is set, the profile and then its step, as varints
+ *
+ *  The first sample of a block is stored as its change from a sample of all zeros. A varint
+ *  holds seven bits in each byte, lowest first, with the top bit set on every byte but the
+ *  last, and zigzag maps 0, -1, 1, -2... to 0, 1, 2, 3... so small changes of either sign
+ *  take one byte. All numbers are little-endian.
+ */
+struct TelemetryBlockHeader
+{
+    uint32_t magic;         // TELEMETRY_BLOCK_MAGIC
+    uint32_t first_seq;     // sequence number of the first sample in the block
+    uint16_t count;         // number of samples in the block
+    uint16_t bytes;         // bytes of encoded samples after the header
+};
+
+static_assert(sizeof(TelemetryBlockHeader) == 12, "TelemetryBlockHeader is sent as it is stored");
+
+/** This class compresses telemetry samples into one block.
+ *
+ *  @details The block is written into a buffer given by the caller. A sample is only added
+ *  if it is sure to fit, so a block never has to be taken apart again; if the buffer comes
+ *  from TELEMETRY_BLOCK_SIZE() every sample up to the limit fits.
+ */
+class TelemetryEncoder
+{
+    protected:
+
+        uint8_t* buffer;            // the block being written, starting with its header
+        size_t size;                // size of the buffer in bytes
+        size_t used;                // bytes written so far, including the header
+        uint16_t count;             // samples added so far
+        uint16_t max_count;         // most samples the block may hold
+        TelemetrySample last;       // the sample added last, which the next one is stored against
+
+        void put_varint(uint32_t value);
+
+    public:
+
+        /** Non-inline functions are commented in TelemetryCodec.cpp */
+        TelemetryEncoder(void);
+
+        void begin(uint8_t* buffer_, size_t size_, uint32_t first_seq, uint16_t max_count_ = TELEMETRY_BLOCK_SAMPLES);
+        bool add(const TelemetrySample& sample);
+        size_t finish(void);
+
+
+
+        /** @brief A function which returns the number of samples added to the block */
+        uint16_t samples(void)
+        {
+            return count;
+        }
+};
+
+/** This class decompresses the samples of one block.
+ *
+ *  @details The block is checked as it is read, so a damaged block stops the decoder rather
+ *  than producing samples from outside it.
+ */
+class TelemetryDecoder
+{
+    protected:
+
+        const uint8_t* data;        // the encoded samples after the block header
+        size_t length;              // number of encoded bytes
+        size_t pos;                 // offset of the next sample in data
+        uint16_t remaining;         // samples not decoded yet
+        uint32_t seq;               // sequence number of the next sample
+        TelemetrySample last;       // the sample decoded last, which the next one is a change from
+
+        bool get_varint(uint32_t& value);
+
+    public:
+
+        /** Non-inline functions are commented in TelemetryCodec.cpp */
+        TelemetryDecoder(void);
+
+        size_t begin(const uint8_t* block, size_t len);
+        bool next(TelemetrySample& sample, uint32_t& sample_seq);
+};
+
+#endif
@@ -0,0 +1,259 @@
+/** @file TelemetryLog.h
+ *  This file contains the TelemetryLog class, which keeps the latest telemetry samples in
+ *  storage given to it once at startup, numbered in the order they were recorded. Readers ask for the samples
+ *  after a sequence number they have already seen and are given pointers into the storage,
+ *  so a reply can be sent straight from it without the samples being copied or formatted.
+ *  The log is filled from the speed and event rings in time order, and can be read out as
+ *  CSV rows a buffer at a time.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _TELEMETRYLOG_H_
+#define _TELEMETRYLOG_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Telemetry.h"
+#include "SpscRing.h"
+
+/** This class is a history of telemetry samples which readers can go back through.
+ *
+ *  @details The newest N samples are kept, N being the size given to begin(), and older ones
+ *  are overwritten. Sample number s is stored at index s mod N, so the samples from any
+ *  sequence number to the newest lie in at most two contiguous spans. The storage is
+ *  allocated by the owner of the log and given to begin(), so it can come from the heap or
+ *  PSRAM instead of static DRAM, and the log must not be used before then. The log has no
+ *  locking: it must be written and read by the same task, which in this program is the
+ *  webserver task, as the HTTP handlers run there.
+ */
+class TelemetryLog
+{
+    protected:
+
+        TelemetrySample* samples;       // storage for the newest samples
+        uint32_t slots;                 // number of samples kept, a power of two
+        uint32_t head;                  // sequence number the next sample will be given
+
+    public:
+
+        /** @brief Constructor which creates a log with no storage yet */
+        TelemetryLog(void)
+            : samples(NULL), slots(0), head(0)
+        {
+        }
+
+
+
+        /** @brief A function which gives the log its storage and empties it
+         *
+         *  @param storage Room for size samples, which the log uses until it is destroyed.
+         *  @param size The number of samples kept. Must be a power of two.
+         *
+         *  @return True if the log can be used, false if storage is NULL or size is not a
+         *  power of two.
+         */
+        bool begin(TelemetrySample* storage, uint32_t size)
+        {
+            if (storage == NULL || size < 2 || (size & (size - 1)) != 0)
+            {
+                return false;
+            }
+            samples = storage;
+            slots = size;
+            head = 0;
+            return true;
+        }
+
+
+
+        /** @brief A function which returns how many samples the log keeps
+         *
+         *  @return The size given to begin(), or zero before then.
+         */
+        uint32_t capacity(void)
+        {
+            return slots;
+        }
+
+
+
+        /** @brief A function which returns the slot the next sample is written to
+         *
+         *  @details The sample is not part of the log until commit() is called, so it can be
+         *  filled in place, for example by popping it straight out of a ring.
+         *
+         *  @return The slot for sample number next_seq().
+         */
+        TelemetrySample& slot(void)
+        {
+            return samples[head & (slots - 1)];
+        }
+
+
+
+        /** @brief A function which adds the sample written into slot() to the log */
+        void commit(void)
+        {
+            head++;
+        }
+
+
+
+        /** @brief A function which returns the sequence number the next sample will be given
+         *
+         *  @return One more than the sequence number of the newest sample.
+         */
+        uint32_t next_seq(void)
+        {
+            return head;
+        }
+
+
+
+        /** @brief A function which returns the sequence number of the oldest sample kept
+         *
+         *  @return The oldest sequence number which can still be read.
+         */
+        uint32_t first_seq(void)
+        {
+            return (head > slots) ? head - slots : 0;
+        }
+
+
+
+        /** @brief A function which moves a reader past samples which have been overwritten
+         *
+         *  @param seq A sequence number handed out by next_seq() earlier.
+         *
+         *  @return seq, or first_seq() if sample seq is no longer kept.
+         */
+        uint32_t skip_lost(uint32_t seq)
+        {
+            return ((int32_t)(seq - first_seq()) < 0) ? first_seq() : seq;
+        }
+
+
+
+        /** @brief A function which returns one sample
+         *
+         *  @param seq The sequence number of the sample, from first_seq() to next_seq() - 1.
+         *
+         *  @return The sample, which stays valid until N more samples have been added.
+         */
+        const TelemetrySample& at(uint32_t seq)
+        {
+            return samples[seq & (slots - 1)];
+        }
+
+
+
+        /** @brief A function which finds the contiguous samples starting at a sequence number
+         *
+         *  @details Call it again with seq + count to get the rest of the samples after the
+         *  storage wraps around.
+         *
+         *  @param seq The first sequence number wanted, from first_seq() to next_seq().
+         *  @param count Filled in with the number of samples in the span, at most max_count.
+         *  @param max_count The most samples wanted.
+         *
+         *  @return A pointer to sample number seq in the storage.
+         */
+        const TelemetrySample* span(uint32_t seq, uint32_t& count, uint32_t max_count)
+        {
+            uint32_t index = seq & (slots - 1);
+            count = head - seq;
+            if (count > slots - index)
+            {
+                count = slots - index;
+            }
+            if (count > max_count)
+            {
+                count = max_count;
+            }
+            return &samples[index];
+        }
+
+
+
+        /** @brief A function which moves samples from two rings into the log in time order
+         *
+         *  @details The speed samples and the commands and transitions are each in time order
+         *  in their ring, so the older of the two at the front of the rings is taken each time.
+         *  An event recorded at the same time as a sample goes first. Samples are popped
+         *  straight into the storage.
+         *
+         *  @param ring The ring of speed samples.
+         *  @param events The ring of commands and state transitions.
+         *  @param max_count The most samples to move, so this cannot run forever while the
+         *  producers keep pushing.
+         *
+         *  @return The number of samples added, which are the newest in the log.
+         */
+        template <uint32_t R, uint32_t E>
+        uint32_t merge(SpscRing<TelemetrySample, R>& ring, SpscRing<TelemetrySample, E>& events,
+                       uint32_t max_count)
+        {
+            TelemetrySample sample;
+            TelemetrySample event;
+            uint32_t count = 0;
+            while (count < max_count)
+            {
+                bool have_sample = ring.peek(sample);
+                bool have_event = events.peek(event);
+                if (have_event && (!have_sample || (int32_t)(event.t_us - sample.t_us) <= 0))
+                {
+                    events.pop(slot());
+                }
+                else if (have_sample)
+                {
+                    ring.pop(slot());
+                }
+                else
+                {
+                    break;
+                }
+                commit();
+                count++;
+            }
+            return count;
+        }
+
+
+
+        /** @brief A function which formats samples as CSV rows until a buffer is full
+         *
+         *  @details Samples overwritten since seq was handed out are skipped, so a reader which
+         *  has fallen more than N samples behind carries on from the oldest sample kept, and
+         *  stops if that is already past end.
+         *
+         *  @param seq The first sequence number to format, moved on past the last row.
+         *  @param end The sequence number to stop at.
+         *  @param buffer The buffer for the rows.
+         *  @param size The size of buffer in bytes.
+         *  @param rows Increased by the number of rows formatted.
+         *
+         *  @return The bytes of text in buffer, which is zero once seq has reached end, or if
+         *  one row does not fit in the buffer.
+         */
+        size_t csv(uint32_t& seq, uint32_t end, char* buffer, size_t size, uint32_t& rows)
+        {
+            size_t used = 0;
+            seq = skip_lost(seq);
+            while ((int32_t)(end - seq) > 0)
+            {
+                size_t len = telemetry_csv(buffer + used, size - used, seq, at(seq));
+                if (len == 0)
+                {
+                    break;
+                }
+                used += len;
+                seq++;
+                rows++;
+            }
+            seq = ((int32_t)(end - seq) < 0) ? end : seq;
+            return used;
+        }
+};
+
+#endif
@@ -0,0 +1,330 @@
+/** @file WebPage.h
+ *  This file contains the control web page, gzip compressed, for the web server to send
+ *  straight from flash. It is generated from web/index.html by tools/embed_page.py;
+ *  edit the page and run the script instead of editing this file.
+ *
+ *  Page: 16658 bytes, compressed: 4772 bytes.
+*/
+
+#ifndef _WEBPAGE_H_
+#define _WEBPAGE_H_
+
+// On the ESP32 the page stays in flash; on a PC, for test_webpage, it is an ordinary array
+#ifdef ESP_PLATFORM
+#include <Arduino.h>
+#else
+#include <stdint.h>
+#define PROGMEM
+#endif
+
+// Entity tag of the compressed page, which changes whenever the page does
+#define WEB_PAGE_ETAG "\"6d01a532e2559e0f\""
+
+// Length of the compressed page in bytes
+#define WEB_PAGE_GZ_LEN 4772
+
+// The compressed page
+static const uint8_t WEB_PAGE_GZ[WEB_PAGE_GZ_LEN] PROGMEM =
+{
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xc5, 0x1c, 0x6b, 0x73, 0xdb, 0xb8,
+    0xf1, 0xbb, 0x7f, 0x05, 0xa2, 0x9b, 0x9e, 0xa8, 0x5a, 0x0f, 0x4a, 0x8e, 0xd3, 0xd4, 0x7a, 0x64,
+    0x72, 0x8e, 0x73, 0xf5, 0xe4, 0xe5, 0x89, 0xdd, 0x9b, 0x76, 0x6e, 0x32, 0x19, 0x48, 0x84, 0x2c,
+    0x34, 0x14, 0xc9, 0x23, 0x21, 0xd9, 0x3e, 0xd7, 0xbf, 0xab, 0xdf, 0xfb, 0xcb, 0xba, 0xbb, 0x00,
+    0x48, 0x90, 0x92, 0x2c, 0x29, 0x49, 0x5b, 0xe7, 0xc6, 0x12, 0x81, 0xc5, 0x62, 0x5f, 0xd8, 0x17,
+    0xe1, 0x1b, 0x3c, 0x79, 0xf5, 0xe1, 0xf4, 0xea, 0xef, 0x17, 0x67, 0x6c, 0xa6, 0xe6, 0xe1, 0x88,
+    0x0d, 0xe8, 0xe3, 0x60, 0x30, 0x13, 0x3c, 0x18, 0x0d, 0xe6, 0x42, 0x71, 0x16, 0xf1, 0xb9, 0x18,
+    0xd6, 0x96, 0x52, 0xdc, 0x24, 0x71, 0xaa, 0x6a, 0x6c, 0x12, 0x47, 0x4a, 0x44, 0x6a, 0x58, 0xbb,
+    0x91, 0x81, 0x9a, 0x0d, 0x03, 0xb1, 0x94, 0x13, 0xd1, 0xa2, 0x87, 0x26, 0x93, 0x91, 0x54, 0x92,
+    0x87, 0xad, 0x6c, 0xc2, 0x43, 0x31, 0xec, 0xb6, 0xfd, 0x26, 0x5b, 0x64, 0x22, 0xa5, 0x67, 0x3e,
+    0x86, 0xa1, 0x28, 0xae, 0x01, 0x7a, 0x25, 0x55, 0x28, 0x46, 0xec, 0x5d, 0xac, 0xe2, 0x94, 0x9d,
+    0x02, 0xc2, 0x34, 0x0e, 0x07, 0x1d, 0x3d, 0x7a, 0x30, 0xc8, 0xd4, 0x1d, 0x7c, 0x22, 0x25, 0xec,
+    0x9e, 0x4d, 0x61, 0xb6, 0x35, 0xe5, 0x73, 0x19, 0xde, 0x9d, 0xb0, 0xbf, 0x88, 0x70, 0x29, 0x94,
+    0x9c, 0xf0, 0x3e, 0x0b, 0x64, 0x96, 0x84, 0x1c, 0xc6, 0x64, 0x14, 0xca, 0x48, 0xb4, 0xc6, 0x61,
+    0x3c, 0xf9, 0xd2, 0x67, 0x73, 0x9e, 0x5e, 0xcb, 0xe8, 0x84, 0xf9, 0xc9, 0x2d, 0xe3, 0x0b, 0x15,
+    0xf7, 0x99, 0x12, 0xb7, 0xaa, 0xc5, 0x43, 0x79, 0x0d, 0xa3, 0x13, 0x20, 0x5c, 0xa4, 0xfd, 0x87,
+    0x83, 0x71, 0x1c, 0xdc, 0xdd, 0x6b, 0xd8, 0x96, 0x8a, 0x93, 0x13, 0x76, 0x0c, 0x0b, 0xfa, 0x0f,
+    0x6c, 0xd6, 0x65, 0xf7, 0x93, 0x38, 0x8c, 0xd3, 0x13, 0xf6, 0xc3, 0x53, 0xf8, 0x79, 0xf9, 0xb2,
+    0x6f, 0x31, 0x1e, 0x5b, 0x94, 0xec, 0x88, 0x60, 0x0f, 0x12, 0x76, 0x4f, 0xc4, 0x65, 0xf2, 0x77,
+    0x71, 0xc2, 0x7a, 0x4f, 0x61, 0xd0, 0x2e, 0xed, 0xd1, 0x8f, 0x59, 0xda, 0x1a, 0xc7, 0x4a, 0xc5,
+    0xf3, 0x13, 0xd6, 0xd5, 0xeb, 0x06, 0x1d, 0xcd, 0x20, 0x7c, 0x21, 0x31, 0x5b, 0x86, 0x0f, 0x18,
+    0x43, 0xb2, 0x80, 0x67, 0xbb, 0xe5, 0x73, 0x80, 0x2f, 0x0b, 0xe0, 0x65, 0x0a, 0xd2, 0x6d, 0xb2,
+    0x8c, 0x47, 0x59, 0x0b, 0xe4, 0x2a, 0xa7, 0x66, 0x5e, 0xd3, 0xd0, 0x3d, 0xc2, 0x05, 0x0f, 0x80,
+    0xe8, 0x07, 0x10, 0x4d, 0xbc, 0x50, 0x80, 0x2b, 0x97, 0xd3, 0x34, 0x14, 0x88, 0x0d, 0x7e, 0xb7,
+    0x02, 0x99, 0x8a, 0x89, 0x92, 0x31, 0x6c, 0x91, 0xc6, 0x37, 0x7d, 0x46, 0xd2, 0x69, 0x49, 0x25,
+    0xe6, 0x99, 0x86, 0x6b, 0x65, 0x8a, 0xa7, 0xaa, 0xcf, 0xae, 0x39, 0x88, 0xa6, 0xdb, 0x2b, 0xb0,
+    0x8a, 0xa9, 0xba, 0xe0, 0x91, 0x20, 0xc5, 0x00, 0x1c, 0xc8, 0x19, 0xfe, 0xf5, 0x9e, 0x23, 0x63,
+    0x40, 0xf5, 0xad, 0x36, 0x83, 0x13, 0x76, 0xd4, 0xf3, 0xf3, 0x35, 0xa9, 0xbc, 0x9e, 0x55, 0x16,
+    0x75, 0xe1, 0x9f, 0x56, 0x0e, 0x42, 0xa0, 0xcc, 0x4b, 0x5c, 0x3c, 0xd7, 0xd8, 0xb4, 0x0c, 0x40,
+    0xac, 0xb0, 0xc5, 0x73, 0xfc, 0x6d, 0xc0, 0x7b, 0x15, 0xf0, 0xa7, 0x2e, 0x38, 0x01, 0xea, 0x45,
+    0x06, 0xfc, 0xa8, 0x02, 0x7e, 0xb4, 0x82, 0x5d, 0x03, 0x4e, 0xe3, 0x74, 0xee, 0xc8, 0x5e, 0xef,
+    0xfb, 0x4c, 0xcf, 0x27, 0x3c, 0x08, 0x64, 0x74, 0x4d, 0xa3, 0x7d, 0xd0, 0x52, 0x1a, 0x08, 0x50,
+    0x73, 0x17, 0x26, 0xb3, 0x38, 0x94, 0x01, 0xfb, 0x21, 0x08, 0x02, 0x3b, 0xde, 0x4a, 0x79, 0x20,
+    0x17, 0x99, 0x81, 0xcd, 0x31, 0x27, 0x0e, 0xee, 0x9e, 0x4b, 0xa4, 0x4b, 0x5b, 0x2e, 0x69, 0x19,
+    0x25, 0x0b, 0xf5, 0xab, 0xba, 0x4b, 0xe0, 0xe8, 0x45, 0x8b, 0xf9, 0x58, 0xa4, 0xb5, 0x4f, 0x80,
+    0xc0, 0x88, 0xb7, 0xeb, 0xfb, 0x7f, 0xc0, 0xed, 0x6e, 0x71, 0x1d, 0xd1, 0x65, 0xb6, 0x86, 0xa1,
+    0x1d, 0x10, 0x66, 0x8b, 0xf1, 0x5c, 0x2a, 0x42, 0xe8, 0x1e, 0x81, 0xa7, 0xc9, 0xba, 0xc5, 0x39,
+    0xeb, 0x48, 0xf4, 0x33, 0x8b, 0x2e, 0x69, 0x83, 0x85, 0xa8, 0x45, 0xe6, 0x30, 0x45, 0x96, 0xb0,
+    0xca, 0x52, 0x97, 0xc4, 0x0d, 0x7b, 0xcc, 0x04, 0x1a, 0x02, 0x8c, 0x88, 0x39, 0xe2, 0x28, 0x4e,
+    0x01, 0x1a, 0x3d, 0x7c, 0x04, 0x72, 0xc9, 0x64, 0x30, 0xac, 0x69, 0xcb, 0xad, 0xb9, 0x23, 0xd6,
+    0xea, 0x70, 0x70, 0xd6, 0x1d, 0x95, 0xdc, 0x06, 0x3b, 0xc7, 0x23, 0x3d, 0xe5, 0x13, 0x01, 0xc7,
+    0xa9, 0x8b, 0x00, 0xbd, 0xd1, 0x55, 0x9c, 0xfe, 0xb6, 0x10, 0x00, 0x31, 0x9f, 0xf3, 0x28, 0x80,
+    0xf1, 0x1e, 0x8c, 0x93, 0x16, 0x10, 0x9d, 0xa2, 0xd9, 0xd7, 0xf0, 0x58, 0x63, 0x9c, 0x8e, 0xc1,
+    0xb0, 0xd6, 0x99, 0xcc, 0x83, 0x1a, 0x03, 0x7f, 0x37, 0x8b, 0x01, 0xe2, 0xe7, 0xb3, 0xab, 0x1a,
+    0x1e, 0xc7, 0x41, 0x32, 0x3a, 0x43, 0xec, 0x4c, 0x2f, 0x01, 0xd7, 0x47, 0x08, 0x99, 0xf7, 0xfe,
+    0xdf, 0xff, 0x9a, 0x37, 0x4e, 0x06, 0x9d, 0x84, 0xa0, 0x48, 0xb6, 0xac, 0xa4, 0x2c, 0x96, 0x29,
+    0x91, 0x0c, 0x6b, 0x7e, 0xdb, 0xf7, 0xbb, 0x35, 0xe3, 0x42, 0x35, 0x92, 0x1a, 0x4b, 0xc5, 0x6f,
+    0x0b, 0x38, 0x80, 0xc1, 0xca, 0x5a, 0xa3, 0x17, 0xb6, 0xe4, 0xe1, 0x02, 0x1e, 0x2f, 0x45, 0x14,
+    0x20, 0xc7, 0x1d, 0xa4, 0x1c, 0x3e, 0x13, 0xa2, 0x5e, 0xcb, 0xfd, 0xb3, 0x45, 0x36, 0x09, 0x79,
+    0x96, 0xd9, 0xd1, 0xda, 0x88, 0x48, 0x42, 0x11, 0x5c, 0x26, 0x42, 0x04, 0x9b, 0x24, 0x90, 0xe1,
+    0xe4, 0xe9, 0x3c, 0xd8, 0x4b, 0x06, 0xb4, 0xa8, 0x10, 0xc1, 0xc7, 0x8b, 0x77, 0xbb, 0x48, 0x20,
+    0xe7, 0x9e, 0x96, 0x7f, 0xa6, 0x2d, 0xbe, 0x8b, 0x00, 0x1c, 0x7c, 0x9b, 0x64, 0xf0, 0x33, 0x97,
+    0x11, 0xbb, 0x14, 0x4a, 0x81, 0xfd, 0x66, 0x46, 0x06, 0x25, 0x1c, 0xaf, 0xcf, 0xdf, 0xbe, 0xe9,
+    0x6e, 0x58, 0x9f, 0x0b, 0x8b, 0x80, 0x76, 0x94, 0x14, 0xc1, 0x82, 0xd7, 0x84, 0x7d, 0x3d, 0x1f,
+    0xac, 0x86, 0x3d, 0xf5, 0xff, 0x7c, 0xbc, 0xa3, 0x98, 0xe0, 0x8c, 0x80, 0xc1, 0xd4, 0xd0, 0x8d,
+    0x0e, 0x6b, 0xb8, 0xce, 0x4a, 0xce, 0x50, 0xb9, 0xbb, 0xd4, 0x14, 0xd3, 0x4b, 0x36, 0x89, 0x0e,
+    0x67, 0x7b, 0xbb, 0xb0, 0xdd, 0xdb, 0x83, 0xed, 0xde, 0x7f, 0x83, 0xed, 0xde, 0xfe, 0x6c, 0xf7,
+    0x36, 0xb2, 0x7d, 0xfa, 0xe1, 0xdd, 0xc5, 0x76, 0x75, 0x6b, 0xa8, 0x1d, 0x19, 0xd7, 0xc0, 0xdf,
+    0x9b, 0x73, 0x4b, 0xe8, 0x3e, 0xac, 0x9b, 0x35, 0x8f, 0xf2, 0xde, 0xdb, 0x89, 0xf7, 0xde, 0x3e,
+    0xbc, 0xf7, 0xfe, 0x2b, 0xbc, 0xf7, 0xbe, 0x82, 0xf7, 0xcd, 0x7a, 0xbf, 0xbc, 0x78, 0xf5, 0xf3,
+    0xcb, 0xf3, 0xf7, 0xdb, 0x98, 0x37, 0x60, 0x3b, 0x72, 0x6f, 0xa0, 0xbf, 0x23, 0xe7, 0x39, 0x99,
+    0xfb, 0xb0, 0x6e, 0x17, 0x6d, 0xe2, 0xfd, 0xed, 0x87, 0x0f, 0x17, 0xbb, 0x30, 0x6f, 0xe1, 0x76,
+    0xe4, 0xde, 0x82, 0x1b, 0xf6, 0xbb, 0x7e, 0xef, 0xe8, 0x6b, 0xd8, 0xc7, 0x75, 0x96, 0xfd, 0x82,
+    0xd2, 0x7d, 0xf8, 0xcf, 0x57, 0x6d, 0x56, 0xfe, 0xd9, 0xd9, 0xab, 0xed, 0xaa, 0x07, 0xa0, 0x9d,
+    0x15, 0x0f, 0xb0, 0x40, 0xe3, 0x54, 0xa4, 0x22, 0x9a, 0x88, 0xef, 0x6a, 0x00, 0x44, 0xea, 0x7e,
+    0xea, 0x47, 0x62, 0x3e, 0x8a, 0xa9, 0xcb, 0x7f, 0x1e, 0xfd, 0x2f, 0xce, 0x5f, 0x31, 0x8c, 0x81,
+    0x6b, 0x63, 0x5f, 0x22, 0x83, 0xcf, 0x5f, 0x92, 0x6d, 0x92, 0x01, 0xa8, 0x37, 0xc9, 0x8e, 0x92,
+    0x79, 0x93, 0x50, 0x56, 0xc0, 0xe2, 0x29, 0x3b, 0x7d, 0xfb, 0x06, 0x8c, 0x23, 0x81, 0xac, 0xc1,
+    0x0c, 0x88, 0x34, 0x8d, 0xd3, 0x5d, 0x04, 0xc4, 0xa3, 0xbb, 0x42, 0x44, 0x5a, 0x2e, 0x96, 0xd2,
+    0x7d, 0x04, 0xf3, 0x26, 0xd9, 0x68, 0x11, 0x84, 0x4e, 0xee, 0xc2, 0xb8, 0xdc, 0x95, 0x71, 0xc9,
+    0xbc, 0x6e, 0x27, 0xfb, 0x16, 0xf6, 0xe4, 0x9e, 0xec, 0xc9, 0xc7, 0xd9, 0x0b, 0x76, 0x61, 0x6f,
+    0xd7, 0xf4, 0xef, 0x0d, 0x64, 0x7b, 0xdf, 0xc4, 0x5c, 0xb0, 0x27, 0x73, 0xa5, 0xa4, 0xaf, 0x03,
+    0x55, 0x80, 0x53, 0x0b, 0x14, 0xd5, 0x64, 0x4d, 0x9b, 0xfa, 0xcb, 0x89, 0x5a, 0xf0, 0x90, 0x69,
+    0x8b, 0x5f, 0x66, 0xec, 0x4a, 0xce, 0x85, 0xb1, 0xf7, 0xd9, 0xd1, 0xe8, 0xad, 0x5c, 0x0a, 0xb2,
+    0xc1, 0x8b, 0x30, 0x56, 0x30, 0x7c, 0x04, 0xc3, 0x13, 0x1e, 0x2d, 0x79, 0xe6, 0x24, 0xc2, 0xf4,
+    0x5c, 0xd3, 0xc5, 0xd5, 0xb0, 0xf6, 0xcc, 0x07, 0xea, 0x75, 0xb1, 0x32, 0xac, 0x1d, 0x1d, 0xfb,
+    0xc8, 0x1d, 0x14, 0x2a, 0xc3, 0x9a, 0x29, 0xfb, 0x9c, 0xaa, 0xcf, 0xa7, 0x9f, 0x3e, 0x4a, 0x57,
+    0x23, 0xc5, 0x6a, 0x26, 0xed, 0xc0, 0xef, 0x90, 0x8f, 0xa1, 0xde, 0x05, 0x16, 0x40, 0x04, 0xb0,
+    0xf3, 0x47, 0xae, 0x44, 0x6d, 0x74, 0xc9, 0xe7, 0x49, 0x28, 0x32, 0x3a, 0x17, 0x99, 0x98, 0xc4,
+    0x98, 0x46, 0xfb, 0x08, 0xc4, 0xc4, 0x52, 0xa4, 0x77, 0x20, 0x7b, 0x9e, 0x2d, 0x52, 0x31, 0x17,
+    0x91, 0x6a, 0x9c, 0xb0, 0x41, 0x87, 0x90, 0x00, 0xb2, 0x75, 0x12, 0x27, 0x25, 0x5a, 0xcc, 0xab,
+    0xce, 0xc5, 0x88, 0xd3, 0xa1, 0xde, 0x94, 0x8e, 0xcf, 0xb0, 0x30, 0xaf, 0xb1, 0x38, 0x9a, 0xcc,
+    0x78, 0x74, 0x2d, 0xc8, 0x40, 0x52, 0x75, 0xa9, 0x52, 0xc1, 0xe7, 0x5e, 0x03, 0x65, 0x9a, 0x25,
+    0x3c, 0x32, 0x06, 0x85, 0x83, 0x97, 0xb9, 0x01, 0xe1, 0x44, 0xce, 0xe0, 0x78, 0xa1, 0x54, 0xac,
+    0xe1, 0x82, 0xf8, 0x26, 0x0a, 0x63, 0x1e, 0xfc, 0xa4, 0xa2, 0x9a, 0xa1, 0x52, 0xcf, 0xd2, 0x36,
+    0xa1, 0x9c, 0x7c, 0x29, 0x60, 0x4e, 0x2f, 0x7f, 0xc1, 0x5d, 0x5e, 0x99, 0x47, 0x06, 0xcf, 0x83,
+    0x8e, 0x86, 0x36, 0xa5, 0x9b, 0xc8, 0x14, 0xfb, 0xb8, 0xc8, 0x7d, 0x96, 0x23, 0xc8, 0x74, 0x11,
+    0x5d, 0xa4, 0xf1, 0x54, 0x86, 0x20, 0x4a, 0xf3, 0x65, 0x93, 0x94, 0xb0, 0xe7, 0xa3, 0x65, 0xe4,
+    0x2c, 0x42, 0x8f, 0x1b, 0x8a, 0xe8, 0x1a, 0x95, 0x8c, 0x71, 0xc7, 0xc8, 0x08, 0xca, 0x19, 0x30,
+    0xa0, 0xaa, 0x9c, 0xba, 0xd4, 0xc1, 0xa8, 0x15, 0x9c, 0x6e, 0x60, 0x8c, 0xc4, 0x07, 0xf4, 0x22,
+    0x57, 0x97, 0xf8, 0x1d, 0x89, 0x77, 0x58, 0xda, 0xb6, 0x3a, 0x4e, 0xf2, 0xc5, 0x71, 0x52, 0x59,
+    0x9b, 0x6b, 0x02, 0x98, 0x58, 0x51, 0x83, 0xc2, 0x76, 0x9a, 0x9d, 0xbd, 0xc2, 0x07, 0x9c, 0xa4,
+    0x51, 0x2d, 0x49, 0x53, 0xfb, 0x31, 0xc3, 0xbe, 0x91, 0x27, 0x4a, 0x86, 0x83, 0x5e, 0xb5, 0x01,
+    0xe9, 0xa9, 0x2b, 0x92, 0x56, 0x1a, 0xdf, 0x80, 0xbf, 0x78, 0x86, 0x0d, 0xbe, 0x10, 0xbe, 0x3c,
+    0x7d, 0x5e, 0xc3, 0x92, 0x2f, 0x0c, 0x27, 0x33, 0x81, 0xa4, 0x4e, 0x79, 0x98, 0xc1, 0x16, 0xbe,
+    0xa9, 0x03, 0x8f, 0x7d, 0xff, 0xa0, 0x07, 0xc6, 0x6f, 0x1e, 0x53, 0x30, 0x6d, 0x1c, 0x63, 0x5d,
+    0x9c, 0x78, 0x56, 0x4c, 0x64, 0x32, 0x12, 0xd8, 0xaf, 0xf0, 0x19, 0x40, 0x33, 0xbf, 0x7d, 0xcc,
+    0x8e, 0x0f, 0xba, 0x34, 0x6f, 0x6a, 0xea, 0x64, 0x01, 0x78, 0x61, 0xc2, 0xef, 0x11, 0x4e, 0x28,
+    0xf9, 0x58, 0xf7, 0x39, 0xcc, 0x03, 0x2f, 0x86, 0xd4, 0xb5, 0x87, 0x4a, 0x53, 0xfe, 0x1e, 0x9c,
+    0x4c, 0x6d, 0x84, 0xbf, 0xb7, 0x5b, 0x82, 0xbb, 0x64, 0x83, 0x29, 0x24, 0xd6, 0x52, 0xbe, 0xce,
+    0x16, 0x16, 0x09, 0xda, 0xb4, 0x91, 0x37, 0xea, 0xf4, 0xaf, 0x34, 0xb0, 0x87, 0x35, 0x80, 0xfd,
+    0x38, 0xcb, 0xc9, 0x9e, 0xf6, 0xb2, 0xa5, 0xd2, 0xe2, 0x38, 0x71, 0xd6, 0x6a, 0xd9, 0x94, 0x44,
+    0x43, 0x8a, 0x1d, 0xc7, 0xb7, 0x25, 0xf1, 0x7c, 0x04, 0xbf, 0x94, 0x62, 0xf8, 0xc0, 0x49, 0xf0,
+    0xd7, 0x4c, 0x0f, 0xb0, 0x14, 0x2d, 0xd3, 0x0a, 0x38, 0x71, 0x57, 0x18, 0xcb, 0x5c, 0x1f, 0x70,
+    0x8c, 0xf7, 0x36, 0x1f, 0xd9, 0x24, 0x95, 0x89, 0x1a, 0x1d, 0x84, 0xe0, 0xe5, 0x03, 0xae, 0x38,
+    0x1b, 0xb2, 0x5f, 0x3f, 0xf5, 0xe9, 0x51, 0x81, 0xdb, 0x7e, 0x55, 0x1e, 0x82, 0x78, 0x54, 0x19,
+    0xc9, 0xe2, 0x45, 0x0a, 0x29, 0xd7, 0x90, 0x45, 0x8b, 0x30, 0xd4, 0x43, 0xb0, 0x29, 0x78, 0x2f,
+    0xb4, 0x3e, 0x77, 0x54, 0x37, 0xa5, 0x31, 0x14, 0xc0, 0xb0, 0x6f, 0xc6, 0x52, 0x7e, 0x73, 0x01,
+    0xe6, 0x25, 0xa3, 0x6b, 0x18, 0x24, 0x73, 0xee, 0x1f, 0x80, 0x13, 0x06, 0x7f, 0x03, 0xd6, 0x70,
+    0x11, 0xcb, 0x48, 0x65, 0x30, 0x71, 0x84, 0x1e, 0xdd, 0x8c, 0x9b, 0x48, 0x31, 0x64, 0x41, 0x3c,
+    0x59, 0xa0, 0x5b, 0x6e, 0x5f, 0x0b, 0x75, 0x16, 0x92, 0x87, 0xfe, 0xe9, 0xee, 0x3c, 0xf0, 0xea,
+    0x4e, 0x00, 0xa9, 0x37, 0xf2, 0x65, 0xea, 0x16, 0xd6, 0xe8, 0xc5, 0xb8, 0x02, 0x3b, 0x55, 0x60,
+    0x86, 0x5e, 0xbd, 0x17, 0x20, 0xd0, 0x74, 0x11, 0x51, 0xc8, 0x65, 0x5c, 0x29, 0x3e, 0x99, 0xbd,
+    0xfc, 0x07, 0xbf, 0xc5, 0x48, 0xec, 0x61, 0xc0, 0x3b, 0x0f, 0x9a, 0x2c, 0xe1, 0x70, 0x9a, 0xd0,
+    0x4c, 0x9b, 0x4c, 0x0b, 0x13, 0x07, 0x49, 0xf4, 0x8d, 0x7b, 0x08, 0x9f, 0x7a, 0x0f, 0x8a, 0xe4,
+    0x9b, 0x09, 0xd3, 0xb8, 0x60, 0x33, 0xc6, 0xe4, 0x94, 0x79, 0x4f, 0xf0, 0xb9, 0x01, 0x51, 0x58,
+    0x2d, 0xd2, 0xa8, 0x6f, 0x5a, 0x92, 0x6d, 0x1e, 0x04, 0x67, 0x4b, 0x58, 0xf1, 0x56, 0x42, 0xfc,
+    0x88, 0x44, 0x0a, 0xec, 0x50, 0x34, 0xae, 0x37, 0x99, 0xa5, 0xd1, 0x13, 0xb4, 0x27, 0x63, 0xa2,
+    0x9d, 0xa4, 0x02, 0x81, 0x5f, 0x89, 0x29, 0x5f, 0x84, 0xca, 0x23, 0xdc, 0x2e, 0x35, 0x46, 0x57,
+    0x91, 0xb8, 0x61, 0xaf, 0xcd, 0x23, 0x91, 0x51, 0x02, 0x84, 0x83, 0x86, 0xc2, 0x37, 0xf3, 0x48,
+    0xb5, 0x97, 0xb3, 0x6b, 0x00, 0x91, 0x5e, 0x02, 0x1b, 0x6a, 0x8d, 0xb2, 0x7f, 0xfe, 0x93, 0xd9,
+    0xe7, 0x7a, 0xdd, 0x65, 0xc2, 0x22, 0x5d, 0xa4, 0x88, 0xb4, 0x8e, 0x09, 0xcc, 0x8b, 0x3a, 0x3b,
+    0x64, 0x90, 0x97, 0xc7, 0x81, 0xf8, 0xeb, 0xc7, 0x73, 0x70, 0x81, 0x49, 0x1c, 0x01, 0xd1, 0xce,
+    0x26, 0x30, 0x5f, 0x1f, 0x6e, 0x80, 0x82, 0x6d, 0x0c, 0x11, 0x53, 0xa1, 0x26, 0x33, 0x0f, 0x10,
+    0x37, 0xe8, 0x91, 0xb1, 0xb6, 0x9a, 0x89, 0xc8, 0x4b, 0xd9, 0x70, 0xc4, 0xd2, 0x36, 0x69, 0xb3,
+    0x51, 0x9e, 0xca, 0x25, 0xa6, 0x6e, 0x95, 0x91, 0x59, 0x41, 0x21, 0xfc, 0xb7, 0x59, 0x57, 0x56,
+    0xc9, 0x66, 0x6b, 0x2b, 0x83, 0x4c, 0x35, 0x60, 0x5d, 0x5b, 0x46, 0xa0, 0x99, 0xbf, 0x5c, 0xbd,
+    0x7b, 0x8b, 0x2c, 0x0e, 0xc6, 0x23, 0x24, 0x5d, 0x3b, 0xc2, 0x43, 0x12, 0x0b, 0xb0, 0x03, 0xc7,
+    0x7c, 0x54, 0xb7, 0x8b, 0x1f, 0x72, 0xb2, 0x26, 0x1c, 0x79, 0x28, 0x34, 0x99, 0xa6, 0x8d, 0x7b,
+    0xa2, 0x27, 0x0e, 0x45, 0x3b, 0x8c, 0xaf, 0x69, 0xa4, 0x0f, 0x0b, 0x70, 0x29, 0xfe, 0x7e, 0x38,
+    0xa8, 0x58, 0x64, 0xbd, 0x68, 0x95, 0x82, 0x4d, 0xc0, 0x8f, 0x19, 0x30, 0x0f, 0xa5, 0x56, 0xa4,
+    0x19, 0x7b, 0x0b, 0xe7, 0xb1, 0xda, 0x2e, 0xcd, 0x80, 0xd3, 0x13, 0x86, 0xa6, 0x5f, 0xc5, 0xef,
+    0x36, 0x22, 0x11, 0x41, 0x3d, 0xef, 0xea, 0xc1, 0x53, 0xbd, 0xda, 0xe9, 0xc3, 0x31, 0xc2, 0x5f,
+    0x6e, 0x45, 0x6e, 0x46, 0x9f, 0xb7, 0xee, 0x34, 0x71, 0x4c, 0x0f, 0xd8, 0x07, 0xb7, 0x09, 0x68,
+    0xc7, 0x08, 0xbd, 0xd3, 0xc5, 0xa3, 0xc0, 0xb0, 0x19, 0x79, 0xaf, 0x8a, 0xbc, 0xb7, 0x06, 0x79,
+    0x6f, 0x05, 0x79, 0x6f, 0x2b, 0xf2, 0xa2, 0x0b, 0x65, 0xe4, 0xaa, 0x07, 0xca, 0x82, 0x2f, 0x8d,
+    0x11, 0x72, 0xb7, 0x1f, 0xb5, 0x0d, 0x7b, 0xaf, 0x8a, 0xbd, 0xb7, 0x06, 0x7b, 0x6f, 0x05, 0xfb,
+    0x76, 0xda, 0x9d, 0x46, 0x0a, 0xad, 0xb6, 0x03, 0xfa, 0xa1, 0xdc, 0x94, 0xd1, 0x63, 0x84, 0xdd,
+    0x76, 0x54, 0x1e, 0xc1, 0xec, 0x76, 0x29, 0xc8, 0x5c, 0xec, 0x80, 0xb6, 0x9d, 0x72, 0xcb, 0x43,
+    0x03, 0x20, 0xe6, 0xbc, 0x5b, 0xf1, 0x28, 0xd1, 0xa6, 0x05, 0x60, 0x95, 0x45, 0x03, 0x15, 0x6d,
+    0x96, 0xc6, 0x0c, 0xd1, 0xe5, 0x6e, 0xc0, 0x23, 0x3b, 0xe4, 0xa5, 0xb4, 0x45, 0xa0, 0xeb, 0xda,
+    0xb2, 0xd0, 0x4b, 0x63, 0xb4, 0x03, 0x16, 0xf1, 0x50, 0x59, 0x6f, 0x41, 0x2c, 0x57, 0x10, 0xcb,
+    0x35, 0x88, 0xe5, 0x0a, 0x62, 0xb9, 0x0d, 0x71, 0xb0, 0x82, 0x38, 0x58, 0x83, 0x38, 0x58, 0x41,
+    0x1c, 0xb8, 0x88, 0x3b, 0x1d, 0xa6, 0x2b, 0x0c, 0x0a, 0xf3, 0x19, 0x86, 0x6b, 0x4c, 0x0d, 0x4d,
+    0x39, 0x34, 0x4d, 0xe3, 0x39, 0xeb, 0x50, 0x70, 0xc9, 0xfa, 0x4c, 0x00, 0x09, 0x50, 0x09, 0x65,
+    0x19, 0xbf, 0x86, 0xf4, 0x36, 0x63, 0x35, 0x3c, 0xde, 0x7d, 0xf5, 0x79, 0x91, 0x35, 0x39, 0x95,
+    0x7a, 0x4d, 0x88, 0xe3, 0x4d, 0x73, 0xf6, 0x9b, 0x48, 0x84, 0x68, 0x4e, 0x43, 0x7e, 0x9d, 0x35,
+    0xc7, 0x29, 0xff, 0x22, 0xfa, 0xed, 0x76, 0xbb, 0x56, 0x84, 0xd8, 0x52, 0x75, 0x73, 0x6f, 0xa2,
+    0xa1, 0x4e, 0x23, 0x1a, 0x26, 0x9d, 0x68, 0x4f, 0xc2, 0x38, 0x13, 0x3a, 0x9e, 0x69, 0x6f, 0x3d,
+    0xfb, 0xfd, 0xb1, 0x90, 0x6f, 0xab, 0xae, 0x7a, 0xa3, 0x4d, 0x2c, 0x62, 0x7c, 0xf2, 0x71, 0x71,
+    0x91, 0x9d, 0x40, 0x08, 0xa4, 0xc0, 0x7a, 0x49, 0x23, 0x5e, 0xdd, 0x30, 0xf7, 0x62, 0xf6, 0xfb,
+    0xa6, 0xc8, 0x33, 0xfb, 0xbd, 0xd1, 0x28, 0x70, 0xb4, 0xe3, 0x28, 0x4e, 0x44, 0x84, 0x91, 0xd2,
+    0x7a, 0x6f, 0x70, 0xdd, 0x9b, 0x93, 0x10, 0xa7, 0x50, 0x03, 0xaa, 0x30, 0x3a, 0x9d, 0xea, 0x97,
+    0xf4, 0x18, 0x33, 0xf4, 0x2c, 0x64, 0x3d, 0x75, 0xf0, 0xf5, 0xa5, 0x3d, 0xa8, 0x29, 0xf3, 0x7d,
+    0x36, 0x49, 0xb1, 0x9c, 0x8d, 0xf0, 0xa5, 0xf2, 0x9a, 0x7d, 0xac, 0x36, 0x87, 0xab, 0x69, 0x85,
+    0x09, 0x8f, 0xc6, 0x12, 0x86, 0x90, 0x66, 0x60, 0x5e, 0xd8, 0xce, 0x92, 0x50, 0x42, 0xbe, 0xd4,
+    0xaf, 0xdb, 0x70, 0x0c, 0x74, 0x7a, 0x98, 0xc4, 0x49, 0x80, 0xe9, 0xf6, 0xe1, 0x63, 0x60, 0x17,
+    0xb5, 0x75, 0x1e, 0x0f, 0x63, 0x87, 0x87, 0x0d, 0x66, 0x03, 0xaf, 0x49, 0x4b, 0x00, 0xda, 0x80,
+    0xfd, 0x2a, 0x3f, 0x59, 0xac, 0xcd, 0x7a, 0x1e, 0x69, 0x6d, 0x74, 0xd6, 0xf9, 0x23, 0x24, 0x09,
+    0x99, 0x38, 0x07, 0x6d, 0x4c, 0x7f, 0xf5, 0x3f, 0xe5, 0x30, 0x60, 0xbc, 0x10, 0xe0, 0x4d, 0x4a,
+    0x09, 0x59, 0x6e, 0x3c, 0xf9, 0x82, 0x76, 0x79, 0xd4, 0x63, 0x63, 0x09, 0x19, 0x63, 0x3c, 0x85,
+    0xa2, 0x7b, 0x92, 0xc6, 0xba, 0xa0, 0xcf, 0x20, 0x67, 0x8b, 0x99, 0x54, 0xec, 0x26, 0xe5, 0x49,
+    0x66, 0xea, 0xfa, 0x3f, 0x75, 0xb1, 0x2e, 0x5f, 0x28, 0x91, 0x1d, 0x14, 0xe1, 0xbd, 0x48, 0x5c,
+    0x9f, 0x98, 0x44, 0xa7, 0xe1, 0xa6, 0xad, 0x87, 0x43, 0xe6, 0x79, 0x9a, 0xb0, 0x56, 0x91, 0xe4,
+    0x36, 0xd8, 0x68, 0x34, 0x62, 0x7e, 0x83, 0x75, 0x58, 0x57, 0x3c, 0xb3, 0x14, 0xba, 0x39, 0x30,
+    0x2d, 0xb1, 0x13, 0x24, 0xcb, 0x64, 0x91, 0xcd, 0x3c, 0x62, 0xed, 0x35, 0x54, 0x23, 0xc8, 0x5c,
+    0xf7, 0x53, 0x23, 0xe7, 0xce, 0xe6, 0xdd, 0x1a, 0xac, 0x20, 0xa0, 0x10, 0x91, 0xce, 0xc2, 0xd7,
+    0xa0, 0x39, 0xca, 0xd1, 0x3c, 0x1c, 0x18, 0x41, 0x7d, 0x11, 0x22, 0x21, 0x69, 0xe1, 0x21, 0xc1,
+    0xbe, 0x28, 0x7e, 0x0f, 0xe1, 0xb0, 0x80, 0x94, 0x13, 0xca, 0xb0, 0xfb, 0x34, 0x34, 0xc5, 0xbc,
+    0x2e, 0xd5, 0x95, 0x05, 0xc8, 0x12, 0xe2, 0x49, 0x07, 0x12, 0x92, 0xf6, 0x24, 0x5b, 0xe6, 0x29,
+    0x20, 0xd1, 0xae, 0x75, 0xcb, 0x46, 0x45, 0x86, 0x5e, 0x55, 0x31, 0x98, 0x61, 0x8a, 0x69, 0xa7,
+    0x0b, 0xde, 0x2a, 0xc0, 0x4b, 0x92, 0x40, 0xfd, 0xc3, 0x71, 0xf4, 0x9b, 0x7a, 0xd5, 0xaa, 0x0c,
+    0x36, 0x01, 0x58, 0x19, 0xac, 0x9f, 0x7f, 0xc8, 0x69, 0x7e, 0xe2, 0xd4, 0x18, 0x05, 0xa1, 0xe5,
+    0xc2, 0x43, 0xa5, 0x0b, 0x61, 0xf1, 0x62, 0x57, 0x0c, 0x44, 0xf3, 0x32, 0x92, 0x73, 0x8e, 0xc7,
+    0xe2, 0x35, 0x24, 0xa9, 0xc2, 0x2b, 0x1d, 0xc7, 0x35, 0x45, 0x8b, 0x1e, 0x04, 0x01, 0x7b, 0x79,
+    0xf6, 0xa6, 0x89, 0x78, 0xc0, 0x14, 0x2e, 0x77, 0x7d, 0x05, 0x14, 0x55, 0x0d, 0xea, 0x16, 0x1c,
+    0x9d, 0xe0, 0x29, 0xd4, 0x73, 0x0a, 0x38, 0xf0, 0x9b, 0xa6, 0x3e, 0xd1, 0x17, 0x77, 0xcc, 0x83,
+    0x6e, 0x7b, 0x99, 0xb2, 0xa1, 0xa4, 0x82, 0x01, 0xeb, 0xb9, 0xa9, 0x37, 0x95, 0x6c, 0x60, 0xd4,
+    0xc8, 0x90, 0x91, 0x1e, 0x9c, 0x99, 0x62, 0x86, 0xdf, 0xba, 0x33, 0xb9, 0x80, 0x35, 0xb2, 0x56,
+    0x37, 0x87, 0xbc, 0xd3, 0x38, 0xde, 0x71, 0x35, 0x6b, 0xc3, 0xd7, 0x36, 0x4f, 0x92, 0xf0, 0xce,
+    0xc3, 0xd3, 0xd0, 0x24, 0x9d, 0x35, 0x0a, 0x40, 0x42, 0xa9, 0x01, 0xf9, 0xed, 0x66, 0xc0, 0x19,
+    0xcf, 0x20, 0xa1, 0x2c, 0x2a, 0xbc, 0x8a, 0xf3, 0xf0, 0xb5, 0xf3, 0xb0, 0x1a, 0x5d, 0xe3, 0x3c,
+    0x10, 0x72, 0x89, 0xf5, 0x9b, 0x06, 0x01, 0xc7, 0x51, 0xd4, 0x25, 0x4f, 0x64, 0xf6, 0x9e, 0xbf,
+    0xf7, 0x96, 0x8d, 0x42, 0xbb, 0x34, 0xac, 0x37, 0x2d, 0x06, 0x59, 0x95, 0x31, 0x0f, 0x9f, 0x9b,
+    0x6c, 0xe9, 0xe4, 0xf8, 0x15, 0x8e, 0x3c, 0x7c, 0x2e, 0x43, 0xe4, 0xac, 0xb8, 0x36, 0xf3, 0xc0,
+    0x04, 0x36, 0x4c, 0xee, 0x4b, 0xb5, 0xc2, 0x12, 0x58, 0xc2, 0x1d, 0x1a, 0x76, 0xdf, 0x65, 0xbf,
+    0x32, 0x3f, 0xa2, 0xfd, 0x1a, 0x76, 0xd7, 0x7c, 0xfe, 0xa1, 0xb0, 0x1e, 0xad, 0x74, 0x0d, 0x00,
+    0x2e, 0x89, 0xf0, 0xdd, 0x6b, 0x84, 0x2d, 0xf0, 0xba, 0x20, 0x39, 0x9a, 0x3b, 0xd4, 0xdf, 0x1f,
+    0x8c, 0xbc, 0xf5, 0xe5, 0x0c, 0xa4, 0xf2, 0x18, 0xce, 0x85, 0x69, 0xcf, 0xe2, 0x63, 0x17, 0x1e,
+    0xb1, 0x25, 0x91, 0x3f, 0xe8, 0x6b, 0x50, 0xfa, 0xf9, 0x29, 0x45, 0x4c, 0x34, 0xca, 0xb1, 0xb8,
+    0x96, 0xd1, 0x05, 0x08, 0xc1, 0x44, 0x60, 0x18, 0x9a, 0xc7, 0x4b, 0x71, 0x15, 0x7b, 0x06, 0xb3,
+    0xc5, 0x92, 0x4f, 0xe3, 0x75, 0x2f, 0x77, 0xba, 0x64, 0xbb, 0xad, 0x7c, 0x97, 0x2a, 0xbc, 0x6b,
+    0xef, 0x2d, 0x4b, 0xe7, 0xf6, 0xd5, 0x10, 0xf7, 0xe2, 0x2f, 0xe2, 0x12, 0x1b, 0x42, 0x18, 0xe8,
+    0x4c, 0xcf, 0xb7, 0x5e, 0x9e, 0x2e, 0x68, 0xc7, 0xab, 0x2f, 0x08, 0x87, 0x97, 0x67, 0x8a, 0xeb,
+    0x6a, 0x39, 0x38, 0x86, 0xcd, 0x97, 0x78, 0xdb, 0x8a, 0x82, 0x26, 0x6e, 0x59, 0x9a, 0xfa, 0x89,
+    0x67, 0x02, 0xc9, 0xc5, 0xd9, 0xb9, 0x0c, 0x82, 0x50, 0xd4, 0xf3, 0x03, 0x70, 0x25, 0x27, 0x5f,
+    0x30, 0x44, 0x1e, 0x6f, 0xb0, 0xe9, 0xa1, 0x01, 0x59, 0x35, 0x66, 0xaa, 0xb9, 0x49, 0x8f, 0x87,
+    0xcc, 0x93, 0xec, 0x8f, 0x4c, 0x2b, 0xb9, 0x65, 0x4c, 0xa6, 0x63, 0x16, 0x1a, 0xcb, 0xa3, 0xcd,
+    0x8a, 0xfe, 0x85, 0x16, 0x0c, 0x00, 0x17, 0xea, 0x6b, 0xe9, 0x02, 0xbd, 0x58, 0x5f, 0xc6, 0x07,
+    0xf8, 0xab, 0x6b, 0x8d, 0x1d, 0x38, 0x48, 0x6c, 0x57, 0x60, 0xd5, 0x02, 0xd6, 0xd9, 0x00, 0xac,
+    0x3c, 0x6e, 0xb2, 0x3b, 0x67, 0x7e, 0x8d, 0x52, 0x01, 0xa8, 0x50, 0xab, 0x0b, 0x5b, 0x55, 0xe1,
+    0x84, 0x7e, 0xea, 0x55, 0x00, 0x77, 0xfb, 0xa9, 0x0c, 0xc3, 0xb5, 0x3a, 0x2f, 0xa6, 0xb1, 0x6b,
+    0x8a, 0x72, 0x68, 0xab, 0xf8, 0xb5, 0xbc, 0x15, 0x81, 0xe7, 0x37, 0x9a, 0xac, 0xa0, 0xf7, 0xb9,
+    0xa5, 0xe1, 0x61, 0x9d, 0xea, 0xf5, 0x45, 0xc4, 0x8d, 0xba, 0x07, 0x79, 0xe5, 0x8a, 0xbf, 0xdd,
+    0xae, 0xf8, 0xdb, 0xf5, 0x8a, 0x57, 0xbf, 0x90, 0xe6, 0x95, 0xab, 0x79, 0xa5, 0x35, 0xa5, 0x8c,
+    0xe6, 0x6e, 0xab, 0x9a, 0x47, 0xe7, 0x60, 0x99, 0x80, 0x35, 0x84, 0xa2, 0x00, 0x2f, 0x2f, 0x2f,
+    0x14, 0x6d, 0xe5, 0x5f, 0xb0, 0x6f, 0x35, 0xb1, 0xa3, 0x9e, 0x6f, 0x9b, 0x9b, 0xed, 0x6d, 0x55,
+    0xeb, 0x8f, 0x41, 0x03, 0xd5, 0xc7, 0x8f, 0xe8, 0x7e, 0x45, 0x95, 0xeb, 0x75, 0x4f, 0xca, 0x45,
+    0xe6, 0x73, 0xed, 0x76, 0x41, 0xbb, 0x5b, 0xf6, 0x7d, 0x5e, 0xd2, 0xf7, 0x1a, 0xc7, 0xf6, 0x08,
+    0x31, 0xa0, 0x57, 0xad, 0xd6, 0xa1, 0xdf, 0x97, 0x03, 0x27, 0xf2, 0xf6, 0x51, 0xa9, 0xf7, 0x1b,
+    0xf5, 0x63, 0x43, 0xac, 0xfc, 0xd4, 0x22, 0xa5, 0x74, 0x48, 0x45, 0xad, 0xb5, 0x0a, 0x6a, 0x99,
+    0x85, 0xad, 0x8a, 0x72, 0xd6, 0x9e, 0xf8, 0x56, 0xe9, 0xbc, 0x07, 0x66, 0x8f, 0x3b, 0xbd, 0x07,
+    0x9e, 0xf7, 0xd6, 0xfa, 0xd3, 0xde, 0xd2, 0x67, 0xbd, 0x55, 0x55, 0x1f, 0x84, 0x16, 0x09, 0x61,
+    0x05, 0x72, 0xd7, 0x92, 0xda, 0xe1, 0x8c, 0xe8, 0x80, 0x56, 0x52, 0x6f, 0xf9, 0xe4, 0x54, 0x7d,
+    0xec, 0x0e, 0x92, 0x9d, 0x4e, 0x73, 0xc9, 0x22, 0x77, 0x53, 0x99, 0x66, 0xaa, 0x1c, 0x4b, 0x8b,
+    0x83, 0x34, 0xc4, 0x63, 0x34, 0xd8, 0x92, 0x11, 0x4c, 0x36, 0x64, 0x04, 0x3a, 0x21, 0x98, 0x40,
+    0x42, 0x80, 0xf7, 0xa2, 0x21, 0xcb, 0x17, 0xfd, 0xff, 0xb7, 0xae, 0x26, 0xdf, 0xa4, 0x25, 0xe6,
+    0x59, 0x61, 0x01, 0xfb, 0xab, 0xba, 0x72, 0x24, 0x69, 0xb2, 0x51, 0x9b, 0x90, 0xac, 0x68, 0xd0,
+    0xc9, 0x2a, 0xb0, 0x03, 0x9d, 0x63, 0x7d, 0x34, 0x6c, 0x3e, 0x5d, 0x1b, 0x36, 0x37, 0xba, 0xe3,
+    0x7d, 0x1d, 0x2b, 0x0f, 0x93, 0x19, 0x1f, 0x23, 0xf2, 0x12, 0x6e, 0x3a, 0xee, 0x75, 0x2a, 0xbc,
+    0xbc, 0xac, 0x51, 0xcf, 0x8f, 0x39, 0xa9, 0xa2, 0xd3, 0xab, 0x66, 0x09, 0xc7, 0x85, 0xdd, 0xf1,
+    0xa5, 0xc3, 0x05, 0xd4, 0x04, 0x51, 0x86, 0xe5, 0x8e, 0xd7, 0x3d, 0xae, 0xac, 0xe9, 0xf4, 0x72,
+    0xa8, 0x34, 0xc6, 0xa6, 0x85, 0xd7, 0xa2, 0xcc, 0xef, 0xe2, 0xdc, 0x99, 0x29, 0x48, 0xd1, 0xaf,
+    0xb3, 0xe9, 0x92, 0x25, 0x50, 0x03, 0xc9, 0x93, 0x5f, 0x2c, 0x87, 0x8a, 0x21, 0x4e, 0xcd, 0xae,
+    0x3a, 0x03, 0xbb, 0x86, 0x0a, 0xe1, 0x6f, 0x85, 0x51, 0x58, 0x6f, 0xdc, 0xf5, 0xe9, 0x97, 0x5f,
+    0x06, 0xfc, 0x3b, 0xa5, 0x63, 0x60, 0x90, 0x5d, 0x7f, 0xad, 0x04, 0xd1, 0xf0, 0x76, 0x49, 0x4a,
+    0xa0, 0xdc, 0xd3, 0x0d, 0x99, 0xdd, 0x12, 0x25, 0xf7, 0xd0, 0x96, 0x23, 0x3c, 0x51, 0xdf, 0xb4,
+    0xd4, 0x99, 0xd9, 0x3c, 0xc9, 0xa3, 0xd9, 0xc3, 0x9e, 0x5f, 0x05, 0x58, 0xb1, 0xa0, 0xb5, 0x26,
+    0x52, 0x11, 0xab, 0xbe, 0x2c, 0x50, 0xb7, 0xb8, 0x00, 0xef, 0xb1, 0x83, 0x57, 0x33, 0x65, 0x5a,
+    0x4b, 0x22, 0xd8, 0xee, 0x5a, 0xf6, 0xe1, 0xeb, 0xb0, 0x7b, 0xbc, 0x95, 0xb5, 0x02, 0xe6, 0xab,
+    0xb8, 0x33, 0x6f, 0x7c, 0xd7, 0xb3, 0x47, 0xb8, 0xa1, 0x3e, 0x04, 0x0e, 0xaf, 0xa0, 0x02, 0x3f,
+    0xbb, 0xbc, 0x38, 0xea, 0x31, 0x28, 0xba, 0x6d, 0x93, 0x42, 0xf7, 0x49, 0x9a, 0x79, 0x57, 0x9d,
+    0x3a, 0xeb, 0x68, 0xa8, 0x8c, 0xac, 0x5a, 0x52, 0x4d, 0x79, 0x23, 0xc1, 0xb0, 0xa8, 0xeb, 0x71,
+    0x13, 0x15, 0xbd, 0x3c, 0xdd, 0xf4, 0xc0, 0xba, 0xfe, 0xf4, 0xf2, 0x17, 0x44, 0x60, 0x9b, 0x7a,
+    0x52, 0x39, 0xe5, 0xa8, 0x7b, 0x03, 0x00, 0xfd, 0xea, 0x8d, 0x8c, 0x60, 0xac, 0x1d, 0xc6, 0x13,
+    0xaa, 0x7d, 0xdb, 0xb3, 0x54, 0x4c, 0xe9, 0x35, 0x8e, 0xe9, 0x04, 0xd4, 0x2d, 0xb5, 0xd8, 0x3c,
+    0x48, 0x17, 0x51, 0xc6, 0x78, 0x2a, 0x4c, 0xd3, 0x00, 0xce, 0x86, 0x8a, 0xd9, 0x34, 0xe4, 0xd9,
+    0x8c, 0x8d, 0xef, 0x68, 0x6b, 0x62, 0xc8, 0x12, 0x02, 0xec, 0x2c, 0xd2, 0x25, 0xde, 0xfd, 0xc0,
+    0xe6, 0x1e, 0x16, 0xcf, 0x08, 0xa2, 0xf8, 0x98, 0x81, 0xd7, 0xe7, 0x80, 0x24, 0x13, 0xaa, 0xd2,
+    0x24, 0xa4, 0xd7, 0xf0, 0xc5, 0xfb, 0x35, 0xf3, 0x72, 0xf3, 0xb1, 0x46, 0x60, 0x71, 0xb5, 0xc0,
+    0xb6, 0x02, 0x8b, 0x16, 0x62, 0x14, 0xdf, 0xd8, 0xda, 0x6e, 0x1a, 0xc6, 0x10, 0xdb, 0xc1, 0xf1,
+    0x8b, 0x36, 0x8c, 0x7a, 0xd4, 0xbb, 0x01, 0xed, 0x91, 0x6a, 0xf5, 0x6b, 0xa6, 0x7a, 0x07, 0xd9,
+    0xeb, 0x10, 0x19, 0x2f, 0xcc, 0xc6, 0x9b, 0x1a, 0x85, 0x66, 0x9a, 0x5e, 0x63, 0xfd, 0x88, 0x1a,
+    0x20, 0x40, 0x40, 0xac, 0x5f, 0xfb, 0x54, 0xde, 0x45, 0x41, 0xfd, 0x06, 0x9c, 0xa2, 0x5f, 0x8b,
+    0x17, 0xca, 0x43, 0xf1, 0xe3, 0xd5, 0x8a, 0x26, 0xbe, 0xe4, 0xa4, 0xde, 0xc1, 0x3e, 0xef, 0x88,
+    0x1e, 0x5c, 0x81, 0x99, 0x6b, 0x0b, 0xf7, 0xab, 0x3c, 0x40, 0xe6, 0xda, 0xf8, 0xdf, 0x50, 0x61,
+    0x11, 0xad, 0x92, 0x61, 0x29, 0x30, 0xaf, 0xeb, 0xfe, 0x91, 0x21, 0x11, 0x55, 0xaa, 0x42, 0x99,
+    0xd9, 0x17, 0x75, 0x8f, 0xa9, 0x78, 0x43, 0xc7, 0x13, 0x57, 0xb7, 0xb5, 0x31, 0xa2, 0x79, 0xbd,
+    0x60, 0x75, 0xf3, 0xa6, 0x1c, 0x1b, 0xa0, 0xec, 0x84, 0xd5, 0xeb, 0xee, 0x1b, 0x4a, 0x7d, 0x59,
+    0xe3, 0x71, 0x5b, 0xa2, 0x3b, 0x1c, 0xb6, 0x35, 0x49, 0x0b, 0x2a, 0xef, 0xfe, 0x54, 0x3a, 0x1a,
+    0xa8, 0xd9, 0x88, 0xee, 0x88, 0xc0, 0x27, 0x7e, 0xcf, 0xef, 0x76, 0x98, 0x67, 0xba, 0x31, 0x20,
+    0x82, 0xe2, 0x59, 0x37, 0x3f, 0xf3, 0x67, 0xfd, 0xa5, 0x03, 0x98, 0x0c, 0x79, 0x9a, 0x0d, 0x10,
+    0x59, 0x3b, 0xa3, 0xd6, 0x56, 0xa3, 0x8d, 0x6f, 0x79, 0x53, 0xec, 0x87, 0x43, 0x4c, 0x4e, 0xcf,
+    0xb8, 0xab, 0x17, 0x80, 0x6b, 0x94, 0xbb, 0x6f, 0x29, 0x99, 0xb9, 0x25, 0x36, 0x13, 0x70, 0x8c,
+    0xd0, 0xc4, 0x57, 0xda, 0xab, 0x48, 0x14, 0x00, 0x02, 0x82, 0xb6, 0x48, 0xe2, 0xc9, 0x0c, 0xe4,
+    0x85, 0x4d, 0x72, 0x3c, 0x14, 0x5e, 0x31, 0xf8, 0x47, 0x7d, 0x30, 0x20, 0xe5, 0x7e, 0x1b, 0xe3,
+    0xdf, 0x8f, 0x5d, 0xaa, 0x14, 0xa4, 0x09, 0x27, 0x06, 0xc4, 0x39, 0x8e, 0x63, 0xc5, 0xd0, 0xd4,
+    0x11, 0x9c, 0x1e, 0x0e, 0xf1, 0x11, 0x47, 0x08, 0x03, 0x6d, 0xf2, 0x79, 0x9e, 0xd9, 0xd3, 0xe5,
+    0x54, 0x65, 0x04, 0x99, 0xe5, 0x2f, 0x48, 0x81, 0x66, 0x43, 0xeb, 0xa9, 0x08, 0x43, 0xaf, 0xaa,
+    0x58, 0x44, 0x26, 0x83, 0x3d, 0x80, 0xad, 0xa7, 0x30, 0x84, 0x40, 0x7e, 0x19, 0x81, 0x3d, 0x03,
+    0xbf, 0x68, 0x13, 0x1e, 0xd1, 0xc5, 0x20, 0x24, 0xa4, 0x37, 0xa9, 0x54, 0xb0, 0xac, 0xa1, 0xad,
+    0xa3, 0xb1, 0xe3, 0x0e, 0x46, 0x78, 0x7b, 0xd0, 0x63, 0x1a, 0xde, 0x1b, 0x57, 0x94, 0x8d, 0x8a,
+    0x33, 0xf4, 0xbb, 0xc3, 0x9a, 0x3e, 0xbe, 0x60, 0x96, 0x2f, 0x64, 0x30, 0xb4, 0x72, 0x96, 0x98,
+    0xb7, 0xd6, 0x6b, 0x23, 0xba, 0xa5, 0xc5, 0xad, 0xcd, 0xd8, 0x17, 0xc6, 0xfb, 0x1d, 0x5b, 0xf0,
+    0xe4, 0xc6, 0x5a, 0xb5, 0x23, 0xc7, 0x3f, 0x4a, 0x03, 0x21, 0xb9, 0xde, 0x9b, 0xe1, 0x85, 0x32,
+    0x27, 0xb8, 0xa4, 0x79, 0x5c, 0x19, 0xe3, 0xe5, 0x24, 0x91, 0x02, 0x40, 0x78, 0xc7, 0xf4, 0x35,
+    0x9b, 0xac, 0xa9, 0x65, 0x93, 0x51, 0xa4, 0xba, 0x41, 0x52, 0x00, 0x33, 0x00, 0xcf, 0xe9, 0xb6,
+    0x87, 0xbd, 0xda, 0x84, 0x68, 0xf2, 0xab, 0x21, 0xb9, 0xeb, 0xa8, 0xdc, 0xd4, 0x29, 0xdc, 0x3e,
+    0xde, 0x5a, 0x7c, 0xf4, 0xe5, 0x4f, 0x71, 0x89, 0xc8, 0x75, 0xfa, 0xd6, 0xf9, 0x98, 0xe9, 0x17,
+    0x74, 0xf9, 0x71, 0x83, 0x07, 0xc7, 0x39, 0xa8, 0x25, 0xef, 0xcd, 0x55, 0x4b, 0x30, 0x86, 0x8b,
+    0x0f, 0x97, 0x57, 0xf5, 0x26, 0xfd, 0xf1, 0xdf, 0xc9, 0xd6, 0xad, 0x31, 0xd4, 0xe7, 0xaf, 0x9e,
+    0x1e, 0x5c, 0xaf, 0x5f, 0xbe, 0x9c, 0x50, 0xbd, 0x95, 0x20, 0xf0, 0x5a, 0xc2, 0x56, 0xec, 0x1b,
+    0xbc, 0x1d, 0x3e, 0xf5, 0xf3, 0xdd, 0xbe, 0x36, 0x68, 0xb8, 0xb7, 0x9b, 0x0a, 0x91, 0x9b, 0xd7,
+    0x00, 0xdb, 0x85, 0xae, 0xfd, 0x2b, 0xd0, 0x66, 0xee, 0x26, 0xc1, 0x01, 0xeb, 0xc2, 0x59, 0xf2,
+    0xbf, 0x3a, 0xea, 0x1a, 0xbc, 0x26, 0xf0, 0x6a, 0x3a, 0xb4, 0xed, 0x6b, 0x92, 0x56, 0x42, 0xec,
+    0xce, 0x72, 0xce, 0x6b, 0x29, 0x7c, 0xa4, 0x17, 0x3c, 0xf5, 0x0f, 0x6f, 0xea, 0x58, 0x50, 0x7d,
+    0x93, 0x02, 0x4c, 0xff, 0xdd, 0x7d, 0xe3, 0xe0, 0xda, 0x79, 0xa3, 0x6a, 0xf5, 0x10, 0x75, 0xe9,
+    0xaf, 0xe3, 0xc0, 0x58, 0x3c, 0xc7, 0xe0, 0xf5, 0x1e, 0x4d, 0xbc, 0x6f, 0x67, 0xab, 0xca, 0xea,
+    0xa4, 0xf7, 0x55, 0x67, 0xbc, 0x94, 0x20, 0x94, 0x54, 0xbd, 0x2a, 0xf2, 0x22, 0x4f, 0x58, 0xd9,
+    0xfc, 0x5b, 0x12, 0x82, 0x0a, 0x17, 0xeb, 0xf7, 0xb6, 0x22, 0xde, 0x9a, 0x23, 0xe4, 0x19, 0x02,
+    0xb5, 0xd3, 0x50, 0x97, 0xe8, 0x91, 0xdb, 0x78, 0xdd, 0x36, 0x03, 0xf3, 0x83, 0xaf, 0xe4, 0x30,
+    0xc0, 0x50, 0x4e, 0x28, 0x38, 0xe5, 0x73, 0x14, 0x72, 0xf0, 0x5b, 0x93, 0xc6, 0x01, 0x51, 0x3b,
+    0x58, 0xa4, 0x94, 0xe8, 0xae, 0x0b, 0x52, 0x5d, 0x1b, 0xa4, 0x30, 0x36, 0xbc, 0x8f, 0xf3, 0xec,
+    0x13, 0x39, 0x12, 0x41, 0xbd, 0xa8, 0xcd, 0x01, 0x0f, 0x3a, 0x4e, 0x7a, 0xbf, 0x44, 0xf4, 0x1c,
+    0x82, 0x69, 0x41, 0x95, 0x67, 0x06, 0x69, 0x4f, 0x97, 0x12, 0x44, 0x5b, 0x90, 0x20, 0x42, 0x9e,
+    0x64, 0x22, 0x78, 0x94, 0x82, 0xd2, 0x5e, 0xfa, 0xb6, 0x71, 0x79, 0x2b, 0xf3, 0x3a, 0xcf, 0xd6,
+    0x09, 0x66, 0x33, 0x1c, 0xfd, 0x3c, 0xe7, 0xb7, 0x9f, 0x17, 0x9a, 0x79, 0xf8, 0xc0, 0x21, 0x83,
+    0xee, 0x5b, 0xac, 0xbe, 0xb0, 0xf5, 0x82, 0x79, 0xf6, 0xe3, 0x8f, 0xac, 0x6c, 0xf9, 0x60, 0x1e,
+    0xf8, 0x76, 0x2b, 0x37, 0xf7, 0xd2, 0x6c, 0x7f, 0x6d, 0x38, 0x78, 0x34, 0x29, 0xfd, 0xba, 0x08,
+    0xf7, 0x1a, 0x6a, 0x31, 0x7c, 0x9b, 0x89, 0x31, 0x8b, 0xae, 0xc9, 0xe0, 0x4d, 0xb7, 0x4c, 0x97,
+    0x4d, 0x38, 0x46, 0x5e, 0x3b, 0x73, 0x22, 0x9e, 0xcc, 0x40, 0x52, 0xc0, 0x50, 0xd9, 0x88, 0xed,
+    0xdf, 0x2c, 0x96, 0xed, 0x37, 0x33, 0xa3, 0xbb, 0x59, 0xae, 0x01, 0x36, 0xf6, 0x4b, 0xdd, 0x2e,
+    0x27, 0xc4, 0x01, 0x69, 0x39, 0x44, 0xe5, 0x8d, 0xaa, 0xbe, 0x22, 0xea, 0xb8, 0xe3, 0xdf, 0x16,
+    0x50, 0x1f, 0x5e, 0x8a, 0x50, 0x4c, 0x14, 0xb8, 0xd4, 0xba, 0xfe, 0x4b, 0x62, 0x7d, 0xbd, 0x9f,
+    0x1c, 0xa3, 0x39, 0x01, 0xb5, 0x4f, 0x45, 0x52, 0x43, 0x9d, 0x31, 0x84, 0x6b, 0x68, 0x74, 0x26,
+    0x5c, 0x0d, 0xf3, 0x4d, 0x69, 0xfd, 0x27, 0xe7, 0xd5, 0xe5, 0x9e, 0xb2, 0x2e, 0x4b, 0xa9, 0x7f,
+    0x50, 0xd4, 0x02, 0xfa, 0xfb, 0x8a, 0x33, 0x2b, 0x5d, 0x04, 0xe9, 0xe3, 0x5f, 0x1f, 0x9b, 0xbb,
+    0xa8, 0x83, 0x8e, 0xf9, 0xfb, 0xe3, 0x8e, 0xfe, 0x5f, 0x1f, 0xfc, 0x07, 0xd1, 0xe9, 0x18, 0x91,
+    0x12, 0x41, 0x00, 0x00,
+};
+
+#endif
@@ -0,0 +1,178 @@
+/** @file WheelEstimator.cpp
+ *  This file contains the WheelEstimator class, which estimates the moment of inertia and
+ *  the friction of the reaction wheel with recursive least squares.
+*/
+
+#include "WheelEstimator.h"
+
+// Conversion from RPM to rad/s
+static const float RPM_TO_RAD_S = 2.0f * 3.14159265f / 60.0f;
+
+// Shortest and longest time over which the acceleration is measured (us)
+static const uint64_t MIN_SAMPLE_GAP_US = 100000;
+static const uint64_t MAX_SAMPLE_GAP_US = 500000;
+
+
+
+/** @brief Constructor for the WheelEstimator class
+ *
+ *  @param lambda_ The forgetting factor. 0.995 weights roughly the last 200 samples.
+ *  @param min_rpm_ The slowest speed used. Near zero the direction of the Coulomb friction
+ *  is not known, and one FGOUT period can span the wheel stopping and turning back, so
+ *  those samples are skipped.
+ */
+WheelEstimator::WheelEstimator(float lambda_, float min_rpm_)
+{
+    lambda = (lambda_ > 0.9f && lambda_ <= 1.0f) ? lambda_ : 0.995f;
+    min_speed = min_rpm_ * RPM_TO_RAD_S;
+    p_init = 1.0e6f;
+    max_trace = 1.0e8f;
+    reset(WheelModel());
+}
+
+
+
+/** @brief A function which starts the estimate again from a known model
+ *
+ *  @param prior The model to start from, such as the one the Controller is using.
+ */
+void WheelEstimator::reset(const WheelModel& prior)
+{
+    float inv_J = 1.0f / prior.get_J();
+    theta[0] = inv_J;
+    theta[1] = prior.get_b() * inv_J;
+    theta[2] = prior.get_c() * inv_J;
+
+    for (uint8_t i = 0; i < WHEEL_PARAMS; i++)
+    {
+        for (uint8_t j = 0; j < WHEEL_PARAMS; j++)
+        {
+            P[i][j] = (i == j) ? p_init : 0.0f;
+        }
+    }
+
+    have_last = false;
+    used = 0;
+}
+
+
+
+/** @brief A function which adds one speed measurement to the estimate
+ *
+ *  @details The acceleration is measured between this sample and an earlier anchor sample
+ *  and matched with the average speed over that interval. The anchor is kept until at least
+ *  100 ms have passed, since the error in a difference of two speeds shrinks with the time
+ *  between them. The interval is thrown away and a new anchor taken if the torque was not
+ *  known or changed, the wheel turned slower than min_rpm_ or changed direction, or more
+ *  than 500 ms passed.
+ *
+ *  @param now_us The time of the measurement in microseconds. A speed averaged over a span
+ *  of edges is the speed halfway through that span, so that is the time to pass; the time
+ *  of the latest edge would make the acceleration wrong whenever the span changes length.
+ *  @param speed The measured speed.
+ *  @param torque The torque applied to the wheel in N*m.
+ *  @param known True if the torque is really what the wheel is receiving. Samples taken while
+ *  the motor or brake applies an unknown torque must pass false.
+ *
+ *  @return True if the sample updated the estimate.
+ */
+bool WheelEstimator::sample(uint64_t now_us, rpm_t speed, float torque, bool known)
+{
+    float omega = rpm_to_float(speed) * RPM_TO_RAD_S;
+    bool fast = (omega > 0.0f ? omega : -omega) >= min_speed;
+
+    bool same = have_last && known && fast && torque == last_torque && omega * last_omega > 0.0f
+                && now_us > last_us && now_us - last_us <= MAX_SAMPLE_GAP_US;
+    if (same && now_us - last_us < MIN_SAMPLE_GAP_US)
+    {
+        // keep the anchor until the interval is long enough
+        return false;
+    }
+
+    if (same)
+    {
+        float dt = (float)(now_us - last_us) * 1.0e-6f;
+        float mid = 0.5f * (omega + last_omega);
+        float phi[WHEEL_PARAMS] = { torque, -mid, (mid > 0.0f) ? -1.0f : 1.0f };
+        update(phi, (omega - last_omega) / dt);
+        used++;
+    }
+
+    last_us = now_us;
+    last_omega = omega;
+    last_torque = torque;
+    have_last = known && fast;
+    return same;
+}
+
+
+
+/** @brief A function which does one recursive least squares step
+ *
+ *  @details With k = P phi / (lambda + phi' P phi), the estimate moves by k times the error
+ *  in the predicted acceleration and P becomes (P - k phi' P) / lambda. Dividing by lambda
+ *  is skipped once the trace of P is large, which happens when the samples stop exciting
+ *  some parameter, so P cannot grow until one sample throws the estimate off.
+ *
+ *  @param phi The regressor [T, -w, -sign(w)].
+ *  @param y The measured acceleration in rad/s^2.
+ */
+void WheelEstimator::update(const float phi[WHEEL_PARAMS], float y)
+{
+    float Pphi[WHEEL_PARAMS];
+    float denom = lambda;
+    float error = y;
+    for (uint8_t i = 0; i < WHEEL_PARAMS; i++)
+    {
+        Pphi[i] = 0.0f;
+        for (uint8_t j = 0; j < WHEEL_PARAMS; j++)
+        {
+            Pphi[i] += P[i][j] * phi[j];
+        }
+        denom += phi[i] * Pphi[i];
+        error -= phi[i] * theta[i];
+    }
+
+    float trace = 0.0f;
+    for (uint8_t i = 0; i < WHEEL_PARAMS; i++)
+    {
+        theta[i] += Pphi[i] / denom * error;
+        trace += P[i][i];
+    }
+    float scale = (trace < max_trace) ? 1.0f / lambda : 1.0f;
+
+    // P is symmetric, so phi' P is Pphi transposed; update the upper triangle and mirror it
+    for (uint8_t i = 0; i < WHEEL_PARAMS; i++)
+    {
+        for (uint8_t j = i; j < WHEEL_PARAMS; j++)
+        {
+            P[i][j] = (P[i][j] - Pphi[i] * Pphi[j] / denom) * scale;
+            P[j][i] = P[i][j];
+        }
+    }
+}
+
+
+
+/** @brief A function which returns the estimated model
+ *
+ *  @details The estimate is only given out once enough samples have been used and it is
+ *  physically possible: a positive moment of inertia and friction that is not negative.
+ *  Small negative friction estimates, which noise can give a frictionless wheel, are
+ *  clamped to zero by WheelModel::set_params().
+ *
+ *  @param out Filled in with J, b and c if the estimate is usable; its step is not changed.
+ *  @param min_samples The number of samples needed before the estimate is trusted.
+ *
+ *  @return True if out was filled in.
+ */
+bool WheelEstimator::model(WheelModel& out, uint32_t min_samples)
+{
+    if (used < min_samples || !(theta[0] > 0.0f))
+    {
+        return false;
+    }
+    float J = 1.0f / theta[0];
+    out.set_params(J, theta[1] * J, theta[2] * J);
+    return true;
+}
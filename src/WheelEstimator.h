@@ -0,0 +1,70 @@
+/** @file WheelEstimator.h
+ *  This file contains the WheelEstimator class, which estimates the moment of inertia and
+ *  the viscous and Coulomb friction of the reaction wheel while it runs, with recursive
+ *  least squares. The estimates can replace the WheelModel the Controller integrates, so
+ *  torque commands still give the right speeds after the flywheel or load is changed.
+ *
+ *  All storage is fixed size and each sample is processed in bounded time. Nothing in this
+ *  file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _WHEELESTIMATOR_H_
+#define _WHEELESTIMATOR_H_
+
+#include <stdint.h>
+#include "SpeedType.h"
+#include "WheelModel.h"
+
+// Number of parameters estimated: 1/J, b/J and c/J
+#define WHEEL_PARAMS 3
+
+/** This class is used to estimate a WheelModel from torque and speed measurements
+ *
+ *  @details The wheel obeys dw/dt = T / J - (b / J) w - (c / J) sign(w), which is linear in
+ *  the parameters theta = [1/J, b/J, c/J] with the regressor [T, -w, -sign(w)]. The
+ *  acceleration is measured from the change in speed between samples, and only appears on
+ *  the measured side, so noise on the speed does not bias the estimate. A forgetting factor
+ *  lets the estimate follow a change of load, and the covariance is kept from growing without
+ *  bound while the samples carry no new information.
+ */
+class WheelEstimator
+{
+    protected:
+
+        float theta[WHEEL_PARAMS];                  // estimated 1/J, b/J and c/J
+        float P[WHEEL_PARAMS][WHEEL_PARAMS];        // covariance of the estimate
+        float lambda;                               // forgetting factor, just below 1
+        float p_init;                               // starting covariance on the diagonal
+        float min_speed;                            // slowest speed used, in rad/s
+        float max_trace;                            // covariance trace above which forgetting stops
+
+        uint64_t last_us;                           // time of the anchor sample
+        float last_omega;                           // speed at the anchor sample in rad/s
+        float last_torque;                          // torque at the anchor sample in N*m
+        bool have_last;                             // true if the anchor sample can be used
+        uint32_t used;                              // number of samples used since reset()
+
+        void update(const float phi[WHEEL_PARAMS], float y);
+
+    public:
+
+        /** Non-inline functions are commented in WheelEstimator.cpp */
+        WheelEstimator(float lambda_ = 0.995f, float min_rpm_ = 60.0f);
+
+        void reset(const WheelModel& prior);
+        bool sample(uint64_t now_us, rpm_t speed, float torque, bool known);
+        bool model(WheelModel& out, uint32_t min_samples);
+
+
+
+        /** @brief A function which returns how many samples have been used
+         *
+         *  @return The number of samples which updated the estimate since reset().
+         */
+        uint32_t samples(void)
+        {
+            return used;
+        }
+};
+
+#endif
@@ -0,0 +1,102 @@
+/** @file WheelModel.cpp
+ *  This file contains the WheelModel class, which describes how the reaction wheel speeds
+ *  up under a torque with viscous and Coulomb friction.
+*/
+
+#include <math.h>
+#include "WheelModel.h"
+
+
+
+/** @brief Constructor for the WheelModel class
+ *
+ *  @details The defaults are the moment of inertia of the motor and load with no friction,
+ *  which is what the Controller integrated before friction was modeled.
+ *
+ *  @param J_ The moment of inertia in kg*m^2.
+ *  @param b_ The viscous friction in N*m per rad/s.
+ *  @param c_ The Coulomb friction in N*m.
+ *  @param dt_ The integration step in seconds.
+ */
+WheelModel::WheelModel(float J_, float b_, float c_, float dt_)
+{
+    J = 0.001712f;
+    b = 0.0f;
+    c = 0.0f;
+    dt = 0.001f;
+    set_params(J_, b_, c_);
+    set_step(dt_);
+}
+
+
+
+/** @brief A function which changes the model parameters
+ *
+ *  @details A moment of inertia that is not positive is ignored, and negative friction
+ *  coefficients are treated as zero, since either would make the model unstable.
+ *
+ *  @param J_ The moment of inertia in kg*m^2.
+ *  @param b_ The viscous friction in N*m per rad/s.
+ *  @param c_ The Coulomb friction in N*m.
+ */
+void WheelModel::set_params(float J_, float b_, float c_)
+{
+    if (J_ > 0.0f)
+    {
+        J = J_;
+    }
+    b = (b_ > 0.0f) ? b_ : 0.0f;
+    c = (c_ > 0.0f) ? c_ : 0.0f;
+    prepare();
+}
+
+
+
+/** @brief A function which changes the integration step
+ *
+ *  @param dt_ The integration step in seconds; values that are not positive are ignored.
+ */
+void WheelModel::set_step(float dt_)
+{
+    if (dt_ > 0.0f)
+    {
+        dt = dt_;
+    }
+    prepare();
+}
+
+
+
+/** @brief A function which works out the coefficients of the exact and trapezoidal steps
+ *
+ *  @details This is the only place an exponential is taken, so a step never needs one.
+ */
+void WheelModel::prepare(void)
+{
+    inv_J = 1.0f / J;
+    float a = b * inv_J;
+    zoh_gain = (a * dt < 1.0e-6f) ? dt : -expm1f(-a * dt) / a;
+    trap_gain = dt / (1.0f + 0.5f * a * dt);
+}
+
+
+
+/** @brief A function which works out which way the Coulomb friction acts over a step
+ *
+ *  @details A turning wheel has friction against its motion. A stopped wheel stays stopped
+ *  unless the torque is larger than the Coulomb friction, and then starts to turn the way
+ *  the torque pushes it.
+ *
+ *  @param omega The wheel speed in rad/s.
+ *  @param torque The motor torque in N*m.
+ *
+ *  @return 1 or -1 for the direction of motion, or 0 if the wheel is stuck.
+ */
+float WheelModel::friction_sign(float omega, float torque) const
+{
+    if (omega > 0.0f) return 1.0f;
+    if (omega < 0.0f) return -1.0f;
+    if (torque > c)   return 1.0f;
+    if (torque < -c)  return -1.0f;
+    return 0.0f;
+}
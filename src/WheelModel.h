@@ -0,0 +1,140 @@
+/** @file WheelModel.h
+ *  This file contains the WheelModel class, which describes how the reaction wheel speeds
+ *  up under a torque: its moment of inertia, viscous friction proportional to speed, and
+ *  Coulomb friction of constant size which opposes the motion. The Controller integrates
+ *  this model to turn torque commands into speed commands.
+ *
+ *  Nothing in this file depends on the Arduino core, so it can be compiled on a PC.
+*/
+
+#ifndef _WHEELMODEL_H_
+#define _WHEELMODEL_H_
+
+#include <stdint.h>
+
+/** This class is used to model the dynamics of the reaction wheel
+ *
+ *  @details The wheel obeys J dw/dt = T - b w - c sign(w), with w in rad/s. Within one
+ *  integration step the sign of the friction is held, so the model is linear in w and the
+ *  coefficients of the exact and trapezoidal steps only change when the parameters or the
+ *  step do. Both steps are written as w0 plus a gain times the acceleration at w0, which
+ *  keeps their rounding error small when the speed changes little per step. Any class with
+ *  the same public functions can be used with the integrators in Integrator.h.
+ */
+class WheelModel
+{
+    protected:
+
+        float J;                    // moment of inertia in kg*m^2
+        float b;                    // viscous friction in N*m per rad/s
+        float c;                    // Coulomb friction in N*m
+        float inv_J;                // 1 / J, so a step needs no divide
+        float dt;                   // integration step in seconds
+        float zoh_gain;             // (1 - exp(-b dt / J)) J / b, or dt without viscous friction
+        float trap_gain;            // dt / (1 + b dt / 2J), gain of one trapezoidal step
+
+        void prepare(void);
+
+    public:
+
+        /** Non-inline functions are commented in WheelModel.cpp */
+        WheelModel(float J_ = 0.001712f, float b_ = 0.0f, float c_ = 0.0f, float dt_ = 0.001f);
+
+        void set_params(float J_, float b_, float c_);
+        void set_step(float dt_);
+        float friction_sign(float omega, float torque) const;
+
+
+
+        /** @brief A function which returns the angular acceleration of the wheel
+         *
+         *  @param omega The wheel speed in rad/s.
+         *  @param torque The motor torque in N*m.
+         *  @param sign The direction the Coulomb friction opposes, from friction_sign().
+         *
+         *  @return The angular acceleration in rad/s^2.
+         */
+        float accel(float omega, float torque, float sign) const
+        {
+            return (torque - b * omega - c * sign) * inv_J;
+        }
+
+
+
+        /** @brief A function which returns the exact speed after one step of constant torque
+         *
+         *  @param omega The wheel speed at the start of the step in rad/s.
+         *  @param torque The motor torque in N*m, held for the whole step.
+         *  @param sign The direction the Coulomb friction opposes, from friction_sign().
+         *
+         *  @return The wheel speed at the end of the step in rad/s.
+         */
+        float zoh_step(float omega, float torque, float sign) const
+        {
+            return omega + zoh_gain * accel(omega, torque, sign);
+        }
+
+
+
+        /** @brief A function which returns the speed after one implicit trapezoidal step
+         *
+         *  @details The trapezoidal rule w1 = w0 + dt (f(w0) + f(w1)) / 2 is solved for w1
+         *  ahead of time, which is possible because the model is linear within the step.
+         *
+         *  @param omega The wheel speed at the start of the step in rad/s.
+         *  @param torque The motor torque in N*m, held for the whole step.
+         *  @param sign The direction the Coulomb friction opposes, from friction_sign().
+         *
+         *  @return The wheel speed at the end of the step in rad/s.
+         */
+        float trapezoid_step(float omega, float torque, float sign) const
+        {
+            return omega + trap_gain * accel(omega, torque, sign);
+        }
+
+
+
+        /** @brief A function which returns the integration step
+         *
+         *  @return The step set with set_step() in seconds.
+         */
+        float get_step(void) const
+        {
+            return dt;
+        }
+
+
+
+        /** @brief A function which returns the moment of inertia
+         *
+         *  @return J in kg*m^2.
+         */
+        float get_J(void) const
+        {
+            return J;
+        }
+
+
+
+        /** @brief A function which returns the viscous friction coefficient
+         *
+         *  @return b in N*m per rad/s.
+         */
+        float get_b(void) const
+        {
+            return b;
+        }
+
+
+
+        /** @brief A function which returns the Coulomb friction torque
+         *
+         *  @return c in N*m.
+         */
+        float get_c(void) const
+        {
+            return c;
+        }
+};
+
+#endif
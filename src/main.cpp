@@ -29,19 +29,50 @@
 #include <PrintStream.h>
 #include "Server.h"
 #include "CtrlTasks.h"
+#include "Recorder.h"
+#include "ProfileTask.h"
 
-// A queue which holds torque command values from the webserver and passes them to the calcSetpoint task
-Queue<float> torque_cmd (2, "Torque Command");
+// A mailbox which holds the latest torque command from the webserver for the calcSetpoint task
+Mailbox<float> torque_cmd;
 
-// A queue which holds speed command values from the webserver and passes them to the speedControl state machine
-Queue<float> speed_cmd (2, "Speed Command"); 
+// A mailbox which holds the latest speed command from the webserver or calcSetpoint for the speedControl 
+// state machine
+Mailbox<rpm_t> speed_cmd;
 
-// A share which populates using an ISR and holds the current speed of the motor
-Share<float> speed_actual ("Speed Actual");
+// A mailbox which holds the latest wheel model estimated by readActual for the torque loop in calcSetpoint
+Mailbox<WheelModel> wheel_model;
 
-// A queue which uses an ISR to trigger the readActual task and calculate the motor speed by reading the square wave 
-// frequency on the FGOUT pin
-Queue<uint32_t> edge_time (4, "Rising Edge Timestamp");
+// A mailbox which holds the latest gains of the outer PID speed loop from the webserver for speedControl
+Mailbox<PidGains> pid_gains;
+
+// A share which populates using an ISR and holds the current filtered speed of the motor
+Share<rpm_t> speed_actual ("Speed Actual");
+
+// A share which holds the unfiltered speed of the motor calculated from the latest single FGOUT period
+Share<rpm_t> speed_raw ("Speed Raw");
+
+// A wait-free ring which the FGOUT capture backend fills with edge timestamps, so the readActual task can
+// calculate the motor speed from the square wave frequency on the FGOUT pin
+EdgeRing edge_ring;
+
+// A wait-free ring which readActual fills with a telemetry sample for every speed it measures, so the
+// webserver task can stream them to the live plot
+SpscRing<TelemetrySample, TELEMETRY_RING_SIZE> telemetry_ring;
+
+// A wait-free ring which speedControl fills with a telemetry sample for every new command and state 
+// transition, so the webserver task can log them between the speed samples
+SpscRing<TelemetrySample, TELEMETRY_EVENT_RING_SIZE> telemetry_events;
+
+// A wait-free ring which the webserver task fills with every sample it logs while a test run is being
+// recorded, so the recorder task can write them to flash
+SpscRing<TelemetrySample, RECORD_RING_SIZE> record_ring;
+
+// A mailbox which holds the latest request from the webserver to start or stop recording a test run
+Mailbox<RecorderCommand> recorder_cmd;
+
+// A queue of register accesses which the driver I/O task performs on the DRV8308 for other tasks, 
+// so that only one task uses the SPI bus
+Queue<DrvRequest> drv_requests (DRV_REQUEST_QUEUE_SIZE, "DRV Requests");
 
 
 
@@ -69,6 +100,12 @@ void setup()
     Peripheral.begin();
     Serial.println("DRV initialized");
 
+    // Find the test runs recorded in flash before the tasks start
+    recorder_begin();
+
+    // Get the command profile player ready for profiles uploaded from the web page
+    profile_begin();
+
     // Set up the webserver
     setup_wifi();
 
@@ -76,19 +113,32 @@ void setup()
     // This task runs every 10ms
     xTaskCreate (task_webserver, "Web Server", 8192, NULL, 1, NULL);
 
+    // Task which writes the samples of the test run being recorded to flash
+    // This task runs every 100ms at the lowest priority, and writes at most a few times a second
+    xTaskCreate(task_recorder, "Recorder", 4096, NULL, 0, NULL);
+
+    // Task which owns the SPI bus and performs register accesses posted by the other tasks
+    // This task runs whenever a value is placed into drv_requests, once per tick at most
+    xTaskCreate(task_driverIO, "Driver I/O", 4096, NULL, 2, NULL);
+
     // Task which calculates the actual speed of the motor based on an ISR
-    // This task runs every time a rising edge is detected on FGOUT
-    xTaskCreate(task_readActual, "Calculate RPM", 4096, NULL, 5, NULL);
+    // This task is notified once every four rising edges on FGOUT, or runs after a 20ms timeout
+    TaskHandle_t readActual_handle = NULL;
+    xTaskCreate(task_readActual, "Calculate RPM", 4096, NULL, 5, &readActual_handle);
+    Peripheral.set_edge_notify(readActual_handle, 4);
 
     // Task which uses an integrator to calculate the speed from a commanded torque
-    // This task runs every time a value is placed into torque_cmd
-    // In the future this is how we will set our control loop frequency
+    // This task runs at a fixed 1kHz once a torque is posted, and sleeps while speeds are commanded directly
     xTaskCreate(task_calcSetpoint, "Calculate Setpoint", 4096, NULL, 3, NULL);
 
     // Task which uses a state machine to command the motor speed
-    // If in idle state, this task will not run until a value is placed into speed_cmd
-    // This task will run every 10ms until back in idle state
+    // This task runs when readActual posts a new speed or a new command is posted to speed_cmd,
+    // and re-checks the speed after 50ms without an event until back in idle state
     xTaskCreate(task_speedControl, "Speed Control", 4096, NULL, 4, NULL);
+
+    // Task which posts the speeds and torques of the command profile being played
+    // This task is woken by a one-shot esp_timer when each command is due, and only runs while a profile plays
+    xTaskCreate(task_profile, "Profile", 4096, NULL, 6, NULL);
 }
 
 
@@ -0,0 +1,78 @@
+/** @file FakeCapture.cpp
+ *  This file contains a fake FGOUT capture source for the host tests, which produces the
+ *  edge timestamps a motor spinning at a known speed would produce.
+*/
+
+#include "FakeCapture.h"
+
+
+
+/** @brief Constructor for the FakeCapture class
+ *
+ *  @param ticks_per_us_ The tick rate of the emulated capture timer, for example 1 for
+ *  micros() or 80 for the MCPWM capture timer running from the APB clock.
+ *  @param jitter_ticks_ The peak timing noise added to each emulated edge.
+ */
+FakeCapture::FakeCapture(uint32_t ticks_per_us_, uint32_t jitter_ticks_)
+{
+    ticks_per_us = ticks_per_us_;
+    jitter_ticks = jitter_ticks_;
+    now_ticks = 0;
+    seed = 12345;
+    delay_ticks = 0;
+    phase_ticks = 0.0f;
+}
+
+
+
+/** @brief A function which produces the timestamp of the next emulated rising edge
+ *
+ *  @param rpm The speed of the emulated motor during this period. Must be nonzero.
+ *
+ *  @return The capture timestamp of the next edge in ticks.
+ */
+uint32_t FakeCapture::next_edge(float rpm)
+{
+    if (rpm < 0.0f) rpm = -rpm;
+
+    // period in ticks is 15 s / rpm, keep the fraction so the average stays exact
+    phase_ticks += 15.0e6f * (float)ticks_per_us / rpm;
+    uint32_t whole = (uint32_t)phase_ticks;
+    phase_ticks -= (float)whole;
+    now_ticks += whole;
+
+    uint32_t stamp = now_ticks + delay_ticks;
+    delay_ticks = 0;
+    if (jitter_ticks > 0)
+    {
+        // simple linear congruential generator so runs are repeatable
+        seed = seed * 1103515245u + 12345u;
+        stamp += (seed >> 16) % (jitter_ticks + 1);
+    }
+    return stamp;
+}
+
+
+
+/** @brief A function which feeds a number of emulated edges into an estimator
+ *
+ *  @param rpm The constant speed of the emulated motor.
+ *  @param edges The number of rising edges to generate.
+ *  @param est The estimator under test.
+ *  @param out An array which receives the filtered speed after each edge.
+ *  @param max_out The length of the out array.
+ *
+ *  @return The number of speeds written to out.
+ */
+uint16_t FakeCapture::run(float rpm, uint16_t edges, SpeedEstimator& est, rpm_t* out, uint16_t max_out)
+{
+    uint16_t produced = 0;
+    for (uint16_t i = 0; i < edges; i++)
+    {
+        if (est.add_edge(next_edge(rpm)) && produced < max_out)
+        {
+            out[produced++] = est.rpm();
+        }
+    }
+    return produced;
+}
@@ -0,0 +1,50 @@
+/** @file FakeCapture.h
+ *  This file contains a fake FGOUT capture source for the host tests, which produces the
+ *  edge timestamps a motor spinning at a known speed would produce, so the SpeedEstimator
+ *  and StallDetector can be checked on a PC without the motor.
+*/
+
+#ifndef _FAKECAPTURE_H_
+#define _FAKECAPTURE_H_
+
+#include <stdint.h>
+#include "SpeedEstimator.h"
+
+/** This class generates capture timestamps for a motor spinning at a known speed
+ *  so the period math can be exercised without any hardware.
+ */
+class FakeCapture
+{
+    protected:
+
+        uint32_t ticks_per_us;      // tick rate of the emulated capture timer
+        uint32_t now_ticks;         // timestamp of the last emulated edge
+        uint32_t jitter_ticks;      // peak jitter added to each emulated edge
+        uint32_t seed;              // state of the pseudo-random jitter generator
+        uint32_t delay_ticks;       // one-off delay added to the next emulated edge
+        float    phase_ticks;       // fractional tick position, so periods do not round the same way
+
+    public:
+
+        /** Non-inline functions are commented in FakeCapture.cpp */
+        FakeCapture(uint32_t ticks_per_us_, uint32_t jitter_ticks_ = 0);
+
+        uint32_t next_edge(float rpm);
+        uint16_t run(float rpm, uint16_t edges, SpeedEstimator& est, rpm_t* out, uint16_t max_out);
+
+
+
+        /** @brief A function which delays the timestamp of the next edge only
+         *
+         *  @details This emulates one late interrupt, which makes one period too long and
+         *  the following one too short, without changing the timing of later edges.
+         *
+         *  @param ticks The extra delay in capture ticks.
+         */
+        void delay_next(uint32_t ticks)
+        {
+            delay_ticks = ticks;
+        }
+};
+
+#endif
@@ -0,0 +1,148 @@
+/** @file FileFlash.cpp
+ *  This file contains the FileFlash class for the host tests, which emulates NOR flash in a
+ *  file.
+*/
+
+#include <string.h>
+#include "FileFlash.h"
+
+
+
+/** @brief Constructor for the FileFlash class
+ *
+ *  @details An existing file is opened as it is, so the contents survive from one run of a
+ *  program to the next like flash survives a reset. A new file starts fully erased.
+ *
+ *  @param path The name of the file holding the emulated flash.
+ *  @param sector_bytes_ The size of one sector in bytes.
+ *  @param sectors_ The number of sectors.
+ */
+FileFlash::FileFlash(const char* path, uint32_t sector_bytes_, uint32_t sectors_)
+{
+    sector_bytes = sector_bytes_;
+    sectors = sectors_;
+    budget = 0;
+    limited = false;
+    writes = 0;
+    erases = 0;
+
+    file = fopen(path, "r+b");
+    if (file == NULL)
+    {
+        file = fopen(path, "w+b");
+        for (uint32_t i = 0; file != NULL && i < sectors; i++)
+        {
+            erase(i);
+        }
+        erases = 0;
+    }
+}
+
+
+
+/** @brief Destructor for the FileFlash class, which closes the file */
+FileFlash::~FileFlash(void)
+{
+    if (file != NULL)
+    {
+        fclose(file);
+    }
+}
+
+
+
+/** @brief A function which reads bytes from the emulated flash
+ *
+ *  @param addr The offset of the first byte.
+ *  @param data Filled in with the bytes read.
+ *  @param len The number of bytes to read.
+ *
+ *  @return True if the bytes were read.
+ */
+bool FileFlash::read(uint32_t addr, void* data, uint32_t len)
+{
+    if (file == NULL || (uint64_t)addr + len > (uint64_t)sector_bytes * sectors)
+    {
+        return false;
+    }
+    fseek(file, addr, SEEK_SET);
+    return fread(data, 1, len, file) == len;
+}
+
+
+
+/** @brief A function which writes bytes to the emulated flash
+ *
+ *  @details Each byte stored is the AND of the old and new bytes, as a NOR write can only
+ *  clear bits. If the power is cut part way through, the bytes before the cut are stored.
+ *
+ *  @param addr The offset of the first byte.
+ *  @param data The bytes to write.
+ *  @param len The number of bytes to write.
+ *
+ *  @return True if all the bytes were written.
+ */
+bool FileFlash::write(uint32_t addr, const void* data, uint32_t len)
+{
+    if (file == NULL || (uint64_t)addr + len > (uint64_t)sector_bytes * sectors)
+    {
+        return false;
+    }
+
+    uint32_t count = len;
+    if (limited)
+    {
+        count = (budget < len) ? budget : len;
+        budget -= count;
+    }
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint8_t old[64];
+    for (uint32_t done = 0; done < count; )
+    {
+        uint32_t n = (count - done < sizeof(old)) ? count - done : sizeof(old);
+        fseek(file, addr + done, SEEK_SET);
+        if (fread(old, 1, n, file) != n)
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < n; i++)
+        {
+            old[i] &= bytes[done + i];
+        }
+        fseek(file, addr + done, SEEK_SET);
+        fwrite(old, 1, n, file);
+        done += n;
+    }
+    fflush(file);
+    writes += count;
+    return count == len;
+}
+
+
+
+/** @brief A function which erases one sector of the emulated flash to all ones
+ *
+ *  @param sector The index of the sector.
+ *
+ *  @return True if the sector was erased, false if it does not exist or the power is cut.
+ */
+bool FileFlash::erase(uint32_t sector)
+{
+    if (file == NULL || sector >= sectors || (limited && budget == 0))
+    {
+        return false;
+    }
+
+    uint8_t ones[64];
+    memset(ones, 0xFF, sizeof(ones));
+    fseek(file, sector * sector_bytes, SEEK_SET);
+    for (uint32_t done = 0; done < sector_bytes; done += sizeof(ones))
+    {
+        uint32_t n = (sector_bytes - done < sizeof(ones)) ? sector_bytes - done : sizeof(ones);
+        fwrite(ones, 1, n, file);
+    }
+    fflush(file);
+    erases++;
+    return true;
+}
@@ -0,0 +1,103 @@
+/** @file FileFlash.h
+ *  This file contains the FileFlash class for the host tests, which emulates NOR flash in a
+ *  file. It is erased a whole sector at a time to all ones and a write can only change ones
+ *  to zeros, like the flash, and it can cut the power part way through a write, so the
+ *  RunLog format and its recovery after a reset can be checked on a PC.
+*/
+
+#ifndef _FILEFLASH_H_
+#define _FILEFLASH_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include "FlashDevice.h"
+
+/** This class emulates NOR flash in a file so the RunLog can be exercised on a PC */
+class FileFlash : public FlashDevice
+{
+    protected:
+
+        FILE* file;                 // file holding the contents of the emulated flash
+        uint32_t sector_bytes;      // size of one sector
+        uint32_t sectors;           // number of sectors
+        uint32_t budget;            // bytes which can still be written before the power is cut
+        bool limited;               // true if the power will be cut after budget bytes
+        uint32_t writes;            // bytes written since the file was opened
+        uint32_t erases;            // sectors erased since the file was opened
+
+    public:
+
+        /** Non-inline functions are commented in FileFlash.cpp */
+        FileFlash(const char* path, uint32_t sector_bytes_, uint32_t sectors_);
+        ~FileFlash(void);
+
+        bool read(uint32_t addr, void* data, uint32_t len);
+        bool write(uint32_t addr, const void* data, uint32_t len);
+        bool erase(uint32_t sector);
+
+
+
+        /** @brief A function which reports whether the file holding the flash was opened */
+        bool is_open(void)
+        {
+            return file != NULL;
+        }
+
+
+
+        /** @brief A function which returns the size of one sector in bytes */
+        uint32_t sector_size(void)
+        {
+            return sector_bytes;
+        }
+
+
+
+        /** @brief A function which returns the number of sectors in the emulated flash */
+        uint32_t sector_count(void)
+        {
+            return sectors;
+        }
+
+
+
+        /** @brief A function which cuts the power after some more bytes have been written
+         *
+         *  @details The write which runs past the budget stores only the bytes within it and
+         *  fails, as does every write and erase after it, until restore_power() is called.
+         *  This emulates a reset part way through a write.
+         *
+         *  @param bytes The number of bytes which can still be written.
+         */
+        void cut_after(uint32_t bytes)
+        {
+            budget = bytes;
+            limited = true;
+        }
+
+
+
+        /** @brief A function which brings the power back after cut_after() */
+        void restore_power(void)
+        {
+            limited = false;
+        }
+
+
+
+        /** @brief A function which returns how many bytes have been written */
+        uint32_t bytes_written(void)
+        {
+            return writes;
+        }
+
+
+
+        /** @brief A function which returns how many sectors have been erased */
+        uint32_t sectors_erased(void)
+        {
+            return erases;
+        }
+};
+
+#endif
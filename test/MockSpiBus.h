@@ -0,0 +1,119 @@
+/** @file MockSpiBus.h
+ *  This file contains a mock SpiBus for the host tests. It records every transaction as a
+ *  line of text, and answers read frames from an emulated DRV8308 register file which write
+ *  frames change, so the traffic the register code sends can be checked exactly.
+*/
+
+#ifndef _MOCKSPIBUS_H_
+#define _MOCKSPIBUS_H_
+
+#include <stdio.h>
+#include <string>
+#include "SpiBus.h"
+
+/** This class records SPI traffic and emulates the DRV8308 registers behind it */
+class MockSpiBus : public SpiBus
+{
+    public:
+
+        std::string trace;              // "B" and "E" for each transaction, "G" for each gap, and each frame
+        uint16_t chip[128];             // the registers of the emulated chip
+        uint32_t transactions;          // number of transactions started
+        uint32_t writes;                // number of write frames sent
+        uint32_t reads;                 // number of read frames sent
+        bool open;                      // true between begin_transaction() and end_transaction()
+        bool misuse;                    // true if a frame or gap was sent outside a transaction
+
+        /** @brief Constructor which starts with every register of the chip at zero */
+        MockSpiBus(void)
+        {
+            clear();
+            for (uint16_t& value : chip)
+            {
+                value = 0;
+            }
+            open = false;
+            misuse = false;
+        }
+
+
+
+        /** @brief A function which forgets the traffic recorded so far */
+        void clear(void)
+        {
+            trace.clear();
+            transactions = 0;
+            writes = 0;
+            reads = 0;
+        }
+
+
+
+        void begin_transaction(void) override
+        {
+            misuse |= open;
+            open = true;
+            transactions++;
+            trace += "B ";
+        }
+
+
+
+        void end_transaction(void) override
+        {
+            misuse |= !open;
+            open = false;
+            trace += "E";
+        }
+
+
+
+        void frame_gap(void) override
+        {
+            misuse |= !open;
+            trace += "G ";
+        }
+
+
+
+        /** @brief A function which records a frame and answers it as the DRV8308 would
+         *
+         *  @details A frame is recorded as its bytes in hex. The first bit selects a read,
+         *  for which the register value is returned in the last two bytes, or a write.
+         */
+        void frame(const uint8_t* tx, uint8_t* rx, uint8_t length) override
+        {
+            misuse |= !open;
+            char text[8];
+            for (uint8_t i = 0; i < length; i++)
+            {
+                snprintf(text, sizeof(text), "%02X", tx[i]);
+                trace += text;
+            }
+            trace += " ";
+            if (length != 3)
+            {
+                misuse = true;
+                return;
+            }
+
+            uint8_t addr = tx[0] & 0x7F;
+            if (tx[0] & 0x80)
+            {
+                reads++;
+                if (rx != nullptr)
+                {
+                    rx[0] = 0;
+                    rx[1] = (uint8_t)(chip[addr] >> 8);
+                    rx[2] = (uint8_t)(chip[addr] & 0xFF);
+                }
+            }
+            else
+            {
+                writes++;
+                chip[addr] = (uint16_t)((tx[1] << 8) | tx[2]);
+            }
+        }
+};
+
+#endif
@@ -0,0 +1,62 @@
+/** @file test.h
+ *  This file contains the few helpers shared by the host tests: a CHECK macro which counts
+ *  failures instead of stopping at the first one, and a cycle counter for the benchmarks.
+ *
+ *  The tests build the portable parts of the firmware from ../src with the PC compiler, so
+ *  nothing here may depend on the Arduino core.
+*/
+
+#ifndef _TEST_H_
+#define _TEST_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static int test_failures = 0;               // number of checks which have failed in this test
+
+// Check a condition, print where it failed and carry on
+#define CHECK(cond)                                                                 \
+    do                                                                              \
+    {                                                                               \
+        if (!(cond))                                                                \
+        {                                                                           \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);         \
+            test_failures++;                                                        \
+        }                                                                           \
+    } while (0)
+
+
+
+/** @brief Function which prints the outcome of a test program
+ *
+ *  @param name The name of the test.
+ *
+ *  @return The exit status for main(): zero if every check passed.
+ */
+static inline int test_result(const char* name)
+{
+    printf("%s: %s\n", name, test_failures == 0 ? "passed" : "FAILED");
+    return test_failures == 0 ? 0 : 1;
+}
+
+
+
+/** @brief Function which reads a free-running cycle counter for the benchmarks
+ *
+ *  @return The time stamp counter on x86, otherwise nanoseconds from a steady clock.
+ */
+static inline uint64_t host_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+#endif
@@ -0,0 +1,238 @@
+/** @file test_brakecontroller.cpp
+ *  This file contains the host model of the motor and brake, run against the
+ *  BrakeController as the readActual and speedControl tasks drive it. The wheel coasts
+ *  against friction and the brake adds a torque which grows with the duty cycle and the
+ *  speed. FGOUT edges come from the wheel speed, readActual measures the speed every four
+ *  edges (or after 20 ms) and posts it with the time of the latest edge, and speedControl
+ *  gets to each measurement a pseudo-random time later and also times out every 50 ms.
+ *
+ *  Each maneuver is run twice: as the firmware does it, updating the brake only on a new
+ *  measurement with the time it was measured, and the way it used to, updating it on every
+ *  event with the time the task woke. The deceleration the wheel really had, how closely
+ *  it followed the command and how long the maneuver took are printed for both.
+*/
+
+#include <math.h>
+#include "test.h"
+#include "BrakeController.h"
+
+// Time step of the simulation (us)
+#define SIM_STEP_US 20
+
+// Edges between speed measurements, and the longest time between them (us)
+#define NOTIFY_EDGES 4
+#define EDGE_TIMEOUT_US 20000
+
+// Time speedControl waits for an event while braking before it re-checks the speed (us)
+#define FSM_TIMEOUT_US 50000
+
+// How close to the command the speed has to get for the brake to be released (RPM)
+#define DEADBAND_RPM 20.0
+
+// Deceleration the brake controller is commanded to hold (RPM/s)
+#define BRAKE_DECEL 1000.0f
+
+// Time after the brake is set before the deceleration is compared with the command (us)
+#define WINDOW_START_US 150000
+
+/** Model of the wheel slowing down against friction and the brake */
+struct WheelPlant
+{
+    double rpm = 0.0;               // wheel speed in RPM, never negative
+    double friction = 40.0;         // deceleration from friction alone in RPM/s
+    double brake_tau = 0.25;        // time constant of the full brake at speed in s
+    double brake_floor = 300.0;     // deceleration from the full brake at any speed in RPM/s
+
+    /** @brief Function which returns the deceleration at a duty cycle
+     *
+     *  @param duty The brake duty cycle, 0 to 1.
+     *
+     *  @return The deceleration in RPM/s.
+     */
+    double decel(double duty)
+    {
+        return (rpm > 0.0) ? friction + duty * (rpm / brake_tau + brake_floor) : 0.0;
+    }
+
+    /** @brief Function which advances the model by one time step
+     *
+     *  @param duty The brake duty cycle, 0 to 1.
+     *  @param dt The time step in seconds.
+     */
+    void step(double duty, double dt)
+    {
+        rpm -= decel(duty) * dt;
+        rpm = (rpm > 0.0) ? rpm : 0.0;
+    }
+};
+
+/** The results of one simulated maneuver */
+struct BrakeResult
+{
+    double length_s;                // time until the brake was released, or -1
+    double mean_decel;              // true deceleration over the constant-rate part in RPM/s
+    double rms_error;               // RMS of the true deceleration from the command there
+    uint32_t updates;               // calls to BrakeController::update()
+};
+
+
+
+/** @brief Function which simulates one braking maneuver
+ *
+ *  @param from The wheel speed when the brake is set in RPM.
+ *  @param to The speed commanded in RPM.
+ *  @param latency_us The most time speedControl takes to get to a measurement.
+ *  @param sample_time True to update on new measurements with their time, false to update
+ *  on every event with the time the task woke.
+ *
+ *  @return What happened during the maneuver.
+ */
+static BrakeResult simulate(double from, double to, uint32_t latency_us, bool sample_time)
+{
+    BrakeController brake(BRAKE_DECEL);
+    WheelPlant wheel;
+    wheel.rpm = from;
+    BrakeResult result = { -1.0, 0.0, 0.0, 0 };
+
+    uint32_t seed = 7;
+    double phase = 0.0;             // fraction of a period since the last edge
+    int64_t edges[NOTIFY_EDGES + 1] = { 0 };   // times of the latest edges, newest last
+    uint32_t edge_count = 0;        // edges seen in total
+    uint32_t pending = 0;           // edges since the last measurement
+    int64_t measured_at = 0;        // time of the last measurement
+    double sample_rpm = from;       // latest measured speed and the time of its edge
+    int64_t sample_us = 0;
+    int64_t run_at = -1;            // time speedControl gets to the latest measurement
+    int64_t last_event = 0;         // time speedControl last ran
+
+    double duty = brake.start(0, rpm_from_float((float)from), rpm_from_float((float)to));
+    // the constant-rate part starts once the first full-brake update has been corrected and
+    // ends well before the taper onto the target
+    double window_end_rpm = to + 2.0 * BRAKE_DECEL * 0.1 + DEADBAND_RPM;
+    double window_rpm[2] = { -1.0, -1.0 }, window_s[2] = { 0.0, 0.0 };
+    double error_sum = 0.0;
+    uint32_t error_count = 0;
+
+    for (int64_t t = SIM_STEP_US; t < 5000000; t += SIM_STEP_US)
+    {
+        double decel = wheel.decel(duty);
+        wheel.step(duty, SIM_STEP_US * 1.0e-6);
+        if (wheel.rpm > window_end_rpm && t > WINDOW_START_US)
+        {
+            error_sum += (decel - BRAKE_DECEL) * (decel - BRAKE_DECEL);
+            error_count++;
+            int end = (window_rpm[0] < 0.0) ? 0 : 1;
+            window_rpm[end] = wheel.rpm;
+            window_s[end] = t * 1.0e-6;
+        }
+
+        // an edge every 1/4 revolution
+        phase += wheel.rpm / 15.0 * SIM_STEP_US * 1.0e-6;
+        if (phase >= 1.0)
+        {
+            phase -= 1.0;
+            for (int i = 0; i < NOTIFY_EDGES; i++)
+            {
+                edges[i] = edges[i + 1];
+            }
+            edges[NOTIFY_EDGES] = t;
+            edge_count++;
+            pending++;
+        }
+
+        // readActual measures the speed over the edges it has
+        bool timeout = t - measured_at >= EDGE_TIMEOUT_US && pending > 0;
+        if ((pending >= NOTIFY_EDGES || timeout) && edge_count > NOTIFY_EDGES)
+        {
+            uint32_t n = (pending < NOTIFY_EDGES) ? pending : NOTIFY_EDGES;
+            sample_rpm = 15.0e6 * n / (double)(edges[NOTIFY_EDGES] - edges[NOTIFY_EDGES - n]);
+            sample_us = edges[NOTIFY_EDGES];
+            measured_at = t;
+            pending = 0;
+            seed = seed * 1103515245u + 12345u;
+            run_at = t + (seed >> 8) % (latency_us + 1);
+        }
+
+        // speedControl runs on the measurement or on its own timeout
+        bool speed_event = run_at >= 0 && t >= run_at;
+        bool timeout_event = !speed_event && t - last_event >= FSM_TIMEOUT_US;
+        if (!speed_event && !timeout_event)
+        {
+            continue;
+        }
+        run_at = -1;
+        last_event = t;
+
+        rpm_t actual = rpm_from_float((float)sample_rpm);
+        if (sample_rpm <= to + DEADBAND_RPM)
+        {
+            brake.finish(sample_time ? sample_us : t, actual);
+            result.length_s = t * 1.0e-6;
+            break;
+        }
+        if (sample_time && speed_event)
+        {
+            duty = brake.update(sample_us, actual);
+            result.updates++;
+        }
+        else if (!sample_time)
+        {
+            duty = brake.update(t, actual);
+            result.updates++;
+        }
+    }
+
+    double window = window_s[1] - window_s[0];
+    result.mean_decel = (window > 0.0) ? (window_rpm[0] - window_rpm[1]) / window : 0.0;
+    result.rms_error = (error_count > 0) ? sqrt(error_sum / error_count) : 0.0;
+    return result;
+}
+
+
+
+/** @brief Function which prints the maneuvers and checks the brake follows its command
+ *
+ *  @details With the measurement times every maneuver must finish, the deceleration over
+ *  the constant-rate part must be within 15% of the command at any task latency, and no
+ *  maneuver may take much longer than with the wake times. Below about 300 RPM the edges
+ *  come further apart than the 50 ms timeout. Feeding the same speed in again on each
+ *  timeout shows the controller no deceleration, and the next measurement then shows the
+ *  whole drop over a fraction of its real time, so the estimate swings and the maneuver
+ *  drags out; maneuvers down to such speeds must be quicker with the measurement times.
+ */
+static void report_maneuvers(void)
+{
+    const double runs[][2] = { { 2000, 500 }, { 2500, 1500 }, { 1000, 200 }, { 1500, 100 } };
+    const uint32_t latencies[] = { 0, 2000, 5000 };
+
+    printf("   from -> to   latency   sample time: decel  rms error  length s"
+           "   wake time: decel  rms error  length s\n");
+    for (auto& r : runs)
+    {
+        for (uint32_t latency : latencies)
+        {
+            BrakeResult now = simulate(r[0], r[1], latency, true);
+            BrakeResult old = simulate(r[0], r[1], latency, false);
+            printf("  %4.0f -> %4.0f  %5u us          %6.0f  %9.0f  %8.3f"
+                   "            %6.0f  %9.0f  %8.3f\n", r[0], r[1], (unsigned)latency,
+                   now.mean_decel, now.rms_error, now.length_s,
+                   old.mean_decel, old.rms_error, old.length_s);
+
+            CHECK(now.length_s > 0.0);
+            CHECK(fabs(now.mean_decel - BRAKE_DECEL) < 0.15 * BRAKE_DECEL);
+            CHECK(now.length_s <= old.length_s * 1.1);
+            if (r[1] <= 200.0)
+            {
+                CHECK(now.length_s < old.length_s);
+            }
+        }
+    }
+}
+
+
+
+int main(void)
+{
+    report_maneuvers();
+    return test_result("test_brakecontroller");
+}
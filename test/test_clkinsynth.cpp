@@ -0,0 +1,133 @@
+/** @file test_clkinsynth.cpp
+ *  This file contains the host model of the CLKIN frequency synthesis. For each speed
+ *  setpoint the ClkinSynth settings are worked out from rpm_to_clkin_mhz() as the Driver
+ *  does, and the frequency the MCPWM timer would really produce is compared with the
+ *  RPM / 15 Hz the DRV8308 needs, and with the whole-hertz frequency ledcWriteTone() gave.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include "test.h"
+#include "ClkinSynth.h"
+#include "SpeedType.h"
+
+// Slowest speed the DRV8308 commutation timer can run the motor at (RPM)
+#define SLOWEST_RPM 23
+
+
+
+/** @brief Function which returns the frequency the timer settings really produce
+ *
+ *  @details ClkinSynth::actual_mhz() rounds to whole millihertz, which is most of the
+ *  error at the slowest speeds, so the model works it out in full.
+ */
+static double timer_hz(ClkinSynth& synth)
+{
+    return (double)CLKIN_GROUP_HZ / synth.get_prescale() / synth.get_period();
+}
+
+
+
+/** @brief Function which returns the largest error allowed at a frequency
+ *
+ *  @details The command is rounded to a millihertz and the period to a tick, which is at
+ *  most 1 / (2 CLKIN_PERIOD_MIN) of the frequency with the prescaler it is given.
+ */
+static double allowed_hz(double wanted)
+{
+    return 0.0005 + wanted * 0.5 / CLKIN_PERIOD_MIN;
+}
+
+
+
+/** @brief Function which prints the frequency error for a table of speed setpoints
+ *
+ *  @details The error of each setpoint must be within half a millihertz of the command
+ *  plus half a step of the timer period.
+ */
+static void report_setpoints(void)
+{
+    const int setpoints[] = { 23, 30, 50, 100, 250, 500, 750, 1000, 1500, 2000, 2500 };
+    ClkinSynth synth;
+
+    printf("   RPM  prescale  period    wanted Hz    actual Hz   error mHz  error ppm  LEDC error mHz\n");
+    for (int rpm : setpoints)
+    {
+        synth.tune(rpm_to_clkin_mhz(rpm_from_float((float)rpm)));
+        double wanted = rpm / 15.0;
+        double actual = timer_hz(synth);
+        double error = actual - wanted;
+        double ledc = floor(wanted) - wanted;
+        printf("  %4d  %8u  %6u  %11.4f  %11.4f  %10.2f  %9.1f  %14.1f\n", rpm, synth.get_prescale(),
+               synth.get_period(), wanted, actual, error * 1000.0, error / wanted * 1e6, ledc * 1000.0);
+        CHECK(synth.is_running());
+        CHECK(fabs(error) <= allowed_hz(wanted));
+    }
+}
+
+
+
+/** @brief Function which sweeps every whole RPM in both directions
+ *
+ *  @details Across 23 to 2500 RPM forward and reverse, the error must stay within the same
+ *  bound, and the prescaler, which cannot change without a glitch, must
+ *  change only a handful of times over each sweep.
+ */
+static void sweep(void)
+{
+    ClkinSynth synth;
+    double worst = 0.0;
+    double worst_rpm = 0.0;
+    bool within = true;
+    int changes = 0;
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = SLOWEST_RPM; i <= 2500; i++)
+        {
+            int rpm = (pass == 0) ? i : 2500 + SLOWEST_RPM - i;
+            changes += synth.tune(rpm_to_clkin_mhz(rpm_from_float((float)-rpm))) ? 1 : 0;
+            double wanted = rpm / 15.0;
+            double error = fabs(timer_hz(synth) - wanted);
+            within &= error <= allowed_hz(wanted);
+            error /= wanted;
+            if (error > worst)
+            {
+                worst = error;
+                worst_rpm = rpm;
+            }
+        }
+    }
+    printf("sweep up and down: worst error %.1f ppm at %.0f RPM, %d prescaler changes\n",
+           worst * 1e6, worst_rpm, changes);
+    CHECK(within);
+    CHECK(changes <= 12);
+}
+
+
+
+/** @brief Function which checks stopping and the lowest frequency */
+static void test_stop(void)
+{
+    ClkinSynth synth;
+    synth.tune(rpm_to_clkin_mhz(rpm_from_float(600.0f)));
+    CHECK(synth.is_running());
+    synth.tune(0);
+    CHECK(!synth.is_running());
+    CHECK(synth.actual_mhz() == 0);
+
+    printf("lowest frequency %u mHz, %.1f RPM\n", synth.min_mhz(), synth.min_mhz() * 15.0 / 1000.0);
+    CHECK(synth.min_mhz() * 15 < SLOWEST_RPM * 1000);
+    synth.tune(synth.min_mhz() / 2);
+    CHECK(!synth.is_running());
+}
+
+
+
+int main(void)
+{
+    report_setpoints();
+    sweep();
+    test_stop();
+    return test_result("test_clkinsynth");
+}
@@ -0,0 +1,165 @@
+/** @file test_directionestimator.cpp
+ *  This file contains the host test of the DirectionEstimator. A wheel turning at 600 RPM
+ *  has DIR reversed and is driven down through zero and up to 600 RPM the other way, with
+ *  FGOUT edges generated from its true speed and filtered by a SpeedEstimator as in the
+ *  readActual task. The sign given to each measured speed is compared with the true
+ *  direction of rotation, and with the sign the DIR pin alone would have given.
+*/
+
+#include <math.h>
+#include <initializer_list>
+#include "test.h"
+#include "SpeedEstimator.h"
+#include "DirectionEstimator.h"
+
+// Time step of the simulation (s)
+#define SIM_STEP_S 1e-6
+
+// Tick rate of the MCPWM capture timer
+#define TICKS_PER_US 80
+
+// Speeds slower than this are not checked, as FGOUT says too little about them (RPM)
+#define CHECK_ABOVE_RPM 30.0
+
+/** The signs given to the speeds measured during one run */
+struct SignCount
+{
+    uint32_t checked;       // speeds measured while the wheel turned faster than CHECK_ABOVE_RPM
+    uint32_t wrong;         // of those, speeds given the wrong sign by the estimator
+    uint32_t wrong_pin;     // of those, speeds the DIR pin would have given the wrong sign
+    double worst_rpm;       // fastest the wheel turned while the estimator had the wrong sign
+};
+
+
+
+/** @brief Function which simulates a reversal of DIR at 600 RPM
+ *
+ *  @param accel The rate the speed changes after the reversal, in RPM per second.
+ *  @param cancel_s If positive, DIR is put back this long after the reversal, before the
+ *  wheel has stopped, and the wheel speeds up the old way again.
+ *
+ *  @return How many speeds were given the wrong sign.
+ */
+static SignCount reverse(double accel, double cancel_s)
+{
+    SpeedEstimator estimator(ESTIMATE_ADAPTIVE, 8, 5, TICKS_PER_US);
+    DirectionEstimator direction;
+    SignCount count = { 0, 0, 0, 0.0 };
+
+    const double reverse_s = 0.5;
+    double rpm = 600.0;                 // true signed speed of the wheel
+    double phase = 0.0;                 // fraction of an FGOUT period since the last edge
+    bool negative = false;              // direction commanded on DIR
+    double length_s = reverse_s + 1200.0 / accel + 0.5;
+
+    for (double t = 0.0; t < length_s; t += SIM_STEP_S)
+    {
+        bool want = t >= reverse_s && !(cancel_s > 0.0 && t >= reverse_s + cancel_s);
+        if (want != negative)
+        {
+            negative = want;
+            direction.command(negative);
+        }
+        double target = negative ? -600.0 : 600.0;
+        if (rpm > target)
+        {
+            rpm = fmax(target, rpm - accel * SIM_STEP_S);
+        }
+        else if (rpm < target)
+        {
+            rpm = fmin(target, rpm + accel * SIM_STEP_S);
+        }
+
+        // four FGOUT edges per revolution, whichever way the wheel turns
+        phase += fabs(rpm) / 15.0 * SIM_STEP_S;
+        if (phase < 1.0)
+        {
+            continue;
+        }
+        phase -= 1.0;
+        if (!estimator.add_edge((uint32_t)(t * 1e6 * TICKS_PER_US)))
+        {
+            continue;
+        }
+        float measured = rpm_to_float(direction.update(estimator.rpm()));
+        if (fabs(rpm) > CHECK_ABOVE_RPM)
+        {
+            count.checked++;
+            count.wrong_pin += (negative != (rpm < 0.0)) ? 1 : 0;
+            if ((measured < 0.0f) != (rpm < 0.0))
+            {
+                count.wrong++;
+                count.worst_rpm = fmax(count.worst_rpm, fabs(rpm));
+            }
+        }
+    }
+    return count;
+}
+
+
+
+/** @brief Function which checks reversals at slow, medium and fast deceleration
+ *
+ *  @details The estimator waits for the measured speed to rise again, and the speed
+ *  measured just after the turnaround still averages the long periods near zero, so the
+ *  first speed after the true zero crossing may keep the old sign, but no more than that.
+ *  The DIR pin is wrong for every speed from the reversal to the zero crossing, which is
+ *  never fewer.
+ */
+static void test_reversal(void)
+{
+    for (double accel : { 500.0, 2000.0, 8000.0 })
+    {
+        SignCount count = reverse(accel, 0.0);
+        printf("reversal at %5.0f RPM/s: estimator %u and DIR pin %u of %u speeds wrong, "
+               "worst at %.0f RPM\n", accel, count.wrong, count.wrong_pin, count.checked, count.worst_rpm);
+        CHECK(count.wrong <= 1);
+        CHECK(count.wrong_pin >= count.wrong);
+    }
+}
+
+
+
+/** @brief Function which checks a reversal cancelled before the wheel stops
+ *
+ *  @details DIR is put back while the wheel is still turning the old way, so the old sign
+ *  was right all along and must never be dropped.
+ */
+static void test_cancelled(void)
+{
+    SignCount count = reverse(2000.0, 0.1);
+    printf("cancelled reversal: estimator %u and DIR pin %u of %u speeds wrong\n",
+           count.wrong, count.wrong_pin, count.checked);
+    CHECK(count.wrong == 0);
+    CHECK(count.wrong_pin > 0);
+}
+
+
+
+/** @brief Function which checks a start from a stop after a reversal
+ *
+ *  @details Once the wheel is reported stopped it can only start the commanded way, so the
+ *  first speed afterwards must already have the new sign.
+ */
+static void test_stopped(void)
+{
+    DirectionEstimator direction;
+    CHECK(direction.update(rpm_from_float(300.0f)) > 0);
+    direction.command(true);
+    CHECK(direction.is_pending());
+    CHECK(direction.update(rpm_from_float(200.0f)) > 0);
+    direction.stopped();
+    CHECK(!direction.is_pending());
+    CHECK(direction.update(rpm_from_float(40.0f)) < 0);
+    CHECK(direction.is_negative());
+}
+
+
+
+int main(void)
+{
+    test_reversal();
+    test_cancelled();
+    test_stopped();
+    return test_result("test_directionestimator");
+}
@@ -0,0 +1,241 @@
+/** @file test_drvregisters.cpp
+ *  This file contains the host test of the frames DrvRegisters sends to the DRV8308 and of
+ *  its register shadow. A mock SPI bus records each transaction and emulates the register
+ *  file of the chip. The trace is compared with the frames the datasheet specifies: a write
+ *  bit of 0 or read bit of 1, the 7-bit address and 16 data bits, most significant first,
+ *  with one transaction per burst and a chip select gap between its frames. The shadow must
+ *  coalesce changes into one burst of the registers which really changed, in address order,
+ *  and keep agreeing with the chip.
+*/
+
+#include <string.h>
+#include "test.h"
+#include "MockSpiBus.h"
+#include "DrvRegisters.h"
+
+
+
+/** @brief Function which checks single register writes and reads */
+static void test_single(void)
+{
+    MockSpiBus bus;
+    DrvRegisters registers(bus);
+
+    registers.write(0x05, 0x1234);
+    CHECK(bus.trace == "B 051234 E");
+    CHECK(bus.chip[0x05] == 0x1234);
+
+    // the address is 7 bits, so a stray top bit must not turn the write into a read
+    bus.clear();
+    registers.write(0x8B, 0xBEEF);
+    CHECK(bus.trace == "B 0BBEEF E");
+    CHECK(bus.chip[0x0B] == 0xBEEF);
+
+    bus.clear();
+    bus.chip[0x2A] = 0x00C3;
+    CHECK(registers.read(0x2A) == 0x00C3);
+    CHECK(bus.trace == "B AA0000 E");
+    CHECK(!bus.misuse);
+}
+
+
+
+/** @brief Function which checks that a burst is one transaction with gaps between frames */
+static void test_burst(void)
+{
+    MockSpiBus bus;
+    DrvRegisters registers(bus);
+    DrvReg regs[] =
+    {
+        {0x00, 0x2000},
+        {0x03, 0x0F82},
+        {0x0A, 0x0200},
+    };
+
+    registers.write_burst(regs, 3);
+    CHECK(bus.trace == "B 002000 G 030F82 G 0A0200 E");
+    CHECK(bus.transactions == 1);
+    CHECK(bus.writes == 3);
+    CHECK(bus.chip[0x03] == 0x0F82);
+
+    // the boot burst of Driver::begin() writes every configuration register in order
+    bus.clear();
+    DrvReg boot[12];
+    for (uint8_t i = 0; i < 12; i++)
+    {
+        boot[i].addr = i;
+        boot[i].value = (uint16_t)(0x0100 * i + i);
+    }
+    registers.write_burst(boot, 12);
+    CHECK(bus.transactions == 1);
+    CHECK(bus.writes == 12);
+    CHECK(bus.trace.substr(0, 16) == "B 000000 G 01010");
+    CHECK(bus.trace.substr(bus.trace.size() - 10) == "G 0B0B0B E");
+    for (uint8_t i = 0; i < 12; i++)
+    {
+        CHECK(bus.chip[i] == boot[i].value);
+    }
+
+    // an empty burst must not take the bus at all
+    bus.clear();
+    registers.write_burst(regs, 0);
+    CHECK(bus.trace.empty());
+    CHECK(bus.transactions == 0);
+    CHECK(!bus.misuse);
+}
+
+
+
+/** @brief Function which checks that changes are coalesced until flush()
+ *
+ *  @details Several changes to one register cost one write of the last value, a change
+ *  back to the value already on the chip before a flush still costs a write since the
+ *  shadow cannot tell, and setting the value the shadow already holds costs nothing.
+ */
+static void test_coalescing(void)
+{
+    MockSpiBus bus;
+    DrvRegisters registers(bus);
+
+    registers.set(0x06, 0x0010);
+    registers.set(0x06, 0x0020);
+    registers.set(0x06, 0x0030);
+    registers.set(0x02, 0x0001);
+    registers.set(0x09, 0x0000);
+    CHECK(bus.trace.empty());
+    CHECK(registers.is_dirty());
+    CHECK(registers.get(0x06) == 0x0030);
+
+    CHECK(registers.flush() == 2);
+    CHECK(bus.trace == "B 020001 G 060030 E");
+    CHECK(!registers.is_dirty());
+    CHECK(bus.chip[0x06] == 0x0030);
+
+    // nothing changed, so nothing is sent
+    bus.clear();
+    registers.set(0x06, 0x0030);
+    CHECK(!registers.is_dirty());
+    CHECK(registers.flush() == 0);
+    CHECK(bus.trace.empty());
+
+    // a forced set is written even though the shadow already holds the value
+    registers.set(0x06, 0x0030, true);
+    CHECK(registers.flush() == 1);
+    CHECK(bus.trace == "B 060030 E");
+}
+
+
+
+/** @brief Function which checks forced reads against pending changes */
+static void test_forced_read(void)
+{
+    MockSpiBus bus;
+    DrvRegisters registers(bus);
+
+    // the chip was changed behind the shadow's back, as by a DRV8308 reset
+    bus.chip[0x04] = 0x0200;
+    CHECK(registers.get(0x04) == 0x0000);
+    CHECK(bus.reads == 0);
+    CHECK(registers.get(0x04, true) == 0x0200);
+    CHECK(bus.reads == 1);
+    CHECK(registers.get(0x04) == 0x0200);
+
+    // a forced read returns the chip, but keeps the change waiting to be flushed
+    registers.set(0x04, 0x0300);
+    CHECK(registers.get(0x04, true) == 0x0200);
+    CHECK(registers.get(0x04) == 0x0300);
+    CHECK(registers.flush() == 1);
+    CHECK(bus.chip[0x04] == 0x0300);
+}
+
+
+
+/** @brief Function which checks registers outside the shadow
+ *
+ *  @details The fault and status registers from 0x0C up are never cached: every set is
+ *  written at once and every get reads the chip.
+ */
+static void test_outside_shadow(void)
+{
+    MockSpiBus bus;
+    DrvRegisters registers(bus);
+
+    registers.set(0x2A, 0x0000);
+    CHECK(bus.trace == "B 2A0000 E");
+    CHECK(!registers.is_dirty());
+
+    bus.clear();
+    bus.chip[0x2A] = 0x0040;
+    CHECK(registers.get(0x2A) == 0x0040);
+    CHECK(registers.get(0x2A) == 0x0040);
+    CHECK(bus.reads == 2);
+    CHECK(registers.flush() == 0);
+}
+
+
+
+/** @brief Function which checks the shadow against the chip after random changes
+ *
+ *  @details Thousands of random changes are made to the configuration registers with a
+ *  flush after every few. After each flush the shadow and the chip must agree on every
+ *  register, and the flush must write each register that set() changed since the last one
+ *  once, which takes in every register whose value differs from the chip.
+ */
+static void test_random(void)
+{
+    MockSpiBus bus;
+    DrvRegisters registers(bus);
+    uint16_t flushed[DRV_REG_COUNT] = { 0 };
+    uint32_t seed = 99;
+    uint32_t wrong_count = 0;
+    uint32_t disagree = 0;
+
+    for (uint32_t round = 0; round < 5000; round++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        uint8_t changes = (uint8_t)((seed >> 16) % 6);
+        bool touched[DRV_REG_COUNT] = { false };
+        for (uint8_t i = 0; i < changes; i++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            uint8_t addr = (uint8_t)((seed >> 16) % DRV_REG_COUNT);
+            uint16_t value = (uint16_t)((seed >> 8) & 0x0003);
+            touched[addr] |= registers.get(addr) != value;
+            registers.set(addr, value);
+        }
+
+        uint8_t expected = 0;
+        uint8_t differ = 0;
+        for (uint8_t addr = 0; addr < DRV_REG_COUNT; addr++)
+        {
+            expected += touched[addr] ? 1 : 0;
+            differ += (registers.get(addr) != flushed[addr]) ? 1 : 0;
+        }
+        bus.clear();
+        uint8_t written = registers.flush();
+        wrong_count += (written != expected || written < differ || bus.writes != written) ? 1 : 0;
+        for (uint8_t addr = 0; addr < DRV_REG_COUNT; addr++)
+        {
+            flushed[addr] = registers.get(addr);
+            disagree += (bus.chip[addr] != flushed[addr]) ? 1 : 0;
+        }
+    }
+    printf("random changes: %u flushes with the wrong writes, %u registers disagreeing\n",
+           wrong_count, disagree);
+    CHECK(wrong_count == 0);
+    CHECK(disagree == 0);
+    CHECK(!bus.misuse);
+}
+
+
+
+int main(void)
+{
+    test_single();
+    test_burst();
+    test_coalescing();
+    test_forced_read();
+    test_outside_shadow();
+    test_random();
+    return test_result("test_drvregisters");
+}
@@ -0,0 +1,229 @@
+/** @file test_integrator.cpp
+ *  This file contains the accuracy check and benchmark of the integrators in Integrator.h
+ *  stepping a WheelModel. Each method spins the wheel up under a constant torque against
+ *  viscous and Coulomb friction, and coasts it down to a stop, at the 1 ms step of the
+ *  torque loop and at a ten times longer step, and the largest difference from the exact
+ *  solution is printed with the host cycles each step takes.
+*/
+
+#include <math.h>
+#include "test.h"
+#include "WheelModel.h"
+#include "Integrator.h"
+
+// Moment of inertia of the motor and load, the WheelModel default (kg*m^2)
+#define WHEEL_J 0.001712f
+
+// Coulomb friction and torque used for the runs (N*m)
+#define WHEEL_C 0.002f
+#define WHEEL_TORQUE 0.02f
+
+// Steps timed for each method in the benchmark
+#define BENCH_STEPS 10000000
+
+/** Names of the methods, in the order of IntegratorMode */
+static const char* const mode_names[] = { "euler", "trapezoid", "rk4", "zoh" };
+
+
+
+/** @brief Function which returns the exact speed of a spin-up
+ *
+ *  @param w0 The speed at the start in rad/s.
+ *  @param b The viscous friction in N*m per rad/s.
+ *  @param t The time since the start in s.
+ *
+ *  @return The speed in rad/s, which approaches (T - c) / b with time constant J / b.
+ */
+static double exact_spin_up(double w0, double b, double t)
+{
+    double steady = (WHEEL_TORQUE - WHEEL_C) / b;
+    return steady + (w0 - steady) * exp(-b / WHEEL_J * t);
+}
+
+
+
+/** @brief Function which returns the exact speed of a coast-down without torque
+ *
+ *  @details The speed decays toward -c / b until it reaches zero, then stays there.
+ *
+ *  @param w0 The speed at the start in rad/s.
+ *  @param b The viscous friction in N*m per rad/s.
+ *  @param t The time since the start in s.
+ *
+ *  @return The speed in rad/s.
+ */
+static double exact_coast(double w0, double b, double t)
+{
+    double floor = -WHEEL_C / b;
+    double w = floor + (w0 - floor) * exp(-b / WHEEL_J * t);
+    return (w > 0.0) ? w : 0.0;
+}
+
+
+
+/** @brief Function which runs one method over a spin-up and a coast-down
+ *
+ *  @tparam M The integration method.
+ *
+ *  @param b The viscous friction in N*m per rad/s.
+ *  @param dt The step in s.
+ *  @param spin_error Filled in with the largest error of the spin-up in rad/s.
+ *  @param coast_error Filled in with the largest error of the coast-down in rad/s.
+ *  @param stuck Filled in with true if the wheel stopped and stayed stopped.
+ */
+template <IntegratorMode M>
+static void run(float b, float dt, double& spin_error, double& coast_error, bool& stuck)
+{
+    WheelModel model(WHEEL_J, b, WHEEL_C, dt);
+    int steps = (int)(2.0f / dt);
+
+    float w = 50.0f;
+    spin_error = 0.0;
+    for (int i = 1; i <= steps; i++)
+    {
+        w = integrate<M>(model, w, WHEEL_TORQUE);
+        spin_error = fmax(spin_error, fabs(w - exact_spin_up(50.0, b, i * dt)));
+    }
+
+    // long enough for the wheel to stop from the highest speed either b reaches
+    w = 200.0f;
+    coast_error = 0.0;
+    stuck = true;
+    for (int i = 1; i <= 3 * steps; i++)
+    {
+        w = integrate<M>(model, w, 0.0f);
+        double exact = exact_coast(200.0, b, i * dt);
+        coast_error = fmax(coast_error, fabs(w - exact));
+        stuck &= (exact > 0.0) || w == 0.0f;
+    }
+}
+
+
+
+/** @brief Function which times one method
+ *
+ *  @tparam M The integration method.
+ *
+ *  @param model The wheel model to step.
+ *
+ *  @return The host cycles per step.
+ */
+template <IntegratorMode M>
+static double bench(const WheelModel& model)
+{
+    volatile float sink = 0.0f;
+    float w = 50.0f;
+    uint64_t begin = host_cycles();
+    for (int i = 0; i < BENCH_STEPS; i++)
+    {
+        w = integrate<M>(model, w, WHEEL_TORQUE);
+        w = (w > 1.0e4f) ? 50.0f : w;
+    }
+    uint64_t cycles = host_cycles() - begin;
+    sink = w;
+    (void)sink;
+    return (double)cycles / BENCH_STEPS;
+}
+
+
+
+/** @brief Function which prints the error of every method against the exact solution
+ *
+ *  @details The exact zero-order-hold step must match the solution to float rounding at
+ *  any step, the trapezoidal rule must be second order (about 100 times the error for ten
+ *  times the step) wherever its error is above that rounding, and every method must stop
+ *  the wheel at zero without turning it back.
+ */
+static void report_accuracy(void)
+{
+    const float frictions[] = { 0.001f, 0.02f };
+    const float steps[] = { 0.001f, 0.01f };
+
+    printf("  b N*m*s    tau s    dt s  method     spin-up error  coast error  rad/s\n");
+    for (float b : frictions)
+    {
+        double trap_error[2] = { 0.0, 0.0 };
+        double zoh_error = 0.0;
+        for (int k = 0; k < 2; k++)
+        {
+            float dt = steps[k];
+            double spin[4], coast[4];
+            bool stuck[4];
+            run<INTEGRATE_EULER>(b, dt, spin[0], coast[0], stuck[0]);
+            run<INTEGRATE_TRAPEZOID>(b, dt, spin[1], coast[1], stuck[1]);
+            run<INTEGRATE_RK4>(b, dt, spin[2], coast[2], stuck[2]);
+            run<INTEGRATE_ZOH>(b, dt, spin[3], coast[3], stuck[3]);
+
+            for (int m = 0; m < 4; m++)
+            {
+                printf("  %7.3f  %7.3f  %6.3f  %-9s  %13.3e  %11.3e\n", b, WHEEL_J / b, dt,
+                       mode_names[m], spin[m], coast[m]);
+                CHECK(stuck[m]);
+            }
+
+            // the speed starts at 50 rad/s, and the float rounding of 2000 steps adds up to 1e-4
+            CHECK(spin[3] < 2.0e-4);
+            CHECK(spin[2] < 1.0e-3);
+            CHECK(spin[1] < spin[0]);
+            trap_error[k] = spin[1];
+            zoh_error = (k == 0) ? spin[3] : zoh_error;
+        }
+
+        // the order only shows where the error is well above the rounding of the exact step
+        if (trap_error[0] > 10.0 * zoh_error)
+        {
+            double order = log10(trap_error[1] / trap_error[0]);
+            printf("  trapezoid error grows as dt^%.2f\n", order);
+            CHECK(order > 1.7 && order < 2.3);
+        }
+    }
+}
+
+
+
+/** @brief Function which checks the run-time dispatch gives the same steps as the templates */
+static void test_dispatch(void)
+{
+    WheelModel model(WHEEL_J, 0.005f, WHEEL_C, 0.001f);
+    float a = 10.0f, b = 10.0f, c = 10.0f, d = 10.0f;
+    bool same = true;
+    for (int i = 0; i < 1000; i++)
+    {
+        float torque = (i < 500) ? WHEEL_TORQUE : -WHEEL_TORQUE;
+        float w = integrate(INTEGRATE_EULER, model, a, torque);
+        same &= w == integrate<INTEGRATE_EULER>(model, a, torque);
+        a = w;
+        w = integrate(INTEGRATE_TRAPEZOID, model, b, torque);
+        same &= w == integrate<INTEGRATE_TRAPEZOID>(model, b, torque);
+        b = w;
+        w = integrate(INTEGRATE_RK4, model, c, torque);
+        same &= w == integrate<INTEGRATE_RK4>(model, c, torque);
+        c = w;
+        w = integrate(INTEGRATE_ZOH, model, d, torque);
+        same &= w == integrate<INTEGRATE_ZOH>(model, d, torque);
+        d = w;
+    }
+    CHECK(same);
+}
+
+
+
+/** @brief Function which prints the host cycles per step of every method */
+static void bench_methods(void)
+{
+    WheelModel model(WHEEL_J, 0.005f, WHEEL_C, 0.001f);
+    printf("  %-9s %.1f cycles per step\n", mode_names[0], bench<INTEGRATE_EULER>(model));
+    printf("  %-9s %.1f cycles per step\n", mode_names[1], bench<INTEGRATE_TRAPEZOID>(model));
+    printf("  %-9s %.1f cycles per step\n", mode_names[2], bench<INTEGRATE_RK4>(model));
+    printf("  %-9s %.1f cycles per step\n", mode_names[3], bench<INTEGRATE_ZOH>(model));
+}
+
+
+
+int main(void)
+{
+    report_accuracy();
+    test_dispatch();
+    bench_methods();
+    return test_result("test_integrator");
+}
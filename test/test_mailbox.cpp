@@ -0,0 +1,302 @@
+/** @file test_mailbox.cpp
+ *  This file contains the tests for the Mailbox used to pass commands between tasks. The
+ *  MAILBOX_PREEMPT hook lets a test run other posts and reads at a chosen point of a post,
+ *  as if the writer had been preempted there: after it reads which slot is published,
+ *  after it claims a slot, after it writes the value and after it publishes the slot. The
+ *  newest value must always be readable except while its own writer still holds it, and
+ *  an older post must never replace it. A stress run then has several producer threads
+ *  posting, yielding at every hook point, while a consumer takes values, and every value
+ *  taken must be whole and newer than the one before.
+*/
+
+#include <thread>
+#include <atomic>
+#include <string.h>
+
+/** @brief Function which runs the test's hook at a point of Mailbox::post() */
+static void preempt_hook(const char* point);
+
+#define MAILBOX_PREEMPT(point) preempt_hook(#point)
+
+#include "test.h"
+#include "Mailbox.h"
+
+// Posts made by each producer thread in the stress run
+#define STRESS_POSTS 200000u
+
+// Number of producer threads in the stress run
+#define STRESS_PRODUCERS 3
+
+/** A value big enough that a torn copy would show, with a check word over the rest */
+struct Payload
+{
+    uint32_t producer;              // thread which posted the value
+    uint32_t count;                 // how many values that thread had posted before
+    uint32_t fill[6];               // copies of count
+    uint32_t check;                 // producer and count mixed together
+};
+
+static void (*hook_fn)(void) = NULL;            // run once at hook_point, then disarmed
+static const char* hook_point = "";             // point of post() at which to run hook_fn
+static std::atomic<bool> hook_yield (false);    // true to yield at every point in the stress run
+
+/** A mailbox whose sequence counter can be started anywhere, so the wrap of the sequence
+ *  number past the 28 bits the published tag holds can be tested quickly.
+ */
+template <typename T, uint32_t N>
+class TestMailbox : public Mailbox<T, N>
+{
+    public:
+
+        /** @brief A function which makes the next post get sequence number @c seq */
+        void preset(uint32_t seq)
+        {
+            this->next_seq.store(seq - 1);
+        }
+};
+
+
+
+static void preempt_hook(const char* point)
+{
+    if (hook_fn != NULL && strcmp(point, hook_point) == 0)
+    {
+        void (*fn)(void) = hook_fn;
+        hook_fn = NULL;
+        fn();
+    }
+    else if (hook_yield.load(std::memory_order_relaxed))
+    {
+        std::this_thread::yield();
+    }
+}
+
+
+
+/** @brief Function which arms the hook to run a function at a point of the next post
+ *
+ *  @param point The point, as named in Mailbox::post().
+ *  @param fn The function to run there.
+ */
+static void arm(const char* point, void (*fn)(void))
+{
+    hook_point = point;
+    hook_fn = fn;
+}
+
+
+
+/** @brief Function which makes a payload for a producer's count */
+static Payload make_payload(uint32_t producer, uint32_t count)
+{
+    Payload p;
+    p.producer = producer;
+    p.count = count;
+    for (uint32_t& f : p.fill)
+    {
+        f = count;
+    }
+    p.check = (producer * 0x9E3779B9u) ^ count;
+    return p;
+}
+
+
+
+/** @brief Function which reports whether a payload was copied whole */
+static bool whole(const Payload& p)
+{
+    for (uint32_t f : p.fill)
+    {
+        if (f != p.count)
+        {
+            return false;
+        }
+    }
+    return p.check == ((p.producer * 0x9E3779B9u) ^ p.count);
+}
+
+static Mailbox<uint32_t> box;       // the mailbox the single-thread tests share
+static bool peeked = false;         // what the hook read from it
+static Mail<uint32_t> peeked_mail;
+
+
+
+/** @brief Function which checks a writer never claims a slot published after it looked
+ *
+ *  @details Writer A reads which slot is published and is preempted; writer B posts and
+ *  publishes the next slot, the one A would try first. A must give that slot back and
+ *  use another, so B's value can still be read while A writes, and A's value, being
+ *  older than B's, must not be published.
+ */
+static void test_stale_published(void)
+{
+    box.post(1, 0);
+    arm("read_published", []
+    {
+        box.post(3, 0);
+        arm("written", [] { peeked = box.peek(peeked_mail); });
+    });
+    uint32_t failures = box.failures();
+    box.post(2, 0);
+
+    CHECK(peeked && peeked_mail.value == 3 && peeked_mail.seq == 3);
+    CHECK(box.failures() == failures);
+
+    Mail<uint32_t> mail;
+    CHECK(box.take(mail) && mail.value == 3);
+    CHECK(box.drops() == 2);
+}
+
+
+
+/** @brief Function which checks writers preempted between claiming and publishing a slot
+ *
+ *  @details While writer A holds a slot, other writers must keep posting around it and
+ *  their values must be readable. Once A has published, its slot cannot be read until A
+ *  releases it, and a read then must give up and count a failure rather than spin.
+ */
+static void test_preempted_writer(void)
+{
+    Mail<uint32_t> mail;
+    box.take(mail);
+
+    // preempted after claiming: newer posts go around the held slot
+    arm("claimed", []
+    {
+        for (uint32_t v = 100; v < 110; v++)
+        {
+            box.post(v, 0);
+        }
+        peeked = box.peek(peeked_mail);
+    });
+    uint32_t seq = box.post(50, 0);
+    CHECK(peeked && peeked_mail.value == 109);
+    CHECK(box.collisions() == 0);
+    CHECK(box.peek(mail) && mail.value == 109 && mail.seq == seq + 10);
+
+    // preempted after writing, with nothing newer: A's value is published once it runs
+    arm("written", [] { peeked = box.peek(peeked_mail); });
+    box.post(60, 0);
+    CHECK(peeked && peeked_mail.value == 109);
+    CHECK(box.peek(mail) && mail.value == 60);
+
+    // preempted after publishing: the read fails and is counted, and later posts still work
+    uint32_t failures = box.failures();
+    arm("published", [] { peeked = box.peek(peeked_mail); });
+    box.post(70, 0);
+    CHECK(!peeked);
+    CHECK(box.failures() == failures + 1);
+    CHECK(box.peek(mail) && mail.value == 70);
+    box.post(80, 0);
+    CHECK(box.take(mail) && mail.value == 80);
+}
+
+
+
+/** @brief Function which checks reads past the 28 bits of sequence number in the tag
+ *
+ *  @details A sequence number whose low 28 bits are zero would make the tag of slot 0 read
+ *  as an empty mailbox, so post() skips it; every value must still be read back.
+ */
+static void test_sequence_wrap(void)
+{
+    const uint32_t starts[] = { 0x0FFFFFF0u, 0xFFFFFFF0u };
+    for (uint32_t start : starts)
+    {
+        TestMailbox<uint32_t, 4> wrap;
+        wrap.preset(start);
+        bool ok = true;
+        for (uint32_t i = 0; i < 40; i++)
+        {
+            uint32_t seq = wrap.post(i, 0);
+            Mail<uint32_t> mail;
+            ok &= (seq & 0x0FFFFFFF) != 0 && wrap.take(mail) && mail.value == i && mail.seq == seq;
+        }
+        CHECK(ok);
+        CHECK(wrap.failures() == 0);
+    }
+}
+
+
+
+/** @brief Function which runs producer threads against a consumer thread
+ *
+ *  @details Every producer yields at each hook point of every post, so posts are cut off
+ *  at all of them. Every value taken must be whole, the sequence numbers taken must rise,
+ *  and each producer's counts must rise. At the end the value left must be the newest one
+ *  which was posted.
+ */
+static void test_stress(void)
+{
+    static Mailbox<Payload> stress;
+    std::atomic<int> running (STRESS_PRODUCERS);
+    std::atomic<uint32_t> newest_seq (0);
+    hook_yield = true;
+
+    std::thread producers[STRESS_PRODUCERS];
+    for (uint32_t p = 0; p < STRESS_PRODUCERS; p++)
+    {
+        producers[p] = std::thread([&, p]
+        {
+            for (uint32_t i = 0; i < STRESS_POSTS; i++)
+            {
+                uint32_t seq = stress.post(make_payload(p, i), 0);
+                uint32_t seen = newest_seq.load();
+                while (seq != 0 && (int32_t)(seq - seen) > 0 && !newest_seq.compare_exchange_weak(seen, seq))
+                {
+                }
+                if ((i & 63) == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            running--;
+        });
+    }
+
+    uint32_t taken = 0, torn = 0, backwards = 0;
+    uint32_t last_seq = 0;
+    uint32_t last_count[STRESS_PRODUCERS] = { 0 };
+    Mail<Payload> mail;
+    while (running.load() > 0)
+    {
+        if (stress.take(mail))
+        {
+            taken++;
+            torn += whole(mail.value) ? 0 : 1;
+            backwards += (taken > 1 && (int32_t)(mail.seq - last_seq) <= 0) ? 1 : 0;
+            uint32_t p = mail.value.producer % STRESS_PRODUCERS;
+            backwards += (mail.value.count < last_count[p]) ? 1 : 0;
+            last_count[p] = mail.value.count;
+            last_seq = mail.seq;
+        }
+        std::this_thread::yield();
+    }
+    for (std::thread& t : producers)
+    {
+        t.join();
+    }
+    hook_yield = false;
+
+    Mail<Payload> last;
+    CHECK(stress.peek(last));
+    printf("  stress: %u posts, %u taken, %u dropped, %u collisions, %u retries, %u failed reads\n",
+           (unsigned)(STRESS_PRODUCERS * STRESS_POSTS), (unsigned)taken, (unsigned)stress.drops(),
+           (unsigned)stress.collisions(), (unsigned)stress.retries(), (unsigned)stress.failures());
+    CHECK(taken > 0);
+    CHECK(torn == 0);
+    CHECK(backwards == 0);
+    CHECK(last.seq == newest_seq.load());
+    CHECK(whole(last.value));
+}
+
+
+
+int main(void)
+{
+    test_stale_published();
+    test_preempted_writer();
+    test_sequence_wrap();
+    test_stress();
+    return test_result("test_mailbox");
+}
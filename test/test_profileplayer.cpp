@@ -0,0 +1,221 @@
+/** @file test_profileplayer.cpp
+ *  This file contains the tests for the ProfilePlayer. A profile with a hold, a ramp, a
+ *  pulse and a sine sweep is played and every command must come on its exact due time with
+ *  the value of its shape. The same profile is then played by a task which wakes late by a
+ *  random amount, as task_profile can, and takes every command which is due, and the due
+ *  times must stay on the same grid. An hour-long ramp must end on the microsecond it is
+ *  due, and profile text with mistakes in it must be rejected with a message.
+*/
+
+#include <math.h>
+#include <string.h>
+#include "test.h"
+#include "Profile.h"
+
+// A hold, a ramp, a pulse and a sine sweep from 1 Hz to 10 Hz, as profile text
+#define FOUR_STEPS "# test\n0 speed 100\n1000 speed ramp 100 200\n2000 torque pulse 0.05 250; " \
+                   "3000 speed sine 500 50 1 10\nend 63000\n"
+
+// Commands the four steps give: the hold, 200 of the ramp, both edges of the pulse, 12000
+// of the sine sweep and its value again at the end
+#define FOUR_STEP_COMMANDS (1 + 200 + 2 + 12000 + 1)
+
+
+
+/** @brief Function which checks every command of a profile is due on its grid with its value
+ *
+ *  @details The profile is started at an odd time so an offset added twice would show. Ramp
+ *  and sweep commands must be PROFILE_UPDATE_US apart from the start of their step, and the
+ *  sweep must follow the phase of a linear chirp to within the float rounding of its phase,
+ *  0.05 RPM.
+ */
+static void test_due_grid(void)
+{
+    ProfilePlayer player;
+    char error[64];
+    CHECK(player.parse(FOUR_STEPS, error, sizeof(error)));
+    CHECK(player.steps_loaded() == 4 && player.duration_ms() == 63000);
+
+    const int64_t t0 = 123456789;
+    player.start(t0);
+    ProfileCommand command;
+    int64_t last_due = -1;
+    uint32_t count = 0, pulse_edges = 0;
+    double sine_error = 0.0;
+    bool on_grid = true;
+    while (player.is_playing())
+    {
+        int64_t due = player.next_due();
+        if (!player.next(command))
+        {
+            CHECK(due == t0 + 63000000LL);
+            break;
+        }
+        on_grid &= command.due_us == due && due > last_due;
+        last_due = due;
+        count++;
+
+        int64_t offset = due - t0;
+        if (command.step == 0)
+        {
+            CHECK(offset == 0 && command.value == 100.0f);
+        }
+        else if (command.step == 1)
+        {
+            float want = 100.0f + 100.0f * (offset - 1000000) / 1.0e6f;
+            on_grid &= (offset - 1000000) % PROFILE_UPDATE_US == 0;
+            CHECK(fabsf(command.value - want) < 1.0e-3f);
+        }
+        else if (command.step == 2)
+        {
+            CHECK(offset == 2000000 || offset == 2250000);
+            CHECK(command.value == ((offset == 2000000) ? 0.05f : 0.0f) && command.target == PROFILE_TORQUE);
+            pulse_edges++;
+        }
+        else
+        {
+            double t = (offset - 3000000) / 1.0e6;
+            double cycles = t + 0.5 * 9.0 * t * t / 60.0;
+            on_grid &= (offset - 3000000) % PROFILE_UPDATE_US == 0;
+            sine_error = fmax(sine_error, fabs(command.value - (500.0 + 50.0 * sin(2.0 * M_PI * cycles))));
+        }
+    }
+    printf("  four steps: %u commands, sine sweep within %.4f RPM, last due %+lld us from the end\n",
+           (unsigned)count, sine_error, (long long)(last_due - t0 - 63000000));
+    CHECK(on_grid);
+    CHECK(pulse_edges == 2);
+    CHECK(count == FOUR_STEP_COMMANDS);
+    CHECK(sine_error < 0.05);
+}
+
+
+
+/** @brief Function which plays the profile with a task that wakes late
+ *
+ *  @details The task sleeps until the next command is due and wakes up to 200 us late, or
+ *  one time in ten up to 20 ms late, then takes every command which is due and posts only
+ *  the latest, as task_profile does. Every command must still be taken, on the grid it has
+ *  when played on time, and the one posted must be the newest due: lateness must never push
+ *  the due times back.
+ */
+static void test_late_wakeup(void)
+{
+    ProfilePlayer player;
+    char error[64];
+    player.parse(FOUR_STEPS, error, sizeof(error));
+    player.start(0);
+
+    ProfileCommand command, latest;
+    uint32_t seed = 1, posted = 0, taken = 0;
+    int64_t now = 0, worst = 0;
+    bool on_grid = true, newest = true;
+    while (player.is_playing())
+    {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t late = ((seed >> 16) % 10 == 0) ? (seed >> 8) % 20000 : (seed >> 8) % 200;
+        now = ((now > player.next_due()) ? now : player.next_due()) + late;
+
+        bool have = false;
+        while (player.is_playing() && player.next_due() <= now)
+        {
+            if (player.next(command))
+            {
+                on_grid &= command.due_us % 1000 == 0;
+                latest = command;
+                have = true;
+                taken++;
+            }
+        }
+        newest &= !player.is_playing() || player.next_due() > now;
+        if (have)
+        {
+            posted++;
+            worst = (now - latest.due_us > worst) ? now - latest.due_us : worst;
+        }
+    }
+    printf("  late wakeups: %u commands taken, %u posted, worst %lld us late\n", (unsigned)taken,
+           (unsigned)posted, (long long)worst);
+    CHECK(taken == FOUR_STEP_COMMANDS);
+    CHECK(posted < taken);
+    CHECK(on_grid && newest);
+    CHECK(worst < 20000);
+}
+
+
+
+/** @brief Function which checks an hour-long ramp does not drift
+ *
+ *  @details A ramp from 0 to 3600 RPM over an hour gives 720000 commands and its value
+ *  again at the end, which must be due exactly an hour after the start.
+ */
+static void test_drift(void)
+{
+    ProfilePlayer player;
+    ProfileStep steps[2] =
+    {
+        { 0, PROFILE_SPEED, SHAPE_RAMP, 0.0f, 3600.0f, 0.0f, 0.0f },
+        { 3600000, PROFILE_SPEED, SHAPE_HOLD, 0.0f, 0.0f, 0.0f, 0.0f }
+    };
+    CHECK(player.set_steps(steps, 2, 0));
+    player.start(1000);
+
+    ProfileCommand command;
+    int64_t last_due = 0;
+    uint32_t count = 0;
+    bool on_grid = true;
+    while (player.next(command))
+    {
+        on_grid &= (command.due_us - 1000) % PROFILE_UPDATE_US == 0;
+        last_due = command.due_us;
+        count++;
+    }
+    printf("  hour ramp: %u commands, last %+lld us from its due time\n", (unsigned)count,
+           (long long)(last_due - 3600001000LL));
+    CHECK(on_grid);
+    CHECK(count == 720001);
+    CHECK(last_due == 3600001000LL);
+}
+
+
+
+/** @brief Function which checks profile text with mistakes is rejected
+ *
+ *  @details Each text must fail with a message and leave no steps loaded. Commas work as
+ *  separators, and a lone pulse gives both of its edges and ends when it does.
+ */
+static void test_parse_errors(void)
+{
+    const char* const bad[] =
+    {
+        "0 speed", "0 speed ramp 1 2", "0 spin 3", "5 speed 1\n3 speed 2", "0 torque pulse 1 0",
+        "0 speed 1 2", "end x", "", "0 speed 1\n10 speed 2\nend 5"
+    };
+    ProfilePlayer player;
+    char error[64];
+    for (uint32_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        error[0] = '\0';
+        CHECK(!player.parse(bad[i], error, sizeof(error)));
+        CHECK(error[0] != '\0' && player.steps_loaded() == 0);
+        printf("  bad text %u rejected: %s\n", (unsigned)i + 1, error);
+    }
+
+    CHECK(player.parse("0,speed,10\n100,speed,20\n", error, sizeof(error)) && player.steps_loaded() == 2);
+    CHECK(player.parse("0 torque pulse 0.1 50", error, sizeof(error)) && player.duration_ms() == 50);
+    ProfileCommand command;
+    player.start(0);
+    CHECK(player.next(command) && command.value == 0.1f && player.next_due() == 50000);
+    CHECK(player.next(command) && command.value == 0.0f && player.next_due() == 50000);
+    CHECK(!player.next(command) && !player.is_playing());
+}
+
+
+
+int main(void)
+{
+    test_due_grid();
+    test_late_wakeup();
+    test_drift();
+    test_parse_errors();
+    return test_result("test_profileplayer");
+}
@@ -0,0 +1,365 @@
+/** @file test_runlog.cpp
+ *  This file contains the tests for the RunLog, run against a FileFlash which emulates the
+ *  flash in a file. Runs are recorded, the log is mounted again as after a reset, and every
+ *  run in the index must read back whole. The power is then cut at random points while runs
+ *  are recorded, and after each cut the log must mount, hold only whole runs and record a
+ *  new run. Long sequences of runs check that the log wraps around cleanly and wears every
+ *  sector equally, and that with spare sectors set no sector is erased while recording.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "test.h"
+#include "RunLog.h"
+#include "FileFlash.h"
+
+// File holding the emulated flash, which the Makefile puts in its build directory. The
+// first argument of the program overrides it
+#ifndef FLASH_PATH
+#define FLASH_PATH "test_runlog.bin"
+#endif
+
+// Size of the emulated flash
+#define SECTOR_BYTES 4096
+#define SECTORS 16
+
+// Random power cuts made while recording
+#define POWER_CUTS 300
+
+static const char* flash_path = FLASH_PATH;    // file holding the emulated flash
+
+/** @brief Function which makes a sample whose fields can be checked from its time */
+static TelemetrySample make_sample(uint32_t i)
+{
+    TelemetrySample s;
+    memset(&s, 0, sizeof(s));
+    s.t_us = i;
+    s.actual = i * 3;
+    s.brake = i & 0xFFFF;
+    return s;
+}
+
+
+
+/** @brief Function which records one run of numbered samples
+ *
+ *  @param log The log.
+ *  @param profile The name of the run's profile.
+ *  @param batches The number of batches of RUNLOG_RECORD_SAMPLES samples in the run.
+ *  @param t The number of the first sample, moved on past the last one.
+ *
+ *  @return True if the run was started and every batch written.
+ */
+static bool record_run(RunLog& log, const char* profile, uint32_t batches, uint32_t& t)
+{
+    TelemetrySample batch[RUNLOG_RECORD_SAMPLES];
+    bool ok = log.start_run(profile, 0, 0);
+    for (uint32_t k = 0; ok && k < batches; k++)
+    {
+        for (uint32_t i = 0; i < RUNLOG_RECORD_SAMPLES; i++)
+        {
+            batch[i] = make_sample(t++);
+        }
+        ok = log.append(batch, RUNLOG_RECORD_SAMPLES);
+    }
+    log.end_run();
+    return ok;
+}
+
+
+
+/** @brief Function which stops the test if the file holding the flash could not be opened
+ *
+ *  @details Every check after that would fail, and the power cut trials would go on
+ *  failing for a long time, so the test ends at once.
+ */
+static void require_open(FileFlash& flash)
+{
+    if (!flash.is_open())
+    {
+        printf("  cannot open %s\n", flash_path);
+        test_failures++;
+        exit(test_result("test_runlog"));
+    }
+}
+
+
+
+/** @brief Function which reads a run back and checks its samples follow on from each other
+ *
+ *  @param log The log.
+ *  @param info The index entry of the run.
+ *
+ *  @return True if every sample read is whole and in order, and as many were read as the
+ *  index says the run holds.
+ */
+static bool run_intact(RunLog& log, const RunInfo& info)
+{
+    RunCursor cursor;
+    TelemetrySample batch[RUNLOG_RECORD_SAMPLES];
+    if (!log.open_run(info.id, cursor))
+    {
+        return false;
+    }
+
+    uint32_t read = 0, last = 0;
+    bool ok = true;
+    for (uint16_t n = log.read_run(cursor, batch); n > 0; n = log.read_run(cursor, batch))
+    {
+        for (uint16_t i = 0; i < n; i++)
+        {
+            ok &= (read == 0 || batch[i].t_us == last + 1);
+            ok &= (uint32_t)batch[i].actual == batch[i].t_us * 3 && batch[i].brake == (batch[i].t_us & 0xFFFF);
+            last = batch[i].t_us;
+            read++;
+        }
+    }
+    return ok && read == info.samples;
+}
+
+
+
+/** @brief Function which checks every run in the index reads back whole and is closed */
+static bool all_intact(RunLog& log)
+{
+    bool ok = true;
+    for (uint8_t i = 0; i < log.runs_kept(); i++)
+    {
+        ok &= run_intact(log, log.run(i)) && !log.run(i).open;
+    }
+    return ok;
+}
+
+
+
+/** @brief Function which finds the least and most erase counts in the segment headers
+ *
+ *  @details Spare sectors, which are erased and have no header yet, are skipped.
+ *
+ *  @param flash The flash holding the log.
+ *  @param least Filled in with the lowest count.
+ *  @param most Filled in with the highest count.
+ */
+static void erase_counts(FileFlash& flash, uint32_t& least, uint32_t& most)
+{
+    least = 0xFFFFFFFF;
+    most = 0;
+    for (uint32_t s = 0; s < SECTORS; s++)
+    {
+        uint32_t header[4];
+        flash.read(s * SECTOR_BYTES, header, sizeof(header));
+        if (header[0] == 0xFFFFFFFF)
+        {
+            continue;
+        }
+        least = (header[2] < least) ? header[2] : least;
+        most = (header[2] > most) ? header[2] : most;
+    }
+}
+
+
+
+/** @brief Function which checks runs survive the log being mounted again
+ *
+ *  @details Three runs are recorded and the flash is closed, as the ESP32 would be reset.
+ *  The new log must find all three with their profile and samples.
+ */
+static void test_remount(void)
+{
+    unlink(flash_path);
+    uint32_t t = 0;
+    {
+        FileFlash flash(flash_path, SECTOR_BYTES, SECTORS);
+        require_open(flash);
+        RunLog log(&flash);
+        CHECK(log.mount());
+        for (int r = 0; r < 3; r++)
+        {
+            CHECK(record_run(log, "step", 20, t));
+            t += 1000;
+        }
+    }
+
+    FileFlash flash(flash_path, SECTOR_BYTES, SECTORS);
+    require_open(flash);
+    RunLog log(&flash);
+    CHECK(log.mount());
+    CHECK(log.runs_kept() == 3);
+    for (uint8_t i = 0; i < log.runs_kept(); i++)
+    {
+        const RunInfo& run = log.run(i);
+        CHECK(run.id == i + 1u && run.boot == 1 && strcmp(run.profile, "step") == 0);
+        CHECK(run.samples == 20u * RUNLOG_RECORD_SAMPLES && !run.truncated);
+        CHECK(run_intact(log, run));
+    }
+    printf("  remount: %u runs in %u segments\n", (unsigned)log.runs_kept(), (unsigned)log.segments_used());
+}
+
+
+
+/** @brief Function which cuts the power at random points while runs are recorded
+ *
+ *  @details Each cut falls somewhere in the next 20000 bytes written, so it lands in run
+ *  starts, sample records, run ends and segment headers, and with the log wrapped around.
+ *  Every other run is recorded into spare sectors erased beforehand. After each cut the log
+ *  must mount, every run it kept must read back whole and closed, and a new run must record
+ *  and read back.
+ */
+static void test_power_cuts(void)
+{
+    uint32_t seed = 1, recovered = 0;
+    for (uint32_t trial = 0; trial < POWER_CUTS; trial++)
+    {
+        {
+            FileFlash flash(flash_path, SECTOR_BYTES, SECTORS);
+            require_open(flash);
+            RunLog log(&flash);
+            log.mount();
+            if (trial & 1)
+            {
+                log.set_spare(8);
+                while (log.prepare())
+                {
+                }
+            }
+            seed = seed * 1103515245u + 12345u;
+            flash.cut_after((seed >> 8) % 20000);
+            uint32_t t = trial * 100000;
+            record_run(log, "cut", 20, t);
+        }
+
+        FileFlash flash(flash_path, SECTOR_BYTES, SECTORS);
+        require_open(flash);
+        RunLog log(&flash);
+        bool ok = log.mount() && all_intact(log);
+        uint32_t t = 0;
+        ok &= record_run(log, "after", 1, t);
+        ok &= log.runs_kept() > 0 && run_intact(log, log.run(log.runs_kept() - 1));
+        ok &= log.write_failures() == 0;
+        recovered += ok ? 1 : 0;
+    }
+    printf("  power cuts: %u of %u recovered\n", (unsigned)recovered, (unsigned)POWER_CUTS);
+    CHECK(recovered == POWER_CUTS);
+}
+
+
+
+/** @brief Function which checks the log wraps around and wears the sectors evenly
+ *
+ *  @details 200 runs fill the log many times over, once erasing sectors as they are needed
+ *  and once from spare sectors erased between runs. The erase counts of the sectors must
+ *  differ by at most one, the oldest run left must be cut short at the oldest segment and
+ *  read back whole, and the log must mount again with the same runs.
+ */
+static void test_wraparound(void)
+{
+    for (uint32_t spare = 0; spare <= 6; spare += 6)
+    {
+        unlink(flash_path);
+        FileFlash flash(flash_path, SECTOR_BYTES, SECTORS);
+        require_open(flash);
+        RunLog log(&flash);
+        log.mount();
+        log.set_spare(spare);
+        uint32_t t = 0;
+        bool recorded = true;
+        for (int r = 0; r < 200; r++)
+        {
+            while (log.prepare())
+            {
+            }
+            recorded &= record_run(log, "wear", 30, t);
+        }
+
+        uint32_t least, most;
+        erase_counts(flash, least, most);
+        printf("  %u spare sectors: erases %u to %u, %u runs in %u segments and %u spare, oldest run truncated %d\n",
+               (unsigned)spare, (unsigned)least, (unsigned)most, (unsigned)log.runs_kept(),
+               (unsigned)log.segments_used(), (unsigned)log.spare_sectors(), (int)log.run(0).truncated);
+        CHECK(recorded);
+        CHECK(most - least <= 1 && log.wear() == most);
+        CHECK(log.segments_used() + log.spare_sectors() == SECTORS);
+        CHECK(log.run(0).truncated);
+        CHECK(all_intact(log));
+
+        uint8_t runs = log.runs_kept();
+        RunLog again(&flash);
+        CHECK(again.mount() && again.runs_kept() == runs && all_intact(again));
+    }
+}
+
+
+
+/** @brief Function which checks nothing is erased while a run is recorded with spare sectors
+ *
+ *  @details With six spare sectors erased beforehand, a run which fills five segments must
+ *  not erase any sector. A run which needs more than there are must be refused the segment
+ *  and stop, rather than erase, and once it has ended prepare() must erase the sectors again
+ *  so the next run records. After a reset the spare sectors, which are still erased, must not
+ *  be erased a second time.
+ */
+static void test_spares(void)
+{
+    unlink(flash_path);
+    FileFlash flash(flash_path, SECTOR_BYTES, SECTORS);
+    require_open(flash);
+    RunLog log(&flash);
+    log.mount();
+    log.set_spare(6);
+    while (log.prepare())
+    {
+    }
+    CHECK(log.spare_sectors() == 6);
+
+    uint32_t t = 0, erased = flash.sectors_erased();
+    uint32_t used = log.segments_used();
+    CHECK(log.start_run("spare", 0, 0) && !log.prepare());
+    TelemetrySample batch[RUNLOG_RECORD_SAMPLES];
+    while (log.segments_used() < used + 5)
+    {
+        for (uint32_t i = 0; i < RUNLOG_RECORD_SAMPLES; i++)
+        {
+            batch[i] = make_sample(t++);
+        }
+        CHECK(log.append(batch, RUNLOG_RECORD_SAMPLES));
+    }
+    log.end_run();
+    CHECK(flash.sectors_erased() == erased);
+
+    // a run longer than the spare sectors is cut short instead of erasing
+    CHECK(!record_run(log, "long", 200, t));
+    CHECK(flash.sectors_erased() == erased && log.spare_refusals() > 0);
+    CHECK(all_intact(log));
+    while (log.prepare())
+    {
+    }
+    CHECK(log.spare_sectors() == 6 && record_run(log, "next", 5, t));
+
+    // spare sectors left erased by a reset are taken as they are
+    RunLog again(&flash);
+    again.mount();
+    again.set_spare(6);
+    erased = flash.sectors_erased();
+    uint32_t prepared = 0;
+    while (again.prepare())
+    {
+        prepared++;
+    }
+    printf("  spares: %u refused segments, %u spare sectors found erased after a remount\n",
+           (unsigned)log.spare_refusals(), (unsigned)prepared);
+    CHECK(prepared > 0 && flash.sectors_erased() - erased < prepared);
+}
+
+
+
+int main(int argc, char** argv)
+{
+    flash_path = (argc > 1) ? argv[1] : flash_path;
+    test_remount();
+    test_power_cuts();
+    test_wraparound();
+    test_spares();
+    unlink(flash_path);
+    return test_result("test_runlog");
+}
@@ -0,0 +1,182 @@
+/** @file test_speedestimator.cpp
+ *  This file contains the host test of the SpeedEstimator. Edges for a known speed are
+ *  generated by FakeCapture with the 80 MHz tick of the MCPWM capture timer, and each filter
+ *  mode must settle on that speed, keep its error within the timing noise and, for the
+ *  median, ignore one late interrupt. It also measures the host cycles each mode spends per
+ *  edge, as a relative measure of the work add_edge() and rpm() do in the readActual task.
+*/
+
+#include <math.h>
+#include "test.h"
+#include "FakeCapture.h"
+
+// Tick rate of the MCPWM capture timer, which runs from the 80 MHz APB clock
+#define TICKS_PER_US 80
+
+// Edges timed for each mode in the benchmark
+#define BENCH_EDGES 1000000
+
+static const char* mode_names[] = { "average", "median", "adaptive" };
+
+
+
+/** @brief Function which returns the relative error of a measured speed
+ *
+ *  @param measured The speed from the estimator.
+ *  @param rpm The speed of the emulated motor.
+ *
+ *  @return The error as a fraction of @c rpm.
+ */
+static float relative_error(rpm_t measured, float rpm)
+{
+    return fabsf(rpm_to_float(measured) - rpm) / rpm;
+}
+
+
+
+/** @brief Function which checks every mode at constant speeds from 30 to 2500 RPM
+ *
+ *  @details Without timing noise every filtered speed after the window has filled must be
+ *  within 0.05% of the true speed. With 100 ns of jitter on every edge the single-period
+ *  speed is noisy, and each filter must do better than it.
+ */
+static void test_constant_speed(void)
+{
+    const float speeds[] = { 30.0f, 100.0f, 500.0f, 1000.0f, 2500.0f };
+    rpm_t out[64];
+
+    for (int mode = 0; mode < 3; mode++)
+    {
+        for (float rpm : speeds)
+        {
+            SpeedEstimator est((EstimatorMode)mode, 8, 5, TICKS_PER_US);
+            FakeCapture clean(TICKS_PER_US);
+            uint16_t n = clean.run(rpm, 40, est, out, 64);
+            CHECK(n == 39);
+            float worst = 0.0f;
+            for (uint16_t i = 10; i < n; i++)
+            {
+                worst = fmaxf(worst, relative_error(out[i], rpm));
+            }
+            CHECK(worst < 0.0005f);
+
+            SpeedEstimator noisy_est((EstimatorMode)mode, 8, 5, TICKS_PER_US);
+            FakeCapture noisy(TICKS_PER_US, 8);
+            n = noisy.run(rpm, 64, noisy_est, out, 64);
+            float filtered = 0.0f;
+            for (uint16_t i = 10; i < n; i++)
+            {
+                filtered = fmaxf(filtered, relative_error(out[i], rpm));
+            }
+            float raw = relative_error(noisy_est.raw_rpm(), rpm);
+            printf("%-8s %6.0f RPM: clean error %.5f%%, jittered %.5f%% (last raw %.5f%%)\n",
+                   mode_names[mode], rpm, worst * 100.0f, filtered * 100.0f, raw * 100.0f);
+            CHECK(filtered < 0.002f);
+        }
+    }
+}
+
+
+
+/** @brief Function which checks how each mode handles one late interrupt
+ *
+ *  @details One edge is delayed by a quarter of a period at 2000 RPM, which makes one
+ *  period 25% long and the next 25% short. The median must not move by more than 0.1%. The
+ *  average over K = 8 edges spreads the error over the periods in its window, so it must
+ *  stay within 4%, while the adaptive average fits only two periods in its 20 ms at this speed and just
+ *  has to do better than a single period. Once both periods are in the window they cancel,
+ *  and every mode must be back on the true speed after the window has passed them.
+ */
+static void test_late_interrupt(void)
+{
+    const float rpm = 2000.0f;
+    const uint32_t period_ticks = (uint32_t)(15.0e6f / rpm) * TICKS_PER_US;
+    const float limits[] = { 0.04f, 0.001f, 0.25f };
+    rpm_t out[64];
+
+    for (int mode = 0; mode < 3; mode++)
+    {
+        SpeedEstimator est((EstimatorMode)mode, 8, 5, TICKS_PER_US);
+        FakeCapture capture(TICKS_PER_US);
+        capture.run(rpm, 20, est, out, 64);
+        capture.delay_next(period_ticks / 4);
+        uint16_t n = capture.run(rpm, 12, est, out, 64);
+        float worst = 0.0f;
+        for (uint16_t i = 0; i < n; i++)
+        {
+            worst = fmaxf(worst, relative_error(out[i], rpm));
+        }
+        printf("%-8s late edge: worst error %.3f%%\n", mode_names[mode], worst * 100.0f);
+        CHECK(worst < limits[mode]);
+        CHECK(relative_error(out[n - 1], rpm) < 0.0005f);
+    }
+}
+
+
+
+/** @brief Function which checks that a step in speed is followed within the window
+ *
+ *  @details The speed steps from 1000 to 1500 RPM. Every mode must reach the new speed
+ *  within 0.05% once K edges have passed, and must never overshoot it.
+ */
+static void test_speed_step(void)
+{
+    rpm_t out[64];
+
+    for (int mode = 0; mode < 3; mode++)
+    {
+        SpeedEstimator est((EstimatorMode)mode, 8, 5, TICKS_PER_US);
+        FakeCapture capture(TICKS_PER_US);
+        capture.run(1000.0f, 20, est, out, 64);
+        uint16_t n = capture.run(1500.0f, 12, est, out, 64);
+        for (uint16_t i = 0; i < n; i++)
+        {
+            CHECK(rpm_to_float(out[i]) < 1500.0f * 1.0005f);
+        }
+        CHECK(relative_error(out[8], 1500.0f) < 0.0005f);
+    }
+}
+
+
+
+/** @brief Function which measures the host cycles per edge of each mode
+ *
+ *  @details The timestamps are generated before the timing starts, so only add_edge() and
+ *  rpm() are measured, as the readActual task calls them for every edge.
+ */
+static void bench_modes(void)
+{
+    static uint32_t stamps[BENCH_EDGES];
+    FakeCapture capture(TICKS_PER_US, 8);
+    for (uint32_t i = 0; i < BENCH_EDGES; i++)
+    {
+        stamps[i] = capture.next_edge(1500.0f + 500.0f * sinf(i * 1e-4f));
+    }
+
+    for (int mode = 0; mode < 3; mode++)
+    {
+        SpeedEstimator est((EstimatorMode)mode, 8, 5, TICKS_PER_US);
+        volatile int32_t sink = 0;
+        uint64_t begin = host_cycles();
+        for (uint32_t i = 0; i < BENCH_EDGES; i++)
+        {
+            if (est.add_edge(stamps[i]))
+            {
+                sink = sink + (int32_t)est.rpm();
+            }
+        }
+        uint64_t cycles = host_cycles() - begin;
+        printf("%-8s %.1f cycles per edge\n", mode_names[mode], (double)cycles / BENCH_EDGES);
+    }
+}
+
+
+
+int main(void)
+{
+    test_constant_speed();
+    test_late_interrupt();
+    test_speed_step();
+    bench_modes();
+    return test_result("test_speedestimator");
+}
@@ -0,0 +1,330 @@
+/** @file test_speedfsm.cpp
+ *  This file contains the host test of the SpeedFsm, driven by recorded event traces. Each
+ *  trace is a list of the events the speedControl task dispatched, one per line, with the
+ *  state and outputs the machine gave for it:
+ *
+ *      <event> <value>  <state>  <actions>  <dir> <speed>
+ *
+ *  where the event is @c cmd (EV_NEW_COMMAND, the value is the command), @c spd
+ *  (EV_SPEED_UPDATED, the value is the speed) or @c tmo (EV_TIMEOUT, the value is the
+ *  speed), the actions are the FSM_OUT_ names joined with '+' or '-' for none, and the
+ *  direction is '+' or '-'. A command and a speed which woke the task together are
+ *  written @c c+s with the value <command>/<speed>; the task takes the speed, dispatches
+ *  the command and then the speed, and the line gives the state after both and the actions
+ *  of both. Random event streams are then run against the invariants the speedControl task
+ *  relies on, and a stream of 1 RPM command steps must be held while the machine is idle.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "SpeedFsm.h"
+
+// Deadband the speedControl task gives the machine (RPM)
+#define DEADBAND_RPM 20.0f
+
+/** Names of the states, in the order of FsmState */
+static const char* const state_names[FSM_STATES] = { "IDLE", "ACCEL", "DECEL" };
+
+/** Names of the output bits, in the order they are applied */
+static const struct { uint8_t bit; const char* name; } action_names[] =
+{
+    { FSM_OUT_STOP, "stop" }, { FSM_OUT_BRAKE, "brake" }, { FSM_OUT_DIR, "dir" },
+    { FSM_OUT_UNBRAKE, "unbrake" }, { FSM_OUT_SET, "set" }, { FSM_OUT_RAMP, "ramp" }
+};
+
+/** Speed up, stop short with the brake, and ramp back up after braking too far */
+static const char* const trace_same_direction =
+    "cmd   1000  ACCEL  ramp                    + 1000\n"
+    "spd    500  ACCEL  -                       + 0\n"
+    "spd    990  IDLE   -                       + 0\n"
+    "cmd    500  DECEL  stop+brake              + 0\n"
+    "spd    800  DECEL  -                       + 0\n"
+    "spd    400  ACCEL  unbrake+ramp            + 500\n"
+    "spd    495  IDLE   -                       + 0\n"
+    "spd    510  IDLE   -                       + 0\n"
+    "cmd    300  DECEL  stop+brake              + 0\n"
+    "tmo    310  IDLE   unbrake+set             + 300\n";
+
+/** A reversal pre-empted by a new command, then a full reversal through zero */
+static const char* const trace_reversal =
+    "cmd    800  ACCEL  ramp                    + 800\n"
+    "spd    800  IDLE   -                       + 0\n"
+    "cmd   -600  DECEL  stop+brake              + 0\n"
+    "spd    200  DECEL  -                       + 0\n"
+    "cmd    700  ACCEL  unbrake+ramp            + 700\n"
+    "cmd   -600  DECEL  stop+brake              + 0\n"
+    "spd    100  DECEL  -                       + 0\n"
+    "tmo     10  ACCEL  dir+unbrake+ramp        - 600\n"
+    "spd   -300  ACCEL  -                       - 0\n"
+    "spd   -590  IDLE   -                       - 0\n"
+    "cmd  -1000  ACCEL  ramp                    - 1000\n"
+    "spd  -1000  IDLE   -                       - 0\n";
+
+/** Reversing from standstill in one event, then stopping, which hands DIR back to positive */
+static const char* const trace_stop =
+    "cmd   -400  ACCEL  stop+brake+dir+unbrake+ramp  - 400\n"
+    "spd   -400  IDLE   -                       - 0\n"
+    "cmd      0  DECEL  stop+brake              - 0\n"
+    "tmo   -300  DECEL  -                       - 0\n"
+    "spd    -10  ACCEL  dir+unbrake+ramp        + 0\n"
+    "spd      0  IDLE   -                       + 0\n"
+    "spd      5  IDLE   -                       + 0\n";
+
+/** Commands which arrive with a speed: one reached by that speed, one which stops a brake */
+static const char* const trace_combined =
+    "cmd   1000  ACCEL  ramp                    + 1000\n"
+    "spd    600  ACCEL  -                       + 0\n"
+    "c+s 1010/990  IDLE  ramp                   + 1010\n"
+    "cmd    300  DECEL  stop+brake              + 0\n"
+    "spd    700  DECEL  -                       + 0\n"
+    "c+s  400/410  IDLE  stop+brake+unbrake+set  + 400\n"
+    "c+s  800/405  ACCEL  ramp                  + 800\n"
+    "spd    790  IDLE   -                       + 0\n";
+
+
+
+/** @brief Function which turns a list of action names into FSM_OUT_ bits
+ *
+ *  @param text The names joined with '+', or "-" for none.
+ *
+ *  @return The bits, or 0xFF if a name is not known.
+ */
+static uint8_t parse_actions(const char* text)
+{
+    if (strcmp(text, "-") == 0)
+    {
+        return 0;
+    }
+
+    uint8_t bits = 0;
+    char copy[64];
+    strncpy(copy, text, sizeof(copy) - 1);
+    copy[sizeof(copy) - 1] = '\0';
+    for (char* name = strtok(copy, "+"); name != NULL; name = strtok(NULL, "+"))
+    {
+        uint8_t bit = 0xFF;
+        for (auto& a : action_names)
+        {
+            bit = (strcmp(name, a.name) == 0) ? a.bit : bit;
+        }
+        if (bit == 0xFF)
+        {
+            return 0xFF;
+        }
+        bits |= bit;
+    }
+    return bits;
+}
+
+
+
+/** @brief Function which plays a recorded trace into a new machine
+ *
+ *  @details Every line is dispatched in turn and the state, actions, direction and speed
+ *  are compared with what was recorded. The speed is only compared when SET or RAMP is
+ *  given, since it means nothing otherwise. A @c c+s line sets the speed, then dispatches
+ *  the command and the speed as the speedControl task does when both arrive together.
+ *
+ *  @param name The name of the trace, for the messages.
+ *  @param trace The trace.
+ */
+static void play_trace(const char* name, const char* trace)
+{
+    SpeedFsm fsm(rpm_from_float(DEADBAND_RPM));
+    int line_number = 0;
+    int mismatches = 0;
+
+    for (const char* line = trace; *line != '\0'; line = strchr(line, '\n') + 1)
+    {
+        line_number++;
+        char event[8], values[24], state[8], actions[64], dir;
+        float value, actual, speed;
+        int fields = sscanf(line, "%7s %23s %7s %63s %c %f", event, values, state, actions, &dir, &speed);
+        bool combined = strcmp(event, "c+s") == 0;
+        int numbers = combined ? sscanf(values, "%f/%f", &value, &actual) : sscanf(values, "%f", &value);
+        CHECK(fields == 6 && numbers == (combined ? 2 : 1));
+        if (fields != 6 || numbers != (combined ? 2 : 1))
+        {
+            return;
+        }
+
+        FsmOutput out;
+        if (combined)
+        {
+            fsm.set_actual(rpm_from_float(actual));
+            fsm.set_command(rpm_from_float(value));
+            out = fsm.dispatch(EV_NEW_COMMAND);
+            FsmOutput more = fsm.dispatch(EV_SPEED_UPDATED);
+            out.actions |= more.actions;
+            out.dir = more.dir;
+            out.speed = (more.actions & (FSM_OUT_SET | FSM_OUT_RAMP)) ? more.speed : out.speed;
+        }
+        else if (strcmp(event, "cmd") == 0)
+        {
+            fsm.set_command(rpm_from_float(value));
+            out = fsm.dispatch(EV_NEW_COMMAND);
+        }
+        else
+        {
+            fsm.set_actual(rpm_from_float(value));
+            out = fsm.dispatch((strcmp(event, "tmo") == 0) ? EV_TIMEOUT : EV_SPEED_UPDATED);
+        }
+
+        uint8_t want_actions = parse_actions(actions);
+        bool ok = strcmp(state_names[fsm.get_state()], state) == 0
+               && out.actions == want_actions
+               && out.dir == (dir == '-');
+        if (out.actions & (FSM_OUT_SET | FSM_OUT_RAMP))
+        {
+            ok = ok && rpm_abs(out.speed - rpm_from_float(speed)) < rpm_from_float(0.01f);
+        }
+        if (!ok)
+        {
+            printf("%s line %d: got %s actions %02x dir %c speed %.0f\n", name, line_number,
+                   state_names[fsm.get_state()], out.actions, out.dir ? '-' : '+',
+                   rpm_to_float(out.speed));
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0);
+    printf("  %-16s %2d events replayed\n", name, line_number);
+}
+
+
+
+/** @brief Function which runs random event streams against the machine's invariants
+ *
+ *  @details The speedControl task relies on these, whatever order events arrive in:
+ *  - the brake is on exactly while the machine is in FSM_DECEL;
+ *  - DIR only changes with FSM_OUT_DIR, and only when the speed is within the deadband
+ *    of zero;
+ *  - CLKIN is only stopped together with setting the brake, and is never both set and
+ *    ramped by one event;
+ *  - FSM_IDLE is only entered with the speed within the deadband of the command, or with
+ *    the command just sent straight to CLKIN after braking.
+ */
+static void test_random_streams(void)
+{
+    srand(12345);
+    const rpm_t deadband = rpm_from_float(DEADBAND_RPM);
+    uint32_t events = 0;
+    uint32_t reversals = 0;
+
+    for (int stream = 0; stream < 200; stream++)
+    {
+        SpeedFsm fsm(deadband);
+        bool brake = false;
+        bool dir = false;
+        rpm_t command = 0;
+        rpm_t actual = 0;
+
+        for (int i = 0; i < 500; i++)
+        {
+            int pick = rand() % 10;
+            FsmEvent ev = (pick == 0) ? EV_NEW_COMMAND : ((pick == 1) ? EV_TIMEOUT : EV_SPEED_UPDATED);
+            if (ev == EV_NEW_COMMAND)
+            {
+                command = rpm_from_float((float)(rand() % 5001 - 2500));
+                fsm.set_command(command);
+            }
+            else
+            {
+                // the speed wanders toward the command, or toward zero while braking
+                float a = rpm_to_float(actual);
+                float goal = brake ? 0.0f : rpm_to_float(command);
+                a += (goal - a) * (float)(rand() % 50) / 100.0f + (float)(rand() % 21 - 10);
+                actual = rpm_from_float(a);
+                fsm.set_actual(actual);
+            }
+
+            FsmState before = fsm.get_state();
+            FsmOutput out = fsm.dispatch(ev);
+            events++;
+
+            if (out.actions & FSM_OUT_BRAKE)   brake = true;
+            if (out.actions & FSM_OUT_UNBRAKE) brake = false;
+            CHECK(brake == (fsm.get_state() == FSM_DECEL));
+
+            if (out.actions & FSM_OUT_DIR)
+            {
+                CHECK(rpm_abs(actual) < deadband);
+                reversals += (out.dir != dir) ? 1 : 0;
+                dir = out.dir;
+            }
+            CHECK(fsm.get_dir() == dir);
+            CHECK(!(out.actions & FSM_OUT_STOP) || (out.actions & FSM_OUT_BRAKE));
+            CHECK((out.actions & (FSM_OUT_SET | FSM_OUT_RAMP)) != (FSM_OUT_SET | FSM_OUT_RAMP));
+
+            if (fsm.get_state() == FSM_IDLE && before != FSM_IDLE && !(out.actions & FSM_OUT_SET))
+            {
+                CHECK(rpm_abs(actual - command) <= deadband);
+            }
+        }
+    }
+    printf("  random streams   %u events, %u reversals\n", (unsigned)events, (unsigned)reversals);
+    CHECK(reversals > 0);
+}
+
+
+
+/** @brief Function which checks small command steps are held without a transition
+ *
+ *  @details The torque loop posts the speed it integrates every time it moves by 1 RPM.
+ *  Once the machine is idle, steps within the deadband of the command it settled on must
+ *  be held, so the speedControl task leaves them to the PID loop instead of resetting it,
+ *  and only a step past the deadband, or through zero, or while a transition runs, must be
+ *  dispatched.
+ */
+static void test_small_steps(void)
+{
+    const rpm_t deadband = rpm_from_float(DEADBAND_RPM);
+    SpeedFsm fsm(deadband);
+    fsm.set_command(rpm_from_float(1000.0f));
+    fsm.dispatch(EV_NEW_COMMAND);
+    fsm.set_actual(rpm_from_float(1000.0f));
+    fsm.dispatch(EV_SPEED_UPDATED);
+    CHECK(fsm.get_state() == FSM_IDLE);
+
+    uint32_t held = 0, dispatched = 0;
+    for (int rpm = 1001; rpm <= 1200; rpm++)
+    {
+        rpm_t command = rpm_from_float((float)rpm);
+        if (fsm.holds(command))
+        {
+            held++;
+            continue;
+        }
+        dispatched++;
+        fsm.set_command(command);
+        FsmOutput out = fsm.dispatch(EV_NEW_COMMAND);
+        CHECK(out.actions == FSM_OUT_RAMP && fsm.get_state() == FSM_ACCEL);
+        CHECK(!fsm.holds(command));
+        fsm.set_actual(command);
+        fsm.dispatch(EV_SPEED_UPDATED);
+    }
+    printf("  small steps      %u held, %u dispatched\n", (unsigned)held, (unsigned)dispatched);
+    CHECK(dispatched == 200 / ((uint32_t)DEADBAND_RPM + 1) && held + dispatched == 200);
+
+    SpeedFsm near_zero(deadband);
+    near_zero.set_command(rpm_from_float(10.0f));
+    near_zero.dispatch(EV_NEW_COMMAND);
+    near_zero.set_actual(rpm_from_float(10.0f));
+    near_zero.dispatch(EV_SPEED_UPDATED);
+    CHECK(near_zero.get_state() == FSM_IDLE);
+    CHECK(near_zero.holds(rpm_from_float(5.0f)));
+    CHECK(!near_zero.holds(rpm_from_float(-5.0f)) && !near_zero.holds(0));
+}
+
+
+
+int main(void)
+{
+    play_trace("same direction", trace_same_direction);
+    play_trace("reversal", trace_reversal);
+    play_trace("stop", trace_stop);
+    play_trace("combined", trace_combined);
+    test_random_streams();
+    test_small_steps();
+    return test_result("test_speedfsm");
+}
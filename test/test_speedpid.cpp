@@ -0,0 +1,302 @@
+/** @file test_speedpid.cpp
+ *  This file contains the step-response harness of the SpeedPid outer loop. The DRV8308
+ *  loop is modelled as following CLKIN with a first order lag, a limited acceleration and
+ *  a steady error which depends on the load, and it cannot slow the wheel by itself: only
+ *  friction and the brake do. FGOUT edges come from the wheel speed, a SpeedEstimator
+ *  measures them as readActual does, and the loop runs every 5 ms with the gains the
+ *  speedControl task starts with.
+ *
+ *  The wheel is settled at one command and then stepped to another, with the loop on and
+ *  with CLKIN equal to the command, and the rise time, overshoot, settling time and steady
+ *  error of each are printed. The limit, anti-windup, derivative and brake are then checked
+ *  on their own.
+*/
+
+#include <math.h>
+#include "test.h"
+#include "SpeedPid.h"
+#include "SpeedEstimator.h"
+
+// Period of the loop, as PID_PERIOD_US in CtrlTasks.cpp (us)
+#define PID_PERIOD_US 5000
+
+// Time step of the wheel model (us)
+#define SIM_STEP_US 10
+
+// Edges between speed measurements, and the longest time between them (us)
+#define NOTIFY_EDGES 4
+#define EDGE_TIMEOUT_US 20000
+
+// Band the wheel speed has to stay in to count as settled (RPM)
+#define SETTLE_BAND 5.0
+
+/** The gains the speedControl task starts with, as PID_GAINS in CtrlTasks.cpp */
+static const PidGains start_gains = { 1.0f, 4.0f, 0.01f, 1.0f };
+
+/** Gains which leave CLKIN equal to the command */
+static const PidGains no_gains = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+/** Model of the DRV8308 loop driving the wheel, with the brake */
+struct DrvLoop
+{
+    double w = 0.0;                 // wheel speed in RPM, never negative
+    double gain = 0.97;             // speed the loop settles at per RPM of CLKIN
+    double offset = 8.0;            // speed the load takes off that, in RPM
+    double tau = 0.12;              // time constant of the loop in s
+    double max_accel = 3000.0;      // acceleration the motor current allows in RPM/s
+    double friction = 40.0;         // deceleration from friction alone in RPM/s
+
+    /** @brief Function which advances the model by one time step
+     *
+     *  @param clkin The speed on CLKIN in RPM.
+     *  @param brake The brake duty cycle, 0 to 1.
+     *  @param dt The time step in seconds.
+     */
+    void step(double clkin, double brake, double dt)
+    {
+        double target = gain * clkin - offset;
+        double a = (target > w) ? fmin((target - w) / tau, max_accel) : -friction;
+        a -= brake * (w / 0.25 + 300.0);
+        w += a * dt;
+        w = (w > 0.0) ? w : 0.0;
+    }
+};
+
+/** The results of one step */
+struct StepResult
+{
+    double rise_s;                  // time from 10% to 90% of the step, or -1
+    double overshoot;               // furthest the wheel went past the command in RPM
+    double settle_s;                // time the wheel entered the band for good, or -1
+    double steady_error;            // mean error over the last second in RPM
+    double max_brake;               // largest brake duty cycle used
+};
+
+/** The wheel, its speed measurement and the loop, run together */
+struct PidRun
+{
+    DrvLoop loop;
+    SpeedEstimator speed;
+    SpeedPid pid;
+    double phase = 0.0;             // fraction of a period since the last edge
+    uint32_t pending = 0;           // edges since the last measurement
+    int64_t t = 0;                  // time in us
+    int64_t measured_at = 0;        // time of the last measurement
+    rpm_t measured = 0;             // latest measured speed
+    PidOutput out = { 0, 0.0f };    // latest output of the loop
+
+    /** @brief Constructor which starts the wheel at a speed with the loop reset there */
+    PidRun(double rpm, const PidGains& gains) : speed(ESTIMATE_ADAPTIVE, 8, 5, 1),
+                                                pid(PID_PERIOD_US * 1.0e-6f)
+    {
+        loop.w = rpm;
+        measured = rpm_from_float((float)rpm);
+        pid.set_gains(gains);
+        pid.reset(measured);
+    }
+
+    /** @brief Function which advances the wheel, the measurement and the loop by one step
+     *
+     *  @param command The commanded speed in RPM.
+     */
+    void step(double command)
+    {
+        if (t % PID_PERIOD_US == 0)
+        {
+            out = pid.update(rpm_from_float((float)command), measured);
+        }
+        loop.step(rpm_to_float(out.clkin), out.brake, SIM_STEP_US * 1.0e-6);
+        t += SIM_STEP_US;
+
+        // an edge every 1/4 revolution, measured every four edges or after 20 ms
+        phase += loop.w / 15.0 * SIM_STEP_US * 1.0e-6;
+        if (phase >= 1.0)
+        {
+            phase -= 1.0;
+            pending += speed.add_edge((uint32_t)t) ? 1 : 0;
+        }
+        if (pending >= NOTIFY_EDGES || (pending > 0 && t - measured_at >= EDGE_TIMEOUT_US))
+        {
+            pending = 0;
+            measured_at = t;
+            measured = speed.rpm();
+        }
+    }
+};
+
+
+
+/** @brief Function which settles the wheel at one command and steps it to another
+ *
+ *  @param from The command the wheel is settled at in RPM.
+ *  @param to The command after the step in RPM.
+ *  @param gains The gains of the loop.
+ *
+ *  @return The response to the step.
+ */
+static StepResult step_response(double from, double to, const PidGains& gains)
+{
+    PidRun run(from, gains);
+    for (int i = 0; i < 300000; i++)
+    {
+        run.step(from);
+    }
+
+    StepResult result = { -1.0, 0.0, -1.0, 0.0, 0.0 };
+    double start = run.loop.w;
+    double t10 = -1.0, error_sum = 0.0;
+    int error_count = 0;
+    const int steps = 400000;
+    for (int i = 1; i <= steps; i++)
+    {
+        run.step(to);
+        double t = i * SIM_STEP_US * 1.0e-6;
+        double w = run.loop.w;
+        double done = (w - start) / (to - start);
+        t10 = (t10 < 0.0 && done >= 0.1) ? t : t10;
+        result.rise_s = (result.rise_s < 0.0 && t10 >= 0.0 && done >= 0.9) ? t - t10 : result.rise_s;
+
+        double past = (to > start) ? w - to : to - w;
+        result.overshoot = fmax(result.overshoot, past);
+        result.max_brake = fmax(result.max_brake, run.out.brake);
+        if (fabs(w - to) > SETTLE_BAND)
+        {
+            result.settle_s = -1.0;
+        }
+        else if (result.settle_s < 0.0)
+        {
+            result.settle_s = t;
+        }
+        if (i > steps - 100000)
+        {
+            error_sum += to - w;
+            error_count++;
+        }
+    }
+    result.steady_error = error_sum / error_count;
+    return result;
+}
+
+
+
+/** @brief Function which prints a table of steps and checks the loop removes the error
+ *
+ *  @details With CLKIN equal to the command the wheel settles short of it by the load, or
+ *  never comes down from a higher speed. With the loop on, every step must end with less
+ *  than 1 RPM of steady error. Steps up must settle within 5 RPM in under a second and
+ *  overshoot by less than 25 RPM. Steps down by more than the 50 RPM at which the loop
+ *  starts to brake must use the brake, which the loop applies hard while its correction is
+ *  at the limit, so the wheel undershoots. In the firmware the state machine brakes a
+ *  large step down to within its deadband before the loop takes over, so steps down only
+ *  have to settle within 3 s and undershoot by less than 40 RPM.
+ */
+static void report_steps(void)
+{
+    const double steps[][2] = { { 1000, 1200 }, { 2000, 2200 }, { 300, 400 }, { 1000, 970 }, { 1000, 800 },
+                                { 2500, 2400 } };
+
+    printf("   from -> to RPM     off: rise s  overshoot  settle s  error"
+           "     pid: rise s  overshoot  settle s  error  brake\n");
+    for (auto& s : steps)
+    {
+        StepResult off = step_response(s[0], s[1], no_gains);
+        StepResult on = step_response(s[0], s[1], start_gains);
+        printf("  %5.0f -> %5.0f         %6.3f  %9.1f  %8.3f  %5.1f         %6.3f  %9.1f  %8.3f  %5.2f  %5.2f\n",
+               s[0], s[1], off.rise_s, off.overshoot, off.settle_s, off.steady_error,
+               on.rise_s, on.overshoot, on.settle_s, on.steady_error, on.max_brake);
+
+        bool up = s[1] > s[0];
+        CHECK(fabs(off.steady_error) > 10.0);
+        CHECK(fabs(on.steady_error) < 1.0);
+        CHECK(on.settle_s > 0.0 && on.settle_s < (up ? 1.0 : 3.0));
+        CHECK(on.overshoot < (up ? 25.0 : 40.0));
+        CHECK(up || s[0] - s[1] < 50.0 || on.max_brake > 0.0);
+    }
+}
+
+
+
+/** @brief Function which checks the loop against a load that changes while it runs
+ *
+ *  @details Once the wheel has settled the load takes 40 RPM more off the loop, as if the
+ *  wheel started to rub. The loop must bring the wheel back within 5 RPM of the command in
+ *  under 1.5 s.
+ */
+static void test_load_step(void)
+{
+    PidRun run(1500, start_gains);
+    for (int i = 0; i < 300000; i++)
+    {
+        run.step(1500);
+    }
+    run.loop.offset += 40.0;
+
+    double dip = 0.0, back_s = -1.0;
+    for (int i = 1; i <= 200000; i++)
+    {
+        run.step(1500);
+        double error = 1500.0 - run.loop.w;
+        dip = fmax(dip, error);
+        back_s = (fabs(error) > SETTLE_BAND) ? -1.0 : ((back_s < 0.0) ? i * SIM_STEP_US * 1.0e-6 : back_s);
+    }
+    printf("  load raised at 1500 RPM: dipped %.1f RPM, back within %.0f RPM after %.3f s\n",
+           dip, SETTLE_BAND, back_s);
+    CHECK(back_s > 0.0 && back_s < 1.5);
+}
+
+
+
+/** @brief Function which checks the limit, anti-windup, derivative and brake on their own
+ *
+ *  @details A new command must not kick the derivative, so the first step after a reset
+ *  only adds the proportional correction. A wheel held far below the command pins the
+ *  correction at the limit, and the integral must not wind up past it, so the correction
+ *  leaves the limit as soon as the error changes sign. CLKIN never crosses zero, and the
+ *  brake is only used for corrections more than brake_start toward zero.
+ */
+static void test_terms(void)
+{
+    SpeedPid pid(PID_PERIOD_US * 1.0e-6f, 200.0f);
+    PidGains gains = { 1.0f, 4.0f, 0.01f, 1.0f };
+    pid.set_gains(gains);
+
+    // no derivative kick on a new command
+    pid.reset(rpm_from_float(1000.0f));
+    PidOutput out = pid.update(rpm_from_float(1100.0f), rpm_from_float(1000.0f));
+    float expected = 1100.0f + 100.0f + 4.0f * 100.0f * PID_PERIOD_US * 1.0e-6f;
+    CHECK(fabs(rpm_to_float(out.clkin) - expected) < 0.01f);
+
+    // held 1000 RPM short for 10 s, the integral stays within the limit
+    gains.kd = 0.0f;
+    pid.set_gains(gains);
+    for (int i = 0; i < 2000; i++)
+    {
+        out = pid.update(rpm_from_float(2000.0f), rpm_from_float(1000.0f));
+    }
+    CHECK(fabs(rpm_to_float(out.clkin) - 2200.0f) < 0.01f);
+    CHECK(pid.get_integral() <= 200.0f + 0.01f);
+    out = pid.update(rpm_from_float(2000.0f), rpm_from_float(2050.0f));
+    CHECK(rpm_to_float(out.clkin) < 2200.0f - 40.0f);
+
+    // a correction down to zero, and the brake only past brake_start
+    pid.reset(rpm_from_float(100.0f));
+    out = pid.update(rpm_from_float(50.0f), rpm_from_float(300.0f));
+    CHECK(out.clkin == 0);
+    CHECK(out.brake > 0.0f);
+    pid.reset(rpm_from_float(-1000.0f));
+    out = pid.update(rpm_from_float(-1000.0f), rpm_from_float(-1030.0f));
+    CHECK(rpm_to_float(out.clkin) < -969.0f && rpm_to_float(out.clkin) > -971.0f);
+    CHECK(out.brake == 0.0f);
+    out = pid.update(rpm_from_float(-1000.0f), rpm_from_float(-1100.0f));
+    CHECK(out.brake > 0.0f);
+}
+
+
+
+int main(void)
+{
+    report_steps();
+    test_load_step();
+    test_terms();
+    return test_result("test_speedpid");
+}
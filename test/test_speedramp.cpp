@@ -0,0 +1,226 @@
+/** @file test_speedramp.cpp
+ *  This file contains the settling-time simulation of the SpeedRamp. The DRV8308 speed loop
+ *  is modelled as an underdamped second order system following CLKIN, with its acceleration
+ *  limited by the motor current, and each speed step is run twice: once stepping CLKIN
+ *  straight to the new speed and once streaming the ramp every RAMP_PERIOD_US as the Driver
+ *  does. The time to settle within 20 RPM, the overshoot and the time spent at the
+ *  acceleration limit of each are printed. The ramp itself must keep to its acceleration
+ *  and jerk limits, never pass its target and finish in about the time the limits allow.
+*/
+
+#include <math.h>
+#include "test.h"
+#include "SpeedRamp.h"
+#include "SpeedType.h"
+
+// Time between ramp steps, as in Driver.h (us)
+#define RAMP_PERIOD_US 2000
+
+// Time step of the loop model (us)
+#define SIM_STEP_US 500
+
+// Limits of the ramp, the SpeedRamp defaults the Driver runs with, in RPM/s and RPM/s^2
+#define MAX_ACCEL 1500.0
+#define MAX_JERK 15000.0
+
+// Band the wheel speed has to stay in to count as settled (RPM)
+#define SETTLE_BAND 20.0
+
+/** Model of the DRV8308 speed loop following the speed on CLKIN */
+struct LoopModel
+{
+    double w = 0.0;                 // wheel speed in RPM
+    double wd = 0.0;                // wheel acceleration in RPM/s
+    double wn = 12.0;               // natural frequency of the loop in rad/s
+    double zeta = 0.35;             // damping ratio of the loop
+    double max_accel = 4000.0;      // acceleration the motor current allows in RPM/s
+
+    /** @brief Function which advances the model by one time step
+     *
+     *  @param cmd The speed on CLKIN in RPM.
+     *  @param dt The time step in seconds.
+     */
+    void step(double cmd, double dt)
+    {
+        wd += (wn * wn * (cmd - w) - 2.0 * zeta * wn * wd) * dt;
+        wd = (wd > max_accel) ? max_accel : ((wd < -max_accel) ? -max_accel : wd);
+        w += wd * dt;
+    }
+};
+
+/** The results of one simulated step */
+struct StepResult
+{
+    double settle_s;                // time the wheel entered the band for good, or -1
+    double overshoot;               // furthest the wheel went past the target in RPM
+    double saturated_s;             // time the loop spent at the acceleration limit
+};
+
+
+
+/** @brief Function which simulates the loop following one speed step
+ *
+ *  @param from The speed before the step in RPM.
+ *  @param to The speed after the step in RPM.
+ *  @param ramped True to stream the ramp to CLKIN, false to step CLKIN.
+ *
+ *  @return The settling time, overshoot and saturation time of the wheel.
+ */
+static StepResult simulate(double from, double to, bool ramped)
+{
+    SpeedRamp ramp(MAX_ACCEL, MAX_JERK, RAMP_PERIOD_US * 1.0e-6f);
+    ramp.reset(rpm_from_float((float)from));
+    ramp.set_target(rpm_from_float((float)to));
+
+    LoopModel loop;
+    loop.w = from;
+    StepResult result = { -1.0, 0.0, 0.0 };
+    const double dt = SIM_STEP_US * 1.0e-6;
+    double cmd = from;
+
+    for (int i = 0; i < 8000; i++)
+    {
+        if (!ramped)
+        {
+            cmd = to;
+        }
+        else if (i % (RAMP_PERIOD_US / SIM_STEP_US) == 0)
+        {
+            cmd = rpm_to_float(ramp.step());
+        }
+        loop.step(cmd, dt);
+
+        double past = (to > from) ? loop.w - to : to - loop.w;
+        result.overshoot = (past > result.overshoot) ? past : result.overshoot;
+        result.saturated_s += (fabs(loop.wd) >= loop.max_accel) ? dt : 0.0;
+        if (fabs(loop.w - to) > SETTLE_BAND)
+        {
+            result.settle_s = -1.0;
+        }
+        else if (result.settle_s < 0.0)
+        {
+            result.settle_s = (i + 1) * dt;
+        }
+    }
+    return result;
+}
+
+
+
+/** @brief Function which prints the settling time of a table of speed steps
+ *
+ *  @details Every run must settle. Stepping CLKIN drives the loop into its acceleration
+ *  limit on large steps; the ramp must keep it out of the limit altogether and overshoot
+ *  no more than the step does, and the wheel must settle within 0.5 s of the ramp
+ *  finishing, which is the lag of the loop model.
+ */
+static void report_settling(void)
+{
+    const double steps[][2] = { { 0, 1000 }, { 500, 2500 }, { 2000, 300 }, { 1000, 1100 } };
+
+    printf("   from -> to RPM          step: settle s  overshoot  saturated s"
+           "    ramp: settle s  overshoot  saturated s\n");
+    for (auto& s : steps)
+    {
+        StepResult stepped = simulate(s[0], s[1], false);
+        StepResult ramped = simulate(s[0], s[1], true);
+        printf("  %5.0f -> %5.0f                 %6.3f  %9.1f  %11.3f           %6.3f  %9.1f  %11.3f\n",
+               s[0], s[1], stepped.settle_s, stepped.overshoot, stepped.saturated_s,
+               ramped.settle_s, ramped.overshoot, ramped.saturated_s);
+
+        // a jerk-limited ramp over d takes d / a + a / J if it reaches a, or 2 sqrt(d / J)
+        double d = fabs(s[1] - s[0]);
+        double ramp_s = (d >= MAX_ACCEL * MAX_ACCEL / MAX_JERK) ? d / MAX_ACCEL + MAX_ACCEL / MAX_JERK
+                                                                : 2.0 * sqrt(d / MAX_JERK);
+        CHECK(stepped.settle_s > 0.0);
+        CHECK(ramped.settle_s > 0.0);
+        CHECK(ramped.saturated_s == 0.0);
+        CHECK(ramped.overshoot <= stepped.overshoot);
+        CHECK(ramped.settle_s < ramp_s + 0.5);
+    }
+}
+
+
+
+/** @brief Function which runs a ramp to its end and checks every step against the limits
+ *
+ *  @param ramp The ramp, with its target set.
+ *  @param target The target in RPM.
+ *  @param accel The acceleration the ramp starts with in RPM/s.
+ *
+ *  @return The number of steps the ramp took to finish.
+ */
+static int check_limits(SpeedRamp& ramp, float target, double accel)
+{
+    const double dt = RAMP_PERIOD_US * 1.0e-6;
+    double speed = rpm_to_float(ramp.get_speed());
+    bool rising = target > speed;
+    int steps = 0;
+
+    while (!ramp.done() && steps < 100000)
+    {
+        double next = rpm_to_float(ramp.step());
+        double next_accel = (next - speed) / dt;
+        steps++;
+
+        CHECK(fabs(next_accel) <= MAX_ACCEL * 1.001 + 1.0);
+        // the last step lands on the target, so it may cut the acceleration short
+        if (!ramp.done())
+        {
+            CHECK(fabs(next_accel - accel) <= MAX_JERK * dt * 1.001 + 1.0);
+        }
+        CHECK(rising ? next <= target + 0.001 : next >= target - 0.001);
+        speed = next;
+        accel = next_accel;
+    }
+    CHECK(ramp.done());
+    CHECK(fabs(rpm_to_float(ramp.get_speed()) - target) < 0.001);
+    return steps;
+}
+
+
+
+/** @brief Function which checks the ramp keeps to its limits and finishes in time
+ *
+ *  @details A new target in the middle of a ramp must continue from the current speed
+ *  and acceleration, so the jerk limit still holds across it.
+ */
+static void test_limits(void)
+{
+    const double dt = RAMP_PERIOD_US * 1.0e-6;
+    SpeedRamp ramp(MAX_ACCEL, MAX_JERK, (float)dt);
+
+    ramp.reset(rpm_from_float(0.0f));
+    ramp.set_target(rpm_from_float(2500.0f));
+    int steps = check_limits(ramp, 2500.0f, 0.0);
+    double ideal = 2500.0 / MAX_ACCEL + MAX_ACCEL / MAX_JERK;
+    printf("  0 -> 2500 RPM took %.3f s, the limits allow %.3f s\n", steps * dt, ideal);
+    CHECK(steps * dt < ideal * 1.1);
+
+    // reverse halfway up a ramp
+    ramp.reset(rpm_from_float(500.0f));
+    ramp.set_target(rpm_from_float(2000.0f));
+    double speed = 500.0;
+    double accel = 0.0;
+    for (int i = 0; i < 200; i++)
+    {
+        double next = rpm_to_float(ramp.step());
+        accel = (next - speed) / dt;
+        speed = next;
+    }
+    ramp.set_target(rpm_from_float(800.0f));
+    check_limits(ramp, 800.0f, accel);
+
+    // a target equal to the speed finishes at once
+    ramp.set_target(rpm_from_float(800.0f));
+    CHECK(ramp.done());
+}
+
+
+
+int main(void)
+{
+    report_settling();
+    test_limits();
+    return test_result("test_speedramp");
+}
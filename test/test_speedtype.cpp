@@ -0,0 +1,179 @@
+/** @file test_speedtype.cpp
+ *  This file contains the host test of the Q16.16 rpm_t conversions. It checks fx_div()
+ *  against exact integer division, reports the error of rpm_from_span() and
+ *  rpm_to_clkin_mhz() over 1 to 2500 RPM next to the error the float build would have, and
+ *  measures the host cycles of the fixed-point conversion against the float one.
+*/
+
+#include <math.h>
+#include <initializer_list>
+#include "test.h"
+#include "SpeedType.h"
+
+// Conversions timed in the benchmark
+#define BENCH_COUNT 4000000
+
+// Speed bands the accuracy is reported over (RPM)
+static const double bands[] = { 1.0, 25.0, 100.0, 500.0, 1000.0, 2500.0 };
+#define BAND_COUNT 5
+
+
+
+/** @brief Function which gives the speed the float build calculates from a span
+ *
+ *  @details This is the RPM_FLOAT branch of rpm_from_span(), so both builds can be
+ *  compared from one program.
+ */
+static float float_from_span(uint32_t span_ticks, uint16_t edges, uint32_t ticks_per_us)
+{
+    return 15.0e6f * (float)ticks_per_us * (float)edges / (float)span_ticks;
+}
+
+
+
+/** @brief Function which checks fx_div() against exact division
+ *
+ *  @details The reciprocal is kept in Q30, so the quotient is good to about 29 bits: the
+ *  result must be within one count plus 2^-28 of the exact quotient for divisors across the
+ *  whole 32-bit range, and must saturate instead of wrapping when the quotient is too big
+ *  (give or take the same error right at the limit).
+ */
+static void test_fx_div(void)
+{
+    uint32_t seed = 7;
+    double worst = 0.0;
+    for (uint32_t i = 0; i < 2000000; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        uint32_t den = seed >> (seed & 31);
+        seed = seed * 1664525u + 1013904223u;
+        uint32_t num = seed >> 8;
+        if (den == 0)
+        {
+            continue;
+        }
+        uint64_t exact = ((uint64_t)num << 16) / den;
+        uint32_t got = fx_div(num, den, 16);
+        if (exact > UINT32_MAX)
+        {
+            CHECK(got >= UINT32_MAX - 2);
+            continue;
+        }
+        double error = fabs((double)got - (double)exact) - 1.0;
+        worst = fmax(worst, error / (double)exact);
+    }
+    printf("fx_div: worst relative error beyond one count %.2e over 2M random operands\n", worst);
+    CHECK(worst <= ldexp(1.0, -28));
+    CHECK(fx_div(1, 0, 16) == UINT32_MAX);
+    CHECK(fx_div(0, 5, 16) == 0);
+}
+
+
+
+/** @brief Function which reports the speed error of both builds over 1 to 2500 RPM
+ *
+ *  @details For every speed in steps of 0.01 RPM the span of one and of eight periods is
+ *  rounded to whole ticks of micros() and of the MCPWM timer, as the capture would see it,
+ *  and both builds convert it back. The reference is the exact speed for that whole-tick
+ *  span, so only the error of the conversion is measured. The fixed-point error must stay
+ *  within two Q16.16 steps per period plus 0.1 ppm.
+ */
+static void test_span_accuracy(void)
+{
+    double worst_fixed[BAND_COUNT] = { 0 };
+    double worst_float[BAND_COUNT] = { 0 };
+    double worst_clkin_fixed = 0.0;
+    double worst_clkin_float = 0.0;
+    bool within = true;
+
+    for (uint32_t step = 100; step <= 250000; step++)
+    {
+        double rpm = step * 0.01;
+        int band = 0;
+        while (band < BAND_COUNT - 1 && rpm >= bands[band + 1])
+        {
+            band++;
+        }
+        for (uint32_t ticks_per_us : { 1u, 80u })
+        {
+            for (uint16_t edges : { (uint16_t)1, (uint16_t)8 })
+            {
+                double span = 15.0e6 * ticks_per_us * edges / rpm;
+                if (span > UINT32_MAX)
+                {
+                    continue;
+                }
+                uint32_t span_ticks = (uint32_t)llround(span);
+                double exact = 15.0e6 * ticks_per_us * edges / span_ticks;
+                double fixed = rpm_to_float(rpm_from_span(span_ticks, edges, ticks_per_us));
+                double single = float_from_span(span_ticks, edges, ticks_per_us);
+                worst_fixed[band] = fmax(worst_fixed[band], fabs(fixed - exact));
+                worst_float[band] = fmax(worst_float[band], fabs(single - exact));
+                within &= fabs(fixed - exact) <= 2.0 / 65536.0 * edges + exact * 1e-7;
+            }
+        }
+
+        // CLKIN is 1000 / 15 mHz per RPM
+        double mhz = rpm * 1000.0 / 15.0;
+        worst_clkin_fixed = fmax(worst_clkin_fixed, fabs(rpm_to_clkin_mhz(rpm_from_float((float)rpm)) - mhz));
+        worst_clkin_float = fmax(worst_clkin_float, fabs((double)(uint32_t)((float)rpm * (1000.0f / 15.0f) + 0.5f) - mhz));
+    }
+
+    printf("speed from span, worst error in RPM:\n");
+    printf("    band (RPM)      Q16.16        float\n");
+    for (int band = 0; band < BAND_COUNT; band++)
+    {
+        printf("    %4.0f - %4.0f   %.3e    %.3e\n", bands[band], bands[band + 1],
+               worst_fixed[band], worst_float[band]);
+    }
+    printf("CLKIN from speed, worst error: Q16.16 %.3f mHz, float %.3f mHz\n",
+           worst_clkin_fixed, worst_clkin_float);
+    CHECK(within);
+    CHECK(worst_clkin_fixed <= 0.51);
+}
+
+
+
+/** @brief Function which measures the host cycles of a speed conversion in both builds
+ *
+ *  @details The spans are those of 20 to 2500 RPM on the MCPWM timer. The float divide is
+ *  fast on a PC, so this shows that the fixed-point path is not slow; on the ESP32 the float
+ *  divide is done in software and takes several times longer than the multiplies.
+ */
+static void bench_span(void)
+{
+    static uint32_t spans[1024];
+    for (uint32_t i = 0; i < 1024; i++)
+    {
+        spans[i] = (uint32_t)(15.0e6 * 80.0 * 8.0 / (20.0 + i * 2.4));
+    }
+
+    volatile int64_t sink = 0;
+    uint64_t begin = host_cycles();
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+    {
+        sink = sink + rpm_from_span(spans[i & 1023], 8, 80);
+    }
+    uint64_t fixed = host_cycles() - begin;
+
+    volatile float fsink = 0.0f;
+    begin = host_cycles();
+    for (uint32_t i = 0; i < BENCH_COUNT; i++)
+    {
+        fsink = fsink + float_from_span(spans[i & 1023], 8, 80);
+    }
+    uint64_t single = host_cycles() - begin;
+
+    printf("speed from span: Q16.16 %.1f cycles, float %.1f cycles\n",
+           (double)fixed / BENCH_COUNT, (double)single / BENCH_COUNT);
+}
+
+
+
+int main(void)
+{
+    test_fx_div();
+    test_span_accuracy();
+    bench_span();
+    return test_result("test_speedtype");
+}
@@ -0,0 +1,185 @@
+/** @file test_spscring.cpp
+ *  This file contains the stress test for the SpscRing used to pass edge timestamps from
+ *  the capture interrupt to the readActual task. A producer thread pushes timestamps at
+ *  several MHz, far faster than FGOUT ever toggles, while a consumer thread drains them, and
+ *  every timestamp must come out once and in order; any which did not fit must be counted.
+*/
+
+#include <thread>
+#include <atomic>
+#include "test.h"
+#include "SpscRing.h"
+#include "EdgeRing.h"
+
+// Timestamps pushed by the producer thread in each stress run
+#define STRESS_ITEMS 4000000u
+
+// Rate the paced producer aims for, like an ISR which cannot wait for the consumer (Hz)
+#define PACED_RATE_HZ 4000000.0
+
+/** A ring whose counters can be started anywhere, so the wrap of the 32-bit counters can be
+ *  tested without pushing four billion items.
+ */
+template <typename T, uint32_t N>
+class TestRing : public SpscRing<T, N>
+{
+    public:
+
+        /** @brief A function which empties the ring and sets both counters to @c count */
+        void preset(uint32_t count)
+        {
+            this->head.store(count);
+            this->tail.store(count);
+        }
+};
+
+
+
+/** @brief Function which checks push, pop and peek from one thread, across the counter wrap */
+static void test_single_thread(void)
+{
+    TestRing<uint32_t, 8> ring;
+    ring.preset(0xFFFFFFFCu);
+    uint32_t item = 0;
+
+    CHECK(!ring.pop(item));
+    CHECK(!ring.peek(item));
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        CHECK(ring.push(100 + i));
+    }
+    CHECK(ring.available() == 8);
+    CHECK(!ring.push(999));
+    CHECK(ring.overflows() == 1);
+
+    CHECK(ring.peek(item) && item == 100);
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        CHECK(ring.pop(item) && item == 100 + i);
+    }
+    CHECK(!ring.pop(item));
+    CHECK(ring.available() == 0);
+}
+
+
+
+/** @brief Function which checks that nothing is lost when the producer waits for room
+ *
+ *  @details The producer retries a full ring, so every one of STRESS_ITEMS timestamps must
+ *  arrive, in order, in a ring the size of the firmware's edge_ring.
+ */
+static void test_lossless(void)
+{
+    static EdgeRing ring;
+    std::thread producer([]
+    {
+        for (uint32_t stamp = 1; stamp <= STRESS_ITEMS; )
+        {
+            if (ring.push(stamp))
+            {
+                stamp++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 1;
+    uint32_t wrong = 0;
+    uint32_t stamp;
+    auto begin = std::chrono::steady_clock::now();
+    while (expected <= STRESS_ITEMS)
+    {
+        if (ring.pop(stamp))
+        {
+            wrong += (stamp != expected) ? 1 : 0;
+            expected = stamp + 1;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    printf("lossless: %u timestamps at %.1f MHz, %u out of order, %u full retries\n",
+           STRESS_ITEMS, STRESS_ITEMS / seconds / 1e6, wrong, ring.overflows());
+    CHECK(wrong == 0);
+    CHECK(ring.available() == 0);
+}
+
+
+
+/** @brief Function which checks a producer which never waits, like the capture ISR
+ *
+ *  @details The producer pushes a timestamp every 250 ns whether or not the ring has room,
+ *  and the consumer drains it in batches as the readActual task does. Timestamps may be
+ *  dropped when the consumer falls behind, but each one which arrives must be newer than
+ *  the one before, and every drop must be counted, so the number received plus the number
+ *  of overflows is the number pushed.
+ */
+static void test_paced(void)
+{
+    static EdgeRing ring;
+    static std::atomic<bool> done (false);
+    static double rate_hz = 0.0;
+
+    std::thread producer([]
+    {
+        auto begin = std::chrono::steady_clock::now();
+        for (uint32_t stamp = 1; stamp <= STRESS_ITEMS; stamp++)
+        {
+            auto due = begin + std::chrono::nanoseconds((uint64_t)(stamp * (1e9 / PACED_RATE_HZ)));
+            while (std::chrono::steady_clock::now() < due)
+            {
+            }
+            ring.push(stamp);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        rate_hz = STRESS_ITEMS / seconds;
+        done.store(true);
+    });
+
+    uint32_t received = 0;
+    uint32_t reordered = 0;
+    uint32_t gaps = 0;
+    uint32_t last = 0;
+    uint32_t stamp;
+    while (true)
+    {
+        bool finished = done.load();
+        while (ring.pop(stamp))
+        {
+            reordered += (stamp <= last) ? 1 : 0;
+            gaps += stamp - last - 1;
+            last = stamp;
+            received++;
+        }
+        if (finished)
+        {
+            break;
+        }
+        std::this_thread::yield();
+    }
+    producer.join();
+    gaps += STRESS_ITEMS - last;
+
+    printf("paced: %u timestamps at %.2f MHz, %u received, %u overflows, %u reordered\n",
+           STRESS_ITEMS, rate_hz / 1e6, received, ring.overflows(), reordered);
+    CHECK(reordered == 0);
+    CHECK(received + ring.overflows() == STRESS_ITEMS);
+    CHECK(gaps == ring.overflows());
+}
+
+
+
+int main(void)
+{
+    test_single_thread();
+    test_lossless();
+    test_paced();
+    return test_result("test_spscring");
+}
@@ -0,0 +1,258 @@
+/** @file test_stalldetector.cpp
+ *  This file contains the host test of the StallDetector together with the SpeedEstimator,
+ *  driven by a simulation of the FGOUT edge stream and of the readActual task: edges are
+ *  passed on in batches of four or after a 20 ms timeout, and the task gets to them some
+ *  time after it is woken. At constant speed the stall timer must never decay the speed,
+ *  however late the task is; after the wheel stops the speed must fall along the 15 / t
+ *  bound and reach zero in a bounded time, and zero must never be reported while the wheel
+ *  still turns faster than 10 RPM.
+*/
+
+#include <math.h>
+#include "test.h"
+#include "SpeedEstimator.h"
+#include "StallDetector.h"
+
+// Time step of the simulation (us)
+#define SIM_STEP_US 10
+
+// Tick rate of the MCPWM capture timer
+#define TICKS_PER_US 80
+
+// Edges between notifications of the readActual task, and its timeout (us)
+#define NOTIFY_EDGES 4
+#define EDGE_TIMEOUT_US 20000
+
+// Latency of the capture interrupt, which is how far edge_time_us() can be off (us)
+#define ISR_LATENCY_US 5
+
+/** The results of one simulated run */
+struct SimResult
+{
+    uint32_t decays_while_turning;  // stall decays while the wheel was faster than the decayed speed
+    uint32_t decays;                // speeds reported by the stall timer
+    double zero_us;                 // time zero was first reported, or -1
+    double last_edge_us;            // time of the last edge
+    double wrong_zero_rpm;          // true speed when zero was reported, if it was above 10 RPM
+    bool above_bound;               // true if a decayed speed was above the 15 / t bound
+    bool rising;                    // true if a decayed speed was above the one before it
+    float last_rpm;                 // latest speed reported
+};
+
+
+
+/** @brief Function which simulates the edge stream and the readActual task
+ *
+ *  @param speed A function giving the true wheel speed in RPM at a time in seconds.
+ *  @param length_s The length of the run in seconds.
+ *  @param latency_us The most time the task takes to get to the edges after it is woken;
+ *  each wakeup takes a pseudo-random time up to this.
+ *
+ *  @return What happened during the run.
+ */
+template <typename Speed>
+static SimResult simulate(Speed speed, double length_s, uint32_t latency_us)
+{
+    SpeedEstimator estimator(ESTIMATE_ADAPTIVE, 8, 5, TICKS_PER_US);
+    StallDetector stall(0.5f);
+    stall.set_batch(NOTIFY_EDGES);
+
+    SimResult result = { 0, 0, -1.0, 0.0, 0.0, false, false, 0.0f };
+    uint32_t seed = 1;
+    double phase = 0.0;                 // fraction of a period since the last edge
+    uint32_t ring[256];                 // edge timestamps waiting for the task, in ticks
+    uint32_t ring_count = 0;
+    uint32_t pending = 0;               // edges since the last notification
+    bool notify_edges = false;
+    bool notify_stall = false;
+    int64_t ref_us = 0;                 // esp_timer time the ISR handled the latest edge
+    uint32_t ref_ticks = 0;             // and its timestamp
+    int64_t deadline_us = -1;           // time the stall timer expires, if it is armed
+    int64_t wait_start_us = 0;          // time the task started waiting
+    int64_t run_at_us = -1;             // time the woken task gets to the edges
+    bool woke_stall = false;
+    float last_decay = 1e9f;
+
+    for (int64_t t = 0; t < (int64_t)(length_s * 1e6); t += SIM_STEP_US)
+    {
+        // the wheel makes an edge every 1/4 revolution, 15 / rpm seconds apart
+        double rpm = speed(t * 1e-6);
+        phase += rpm / 15.0 * SIM_STEP_US * 1e-6;
+        if (phase >= 1.0)
+        {
+            phase -= 1.0;
+            uint32_t ticks = (uint32_t)(t * TICKS_PER_US);
+            ring[ring_count++ & 255] = ticks;
+            ref_ticks = ticks;
+            ref_us = t + ISR_LATENCY_US;
+            result.last_edge_us = (double)t;
+            if (++pending >= NOTIFY_EDGES)
+            {
+                pending = 0;
+                notify_edges = true;
+            }
+        }
+        if (deadline_us >= 0 && t >= deadline_us)
+        {
+            deadline_us = -1;
+            notify_stall = true;
+        }
+
+        // the task wakes on a notification or the timeout, and runs a little later
+        if (run_at_us < 0 && (notify_edges || notify_stall || t - wait_start_us >= EDGE_TIMEOUT_US))
+        {
+            seed = seed * 1103515245u + 12345u;
+            run_at_us = t + (latency_us ? (seed >> 8) % (latency_us + 1) : 0);
+            woke_stall = notify_stall;
+            notify_edges = false;
+            notify_stall = false;
+        }
+        if (run_at_us < 0 || t < run_at_us)
+        {
+            continue;
+        }
+        run_at_us = -1;
+        wait_start_us = t;
+
+        bool updated = false;
+        for (uint32_t i = 0; i < ring_count; i++)
+        {
+            updated |= estimator.add_edge(ring[i]);
+        }
+        ring_count = 0;
+
+        if (!updated && woke_stall)
+        {
+            rpm_t decayed;
+            uint32_t delay = stall.expire(t, decayed);
+            deadline_us = delay ? t + delay : -1;
+            if (stall.is_stalled())
+            {
+                estimator.reset();
+            }
+            float reported = rpm_to_float(decayed);
+            result.decays++;
+            result.last_rpm = reported;
+            result.decays_while_turning += (rpm > 10.0 && rpm > reported + 1.0) ? 1 : 0;
+            result.above_bound |= reported > 15.0e6 / (t - result.last_edge_us - ISR_LATENCY_US) + 0.01;
+            result.rising |= reported > last_decay;
+            last_decay = reported;
+            if (reported == 0.0f && result.zero_us < 0.0)
+            {
+                result.zero_us = (double)t;
+                result.wrong_zero_rpm = (rpm > 10.0) ? rpm : 0.0;
+            }
+            continue;
+        }
+        if (!updated)
+        {
+            continue;
+        }
+
+        result.last_rpm = rpm_to_float(estimator.rpm());
+        last_decay = 1e9f;
+
+        // the firmware gets this from Driver::edge_time_us()
+        int64_t edge_us = ref_us + (int32_t)(estimator.last_edge() - ref_ticks) / TICKS_PER_US;
+        uint32_t delay = stall.edge(edge_us, t, estimator.rpm());
+        deadline_us = t + delay;
+    }
+    return result;
+}
+
+
+
+/** @brief Function which checks that the deadline runs from the time of the edge
+ *
+ *  @details At 600 RPM a period is 25 ms, so with batches of four and half a period of
+ *  margin the timer must expire 112.5 ms after the edge, however late it is processed.
+ */
+static void test_deadline(void)
+{
+    StallDetector stall(0.5f);
+    stall.set_batch(4);
+    CHECK(stall.edge(1000000, 1000000, rpm_from_float(600.0f)) == 112500);
+    CHECK(stall.edge(1000000, 1030000, rpm_from_float(600.0f)) == 82500);
+    CHECK(stall.edge(1000000, 1200000, rpm_from_float(600.0f)) == 1);
+    CHECK(!stall.is_stalled());
+
+    rpm_t rpm;
+    CHECK(stall.expire(1150000, rpm) > 0);
+    CHECK(fabsf(rpm_to_float(rpm) - 100.0f) < 0.01f);
+}
+
+
+
+/** @brief Function which checks that constant speeds are never decayed
+ *
+ *  @details At every speed from the slowest the DRV8308 can run to the fastest, with the
+ *  task getting to its edges up to 2 ms late, the next batch always arrives before the
+ *  stall timer.
+ */
+static void test_constant_speed(void)
+{
+    const double speeds[] = { 25.0, 100.0, 600.0, 1500.0, 2500.0 };
+    for (double rpm : speeds)
+    {
+        SimResult result = simulate([rpm](double) { return rpm; }, 3.0, 2000);
+        printf("constant %6.0f RPM: %u decays, reporting %.2f RPM\n", rpm, result.decays, result.last_rpm);
+        CHECK(result.decays == 0);
+        CHECK(fabs(result.last_rpm - rpm) < rpm * 0.001);
+    }
+}
+
+
+
+/** @brief Function which checks the decay after the edges stop suddenly
+ *
+ *  @details The decayed speed must never be above the 15 / t bound, give or take the
+ *  interrupt latency in the time of the last edge, or rise, and zero must
+ *  be reported between 1.5 s after the last edge, when the bound reaches 10 RPM, and one
+ *  growth step of 25% later.
+ */
+static void test_hard_stop(void)
+{
+    const double speeds[] = { 100.0, 600.0, 2500.0 };
+    for (double rpm : speeds)
+    {
+        SimResult result = simulate([rpm](double s) { return s < 0.5 ? rpm : 0.0; }, 3.0, 2000);
+        double latency_s = (result.zero_us - result.last_edge_us) * 1e-6;
+        printf("stop from %6.0f RPM: %u decays, zero %.3f s after the last edge\n",
+               rpm, result.decays, latency_s);
+        CHECK(result.zero_us > 0.0);
+        CHECK(latency_s >= 1.5 && latency_s <= 1.5 * 1.25 + 0.005);
+        CHECK(!result.above_bound);
+        CHECK(!result.rising);
+        CHECK(result.last_rpm == 0.0f);
+    }
+}
+
+
+
+/** @brief Function which checks a coast-down to a stop
+ *
+ *  @details The wheel slows from 1000 RPM to a stop over 2 s. Zero must not be reported
+ *  while it still turns faster than 10 RPM, and must follow the stop within 1.9 s.
+ */
+static void test_coast_down(void)
+{
+    SimResult result = simulate([](double s) { return s < 2.0 ? 1000.0 * (1.0 - s / 2.0) : 0.0; },
+                                5.0, 2000);
+    double latency_s = result.zero_us * 1e-6 - 2.0;
+    printf("coast-down: %u decays, zero %.3f s after the wheel stopped\n", result.decays, latency_s);
+    CHECK(result.zero_us > 0.0);
+    CHECK(result.wrong_zero_rpm == 0.0);
+    CHECK(latency_s < 1.9);
+    CHECK(!result.above_bound);
+}
+
+
+
+int main(void)
+{
+    test_deadline();
+    test_constant_speed();
+    test_hard_stop();
+    test_coast_down();
+    return test_result("test_stalldetector");
+}
@@ -0,0 +1,419 @@
+/** @file test_telemetrycodec.cpp
+ *  This file contains the tests for the TelemetryEncoder and TelemetryDecoder. A generated
+ *  run of spin-ups, noise, brake pulses and profile steps is compressed into blocks and must
+ *  decode to exactly the samples and sequence numbers it was made from, and the bytes per
+ *  sample and encoding time are printed. A block written before the profile fields were
+ *  added must still decode, and blocks which are cut short or damaged must be rejected
+ *  without any sample being read from outside them.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "test.h"
+#include "TelemetryCodec.h"
+
+// Samples in the generated run, about seven minutes of speeds at 50 Hz
+#define RUN_SAMPLES 20000
+
+// Damaged blocks tried
+#define DAMAGED_BLOCKS 20000
+
+/** @brief Function which makes a run of samples like the ones readActual and speedControl log
+ *
+ *  @details A new command comes every 3000 samples with a transition to accelerate or
+ *  decelerate, and back to idle once the speed is within 20 RPM. The speed follows the
+ *  command with noise, the brake is on while decelerating, and from a third of the way in
+ *  the commands come from a profile whose step goes up with each of them.
+ *
+ *  @param samples Filled in with the run.
+ */
+static void make_run(std::vector<TelemetrySample>& samples)
+{
+    samples.resize(RUN_SAMPLES);
+    srand(3);
+    float speed = 0.0f, command = 0.0f;
+    uint32_t t = 0xFF000000u;
+    uint8_t state = 0;
+    uint16_t profile = 0, step = 0;
+    for (uint32_t i = 0; i < RUN_SAMPLES; i++)
+    {
+        uint8_t flags = 0;
+        if (i % 3000 == 0)
+        {
+            command = (float)(rand() % 2000 - 1000);
+            state = (command > speed) ? 1 : 2;
+            flags |= TELEMETRY_COMMAND | TELEMETRY_TRANSITION;
+            profile = (i >= RUN_SAMPLES / 3) ? 7 : 0;
+            step = (profile != 0) ? step + 1 : 0;
+        }
+        if (fabsf(command - speed) < 20.0f && state != 0)
+        {
+            state = 0;
+            flags |= TELEMETRY_TRANSITION;
+        }
+        speed += (command - speed) * 0.01f;
+        float actual = speed + (rand() % 1000 - 500) / 1000.0f;
+        t += (flags != 0) ? 137 : 20000 + rand() % 300;
+
+        TelemetrySample& s = samples[i];
+        memset(&s, 0, sizeof(s));
+        s.t_us = t;
+        s.actual = rpm_from_float(actual);
+        s.raw = rpm_from_float(actual + (rand() % 4000 - 2000) / 1000.0f);
+        s.command = rpm_from_float(command);
+        s.state = state;
+        s.flags = flags;
+        s.brake = (state == 2) ? 300 + rand() % 5 : 0;
+        s.profile = profile;
+        s.step = step;
+    }
+}
+
+
+
+/** @brief Function which compresses samples into a stream of blocks
+ *
+ *  @param samples The samples, numbered from zero.
+ *  @param stream Filled in with the blocks one after another.
+ *
+ *  @return The host cycles spent in the encoder.
+ */
+static uint64_t encode_run(const std::vector<TelemetrySample>& samples, std::vector<uint8_t>& stream)
+{
+    static uint8_t block[TELEMETRY_BLOCK_SIZE(TELEMETRY_BLOCK_SAMPLES)];
+    TelemetryEncoder encoder;
+    uint64_t cycles = 0;
+    stream.clear();
+    for (uint32_t i = 0; i < samples.size(); )
+    {
+        uint64_t start = host_cycles();
+        encoder.begin(block, sizeof(block), i);
+        while (i < samples.size() && encoder.add(samples[i]))
+        {
+            i++;
+        }
+        size_t size = encoder.finish();
+        cycles += host_cycles() - start;
+        stream.insert(stream.end(), block, block + size);
+    }
+    return cycles;
+}
+
+
+
+/** @brief Function which decodes a stream of blocks and compares it with the samples
+ *
+ *  @param stream The blocks.
+ *  @param samples The samples they should hold, numbered from zero.
+ *  @param blocks Filled in with the number of blocks.
+ *
+ *  @return True if every block was whole and every sample and sequence number the same.
+ */
+static bool decode_matches(const std::vector<uint8_t>& stream, const std::vector<TelemetrySample>& samples,
+                           uint32_t& blocks)
+{
+    TelemetryDecoder decoder;
+    TelemetrySample sample;
+    uint32_t seq = 0, decoded = 0;
+    bool ok = true;
+    blocks = 0;
+    for (size_t pos = 0; pos < stream.size(); blocks++)
+    {
+        size_t size = decoder.begin(&stream[pos], stream.size() - pos);
+        if (size == 0)
+        {
+            return false;
+        }
+        while (decoder.next(sample, seq))
+        {
+            ok &= seq == decoded && decoded < samples.size() &&
+                  memcmp(&sample, &samples[decoded], sizeof(sample)) == 0;
+            decoded++;
+        }
+        pos += size;
+    }
+    return ok && decoded == samples.size();
+}
+
+
+
+/** @brief Function which checks a generated run comes back exactly and measures the encoder
+ *
+ *  @details The run is encoded five times and the fastest pass is taken. Every block but
+ *  the last must hold TELEMETRY_BLOCK_SAMPLES samples, each a keyframe, and the stream must
+ *  be at least twice as small as the 24-byte binary samples.
+ */
+static void test_round_trip(void)
+{
+    std::vector<TelemetrySample> samples;
+    std::vector<uint8_t> stream;
+    make_run(samples);
+
+    uint64_t cycles = ~(uint64_t)0;
+    for (int pass = 0; pass < 5; pass++)
+    {
+        uint64_t pass_cycles = encode_run(samples, stream);
+        cycles = (pass_cycles < cycles) ? pass_cycles : cycles;
+    }
+
+    uint32_t blocks = 0;
+    CHECK(decode_matches(stream, samples, blocks));
+    CHECK(blocks == (RUN_SAMPLES + TELEMETRY_BLOCK_SAMPLES - 1) / TELEMETRY_BLOCK_SAMPLES);
+
+    size_t csv_bytes = 0;
+    char row[128];
+    for (uint32_t i = 0; i < RUN_SAMPLES; i++)
+    {
+        csv_bytes += telemetry_csv(row, sizeof(row), i, samples[i]);
+    }
+    double per_sample = (double)stream.size() / RUN_SAMPLES;
+    printf("  round trip: %u samples in %u blocks, %.2f bytes per sample, %.1fx smaller than binary, "
+           "%.1fx smaller than CSV\n", (unsigned)RUN_SAMPLES, (unsigned)blocks, per_sample,
+           sizeof(TelemetrySample) / per_sample, (double)csv_bytes / stream.size());
+    printf("  encode: %.1f cycles per sample\n", (double)cycles / RUN_SAMPLES);
+    CHECK(per_sample * 2 < sizeof(TelemetrySample));
+}
+
+
+
+/** @brief Function which checks samples whose every field changes as far as it can
+ *
+ *  @details Each sample moves the time, speeds and command half their range from the one
+ *  before, so each takes a five-byte varint, and changes the state, brake, profile and step,
+ *  so nearly every sample takes TELEMETRY_SAMPLE_MAX bytes. A block of them must fit the
+ *  TELEMETRY_BLOCK_SIZE() buffer, refuse one sample more than its limit, and come back
+ *  exactly.
+ */
+static void test_extremes(void)
+{
+    std::vector<TelemetrySample> samples(TELEMETRY_BLOCK_SAMPLES);
+    for (uint32_t i = 0; i < TELEMETRY_BLOCK_SAMPLES; i++)
+    {
+        bool odd = (i & 1) != 0;
+        TelemetrySample& s = samples[i];
+        memset(&s, 0, sizeof(s));
+        s.t_us = odd ? 0x80000000u : 0;
+        s.actual = odd ? INT32_MIN : 0;
+        s.raw = odd ? 0 : INT32_MIN;
+        s.command = odd ? 0 : INT32_MIN;
+        s.state = (uint8_t)i;
+        s.flags = (uint8_t)~i;
+        s.brake = odd ? 0 : 0xFFFF;
+        s.profile = odd ? 0 : 0xFFFF;
+        s.step = odd ? 0xFFFF : 0;
+    }
+
+    uint8_t block[TELEMETRY_BLOCK_SIZE(TELEMETRY_BLOCK_SAMPLES)];
+    TelemetryEncoder encoder;
+    encoder.begin(block, sizeof(block), 1000);
+    bool added = true;
+    for (uint32_t i = 0; i < TELEMETRY_BLOCK_SAMPLES; i++)
+    {
+        added &= encoder.add(samples[i]);
+    }
+    CHECK(added && !encoder.add(samples[0]));
+    size_t size = encoder.finish();
+    CHECK(size > sizeof(TelemetryBlockHeader) && size <= sizeof(block));
+
+    TelemetryDecoder decoder;
+    TelemetrySample sample;
+    uint32_t seq = 0, decoded = 0;
+    bool same = true;
+    CHECK(decoder.begin(block, size) == size);
+    while (decoder.next(sample, seq))
+    {
+        same &= seq == 1000 + decoded && memcmp(&sample, &samples[decoded], sizeof(sample)) == 0;
+        decoded++;
+    }
+    printf("  extremes: %u samples in %u bytes, %.1f bytes per sample\n", (unsigned)decoded, (unsigned)size,
+           (double)(size - sizeof(TelemetryBlockHeader)) / decoded);
+    CHECK(same && decoded == TELEMETRY_BLOCK_SAMPLES);
+}
+
+
+
+/** @brief Function which checks a block written before the profile fields still decodes
+ *
+ *  @details The block is written out byte by byte as the encoder wrote it before mask bit 3
+ *  was added: a first sample with every field but the profile, then one where only the
+ *  speeds change. Its samples must have profile and step zero, and the encoder must still
+ *  write exactly these bytes for the same samples, so old and new readers agree.
+ */
+static void test_old_block(void)
+{
+    const uint8_t block[] =
+    {
+        'T', 'L', 'Z', '1', 0xF4, 0x01, 0x00, 0x00, 0x02, 0x00, 0x0F, 0x00,
+        0x07, 0xD0, 0x0F, 0x80, 0x01, 0x03, 0x14, 0x01, TELEMETRY_COMMAND, 0x14,
+        0x00, 0xA0, 0x01, 0x01, 0x02
+    };
+    TelemetrySample want[2];
+    memset(want, 0, sizeof(want));
+    want[0].t_us = 1000;
+    want[0].actual = 64;
+    want[0].raw = 62;
+    want[0].command = 10;
+    want[0].state = 1;
+    want[0].flags = TELEMETRY_COMMAND;
+    want[0].brake = 10;
+    want[1] = want[0];
+    want[1].t_us = 1080;
+    want[1].actual = 63;
+    want[1].raw = 64;
+
+    TelemetryDecoder decoder;
+    TelemetrySample sample;
+    uint32_t seq = 0, decoded = 0;
+    bool same = true;
+    CHECK(decoder.begin(block, sizeof(block)) == sizeof(block));
+    while (decoder.next(sample, seq))
+    {
+        same &= decoded < 2 && seq == 500 + decoded && memcmp(&sample, &want[decoded], sizeof(sample)) == 0;
+        decoded++;
+    }
+    CHECK(same && decoded == 2);
+
+    uint8_t again[TELEMETRY_BLOCK_SIZE(2)];
+    TelemetryEncoder encoder;
+    encoder.begin(again, sizeof(again), 500);
+    CHECK(encoder.add(want[0]) && encoder.add(want[1]));
+    CHECK(encoder.finish() == sizeof(block) && memcmp(again, block, sizeof(block)) == 0);
+    printf("  old block: %u samples decoded, written again the same\n", (unsigned)decoded);
+}
+
+
+
+/** @brief Function which decodes a block and counts its samples
+ *
+ *  @param block The block.
+ *  @param len The bytes available from @c block on.
+ *  @param damaged Set if the decoder stopped before the count in the header.
+ *
+ *  @return The number of samples decoded, or -1 if begin() rejected the block.
+ */
+static int decode_count(const uint8_t* block, size_t len, bool& damaged)
+{
+    TelemetryDecoder decoder;
+    TelemetrySample sample;
+    uint32_t seq = 0;
+    damaged = false;
+    if (decoder.begin(block, len) == 0)
+    {
+        return -1;
+    }
+    int count = 0;
+    while (decoder.next(sample, seq))
+    {
+        count++;
+    }
+    TelemetryBlockHeader header;
+    memcpy(&header, block, sizeof(header));
+    damaged = count != header.count;
+    return count;
+}
+
+
+
+/** @brief Function which checks blocks cut short or damaged are rejected
+ *
+ *  @details A block cut anywhere before its end, or with the wrong magic, must be refused by
+ *  begin(). A header whose byte count is smaller than its samples need, or whose sample
+ *  count is larger than its bytes hold, must stop the decoder early. Random bytes after a
+ *  good header, and blocks with random bytes changed, are decoded into a buffer sized to
+ *  the block so a read past its end would show under a memory checker; they must never give
+ *  more samples than the header says, and most must be found damaged.
+ */
+static void test_damaged(void)
+{
+    std::vector<TelemetrySample> samples;
+    make_run(samples);
+    samples.resize(TELEMETRY_BLOCK_SAMPLES);
+    uint8_t block[TELEMETRY_BLOCK_SIZE(TELEMETRY_BLOCK_SAMPLES)];
+    TelemetryEncoder encoder;
+    encoder.begin(block, sizeof(block), 0);
+    for (const TelemetrySample& s : samples)
+    {
+        encoder.add(s);
+    }
+    size_t size = encoder.finish();
+    bool damaged;
+    CHECK(decode_count(block, size, damaged) == TELEMETRY_BLOCK_SAMPLES && !damaged);
+
+    bool cut_rejected = true;
+    for (size_t cut = 0; cut < size; cut++)
+    {
+        std::vector<uint8_t> copy(block, block + cut);
+        cut_rejected &= decode_count(copy.data(), copy.size(), damaged) == -1;
+    }
+    CHECK(cut_rejected);
+
+    TelemetryBlockHeader header;
+    memcpy(&header, block, sizeof(header));
+    std::vector<uint8_t> copy(block, block + size);
+    copy[0] ^= 0x20;
+    CHECK(decode_count(copy.data(), copy.size(), damaged) == -1);
+
+    copy.assign(block, block + size);
+    TelemetryBlockHeader shorter = header;
+    shorter.bytes -= 5;
+    memcpy(copy.data(), &shorter, sizeof(shorter));
+    CHECK(decode_count(copy.data(), copy.size(), damaged) < TELEMETRY_BLOCK_SAMPLES && damaged);
+
+    TelemetryBlockHeader more = header;
+    more.count += 1;
+    memcpy(copy.data(), &more, sizeof(more));
+    CHECK(decode_count(copy.data(), copy.size(), damaged) == TELEMETRY_BLOCK_SAMPLES && damaged);
+
+    TelemetryBlockHeader fewer = header;
+    fewer.count -= 1;
+    memcpy(copy.data(), &fewer, sizeof(fewer));
+    CHECK(decode_count(copy.data(), copy.size(), damaged) < TELEMETRY_BLOCK_SAMPLES - 1 && damaged);
+
+    srand(11);
+    uint32_t overruns = 0, found = 0;
+    for (uint32_t trial = 0; trial < DAMAGED_BLOCKS; trial++)
+    {
+        if (trial & 1)
+        {
+            copy.assign(block, block + size);
+            for (int k = 0; k < 1 + rand() % 3; k++)
+            {
+                size_t at = sizeof(header) + rand() % (size - sizeof(header));
+                copy[at] ^= (uint8_t)(1 + rand() % 255);
+            }
+        }
+        else
+        {
+            copy.resize(sizeof(header) + rand() % 300);
+            for (size_t k = sizeof(header); k < copy.size(); k++)
+            {
+                copy[k] = (uint8_t)rand();
+            }
+            TelemetryBlockHeader junk = { TELEMETRY_BLOCK_MAGIC, 0, (uint16_t)(1 + rand() % 100),
+                                          (uint16_t)(copy.size() - sizeof(header)) };
+            memcpy(copy.data(), &junk, sizeof(junk));
+        }
+        uint16_t count;
+        memcpy(&count, &copy[8], sizeof(count));
+        int decoded = decode_count(copy.data(), copy.size(), damaged);
+        overruns += (decoded > (int)count) ? 1 : 0;
+        found += damaged ? 1 : 0;
+    }
+    printf("  damaged: %u of %u changed or random blocks found damaged, %u gave too many samples\n",
+           (unsigned)found, (unsigned)DAMAGED_BLOCKS, (unsigned)overruns);
+    CHECK(overruns == 0);
+    CHECK(found > DAMAGED_BLOCKS * 3 / 4);
+}
+
+
+
+int main(void)
+{
+    test_round_trip();
+    test_extremes();
+    test_old_block();
+    test_damaged();
+    return test_result("test_telemetrycodec");
+}
@@ -0,0 +1,255 @@
+/** @file test_telemetrylog.cpp
+ *  This file contains the tests for the TelemetryLog. A small log is filled past the end of
+ *  its storage, and the oldest sequence number it keeps, the samples it gives back and the
+ *  spans a reply is sent from are checked before and after the storage wraps around. Speed
+ *  samples and events are merged into it from two rings, and must come out in time order
+ *  across the wrap of the microsecond clock. The log is then read out as CSV a small buffer
+ *  at a time while new samples overwrite the rows not yet sent, which must be skipped.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "test.h"
+#include "TelemetryLog.h"
+
+// Samples kept by the log under test
+#define LOG_SIZE 16
+
+static TelemetrySample storage[LOG_SIZE];      // storage given to the log under test
+
+/** @brief Function which makes a sample whose fields can be checked from its time */
+static TelemetrySample make_sample(uint32_t t_us)
+{
+    TelemetrySample s;
+    memset(&s, 0, sizeof(s));
+    s.t_us = t_us;
+    s.actual = (rpm_t)(t_us * 7);
+    return s;
+}
+
+
+
+/** @brief Function which adds samples to a log, numbering their times from its next sequence number */
+static void add_samples(TelemetryLog& log, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        log.slot() = make_sample(log.next_seq());
+        log.commit();
+    }
+}
+
+
+
+/** @brief Function which reads samples through span() and checks each is the one wanted
+ *
+ *  @param log The log.
+ *  @param seq The first sequence number wanted.
+ *  @param count The samples wanted.
+ *  @param max_span The most samples asked for in one span.
+ *  @param spans Filled in with the number of spans the samples came in.
+ *
+ *  @return True if every sample read was the one with its sequence number.
+ */
+static bool read_spans(TelemetryLog& log, uint32_t seq, uint32_t count, uint32_t max_span, uint32_t& spans)
+{
+    bool ok = true;
+    spans = 0;
+    while (count > 0)
+    {
+        uint32_t n = 0;
+        const TelemetrySample* samples = log.span(seq, n, (count < max_span) ? count : max_span);
+        if (n == 0)
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < n; i++)
+        {
+            ok &= samples[i].t_us == seq + i && &samples[i] == &log.at(seq + i);
+        }
+        seq += n;
+        count -= n;
+        spans++;
+    }
+    return ok;
+}
+
+
+
+/** @brief Function which checks first_seq() and at() before and after the storage wraps
+ *
+ *  @details The log must refuse storage which is missing or not a power of two. Until N
+ *  samples have been added every one is kept and the oldest is number zero. After that the
+ *  oldest kept is always N behind the next, and at() must give the newest sample written to
+ *  each slot.
+ */
+static void test_first_seq(void)
+{
+    TelemetryLog log;
+    CHECK(log.capacity() == 0);
+    CHECK(!log.begin(NULL, LOG_SIZE) && !log.begin(storage, LOG_SIZE - 1) && !log.begin(storage, 1));
+    CHECK(log.begin(storage, LOG_SIZE) && log.capacity() == LOG_SIZE);
+    CHECK(log.first_seq() == 0 && log.next_seq() == 0);
+
+    add_samples(log, LOG_SIZE - 1);
+    CHECK(log.first_seq() == 0 && log.next_seq() == LOG_SIZE - 1);
+    add_samples(log, 1);
+    CHECK(log.first_seq() == 0 && log.next_seq() == LOG_SIZE);
+    add_samples(log, 1);
+    CHECK(log.first_seq() == 1);
+
+    bool kept = true;
+    for (uint32_t added = 0; added < 5 * LOG_SIZE; added++)
+    {
+        add_samples(log, 1);
+        kept &= log.next_seq() - log.first_seq() == LOG_SIZE;
+        for (uint32_t seq = log.first_seq(); seq != log.next_seq(); seq++)
+        {
+            kept &= log.at(seq).t_us == seq;
+        }
+    }
+    printf("  first_seq: %u kept of %u added\n", (unsigned)(log.next_seq() - log.first_seq()),
+           (unsigned)log.next_seq());
+    CHECK(kept);
+}
+
+
+
+/** @brief Function which checks span() splits a read where the storage wraps around
+ *
+ *  @details From every starting point in a full log, reading to the newest sample must take
+ *  one span if the samples lie in order in the storage and two if they wrap past its end,
+ *  or more only when the reader asks for fewer at a time. A span never runs past the newest
+ *  sample, and asking for one from the next sequence number gives none.
+ */
+static void test_span_wrap(void)
+{
+    TelemetryLog log;
+    CHECK(log.begin(storage, LOG_SIZE));
+    add_samples(log, 3 * LOG_SIZE + 5);
+
+    bool ok = true;
+    uint32_t wrapped = 0;
+    for (uint32_t seq = log.first_seq(); seq != log.next_seq(); seq++)
+    {
+        uint32_t spans = 0;
+        uint32_t count = log.next_seq() - seq;
+        ok &= read_spans(log, seq, count, LOG_SIZE, spans);
+        bool wraps = (seq % LOG_SIZE) + count > LOG_SIZE;
+        ok &= spans == (wraps ? 2u : 1u);
+        wrapped += wraps ? 1 : 0;
+
+        ok &= read_spans(log, seq, count, 3, spans);
+        ok &= spans >= (count + 2) / 3;
+    }
+
+    uint32_t n = 99;
+    log.span(log.next_seq(), n, LOG_SIZE);
+    printf("  span: %u of %u starting points wrap\n", (unsigned)wrapped, (unsigned)LOG_SIZE);
+    CHECK(ok);
+    CHECK(wrapped == LOG_SIZE - 5 && n == 0);
+}
+
+
+
+/** @brief Function which checks samples and events are merged from the rings in time order
+ *
+ *  @details The times run across the wrap of the 32-bit microsecond clock. An event at the
+ *  same time as a speed sample must come first, the rest must be in time order, and a merge
+ *  limited to fewer samples than are waiting must leave the rest in the rings.
+ */
+static void test_merge(void)
+{
+    SpscRing<TelemetrySample, 16> ring;
+    SpscRing<TelemetrySample, 8> events;
+    const uint32_t t0 = 0xFFFFFF00u;
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        ring.push(make_sample(t0 + i * 50));
+    }
+    const uint32_t event_times[] = { t0 + 25, t0 + 100, t0 + 260, t0 + 1000 };
+    for (uint32_t t : event_times)
+    {
+        TelemetrySample event = make_sample(t);
+        event.flags = TELEMETRY_COMMAND;
+        events.push(event);
+    }
+
+    TelemetryLog log;
+    CHECK(log.begin(storage, LOG_SIZE));
+    CHECK(log.merge(ring, events, 3) == 3);
+    CHECK(log.merge(ring, events, 100) == 11);
+    CHECK(log.merge(ring, events, 100) == 0);
+
+    bool ordered = true, events_first = true;
+    for (uint32_t seq = log.first_seq() + 1; seq != log.next_seq(); seq++)
+    {
+        const TelemetrySample& a = log.at(seq - 1);
+        const TelemetrySample& b = log.at(seq);
+        ordered &= (int32_t)(b.t_us - a.t_us) >= 0;
+        events_first &= !(a.t_us == b.t_us && (b.flags & TELEMETRY_COMMAND));
+    }
+    printf("  merge: %u samples from t = %08x to %08x\n", (unsigned)log.next_seq(),
+           (unsigned)log.at(0).t_us, (unsigned)log.at(log.next_seq() - 1).t_us);
+    CHECK(ordered && events_first);
+    CHECK(log.at(2).t_us == t0 + 50 && (log.at(1).flags & TELEMETRY_COMMAND));
+    CHECK((log.at(log.next_seq() - 1).flags & TELEMETRY_COMMAND) && log.at(log.next_seq() - 1).t_us == t0 + 1000);
+}
+
+
+
+/** @brief Function which reads the log out as CSV while new samples overwrite it
+ *
+ *  @details The buffer holds two rows, and after each buffer five new samples are added, as
+ *  the rings are drained between chunks of /log.csv. The reader starts from a sequence
+ *  number which has already been overwritten. Every row must be the sample its sequence
+ *  number says, the rows must go up, rows overwritten before they were sent must be skipped
+ *  and the read must stop at the newest sample when it started. A reader which falls so far
+ *  behind that the oldest sample kept is past its end must stop at once.
+ */
+static void test_csv_skip(void)
+{
+    TelemetryLog log;
+    CHECK(log.begin(storage, LOG_SIZE));
+    add_samples(log, 40);
+
+    char buffer[128];
+    uint32_t seq = 3, end = log.next_seq(), rows = 0, chunks = 0, last = 0;
+    bool ok = true, ascending = true;
+    for (size_t used = log.csv(seq, end, buffer, sizeof(buffer), rows); used > 0;
+         used = log.csv(seq, end, buffer, sizeof(buffer), rows))
+    {
+        buffer[used] = '\0';
+        for (const char* row = buffer; *row != '\0'; row = strchr(row, '\n') + 1)
+        {
+            unsigned long row_seq, row_t;
+            ok &= sscanf(row, "%lu,%lu,", &row_seq, &row_t) == 2 && row_seq == row_t;
+            ascending &= chunks == 0 || row_seq > last;
+            last = row_seq;
+        }
+        chunks++;
+        add_samples(log, 5);
+    }
+    uint32_t skipped = (end - 24) - rows;
+    printf("  csv: %u rows in %u chunks, %u overwritten rows skipped, last row %u\n", (unsigned)rows,
+           (unsigned)chunks, (unsigned)skipped, (unsigned)last);
+    CHECK(ok && ascending);
+    CHECK(seq == end && last == end - 1);
+    CHECK(skipped > 0);
+
+    uint32_t behind = log.next_seq() - 3 * LOG_SIZE;
+    end = behind + 2;
+    rows = 0;
+    CHECK(log.csv(behind, end, buffer, sizeof(buffer), rows) == 0 && behind == end && rows == 0);
+}
+
+
+
+int main(void)
+{
+    test_first_seq();
+    test_span_wrap();
+    test_merge();
+    test_csv_skip();
+    return test_result("test_telemetrylog");
+}
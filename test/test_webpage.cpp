@@ -0,0 +1,92 @@
+/** @file test_webpage.cpp
+ *  This file contains the before and after bench of the control page handler. The old
+ *  handler (OldPage.h) built the page from about 250 String appends on every request and
+ *  sent it uncompressed; the new one sends the gzip bytes of WebPage.h as they are, or
+ *  nothing when the browser already has the page. Both are timed with the bytes they send
+ *  copied out in TCP segments, as the WebServer does, and the bytes sent and the time per
+ *  request are printed. The times are host cycles, so only their ratio carries over to the
+ *  ESP32, where the old handler also fragmented the heap.
+*/
+
+#include <string.h>
+#include <vector>
+#include "test.h"
+#include "OldPage.h"
+#include "WebPage.h"
+
+// Requests timed for each handler
+#define REQUESTS 20000
+
+// Bytes copied into the socket at a time, one TCP segment on the ESP32
+#define SEGMENT_BYTES 1436
+
+/** @brief Function which copies the bytes of a reply out in TCP segments
+ *
+ *  @param data The reply.
+ *  @param length The bytes in the reply.
+ *  @param segment A buffer of SEGMENT_BYTES bytes.
+ *
+ *  @return The last byte copied, so the copies cannot be optimised away.
+ */
+static uint8_t send_segments(const uint8_t* data, size_t length, uint8_t* segment)
+{
+    uint8_t last = 0;
+    for (size_t sent = 0; sent < length; sent += SEGMENT_BYTES)
+    {
+        size_t n = (length - sent < SEGMENT_BYTES) ? length - sent : SEGMENT_BYTES;
+        memcpy(segment, data + sent, n);
+        last ^= segment[n - 1];
+    }
+    return last;
+}
+
+
+
+/** @brief Function which times the old and new handlers and compares the bytes they send
+ *
+ *  @details The old page is built with the DRV8308 gains the Driver starts with and the
+ *  starting PID gains. The new handler must send less than half the bytes of the old one
+ *  and take less time per request.
+ */
+static void test_handlers(void)
+{
+    const uint16_t regs[16] = { 0, 0, 0, 0, 0, 0x0100, 127, 507, 100, 100, 0x0200, 0x0300 };
+    const PidGains pid = { 1.0f, 4.0f, 0.01f, 1.0f };
+    std::vector<uint8_t> segment(SEGMENT_BYTES);
+    volatile uint32_t sink = 0;
+
+    size_t old_bytes = 0;
+    uint64_t start = host_cycles();
+    for (int i = 0; i < REQUESTS; i++)
+    {
+        std::string a_str;
+        build_old_page(a_str, regs, pid);
+        old_bytes = a_str.size();
+        sink += send_segments((const uint8_t*)a_str.data(), a_str.size(), segment.data());
+    }
+    double old_cycles = (double)(host_cycles() - start) / REQUESTS;
+
+    start = host_cycles();
+    for (int i = 0; i < REQUESTS; i++)
+    {
+        sink += send_segments(WEB_PAGE_GZ, WEB_PAGE_GZ_LEN, segment.data());
+    }
+    double new_cycles = (double)(host_cycles() - start) / REQUESTS;
+    (void)sink;
+
+    printf("  old handler: %6u bytes, %8.0f cycles per request\n", (unsigned)old_bytes, old_cycles);
+    printf("  new handler: %6u bytes, %8.0f cycles per request, 0 bytes when revalidated (304)\n",
+           (unsigned)WEB_PAGE_GZ_LEN, new_cycles);
+    printf("  bytes %.1fx fewer, handler %.0fx faster\n", (double)old_bytes / WEB_PAGE_GZ_LEN,
+           old_cycles / new_cycles);
+    CHECK(WEB_PAGE_GZ_LEN * 2 < old_bytes);
+    CHECK(new_cycles < old_cycles);
+}
+
+
+
+int main(void)
+{
+    test_handlers();
+    return test_result("test_webpage");
+}
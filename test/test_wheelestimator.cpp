@@ -0,0 +1,219 @@
+/** @file test_wheelestimator.cpp
+ *  This file contains the validation of the WheelEstimator against a wheel with known
+ *  inertia and friction. The wheel is spun up by constant torques and coasts down, once
+ *  through a reversal, and is slowed once by a torque the estimator is not told about, as
+ *  while the brake is on. FGOUT edges with timing jitter come from the wheel speed, a
+ *  SpeedEstimator filters them as readActual does every four edges (or after 20 ms), and
+ *  each speed is given to the WheelEstimator signed with the direction the wheel turns.
+ *
+ *  Each run is made twice: with the speed stamped halfway through the span it was averaged
+ *  over, as the firmware does, and with the time the task woke. The estimate at the end of
+ *  every segment is printed for both, and the estimate must then follow a heavier flywheel.
+*/
+
+#include <math.h>
+#include "test.h"
+#include "WheelEstimator.h"
+#include "SpeedEstimator.h"
+
+// The wheel the estimate must find: inertia (kg*m^2), viscous (N*m per rad/s) and Coulomb
+// friction (N*m)
+#define WHEEL_J 0.0025
+#define WHEEL_B 1.0e-4
+#define WHEEL_C 0.004
+
+// Time step of the wheel model (us)
+#define SIM_STEP_US 10
+
+// Edges between speed measurements, and the longest time between them (us)
+#define NOTIFY_EDGES 4
+#define EDGE_TIMEOUT_US 20000
+
+// Peak timing noise on each edge (us)
+#define EDGE_JITTER_US 20
+
+// Samples used before the estimate is trusted, as WHEEL_MIN_SAMPLES in CtrlTasks.cpp
+#define MIN_SAMPLES 50
+
+// Conversion from rad/s to RPM
+#define RAD_S_TO_RPM (60.0 / (2.0 * M_PI))
+
+/** One part of a run, holding a torque on the wheel */
+struct Segment
+{
+    const char* name;               // what the segment does, for the table
+    double seconds;                 // how long it lasts
+    double torque;                  // torque on the wheel in N*m
+    bool known;                     // false if the estimator is not told the torque
+};
+
+/** Spin-ups and coast-downs in both directions, with an unknown braking torque in between */
+static const Segment schedule[] =
+{
+    { "spin up",     4.0,  0.10, true  },
+    { "coast",      20.0,  0.0,  true  },
+    { "brake",       1.0, -0.05, false },
+    { "spin up",     3.0,  0.05, true  },
+    { "coast",      10.0,  0.0,  true  },
+    { "reverse",     4.0, -0.10, true  },
+    { "coast",      20.0,  0.0,  true  }
+};
+
+/** Model of the wheel, its FGOUT edges and the readActual task measuring them */
+struct WheelRun
+{
+    double J = WHEEL_J;             // true wheel parameters
+    double b = WHEEL_B;
+    double c = WHEEL_C;
+    double w = 5.0;                 // wheel speed in rad/s
+    int64_t t = 0;                  // time in us
+    double phase = 0.0;             // fraction of a period since the last edge
+    uint32_t pending = 0;           // edges since the last measurement
+    int64_t measured_at = 0;        // time of the last measurement
+    uint32_t seed = 11;             // state of the jitter generator
+    bool midpoint = true;           // true to stamp speeds halfway through their span
+
+    SpeedEstimator speed;
+    WheelEstimator estimate;
+
+    /** @brief Constructor which starts the estimate from the default WheelModel */
+    WheelRun(bool midpoint_) : midpoint(midpoint_), speed(ESTIMATE_ADAPTIVE, 8, 5, 1)
+    {
+        estimate.reset(WheelModel());
+    }
+
+    /** @brief Function which runs the wheel through one segment
+     *
+     *  @param seg The segment.
+     *
+     *  @return The number of samples which updated the estimate during it.
+     */
+    uint32_t play(const Segment& seg)
+    {
+        uint32_t used = estimate.samples();
+        const double dt = SIM_STEP_US * 1.0e-6;
+        for (int64_t end = t + (int64_t)(seg.seconds * 1.0e6); t < end; t += SIM_STEP_US)
+        {
+            // the wheel stops for a step where it passes through zero
+            double sign = (w > 0.0) ? 1.0 : ((w < 0.0) ? -1.0 : 0.0);
+            double next = w + (seg.torque - b * w - c * sign) / J * dt;
+            w = (next * w < 0.0) ? 0.0 : next;
+
+            // an edge every 1/4 revolution
+            phase += fabs(w) * RAD_S_TO_RPM / 15.0 * dt;
+            if (phase >= 1.0)
+            {
+                phase -= 1.0;
+                seed = seed * 1103515245u + 12345u;
+                uint32_t stamp = (uint32_t)t + (seed >> 16) % (EDGE_JITTER_US + 1);
+                pending += speed.add_edge(stamp) ? 1 : 0;
+            }
+
+            bool timeout = t - measured_at >= EDGE_TIMEOUT_US && pending > 0;
+            if (pending >= NOTIFY_EDGES || timeout)
+            {
+                pending = 0;
+                measured_at = t;
+                float rpm = rpm_to_float(speed.rpm()) * ((w < 0.0) ? -1.0f : 1.0f);
+                uint64_t now_us = midpoint ? speed.last_edge() - speed.span() / 2 : (uint64_t)t;
+                estimate.sample(now_us, rpm_from_float(rpm), seg.known ? (float)seg.torque : 0.0f,
+                                seg.known);
+            }
+        }
+        return estimate.samples() - used;
+    }
+};
+
+
+
+/** @brief Function which returns the relative error of an estimate in percent */
+static double error_pct(double estimate, double truth)
+{
+    return 100.0 * (estimate - truth) / truth;
+}
+
+
+
+/** @brief Function which prints the estimate after every segment and checks it converges
+ *
+ *  @details Once the estimate is trusted, after the first spin-up and coast-down, it must
+ *  stay within 2% of the inertia and 10% of both frictions at the end of every segment
+ *  with the speeds stamped halfway through their span. The braking torque must not update
+ *  the estimate at all.
+ */
+static void report_convergence(void)
+{
+    WheelRun now(true), wake(false);
+
+    printf("  segment       t s  speed RPM   midpoint: samples  J err %%  b err %%  c err %%"
+           "   wake time: J err %%  b err %%  c err %%\n");
+    for (const Segment& seg : schedule)
+    {
+        uint32_t used = now.play(seg);
+        wake.play(seg);
+        CHECK(seg.known || used == 0);
+
+        WheelModel m, old;
+        bool trusted = now.estimate.model(m, MIN_SAMPLES);
+        bool old_trusted = wake.estimate.model(old, MIN_SAMPLES);
+        printf("  %-9s  %6.1f  %9.0f            %7u", seg.name, now.t * 1.0e-6, now.w * RAD_S_TO_RPM,
+               (unsigned)now.estimate.samples());
+        if (trusted && old_trusted)
+        {
+            printf("  %7.2f  %7.2f  %7.2f             %7.2f  %7.2f  %7.2f\n",
+                   error_pct(m.get_J(), WHEEL_J), error_pct(m.get_b(), WHEEL_B),
+                   error_pct(m.get_c(), WHEEL_C), error_pct(old.get_J(), WHEEL_J),
+                   error_pct(old.get_b(), WHEEL_B), error_pct(old.get_c(), WHEEL_C));
+        }
+        else
+        {
+            printf("  not trusted yet\n");
+        }
+
+        if (now.t > 20000000)
+        {
+            CHECK(trusted);
+            CHECK(fabs(error_pct(m.get_J(), WHEEL_J)) < 2.0);
+            CHECK(fabs(error_pct(m.get_b(), WHEEL_B)) < 10.0);
+            CHECK(fabs(error_pct(m.get_c(), WHEEL_C)) < 10.0);
+        }
+    }
+}
+
+
+
+/** @brief Function which checks the estimate follows a change of flywheel
+ *
+ *  @details After converging on the wheel, the inertia is raised by 60%, as if a heavier
+ *  flywheel were fitted without resetting the estimator. The forgetting factor must let
+ *  the estimate reach the new inertia within a few spin-ups and coast-downs.
+ */
+static void test_load_change(void)
+{
+    WheelRun run(true);
+    for (const Segment& seg : schedule)
+    {
+        run.play(seg);
+    }
+
+    run.J = 1.6 * WHEEL_J;
+    const Segment cycle[] = { { "spin up", 4.0, 0.10, true }, { "coast", 10.0, 0.0, true } };
+    WheelModel m;
+    for (int i = 0; i < 4; i++)
+    {
+        run.play(cycle[0]);
+        run.play(cycle[1]);
+        run.estimate.model(m, MIN_SAMPLES);
+        printf("  heavier flywheel, cycle %d: J err %.2f%%\n", i + 1, error_pct(m.get_J(), run.J));
+    }
+    CHECK(fabs(error_pct(m.get_J(), run.J)) < 3.0);
+}
+
+
+
+int main(void)
+{
+    report_convergence();
+    test_load_change();
+    return test_result("test_wheelestimator");
+}
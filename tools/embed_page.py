@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Compress web/index.html into src/WebPage.h so the ESP32 can serve it from flash.
+
+The page is gzipped once here instead of being built with String += on every
+request. The header holds the compressed bytes, their length and an ETag made
+from their hash, so a browser which already has the page gets a 304 reply.
+
+Run this from anywhere after editing web/index.html:
+
+    python3 tools/embed_page.py
+"""
+
+import gzip
+import hashlib
+import os
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCE = os.path.join(ROOT, "web", "index.html")
+TARGET = os.path.join(ROOT, "src", "WebPage.h")
+
+
+def main():
+    with open(SOURCE, "rb") as f:
+        html = f.read()
+
+    # mtime=0 keeps the output the same for the same page, so the ETag only changes with the page
+    packed = gzip.compress(html, compresslevel=9, mtime=0)
+    etag = hashlib.sha256(packed).hexdigest()[:16]
+
+    lines = []
+    lines.append("/** @file WebPage.h")
+    lines.append(" *  This file contains the control web page, gzip compressed, for the web server to send")
+    lines.append(" *  straight from flash. It is generated from web/index.html by tools/embed_page.py;")
+    lines.append(" *  edit the page and run the script instead of editing this file.")
+    lines.append(" *")
+    lines.append(" *  Page: %d bytes, compressed: %d bytes." % (len(html), len(packed)))
+    lines.append("*/")
+    lines.append("")
+    lines.append("#ifndef _WEBPAGE_H_")
+    lines.append("#define _WEBPAGE_H_")
+    lines.append("")
+    lines.append("// On the ESP32 the page stays in flash; on a PC, for test_webpage, it is an ordinary array")
+    lines.append("#ifdef ESP_PLATFORM")
+    lines.append("#include <Arduino.h>")
+    lines.append("#else")
+    lines.append("#include <stdint.h>")
+    lines.append("#define PROGMEM")
+    lines.append("#endif")
+    lines.append("")
+    lines.append("// Entity tag of the compressed page, which changes whenever the page does")
+    lines.append('#define WEB_PAGE_ETAG "\\"%s\\""' % etag)
+    lines.append("")
+    lines.append("// Length of the compressed page in bytes")
+    lines.append("#define WEB_PAGE_GZ_LEN %d" % len(packed))
+    lines.append("")
+    lines.append("// The compressed page")
+    lines.append("static const uint8_t WEB_PAGE_GZ[WEB_PAGE_GZ_LEN] PROGMEM =")
+    lines.append("{")
+    for i in range(0, len(packed), 16):
+        chunk = packed[i:i + 16]
+        lines.append("    " + ", ".join("0x%02x" % b for b in chunk) + ",")
+    lines.append("};")
+    lines.append("")
+    lines.append("#endif")
+
+    with open(TARGET, "w", newline="\n") as f:
+        f.write("\n".join(lines) + "\n")
+
+    print("%s: %d bytes -> %d bytes gzip, ETag %s" % (os.path.relpath(TARGET, ROOT), len(html), len(packed), etag))
+
+
+if __name__ == "__main__":
+    main()
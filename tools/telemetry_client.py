@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+"""Measure the live telemetry stream from the ESP32.
+
+Connects to the /events Server-Sent Events stream, reads it for a while and
+reports the sustained samples per second, the messages per second and the
+latency of the samples. Each message starts with the device time it was sent,
+and each sample carries the device time it was measured, so:
+
+  - the batching delay (sent - measured) comes from the device clock alone;
+  - the network delay is the receive time on this computer minus the sent
+    time, less the smallest such difference seen, because the two clocks
+    are not synchronized. It is the delay above the fastest message.
+
+Connect to the ESP32 access point first, then for example:
+
+    python3 tools/telemetry_client.py --hz 0 --seconds 30
+"""
+
+import argparse
+import http.client
+import time
+
+
+def percentile(values, pct):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    index = min(len(values) - 1, int(round(pct / 100.0 * (len(values) - 1))))
+    return values[index]
+
+
+def wrap_us(later, earlier):
+    """Difference of two 32-bit device times in microseconds, allowing for wraparound."""
+    return (later - earlier) & 0xFFFFFFFF
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--host", default="192.168.5.1", help="address of the ESP32")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--hz", type=int, default=0, help="samples per second to ask for, 0 for all")
+    parser.add_argument("--seconds", type=float, default=10.0, help="how long to measure")
+    args = parser.parse_args()
+
+    conn = http.client.HTTPConnection(args.host, args.port, timeout=5)
+    conn.request("GET", "/events?hz=%d" % args.hz, headers={"Accept": "text/event-stream"})
+    response = conn.getresponse()
+    if response.status != 200:
+        raise SystemExit("/events replied %d %s" % (response.status, response.reason))
+
+    samples = 0
+    messages = 0
+    gaps = 0
+    batching_ms = []
+    arrival = []            # (receive time on this computer, device time sent) per message
+    last_stamp = None
+    last_interval = None
+    start = time.monotonic()
+
+    while time.monotonic() - start < args.seconds:
+        line = response.fp.readline()
+        if not line:
+            raise SystemExit("the stream was closed")
+        line = line.decode("ascii", "replace").rstrip("\r\n")
+        if not line.startswith("data: "):
+            continue
+
+        received = time.monotonic()
+        fields = line[6:].split(";")
+        sent = int(fields[0])
+        messages += 1
+        arrival.append((received, sent))
+
+        for sample in fields[1:]:
+            stamp = int(sample.split(",", 1)[0])
+            samples += 1
+            batching_ms.append(wrap_us(sent, stamp) / 1000.0)
+            # count holes in the stream, which appear as a period much longer than the last one
+            if last_stamp is not None:
+                interval = wrap_us(stamp, last_stamp)
+                if last_interval and interval > 3 * last_interval and args.hz == 0:
+                    gaps += 1
+                last_interval = interval
+            last_stamp = stamp
+
+    elapsed = time.monotonic() - start
+    conn.close()
+
+    # device times wrap every 71 minutes, so unwrap them against the first message; the offset
+    # between the clocks plus the fastest delivery is then the smallest difference seen
+    offsets = []
+    if arrival:
+        base_sent = arrival[0][1]
+        offsets = [received * 1e6 - (base_sent + wrap_us(sent, base_sent)) for received, sent in arrival]
+    floor = min(offsets) if offsets else 0.0
+    network_ms = [(offset - floor) / 1000.0 for offset in offsets]
+
+    print("%.1f s: %d samples (%.1f/s) in %d messages (%.1f/s), %d gaps"
+          % (elapsed, samples, samples / elapsed, messages, messages / elapsed, gaps))
+    print("batching delay on the device: median %.1f ms, p99 %.1f ms, max %.1f ms"
+          % (percentile(batching_ms, 50), percentile(batching_ms, 99), max(batching_ms or [0.0])))
+    print("network delay above the fastest message: median %.1f ms, p99 %.1f ms, max %.1f ms"
+          % (percentile(network_ms, 50), percentile(network_ms, 99), max(network_ms or [0.0])))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,253 @@
+#!/usr/bin/env python3
+"""Decode compressed telemetry from the ESP32 into CSV, and measure the compression.
+
+/log.tlz and /runs/get?id=N&format=tlz send samples as a string of blocks in the
+format of src/TelemetryCodec.h. Each block is a 12 byte header followed by the
+samples, each stored as its changes from the one before:
+
+    header: magic "TLZ1", first_seq u32, count u16, bytes u16 (little-endian)
+    sample: mask u8, then zigzag varints of the change in t_us, the change in
+            the filtered speed and the raw minus filtered speed (Q16.16 RPM),
+            then if mask & 1 the change in the command, if mask & 2 the state
+            and flags bytes, if mask & 4 the change in the brake duty, and
+            if mask & 8 the profile and step as plain varints
+
+The first sample of a block is stored against a sample of all zeros, so every
+block can be decoded on its own.
+
+    python3 tools/telemetry_decode.py speed_log.tlz -o speed_log.csv
+    python3 tools/telemetry_decode.py --url http://192.168.5.1/log.tlz -o log.csv
+    python3 tools/telemetry_decode.py --bench speed_log.tlz
+
+--bench reports the bytes per sample against the 24 byte binary samples of
+/telemetry and the CSV rows of /log.csv, and how fast this script decodes. With
+--encode a CSV from /log.csv or telemetry_poll.py is compressed the same way the
+ESP32 does it (the speeds are rounded back to Q16.16), which measures the ratio
+on a run recorded before the codec existed.
+"""
+
+import argparse
+import struct
+import sys
+import time
+import urllib.request
+
+HEADER = struct.Struct("<4sIHH")
+MAGIC = b"TLZ1"
+BINARY_SAMPLE_SIZE = 24     # sizeof(TelemetrySample)
+BLOCK_SAMPLES = 64          # TELEMETRY_BLOCK_SAMPLES in src/TelemetryCodec.h
+FIELD_COMMAND = 0x01
+FIELD_STATE = 0x02
+FIELD_BRAKE = 0x04
+FIELD_PROFILE = 0x08
+FIELD_ALL = 0x0F
+STATES = ("idle", "accel", "decel")
+TORQUE = 0x01
+COMMAND = 0x02
+TRANSITION = 0x04
+CSV_HEADER = "seq,t_us,actual_rpm,raw_rpm,command_rpm,state,mode,brake,event,profile,step\n"
+
+
+def s32(value):
+    """Wrap a number to a signed 32 bit integer, as the ESP32 arithmetic does."""
+    value &= 0xFFFFFFFF
+    return value - 0x100000000 if value & 0x80000000 else value
+
+
+def read_varint(data, pos, end):
+    value = 0
+    shift = 0
+    while pos < end and shift < 35:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if not byte & 0x80:
+            return value, pos
+        shift += 7
+    raise ValueError("varint runs past the end of the block")
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode_blocks(data):
+    """Yield (seq, t_us, actual, raw, command, state, flags, brake, profile, step) with speeds in Q16.16 RPM."""
+    pos = 0
+    while pos < len(data):
+        if len(data) - pos < HEADER.size:
+            raise ValueError("%d stray bytes after the last block" % (len(data) - pos))
+        magic, seq, count, size = HEADER.unpack_from(data, pos)
+        if magic != MAGIC:
+            raise ValueError("bad block magic %r at byte %d" % (magic, pos))
+        pos += HEADER.size
+        end = pos + size
+        if end > len(data):
+            raise ValueError("block at byte %d is cut off" % (pos - HEADER.size))
+
+        t = actual = raw = command = state = flags = brake = profile = step = 0
+        for _ in range(count):
+            if pos >= end or data[pos] & ~FIELD_ALL:
+                raise ValueError("damaged sample at byte %d" % pos)
+            mask = data[pos]
+            pos += 1
+            dt, pos = read_varint(data, pos, end)
+            da, pos = read_varint(data, pos, end)
+            dr, pos = read_varint(data, pos, end)
+            t = (t + unzigzag(dt)) & 0xFFFFFFFF
+            actual = s32(actual + unzigzag(da))
+            raw = s32(actual + unzigzag(dr))
+            if mask & FIELD_COMMAND:
+                dc, pos = read_varint(data, pos, end)
+                command = s32(command + unzigzag(dc))
+            if mask & FIELD_STATE:
+                if pos + 2 > end:
+                    raise ValueError("sample runs past the end of the block at byte %d" % end)
+                state, flags = data[pos], data[pos + 1]
+                pos += 2
+            if mask & FIELD_BRAKE:
+                db, pos = read_varint(data, pos, end)
+                brake = (brake + unzigzag(db)) & 0xFFFF
+            if mask & FIELD_PROFILE:
+                profile, pos = read_varint(data, pos, end)
+                step, pos = read_varint(data, pos, end)
+            if pos > end:
+                raise ValueError("sample runs past the end of the block at byte %d" % end)
+            yield seq, t, actual, raw, command, state, flags, brake, profile, step
+            seq += 1
+        if pos != end:
+            raise ValueError("block ending at byte %d has %d bytes after its samples" % (end, end - pos))
+        pos = end
+
+
+def write_varint(out, value):
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+
+
+def zigzag(value):
+    value = s32(value)
+    return ((value << 1) ^ (value >> 31)) & 0xFFFFFFFF
+
+
+def encode_blocks(samples):
+    """Compress (seq, t_us, actual, raw, command, state, flags, brake, profile, step) tuples as TelemetryEncoder does."""
+    out = bytearray()
+    for start in range(0, len(samples), BLOCK_SAMPLES):
+        block = samples[start:start + BLOCK_SAMPLES]
+        body = bytearray()
+        last = (0,) * 10
+        for s in block:
+            mask_at = len(body)
+            body.append(0)
+            mask = 0
+            write_varint(body, zigzag(s[1] - last[1]))
+            write_varint(body, zigzag(s[2] - last[2]))
+            write_varint(body, zigzag(s[3] - s[2]))
+            if s[4] != last[4]:
+                mask |= FIELD_COMMAND
+                write_varint(body, zigzag(s[4] - last[4]))
+            if s[5] != last[5] or s[6] != last[6]:
+                mask |= FIELD_STATE
+                body += bytes((s[5], s[6]))
+            if s[7] != last[7]:
+                mask |= FIELD_BRAKE
+                write_varint(body, zigzag(s[7] - last[7]))
+            if s[8] != last[8] or s[9] != last[9]:
+                mask |= FIELD_PROFILE
+                write_varint(body, s[8])
+                write_varint(body, s[9])
+            body[mask_at] = mask
+            last = s
+        out += HEADER.pack(MAGIC, block[0][0], len(block), len(body)) + body
+    return bytes(out)
+
+
+def event_name(flags):
+    """Name what a sample records, as in the event column of /log.csv."""
+    if flags & COMMAND:
+        return "command+transition" if flags & TRANSITION else "command"
+    return "transition" if flags & TRANSITION else "speed"
+
+
+def csv_row(s):
+    seq, t_us, actual, raw, command, state, flags, brake, profile, step = s
+    return "%d,%d,%.3f,%.3f,%.3f,%s,%s,%.3f,%s,%d,%d\n" % (
+        seq, t_us, actual / 65536.0, raw / 65536.0, command / 65536.0,
+        STATES[state] if state < len(STATES) else "?",
+        "torque" if flags & TORQUE else "speed", brake / 1000.0, event_name(flags), profile, step)
+
+
+def read_csv(path):
+    """Read a CSV from /log.csv or telemetry_poll.py back into sample tuples.
+
+    CSVs written before the profile and step columns were added read as profile zero.
+    """
+    samples = []
+    with open(path) as f:
+        f.readline()
+        for line in f:
+            fields = line.strip().split(",")
+            seq, t_us, actual, raw, command, state, mode, brake, event = fields[:9]
+            profile, step = (int(fields[9]), int(fields[10])) if len(fields) >= 11 else (0, 0)
+            flags = (TORQUE if mode == "torque" else 0) \
+                | (COMMAND if event.startswith("command") else 0) \
+                | (TRANSITION if event.endswith("transition") else 0)
+            samples.append((int(seq), int(t_us), round(float(actual) * 65536), round(float(raw) * 65536),
+                            round(float(command) * 65536), STATES.index(state) if state in STATES else 255,
+                            flags, round(float(brake) * 1000), profile, step))
+    return samples
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("input", nargs="?", help="compressed file, or a CSV with --encode")
+    parser.add_argument("--url", help="fetch the compressed samples from this URL instead")
+    parser.add_argument("-o", "--output", help="file to write (CSV, or compressed with --encode); "
+                                               "standard output if not given")
+    parser.add_argument("--encode", action="store_true", help="compress a CSV instead of decoding")
+    parser.add_argument("--bench", action="store_true", help="report the compression and decode speed")
+    args = parser.parse_args()
+    if not args.input and not args.url:
+        parser.error("give an input file or --url")
+
+    if args.encode:
+        samples = read_csv(args.input)
+        data = encode_blocks(samples)
+        if args.output:
+            with open(args.output, "wb") as f:
+                f.write(data)
+    else:
+        if args.url:
+            with urllib.request.urlopen(args.url, timeout=30) as response:
+                data = response.read()
+        else:
+            with open(args.input, "rb") as f:
+                data = f.read()
+        start = time.perf_counter()
+        samples = list(decode_blocks(data))
+        decode_s = time.perf_counter() - start
+        if not args.bench or args.output:
+            out = open(args.output, "w") if args.output else sys.stdout
+            out.write(CSV_HEADER)
+            for s in samples:
+                out.write(csv_row(s))
+            if args.output:
+                out.close()
+
+    if args.bench:
+        n = max(len(samples), 1)
+        csv_bytes = sum(len(csv_row(s)) for s in samples)
+        print("%d samples in %d bytes: %.2f bytes/sample" % (len(samples), len(data), len(data) / n),
+              file=sys.stderr)
+        print("%.2fx smaller than binary frames (%d bytes/sample), %.1fx smaller than CSV (%.1f bytes/sample)"
+              % (BINARY_SAMPLE_SIZE * n / max(len(data), 1), BINARY_SAMPLE_SIZE, csv_bytes / max(len(data), 1),
+                 csv_bytes / n), file=sys.stderr)
+        if not args.encode:
+            print("decoded %.0f samples/s" % (len(samples) / max(decode_s, 1e-9)), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Read the binary telemetry frames from the ESP32 and measure their throughput.
+
+Polls the /telemetry endpoint, asking each time for the samples after the last
+one received, decodes the frames and reports the samples per second, the bytes
+per sample on the wire, the request round trip time and any samples which were
+overwritten on the ESP32 before they were asked for. With --csv every decoded
+sample is also written to a file.
+
+A frame is a 16 byte header followed by 24 byte samples, little-endian, exactly
+as struct TelemetryFrameHeader and struct TelemetrySample in src/Telemetry.h:
+
+    header: magic "TLM1", first_seq u32, lost u32, count u16, sample_size u16
+    sample: t_us u32, actual i32, raw i32, command i32 (Q16.16 RPM),
+            state u8, flags u8, brake u16 (thousandths),
+            profile u16, step u16
+
+The flags are 1 for torque mode, 2 for a new command and 4 for a state
+transition; a row with neither 2 nor 4 is a speed measurement. The profile is
+the number of the command profile being played since the ESP32 started, or zero,
+and the step is the step of it which gave the latest command.
+
+Connect to the ESP32 access point first, then for example:
+
+    python3 tools/telemetry_poll.py --seconds 30 --csv run.csv
+"""
+
+import argparse
+import http.client
+import struct
+import time
+
+HEADER = struct.Struct("<4sIIHH")
+SAMPLE = struct.Struct("<IiiiBBHHH")
+MAGIC = b"TLM1"
+FRAME_MAX = 1024    # TELEMETRY_FRAME_MAX in src/Server.cpp
+STATES = ("idle", "accel", "decel")
+TORQUE = 0x01
+COMMAND = 0x02
+TRANSITION = 0x04
+
+
+def decode_frame(frame):
+    """Decode one frame into (first_seq, lost, samples), each sample a dict with speeds in RPM."""
+    if len(frame) < HEADER.size:
+        raise ValueError("frame of %d bytes is shorter than its header" % len(frame))
+    magic, first_seq, lost, count, sample_size = HEADER.unpack_from(frame, 0)
+    if magic != MAGIC:
+        raise ValueError("bad frame magic %r" % magic)
+    if sample_size != SAMPLE.size:
+        raise ValueError("samples are %d bytes, this decoder expects %d" % (sample_size, SAMPLE.size))
+    if len(frame) != HEADER.size + count * SAMPLE.size:
+        raise ValueError("frame of %d bytes does not hold %d samples" % (len(frame), count))
+
+    samples = []
+    for i, fields in enumerate(SAMPLE.iter_unpack(frame[HEADER.size:])):
+        t_us, actual, raw, command, state, flags, brake, profile, step = fields
+        samples.append({
+            "seq": first_seq + i,
+            "t_us": t_us,
+            "actual": actual / 65536.0,
+            "raw": raw / 65536.0,
+            "command": command / 65536.0,
+            "state": state,
+            "flags": flags,
+            "brake": brake / 1000.0,
+            "profile": profile,
+            "step": step,
+        })
+    return first_seq, lost, samples
+
+
+def event_name(flags):
+    """Name what a sample records, as in the event column of /log.csv."""
+    if flags & COMMAND:
+        return "command+transition" if flags & TRANSITION else "command"
+    return "transition" if flags & TRANSITION else "speed"
+
+
+def percentile(values, pct):
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(round(pct / 100.0 * (len(values) - 1))))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--host", default="192.168.5.1", help="address of the ESP32")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--seconds", type=float, default=10.0, help="how long to measure")
+    parser.add_argument("--interval", type=float, default=0.1, help="seconds between polls")
+    parser.add_argument("--csv", help="file to write the decoded samples to")
+    args = parser.parse_args()
+
+    out = open(args.csv, "w") if args.csv else None
+    if out:
+        out.write("seq,t_us,actual_rpm,raw_rpm,command_rpm,state,mode,brake,event,profile,step\n")
+
+    conn = http.client.HTTPConnection(args.host, args.port, timeout=5)
+    since = None
+    samples = 0
+    lost = 0
+    requests = 0
+    wire_bytes = 0
+    round_trip_ms = []
+    start = time.monotonic()
+
+    while time.monotonic() - start < args.seconds:
+        path = "/telemetry" if since is None else "/telemetry?since=%d" % since
+        sent = time.monotonic()
+        conn.request("GET", path)
+        response = conn.getresponse()
+        frame = response.read()
+        round_trip_ms.append((time.monotonic() - sent) * 1000.0)
+        if response.status != 200:
+            raise SystemExit("%s replied %d %s" % (path, response.status, response.reason))
+
+        first_seq, frame_lost, decoded = decode_frame(frame)
+        requests += 1
+        wire_bytes += len(frame)
+        samples += len(decoded)
+        lost += frame_lost
+        since = first_seq + len(decoded)
+        if out:
+            for s in decoded:
+                out.write("%d,%d,%.3f,%.3f,%.3f,%s,%s,%.3f,%s,%d,%d\n" % (
+                    s["seq"], s["t_us"], s["actual"], s["raw"], s["command"],
+                    STATES[s["state"]] if s["state"] < len(STATES) else "?",
+                    "torque" if s["flags"] & TORQUE else "speed", s["brake"], event_name(s["flags"]),
+                    s["profile"], s["step"]))
+
+        # a full frame means more are waiting, so ask again straight away
+        if len(decoded) < FRAME_MAX:
+            time.sleep(args.interval)
+
+    elapsed = time.monotonic() - start
+    conn.close()
+    if out:
+        out.close()
+
+    print("%.1f s: %d samples (%.1f/s) in %d requests, %d lost"
+          % (elapsed, samples, samples / elapsed, requests, lost))
+    print("%.1f bytes per sample on the wire, %.1f kB/s"
+          % (wire_bytes / max(samples, 1), wire_bytes / elapsed / 1000.0))
+    print("round trip: median %.1f ms, p99 %.1f ms, max %.1f ms"
+          % (percentile(round_trip_ms, 50), percentile(round_trip_ms, 99), max(round_trip_ms or [0.0])))
+
+
+if __name__ == "__main__":
+    main()